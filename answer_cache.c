@@ -0,0 +1,201 @@
+/**
+ * $File: answer_cache.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      answer_cache.c
+ *
+ *  @brief     Direct-mapped result cache. See answer_cache.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "answer_cache.h"
+#include "calculate_answer.h"
+#include "ram_funcs.h"
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+AnswerCacheStats_t answer_cache_stats;
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+#if (ANSWER_CACHE_ENTRIES & (ANSWER_CACHE_ENTRIES - 1)) != 0
+#error "ANSWER_CACHE_ENTRIES must be a power of two"
+#endif
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One cached line. A length of 0 marks an empty entry, as empty input is never cached. */
+typedef struct
+{
+    double   answer;
+    uint32_t hash;
+    uint8_t  length;
+    uint8_t  error_ref_no;
+    char     key[ANSWER_CACHE_KEY_SIZE];
+} AnswerCacheEntry_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+#if ANSWER_CACHE_ENTRIES > 0
+static RAMFUNC_ENGINE bool keys_match(const char *p_a, const char *p_b, size_t length);
+#endif
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+#if ANSWER_CACHE_ENTRIES > 0
+static AnswerCacheEntry_t entries[ANSWER_CACHE_ENTRIES];
+#endif
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Calculate the answer to an input string, reusing an earlier result if the
+ * same string has been seen recently. Gives exactly what CalculateAnswer() would.
+ * @param   [in] p_input_buffer The input string.
+ * @param   [in] input_buffer_size The size of the buffer holding it.
+ * @param   [out] p_error_ref_no The error code, 0 if there is no error.
+ * @return  The answer.
+ **/
+RAMFUNC_ENGINE double
+CalculateAnswerCached(char *p_input_buffer, uint8_t input_buffer_size, uint8_t *p_error_ref_no)
+{
+#if ANSWER_CACHE_ENTRIES > 0
+    AnswerCacheEntry_t *p_entry;
+    uint32_t            hash;
+    size_t              length = 0;
+    double              answer;
+
+    while ((length < input_buffer_size) && (length < ANSWER_CACHE_KEY_SIZE) && (p_input_buffer[length] != '\0'))
+    {
+        length++;
+    }
+
+    if ((0u == length) || (length >= input_buffer_size) || (length >= ANSWER_CACHE_KEY_SIZE))
+    {
+        answer_cache_stats.bypasses++;
+        return CalculateAnswer(p_input_buffer, input_buffer_size, p_error_ref_no);
+    }
+
+    hash = answer_cache_hash(p_input_buffer, length);
+    p_entry = &entries[hash & (ANSWER_CACHE_ENTRIES - 1u)];
+
+    if ((p_entry->hash == hash) && (p_entry->length == length) && keys_match(p_entry->key, p_input_buffer, length))
+    {
+        answer_cache_stats.hits++;
+        *p_error_ref_no = p_entry->error_ref_no;
+        return p_entry->answer;
+    }
+
+    answer_cache_stats.misses++;
+    answer = CalculateAnswer(p_input_buffer, input_buffer_size, p_error_ref_no);
+
+    p_entry->answer = answer;
+    p_entry->hash = hash;
+    p_entry->length = (uint8_t)length;
+    p_entry->error_ref_no = *p_error_ref_no;
+    for (size_t index = 0; index < length; index++)
+    {
+        p_entry->key[index] = p_input_buffer[index];
+    }
+
+    return answer;
+#else
+    answer_cache_stats.bypasses++;
+    return CalculateAnswer(p_input_buffer, input_buffer_size, p_error_ref_no);
+#endif
+}
+
+/**
+ * @brief   Hash a key with 32-bit FNV-1a.
+ * One XOR and one multiply per character. FNV leaves the low bits of short, similar
+ * keys poorly mixed, so the high half is folded into them at the end and the low bits
+ * can index a power-of-two table directly.
+ * @param   [in] p_key The characters of the key.
+ * @param   [in] length The number of characters.
+ * @return  The hash.
+ **/
+RAMFUNC_ENGINE uint32_t
+answer_cache_hash(const char *p_key, size_t length)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        hash ^= (uint8_t)p_key[index];
+        hash *= FNV_PRIME;
+    }
+
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * @brief   Empty the cache and clear its counters.
+ * @param   None.
+ * @return  None.
+ **/
+void
+answer_cache_reset(void)
+{
+#if ANSWER_CACHE_ENTRIES > 0
+    for (size_t index = 0; index < ANSWER_CACHE_ENTRIES; index++)
+    {
+        entries[index].length = 0;
+    }
+#endif
+    answer_cache_stats.hits = 0;
+    answer_cache_stats.misses = 0;
+    answer_cache_stats.bypasses = 0;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+#if ANSWER_CACHE_ENTRIES > 0
+/**
+ * @brief   Compare two keys of the same length.
+ * @param   [in] p_a The first key.
+ * @param   [in] p_b The second key.
+ * @param   [in] length The number of characters to compare.
+ * @return  True if every character matches.
+ **/
+static RAMFUNC_ENGINE bool
+keys_match(const char *p_a, const char *p_b, size_t length)
+{
+    for (size_t index = 0; index < length; index++)
+    {
+        if (p_a[index] != p_b[index])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
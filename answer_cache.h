@@ -0,0 +1,74 @@
+/**
+ * $File: answer_cache.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      answer_cache.h
+ *
+ *  @brief     A small direct-mapped cache of results in front of CalculateAnswer().
+ *
+ *             Operators re-enter the same expressions, so each entry keeps a whole input
+ *             line with its answer and error code. An input is looked up by the FNV-1a hash
+ *             of its characters and only counts as a hit when the stored line matches it
+ *             exactly, so a hash collision costs a recalculation and never a wrong answer.
+ *             The key is the input as typed: spaces and other characters the engine rejects
+ *             are part of it, because stripping them would turn an error into an answer.
+ *
+ *             Inputs with no null within the buffer are passed straight to the engine, as
+ *             their result depends on the buffer size. The counters live in
+ *             answer_cache_stats so they can be read from a memory dump.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#ifndef ANSWER_CACHE_ENTRIES
+#define ANSWER_CACHE_ENTRIES 16 //!< Entries in the cache, a power of two. 0 disables it.
+#endif
+#define ANSWER_CACHE_KEY_SIZE 17 //!< Longest cached input plus its null, one display line.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* What the cache has done since it was last reset. */
+typedef struct
+{
+    uint32_t hits;     /* Answered from the cache. */
+    uint32_t misses;   /* Calculated and stored. */
+    uint32_t bypasses; /* Calculated without touching the cache. */
+} AnswerCacheStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+double   CalculateAnswerCached(char *p_input_buffer, uint8_t input_buffer_size, uint8_t *p_error_ref_no);
+uint32_t answer_cache_hash(const char *p_key, size_t length);
+void     answer_cache_reset(void);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+extern AnswerCacheStats_t answer_cache_stats;
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,439 @@
+/**
+ * $File: answer_cache_lru.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      answer_cache_lru.c
+ *
+ *  @brief     Sharded LRU result cache (host only). See answer_cache_lru.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "answer_cache_lru.h"
+#include "answer_cache.h"
+#include "calculate_answer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define NIL        UINT32_MAX //!< End of a list or chain.
+#define LINE_BYTES 64         //!< Shards are kept on separate cache lines.
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One cached line, on its shard's recency list and in one bucket chain. */
+typedef struct
+{
+    double   answer;
+    uint32_t hash;
+    uint32_t prev;  /* Towards the most recently used. */
+    uint32_t next;  /* Towards the least recently used. */
+    uint32_t chain; /* Next entry in the same bucket. */
+    uint8_t  length;
+    uint8_t  error_ref_no;
+    char     key[ANSWER_CACHE_KEY_SIZE];
+} LruEntry_t;
+
+/* One shard: a fixed pool of entries, a bucket table and a recency list. */
+typedef struct
+{
+    _Alignas(LINE_BYTES) pthread_mutex_t lock;
+    LruEntry_t *p_entries;
+    uint32_t   *p_buckets;
+    uint32_t    capacity;
+    uint32_t    bucket_mask;
+    uint32_t    n_used;
+    uint32_t    head; /* Most recently used. */
+    uint32_t    tail; /* Least recently used, the next to be evicted. */
+    uint64_t    hits;
+    uint64_t    misses;
+    uint64_t    evictions;
+} LruShard_t;
+
+struct AnswerCacheLru
+{
+    LruShard_t *p_shards;
+    uint32_t    n_shards;
+    unsigned    shard_shift; /* Shift of the hash that leaves the shard number. */
+    uint64_t    bypasses;    /* Only updated atomically. */
+};
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static uint32_t round_up_power_of_two(size_t value);
+static uint32_t find_entry(const LruShard_t *p_shard, uint32_t hash, const char *p_key, size_t length);
+static void     unlink_entry(LruShard_t *p_shard, uint32_t index);
+static void     push_front(LruShard_t *p_shard, uint32_t index);
+static void     remove_from_bucket(LruShard_t *p_shard, uint32_t index);
+static void     insert_entry(LruShard_t *p_shard, uint32_t hash, const char *p_key, size_t length, double answer,
+                             uint8_t error_ref_no);
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Create a cache.
+ * @param   [in] capacity The total number of lines to hold, shared between the shards.
+ * @param   [in] n_shards The number of shards, rounded up to a power of two. Use a few
+ * per thread that will share the cache.
+ * @return  The cache, or NULL if it could not be allocated.
+ **/
+AnswerCacheLru_t *
+answer_cache_lru_create(size_t capacity, size_t n_shards)
+{
+    AnswerCacheLru_t *p_cache;
+    uint32_t          per_shard;
+    unsigned          shard_bits = 0;
+
+    if ((0u == n_shards) || (n_shards > 4096u) || (0u == capacity) || (capacity > UINT32_MAX / 4u))
+    {
+        return NULL;
+    }
+
+    p_cache = calloc(1, sizeof(*p_cache));
+    if (NULL == p_cache)
+    {
+        return NULL;
+    }
+
+    p_cache->n_shards = round_up_power_of_two(n_shards);
+    while ((1u << shard_bits) < p_cache->n_shards)
+    {
+        shard_bits++;
+    }
+    p_cache->shard_shift = 32u - shard_bits;
+    per_shard = (uint32_t)((capacity + p_cache->n_shards - 1u) / p_cache->n_shards);
+
+    p_cache->p_shards = aligned_alloc(LINE_BYTES, p_cache->n_shards * sizeof(LruShard_t));
+    if (NULL == p_cache->p_shards)
+    {
+        free(p_cache);
+        return NULL;
+    }
+
+    for (uint32_t shard = 0; shard < p_cache->n_shards; shard++)
+    {
+        LruShard_t *p_shard = &p_cache->p_shards[shard];
+        uint32_t    n_buckets = round_up_power_of_two((size_t)per_shard * 2u);
+
+        memset(p_shard, 0, sizeof(*p_shard));
+        pthread_mutex_init(&p_shard->lock, NULL);
+        p_shard->capacity = per_shard;
+        p_shard->bucket_mask = n_buckets - 1u;
+        p_shard->head = NIL;
+        p_shard->tail = NIL;
+        p_shard->p_entries = malloc(per_shard * sizeof(LruEntry_t));
+        p_shard->p_buckets = malloc(n_buckets * sizeof(uint32_t));
+        if ((NULL == p_shard->p_entries) || (NULL == p_shard->p_buckets))
+        {
+            p_cache->n_shards = shard + 1u;
+            answer_cache_lru_destroy(p_cache);
+            return NULL;
+        }
+        for (uint32_t bucket = 0; bucket < n_buckets; bucket++)
+        {
+            p_shard->p_buckets[bucket] = NIL;
+        }
+    }
+
+    return p_cache;
+}
+
+/**
+ * @brief   Free a cache.
+ * @param   [in] p_cache The cache, or NULL.
+ * @return  None.
+ **/
+void
+answer_cache_lru_destroy(AnswerCacheLru_t *p_cache)
+{
+    if (NULL == p_cache)
+    {
+        return;
+    }
+
+    for (uint32_t shard = 0; shard < p_cache->n_shards; shard++)
+    {
+        pthread_mutex_destroy(&p_cache->p_shards[shard].lock);
+        free(p_cache->p_shards[shard].p_entries);
+        free(p_cache->p_shards[shard].p_buckets);
+    }
+    free(p_cache->p_shards);
+    free(p_cache);
+}
+
+/**
+ * @brief   Calculate the answer to an expression, reusing an earlier result if the same
+ * line is in the cache. Gives exactly what CalculateAnswerSpan() would. Thread safe.
+ * @param   [in] p_cache The cache.
+ * @param   [in] p_expression The expression, which need not be null terminated.
+ * @param   [in] length The number of characters in the expression.
+ * @param   [out] p_error_ref_no The error code, 0 if there is no error.
+ * @return  The answer.
+ **/
+double
+answer_cache_lru_calculate(AnswerCacheLru_t *p_cache, const char *p_expression, size_t length,
+                           uint8_t *p_error_ref_no)
+{
+    LruShard_t *p_shard;
+    uint32_t    hash;
+    uint32_t    index;
+    double      answer;
+
+    if ((0u == length) || (length >= ANSWER_CACHE_KEY_SIZE))
+    {
+        __atomic_fetch_add(&p_cache->bypasses, 1u, __ATOMIC_RELAXED);
+        return CalculateAnswerSpan(p_expression, length, p_error_ref_no);
+    }
+
+    hash = answer_cache_hash(p_expression, length);
+    p_shard = &p_cache->p_shards[(p_cache->n_shards > 1u) ? (hash >> p_cache->shard_shift) : 0u];
+
+    pthread_mutex_lock(&p_shard->lock);
+    index = find_entry(p_shard, hash, p_expression, length);
+    if (index != NIL)
+    {
+        const LruEntry_t *p_entry = &p_shard->p_entries[index];
+
+        if (p_shard->head != index)
+        {
+            unlink_entry(p_shard, index);
+            push_front(p_shard, index);
+        }
+        p_shard->hits++;
+        answer = p_entry->answer;
+        *p_error_ref_no = p_entry->error_ref_no;
+        pthread_mutex_unlock(&p_shard->lock);
+        return answer;
+    }
+    p_shard->misses++;
+    pthread_mutex_unlock(&p_shard->lock);
+
+    answer = CalculateAnswerSpan(p_expression, length, p_error_ref_no);
+
+    pthread_mutex_lock(&p_shard->lock);
+    if (NIL == find_entry(p_shard, hash, p_expression, length)) // Another thread may have got there first
+    {
+        insert_entry(p_shard, hash, p_expression, length, answer, *p_error_ref_no);
+    }
+    pthread_mutex_unlock(&p_shard->lock);
+
+    return answer;
+}
+
+/**
+ * @brief   Add up the counters of every shard.
+ * @param   [in] p_cache The cache.
+ * @param   [out] p_stats The totals.
+ * @return  None.
+ **/
+void
+answer_cache_lru_stats(AnswerCacheLru_t *p_cache, AnswerCacheLruStats_t *p_stats)
+{
+    memset(p_stats, 0, sizeof(*p_stats));
+    for (uint32_t shard = 0; shard < p_cache->n_shards; shard++)
+    {
+        LruShard_t *p_shard = &p_cache->p_shards[shard];
+
+        pthread_mutex_lock(&p_shard->lock);
+        p_stats->hits += p_shard->hits;
+        p_stats->misses += p_shard->misses;
+        p_stats->evictions += p_shard->evictions;
+        pthread_mutex_unlock(&p_shard->lock);
+    }
+    p_stats->bypasses = __atomic_load_n(&p_cache->bypasses, __ATOMIC_RELAXED);
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Round up to a power of two.
+ * @param   [in] value The value, at least 1.
+ * @return  The smallest power of two not below it.
+ **/
+static uint32_t
+round_up_power_of_two(size_t value)
+{
+    uint32_t result = 1;
+
+    while (result < value)
+    {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+/**
+ * @brief   Look a key up in a shard. The shard must be locked.
+ * @param   [in] p_shard The shard.
+ * @param   [in] hash The hash of the key.
+ * @param   [in] p_key The key.
+ * @param   [in] length The length of the key.
+ * @return  The index of the entry, or NIL.
+ **/
+static uint32_t
+find_entry(const LruShard_t *p_shard, uint32_t hash, const char *p_key, size_t length)
+{
+    uint32_t index = p_shard->p_buckets[hash & p_shard->bucket_mask];
+
+    while (index != NIL)
+    {
+        const LruEntry_t *p_entry = &p_shard->p_entries[index];
+
+        if ((p_entry->hash == hash) && (p_entry->length == length) && (0 == memcmp(p_entry->key, p_key, length)))
+        {
+            return index;
+        }
+        index = p_entry->chain;
+    }
+
+    return NIL;
+}
+
+/**
+ * @brief   Take an entry off the recency list.
+ * @param   [in] p_shard The shard.
+ * @param   [in] index The entry.
+ * @return  None.
+ **/
+static void
+unlink_entry(LruShard_t *p_shard, uint32_t index)
+{
+    LruEntry_t *p_entry = &p_shard->p_entries[index];
+
+    if (p_entry->prev != NIL)
+    {
+        p_shard->p_entries[p_entry->prev].next = p_entry->next;
+    }
+    else
+    {
+        p_shard->head = p_entry->next;
+    }
+
+    if (p_entry->next != NIL)
+    {
+        p_shard->p_entries[p_entry->next].prev = p_entry->prev;
+    }
+    else
+    {
+        p_shard->tail = p_entry->prev;
+    }
+}
+
+/**
+ * @brief   Put an entry at the most recently used end of the recency list.
+ * @param   [in] p_shard The shard.
+ * @param   [in] index The entry, which must not be on the list.
+ * @return  None.
+ **/
+static void
+push_front(LruShard_t *p_shard, uint32_t index)
+{
+    LruEntry_t *p_entry = &p_shard->p_entries[index];
+
+    p_entry->prev = NIL;
+    p_entry->next = p_shard->head;
+    if (p_shard->head != NIL)
+    {
+        p_shard->p_entries[p_shard->head].prev = index;
+    }
+    else
+    {
+        p_shard->tail = index;
+    }
+    p_shard->head = index;
+}
+
+/**
+ * @brief   Take an entry out of its bucket chain.
+ * @param   [in] p_shard The shard.
+ * @param   [in] index The entry.
+ * @return  None.
+ **/
+static void
+remove_from_bucket(LruShard_t *p_shard, uint32_t index)
+{
+    uint32_t *p_link = &p_shard->p_buckets[p_shard->p_entries[index].hash & p_shard->bucket_mask];
+
+    while (*p_link != index)
+    {
+        p_link = &p_shard->p_entries[*p_link].chain;
+    }
+    *p_link = p_shard->p_entries[index].chain;
+}
+
+/**
+ * @brief   Store a result, evicting the least recently used entry if the shard is full.
+ * @param   [in] p_shard The shard, locked.
+ * @param   [in] hash The hash of the key.
+ * @param   [in] p_key The key.
+ * @param   [in] length The length of the key, below ANSWER_CACHE_KEY_SIZE.
+ * @param   [in] answer The answer.
+ * @param   [in] error_ref_no The error code.
+ * @return  None.
+ **/
+static void
+insert_entry(LruShard_t *p_shard, uint32_t hash, const char *p_key, size_t length, double answer,
+             uint8_t error_ref_no)
+{
+    LruEntry_t *p_entry;
+    uint32_t    index;
+    uint32_t   *p_bucket;
+
+    if (p_shard->n_used < p_shard->capacity)
+    {
+        index = p_shard->n_used++;
+    }
+    else
+    {
+        index = p_shard->tail;
+        unlink_entry(p_shard, index);
+        remove_from_bucket(p_shard, index);
+        p_shard->evictions++;
+    }
+
+    p_entry = &p_shard->p_entries[index];
+    p_entry->answer = answer;
+    p_entry->hash = hash;
+    p_entry->length = (uint8_t)length;
+    p_entry->error_ref_no = error_ref_no;
+    memcpy(p_entry->key, p_key, length);
+
+    p_bucket = &p_shard->p_buckets[hash & p_shard->bucket_mask];
+    p_entry->chain = *p_bucket;
+    *p_bucket = index;
+    push_front(p_shard, index);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,73 @@
+/**
+ * $File: answer_cache_lru.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      answer_cache_lru.h
+ *
+ *  @brief     A sharded least-recently-used cache of results for the host tools
+ *             (calc_eval and calc_daemon), in front of CalculateAnswerSpan().
+ *
+ *             Keys are hashed with answer_cache_hash(); the top bits of the hash pick a
+ *             shard and the low bits a bucket within it, and a hit needs the whole stored
+ *             line to match. Each shard has its own lock, its own fixed pool of entries and
+ *             its own recency list, so threads only contend when they hit the same shard.
+ *             Answers are calculated outside the lock. Lines longer than
+ *             ANSWER_CACHE_KEY_SIZE - 1 are not cached.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#if defined(__arm__)
+#error "answer_cache_lru.c is for the host build only"
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+typedef struct AnswerCacheLru AnswerCacheLru_t;
+
+/* Totals over all shards. */
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bypasses;
+    uint64_t evictions;
+} AnswerCacheLruStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+AnswerCacheLru_t *answer_cache_lru_create(size_t capacity, size_t n_shards);
+void              answer_cache_lru_destroy(AnswerCacheLru_t *p_cache);
+double            answer_cache_lru_calculate(AnswerCacheLru_t *p_cache, const char *p_expression, size_t length,
+                                             uint8_t *p_error_ref_no);
+void              answer_cache_lru_stats(AnswerCacheLru_t *p_cache, AnswerCacheLruStats_t *p_stats);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
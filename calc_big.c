@@ -0,0 +1,1247 @@
+/**
+ * $File: calc_big.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_big.c
+ *
+ *  @brief     Exact evaluation in arena-allocated decimal numbers. See calc_big.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_big.h"
+#include "calculate_answer.h"
+#include <string.h>
+
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define LIMB_BASE   1000000000u //!< Each limb holds 9 decimal digits.
+#define LIMB_DIGITS 9
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* A number: (-1 if negative) x coefficient x 10^exponent. The coefficient's limbs are in
+   the arena, least significant first, with no zero limb at the top (zero has none). */
+typedef struct
+{
+    uint32_t *p_limb;
+    size_t    n_limbs;
+    int32_t   exponent;
+    bool      b_negative;
+} BigNumber_t;
+
+/* The fold of calc_stream.c, one number per level. Each level is in the arena just above
+   the one before it (an empty level has no limbs, and starts where the one before ends),
+   and the factor being read is above them all. */
+typedef struct
+{
+    BigNumber_t answer;            /* The runs before the last - sign, subtracted. */
+    BigNumber_t run;               /* The terms since the last - sign, added. */
+    BigNumber_t product;           /* The term's complete quotient runs, multiplied. */
+    BigNumber_t quotient;          /* The quotient run the factor is divided into. */
+    BigNumber_t factor;            /* The last number, with its E. */
+    char        factor_operator;   /* / before the factor (the quotient goes on), or not. */
+    char        term_sign;         /* + or - before the term, or '\0' for the first. */
+    char        previous_operator; /* The last operator: after an E the number is a power. */
+    bool        b_first_product;   /* No quotient run of the term is complete. */
+    bool        b_first_run;       /* No - sign yet. */
+} Fold_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static uint8_t   token_error(const char *p_expression, size_t length);
+static void      evaluate(CalcBig_t *p_big, const char *p_expression, size_t length, BigNumber_t *p_answer);
+static void      fold_operator(CalcBig_t *p_big, Fold_t *p_fold, char operator);
+static void      read_number(CalcBig_t *p_big, const char *p_text, size_t length, BigNumber_t *p_number);
+static int64_t   read_power(const char *p_text, size_t length);
+static void      settle(CalcBig_t *p_big, BigNumber_t *p_level, uint32_t *p_start, BigNumber_t value);
+static void      empty_level(BigNumber_t *p_level, const BigNumber_t *p_below);
+static uint32_t *level_end(const BigNumber_t *p_level);
+static void      set_exponent(CalcBig_t *p_big, BigNumber_t *p_number, int64_t exponent);
+static void      add_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b, bool b_subtract,
+                             BigNumber_t *p_sum);
+static void      multiply_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b,
+                                  BigNumber_t *p_product);
+static void      divide_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b,
+                                BigNumber_t *p_quotient);
+static void      scale_up(CalcBig_t *p_big, BigNumber_t *p_number, uint64_t digits);
+static uint32_t *allocate(CalcBig_t *p_big, size_t n_limbs);
+static size_t    trim(const uint32_t *p_limb, size_t n_limbs);
+static int       compare_limbs(const uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b);
+static void      add_limbs(uint32_t *p_sum, const uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b);
+static void      add_limbs_in_place(uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b);
+static void      subtract_limbs(uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b);
+static uint32_t  multiply_small(uint32_t *p_product, const uint32_t *p_a, size_t n_a, uint32_t factor);
+static bool      multiply_limbs(CalcBig_t *p_big, uint32_t *p_product, const uint32_t *p_a, size_t n_a,
+                                const uint32_t *p_b, size_t n_b);
+static void      multiply_schoolbook(uint32_t *p_product, const uint32_t *p_a, size_t n_a, const uint32_t *p_b,
+                                     size_t n_b);
+static bool      divide_limbs(CalcBig_t *p_big, uint32_t *p_quotient, const uint32_t *p_u, size_t n_u,
+                              const uint32_t *p_v, size_t n_v, bool *p_b_remainder);
+static bool      format_number(const BigNumber_t *p_number, char *p_text, size_t text_size);
+static char     *write_digits(char *p_text, const uint32_t *p_limb, size_t n_limbs);
+static bool      is_operator(char character);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const uint32_t powers_of_ten[LIMB_DIGITS] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u,
+};
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Give an exact evaluator its arena and its scale.
+ * @param   [out] p_big The evaluator.
+ * @param   [in] p_memory The arena: every number of an evaluation is kept here.
+ * @param   [in] size Its size in bytes.
+ * @param   [in] scale The digits a quotient keeps after the point (at most
+ * CALC_BIG_MAX_EXPONENT).
+ * @return  None.
+ **/
+void
+calc_big_init(CalcBig_t *p_big, void *p_memory, size_t size, uint32_t scale)
+{
+    size_t misalignment = (size_t)((uintptr_t)p_memory % sizeof(uint32_t));
+    size_t skip = (0u == misalignment) ? 0u : sizeof(uint32_t) - misalignment;
+
+    p_big->p_memory = (uint8_t *)p_memory + ((size > skip) ? skip : 0u);
+    p_big->size = (size > skip) ? size - skip : 0u;
+    p_big->used = 0;
+    p_big->peak = 0;
+    p_big->scale = (scale > CALC_BIG_MAX_EXPONENT) ? CALC_BIG_MAX_EXPONENT : scale;
+    p_big->b_exact = true;
+    p_big->status = CALC_BIG_OK;
+}
+
+/**
+ * @brief   Check an expression and work out its answer exactly.
+ * @param   [in,out] p_big The evaluator (its arena is empty again on return).
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [out] p_answer The answer in decimal, e.g. "-12.5" (no exponent and no trailing
+ * zeros after the point), or "" if there is none.
+ * @param   [in] answer_size The room for it, with its null.
+ * @param   [out] p_error_ref_no The engine's error number for the expression, or 0.
+ * @return  CALC_BIG_OK, or why there is no answer.
+ **/
+CalcBigStatus_t
+calc_big_evaluate(CalcBig_t *p_big, const char *p_expression, size_t length, char *p_answer, size_t answer_size,
+                  uint8_t *p_error_ref_no)
+{
+    BigNumber_t answer;
+
+    p_big->used = 0;
+    p_big->peak = 0;
+    p_big->b_exact = true;
+    p_big->status = CALC_BIG_OK;
+    if (answer_size > 0u)
+    {
+        p_answer[0] = '\0';
+    }
+
+    /* The engine's order: the character checks, then the tokens. */
+    CheckExpressionSyntax(p_expression, length, p_error_ref_no);
+    if (0u == *p_error_ref_no)
+    {
+        *p_error_ref_no = token_error(p_expression, length);
+    }
+    if (0u != *p_error_ref_no)
+    {
+        return CALC_BIG_SYNTAX_ERROR;
+    }
+
+    evaluate(p_big, p_expression, length, &answer);
+    if ((CALC_BIG_OK == p_big->status) && !format_number(&answer, p_answer, answer_size))
+    {
+        p_big->status = CALC_BIG_TOO_LARGE;
+    }
+
+    p_big->used = 0; // Nothing outlives the evaluation
+    return p_big->status;
+}
+
+/**
+ * @brief   Whether the last answer is exact.
+ * @param   [in] p_big The evaluator.
+ * @return  false if a quotient was cut at the scale.
+ **/
+bool
+calc_big_exact(const CalcBig_t *p_big)
+{
+    return p_big->b_exact;
+}
+
+/**
+ * @brief   The most of the arena the last evaluation used at once.
+ * @param   [in] p_big The evaluator.
+ * @return  The bytes.
+ **/
+size_t
+calc_big_peak(const CalcBig_t *p_big)
+{
+    return p_big->peak;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   The token errors, as identify_tokens() and calc_stream.c find them: the first 6
+ * (a - where a number must be) or 7 (a number of MAX_NUMBER_STRING_LENGTH or more
+ * characters), else 10 (two E operators in a row).
+ * @param   [in] p_expression The expression, which passed the character checks.
+ * @param   [in] length The number of characters.
+ * @return  The error number, or 0.
+ **/
+static uint8_t
+token_error(const char *p_expression, size_t length)
+{
+    bool    b_in_number = false;
+    bool    b_adjacent_e = false;
+    size_t  number_length = 0;
+    char    previous_operator = '\0';
+
+    for (size_t index = 0; index < length; index++)
+    {
+        char character = p_expression[index];
+
+        if (is_operator(character))
+        {
+            if (!b_in_number)
+            {
+                return 6; // "Invalid number"
+            }
+            b_in_number = false;
+            b_adjacent_e = b_adjacent_e || (('E' == character) && ('E' == previous_operator));
+            previous_operator = character;
+        }
+        else if (!b_in_number)
+        {
+            b_in_number = true;
+            number_length = 1;
+        }
+        else if (number_length >= (MAX_NUMBER_STRING_LENGTH - 1))
+        {
+            return 7;
+        }
+        else
+        {
+            number_length++;
+        }
+    }
+
+    return b_adjacent_e ? 10 : 0; // "Two adjacent" "E operators"
+}
+
+/**
+ * @brief   Evaluate a checked expression.
+ * @param   [in,out] p_big The evaluator, its arena empty.
+ * @param   [in] p_expression The expression, free of errors.
+ * @param   [in] length The number of characters.
+ * @param   [out] p_answer The answer, in the arena (if the status is still CALC_BIG_OK).
+ * @return  None.
+ **/
+static void
+evaluate(CalcBig_t *p_big, const char *p_expression, size_t length, BigNumber_t *p_answer)
+{
+    const BigNumber_t empty = {(uint32_t *)p_big->p_memory, 0, 0, false};
+    Fold_t            fold = {empty, empty, empty, empty, empty, '\0', '\0', '\0', true, true};
+    size_t            number_start = 0;
+
+    for (size_t index = 0; (index <= length) && (CALC_BIG_OK == p_big->status); index++)
+    {
+        char character = (index < length) ? p_expression[index] : '\0';
+
+        if ((index < length) && !is_operator(character))
+        {
+            continue;
+        }
+
+        if ('E' == fold.previous_operator)
+        {
+            /* The number after an E only moves the factor's point. */
+            if (0u != fold.factor.n_limbs)
+            {
+                set_exponent(p_big, &fold.factor,
+                             fold.factor.exponent + read_power(&p_expression[number_start], index - number_start));
+            }
+        }
+        else
+        {
+            read_number(p_big, &p_expression[number_start], index - number_start, &fold.factor);
+        }
+        if (CALC_BIG_OK == p_big->status)
+        {
+            fold_operator(p_big, &fold, character);
+        }
+        number_start = index + 1u;
+    }
+
+    if (fold.b_first_run)
+    {
+        *p_answer = fold.run;
+    }
+    else if (CALC_BIG_OK == p_big->status)
+    {
+        add_numbers(p_big, &fold.answer, &fold.run, true, p_answer);
+    }
+}
+
+/**
+ * @brief   Fold the factor into the levels the operator after it ends, as calc_stream.c
+ * does, except that a quotient run is multiplied into the product as soon as it ends.
+ * @param   [in,out] p_big The evaluator.
+ * @param   [in,out] p_fold The fold.
+ * @param   [in] operator The operator after the factor, or '\0' at the end.
+ * @return  None.
+ **/
+static void
+fold_operator(CalcBig_t *p_big, Fold_t *p_fold, char operator)
+{
+    BigNumber_t value;
+
+    if ('E' == operator)
+    {
+        p_fold->previous_operator = operator; // The factor is the base of the next number
+        return;
+    }
+    p_fold->previous_operator = operator;
+
+    if ('/' == p_fold->factor_operator)
+    {
+        divide_numbers(p_big, &p_fold->quotient, &p_fold->factor, &value);
+        if (CALC_BIG_OK != p_big->status)
+        {
+            return;
+        }
+        settle(p_big, &p_fold->quotient, p_fold->quotient.p_limb, value);
+    }
+    else
+    {
+        settle(p_big, &p_fold->quotient, level_end(&p_fold->product), p_fold->factor);
+    }
+    if ('/' == operator)
+    {
+        p_fold->factor_operator = operator;
+        return;
+    }
+
+    /* The quotient run is complete. */
+    if (p_fold->b_first_product)
+    {
+        settle(p_big, &p_fold->product, level_end(&p_fold->run), p_fold->quotient);
+    }
+    else
+    {
+        multiply_numbers(p_big, &p_fold->product, &p_fold->quotient, &value);
+        if (CALC_BIG_OK != p_big->status)
+        {
+            return;
+        }
+        settle(p_big, &p_fold->product, p_fold->product.p_limb, value);
+    }
+    empty_level(&p_fold->quotient, &p_fold->product);
+    p_fold->b_first_product = false;
+    p_fold->factor_operator = operator;
+    if ('x' == operator)
+    {
+        return;
+    }
+
+    /* So is the term, and - ends the run of terms. */
+    if ('+' == p_fold->term_sign)
+    {
+        add_numbers(p_big, &p_fold->run, &p_fold->product, false, &value);
+        if (CALC_BIG_OK != p_big->status)
+        {
+            return;
+        }
+        settle(p_big, &p_fold->run, p_fold->run.p_limb, value);
+    }
+    else
+    {
+        settle(p_big, &p_fold->run, level_end(&p_fold->answer), p_fold->product);
+    }
+    if ('-' == operator)
+    {
+        if (p_fold->b_first_run)
+        {
+            settle(p_big, &p_fold->answer, (uint32_t *)p_big->p_memory, p_fold->run);
+        }
+        else
+        {
+            add_numbers(p_big, &p_fold->answer, &p_fold->run, true, &value);
+            if (CALC_BIG_OK != p_big->status)
+            {
+                return;
+            }
+            settle(p_big, &p_fold->answer, p_fold->answer.p_limb, value);
+        }
+        empty_level(&p_fold->run, &p_fold->answer);
+        p_fold->b_first_run = false;
+    }
+    empty_level(&p_fold->product, &p_fold->run);
+    empty_level(&p_fold->quotient, &p_fold->product);
+    p_fold->term_sign = operator;
+    p_fold->b_first_product = true;
+}
+
+/**
+ * @brief   Read a number, as simple_atof() reads it: the digits after a second point are
+ * left out.
+ * @param   [in,out] p_big The evaluator (the number goes at the top of its arena).
+ * @param   [in] p_text The number's first character.
+ * @param   [in] length Its characters (fewer than MAX_NUMBER_STRING_LENGTH).
+ * @param   [out] p_number The number.
+ * @return  None.
+ **/
+static void
+read_number(CalcBig_t *p_big, const char *p_text, size_t length, BigNumber_t *p_number)
+{
+    uint8_t digits[MAX_NUMBER_STRING_LENGTH];
+    size_t  n_digits = 0;
+    int32_t n_fraction_digits = 0;
+    int     n_points = 0;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        if ('.' == p_text[index])
+        {
+            n_points++;
+        }
+        else if (n_points < 2)
+        {
+            digits[n_digits++] = (uint8_t)(p_text[index] - '0');
+            n_fraction_digits += n_points;
+        }
+    }
+
+    p_number->p_limb = allocate(p_big, (n_digits + LIMB_DIGITS - 1u) / LIMB_DIGITS);
+    if (NULL == p_number->p_limb)
+    {
+        return;
+    }
+    /* Nine digits to a limb, from the last digit up. */
+    for (size_t limb_no = 0; limb_no * LIMB_DIGITS < n_digits; limb_no++)
+    {
+        size_t   end = n_digits - limb_no * LIMB_DIGITS;
+        size_t   start = (end > LIMB_DIGITS) ? end - LIMB_DIGITS : 0u;
+        uint32_t limb = 0;
+
+        for (size_t digit_no = start; digit_no < end; digit_no++)
+        {
+            limb = limb * 10u + digits[digit_no];
+        }
+        p_number->p_limb[limb_no] = limb;
+    }
+    p_number->n_limbs = trim(p_number->p_limb, (n_digits + LIMB_DIGITS - 1u) / LIMB_DIGITS);
+    p_number->exponent = (0u == p_number->n_limbs) ? 0 : -n_fraction_digits;
+    p_number->b_negative = false;
+}
+
+/**
+ * @brief   Read the power of ten after an E (digits only, as error 11 allows no point).
+ * @param   [in] p_text The number's first character.
+ * @param   [in] length Its characters.
+ * @return  The power, or CALC_BIG_MAX_EXPONENT + 1 if it is larger than that.
+ **/
+static int64_t
+read_power(const char *p_text, size_t length)
+{
+    int64_t power = 0;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        power = power * 10 + (p_text[index] - '0');
+        if (power > CALC_BIG_MAX_EXPONENT)
+        {
+            return CALC_BIG_MAX_EXPONENT + 1;
+        }
+    }
+    return power;
+}
+
+/**
+ * @brief   Make a number a level of the fold: move its limbs down to where the level
+ * starts, over the values it was worked out from, and give the arena above back.
+ * @param   [in,out] p_big The evaluator.
+ * @param   [out] p_level The level.
+ * @param   [in] p_start Where the level starts (at or below the number's limbs).
+ * @param   [in] value The number.
+ * @return  None.
+ **/
+static void
+settle(CalcBig_t *p_big, BigNumber_t *p_level, uint32_t *p_start, BigNumber_t value)
+{
+    /* Zero limbs at the bottom only move the point. */
+    while ((value.n_limbs > 0u) && (0u == value.p_limb[0]))
+    {
+        value.p_limb++;
+        value.n_limbs--;
+        value.exponent += LIMB_DIGITS;
+    }
+    if (0u == value.n_limbs)
+    {
+        value.exponent = 0;
+        value.b_negative = false;
+    }
+
+    memmove(p_start, value.p_limb, value.n_limbs * sizeof(uint32_t));
+    value.p_limb = p_start;
+    *p_level = value;
+    p_big->used = (size_t)((uint8_t *)level_end(p_level) - p_big->p_memory);
+}
+
+/* Make a level zero, starting where the one below it ends. */
+static void
+empty_level(BigNumber_t *p_level, const BigNumber_t *p_below)
+{
+    p_level->p_limb = level_end(p_below);
+    p_level->n_limbs = 0;
+    p_level->exponent = 0;
+    p_level->b_negative = false;
+}
+
+/* Where the level above a level starts. */
+static uint32_t *
+level_end(const BigNumber_t *p_level)
+{
+    return p_level->p_limb + p_level->n_limbs;
+}
+
+/* Give a number a power of ten, if it is within CALC_BIG_MAX_EXPONENT. */
+static void
+set_exponent(CalcBig_t *p_big, BigNumber_t *p_number, int64_t exponent)
+{
+    if (0u == p_number->n_limbs)
+    {
+        p_number->exponent = 0;
+    }
+    else if ((exponent > CALC_BIG_MAX_EXPONENT) || (exponent < -CALC_BIG_MAX_EXPONENT))
+    {
+        p_big->status = CALC_BIG_TOO_LARGE;
+    }
+    else
+    {
+        p_number->exponent = (int32_t)exponent;
+    }
+}
+
+/**
+ * @brief   Add or subtract two numbers, lining up their points.
+ * @param   [in,out] p_big The evaluator.
+ * @param   [in] p_a The first number.
+ * @param   [in] p_b The second number.
+ * @param   [in] b_subtract true for a - b.
+ * @param   [out] p_sum The sum (which may be a or b itself, if the other is zero).
+ * @return  None.
+ **/
+static void
+add_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b, bool b_subtract, BigNumber_t *p_sum)
+{
+    BigNumber_t a = *p_a;
+    BigNumber_t b = *p_b;
+    size_t      n_sum;
+
+    b.b_negative = (b.b_negative != b_subtract) && (0u != b.n_limbs);
+    if ((0u == a.n_limbs) || (0u == b.n_limbs))
+    {
+        *p_sum = (0u == a.n_limbs) ? b : a;
+        return;
+    }
+
+    if (a.exponent > b.exponent)
+    {
+        scale_up(p_big, &a, (uint64_t)((int64_t)a.exponent - b.exponent));
+    }
+    else if (b.exponent > a.exponent)
+    {
+        scale_up(p_big, &b, (uint64_t)((int64_t)b.exponent - a.exponent));
+    }
+    if (CALC_BIG_OK != p_big->status)
+    {
+        return;
+    }
+    if (a.n_limbs < b.n_limbs)
+    {
+        BigNumber_t swap = a;
+
+        a = b;
+        b = swap;
+    }
+
+    n_sum = a.n_limbs + 1u;
+    p_sum->p_limb = allocate(p_big, n_sum);
+    if (NULL == p_sum->p_limb)
+    {
+        return;
+    }
+    p_sum->exponent = a.exponent;
+    if (a.b_negative == b.b_negative)
+    {
+        add_limbs(p_sum->p_limb, a.p_limb, a.n_limbs, b.p_limb, b.n_limbs);
+        p_sum->b_negative = a.b_negative;
+    }
+    else
+    {
+        /* The smaller magnitude from the larger, with the larger's sign. */
+        bool b_a_larger = (compare_limbs(a.p_limb, a.n_limbs, b.p_limb, b.n_limbs) >= 0);
+
+        memcpy(p_sum->p_limb, b_a_larger ? a.p_limb : b.p_limb, a.n_limbs * sizeof(uint32_t));
+        if (b_a_larger)
+        {
+            subtract_limbs(p_sum->p_limb, a.n_limbs, b.p_limb, b.n_limbs);
+        }
+        else
+        {
+            subtract_limbs(p_sum->p_limb, a.n_limbs, a.p_limb, a.n_limbs);
+        }
+        p_sum->p_limb[a.n_limbs] = 0;
+        p_sum->b_negative = b_a_larger ? a.b_negative : b.b_negative;
+    }
+    p_sum->n_limbs = trim(p_sum->p_limb, n_sum);
+    if (0u == p_sum->n_limbs)
+    {
+        p_sum->b_negative = false;
+    }
+}
+
+/**
+ * @brief   Multiply two numbers exactly.
+ * @param   [in,out] p_big The evaluator.
+ * @param   [in] p_a The first number.
+ * @param   [in] p_b The second number.
+ * @param   [out] p_product The product.
+ * @return  None.
+ **/
+static void
+multiply_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b, BigNumber_t *p_product)
+{
+    size_t n_product = p_a->n_limbs + p_b->n_limbs;
+
+    p_product->p_limb = allocate(p_big, n_product);
+    if (NULL == p_product->p_limb)
+    {
+        return;
+    }
+    p_product->n_limbs = 0;
+    p_product->b_negative = false;
+    if ((0u != p_a->n_limbs) && (0u != p_b->n_limbs) &&
+        multiply_limbs(p_big, p_product->p_limb, p_a->p_limb, p_a->n_limbs, p_b->p_limb, p_b->n_limbs))
+    {
+        p_product->n_limbs = trim(p_product->p_limb, n_product);
+        p_product->b_negative = (p_a->b_negative != p_b->b_negative);
+    }
+    set_exponent(p_big, p_product, (int64_t)p_a->exponent + p_b->exponent);
+}
+
+/**
+ * @brief   Divide two numbers, keeping the scale's digits after the point and cutting off
+ * the rest (toward zero).
+ * @param   [in,out] p_big The evaluator (b_exact is cleared if digits are cut off).
+ * @param   [in] p_a The dividend.
+ * @param   [in] p_b The divisor.
+ * @param   [out] p_quotient The quotient.
+ * @return  None.
+ **/
+static void
+divide_numbers(CalcBig_t *p_big, const BigNumber_t *p_a, const BigNumber_t *p_b, BigNumber_t *p_quotient)
+{
+    BigNumber_t dividend = *p_a;
+    BigNumber_t divisor = *p_b;
+    int64_t     shift = (int64_t)p_a->exponent - p_b->exponent + p_big->scale;
+    bool        b_remainder = false;
+    size_t      n_quotient;
+
+    if (0u == divisor.n_limbs)
+    {
+        p_big->status = CALC_BIG_DIVIDE_BY_ZERO;
+        return;
+    }
+
+    /* a / b to the scale is (a's coefficient x 10^shift) / b's coefficient. */
+    p_quotient->p_limb = (uint32_t *)(p_big->p_memory + p_big->used);
+    p_quotient->n_limbs = 0;
+    p_quotient->exponent = 0;
+    p_quotient->b_negative = false;
+    if (0u == dividend.n_limbs)
+    {
+        return;
+    }
+    if ((shift < 0) && ((uint64_t)-shift >= (dividend.n_limbs + 1u) * LIMB_DIGITS))
+    {
+        p_big->b_exact = false; // The divisor has more digits than the dividend: 0
+        return;
+    }
+    if (shift > 0)
+    {
+        scale_up(p_big, &dividend, (uint64_t)shift);
+    }
+    else if (shift < 0)
+    {
+        scale_up(p_big, &divisor, (uint64_t)-shift);
+    }
+    if (CALC_BIG_OK != p_big->status)
+    {
+        return;
+    }
+
+    if (dividend.n_limbs < divisor.n_limbs)
+    {
+        p_big->b_exact = false;
+        return;
+    }
+    n_quotient = dividend.n_limbs - divisor.n_limbs + 1u;
+    p_quotient->p_limb = allocate(p_big, n_quotient);
+    if ((NULL == p_quotient->p_limb) || !divide_limbs(p_big, p_quotient->p_limb, dividend.p_limb, dividend.n_limbs,
+                                                      divisor.p_limb, divisor.n_limbs, &b_remainder))
+    {
+        return;
+    }
+    p_quotient->n_limbs = trim(p_quotient->p_limb, n_quotient);
+    p_quotient->b_negative = (0u != p_quotient->n_limbs) && (p_a->b_negative != p_b->b_negative);
+    set_exponent(p_big, p_quotient, -(int64_t)p_big->scale);
+    p_big->b_exact = p_big->b_exact && !b_remainder;
+}
+
+/**
+ * @brief   Multiply a number's coefficient by a power of ten, keeping its value (the
+ * exponent goes down as much).
+ * @param   [in,out] p_big The evaluator (the new coefficient goes at the top of its arena).
+ * @param   [in,out] p_number The number (not zero).
+ * @param   [in] digits The power of ten.
+ * @return  None.
+ **/
+static void
+scale_up(CalcBig_t *p_big, BigNumber_t *p_number, uint64_t digits)
+{
+    uint64_t  n_zero_limbs = digits / LIMB_DIGITS;
+    uint32_t *p_limb;
+    size_t    n_limbs;
+
+    if (n_zero_limbs > p_big->size / sizeof(uint32_t))
+    {
+        p_big->status = CALC_BIG_TOO_LARGE;
+        return;
+    }
+    n_limbs = (size_t)n_zero_limbs + p_number->n_limbs + 1u;
+    p_limb = allocate(p_big, n_limbs);
+    if (NULL == p_limb)
+    {
+        return;
+    }
+    memset(p_limb, 0, (size_t)n_zero_limbs * sizeof(uint32_t));
+    p_limb[n_limbs - 1u] = multiply_small(&p_limb[n_zero_limbs], p_number->p_limb, p_number->n_limbs,
+                                          powers_of_ten[digits % LIMB_DIGITS]);
+    p_number->p_limb = p_limb;
+    p_number->n_limbs = trim(p_limb, n_limbs);
+    p_number->exponent = (int32_t)(p_number->exponent - (int64_t)digits);
+}
+
+/**
+ * @brief   Take limbs from the top of the arena.
+ * @param   [in,out] p_big The evaluator.
+ * @param   [in] n_limbs The number of limbs.
+ * @return  The limbs, or NULL (and the status CALC_BIG_TOO_LARGE) if the arena is full.
+ **/
+static uint32_t *
+allocate(CalcBig_t *p_big, size_t n_limbs)
+{
+    uint32_t *p_limb = (uint32_t *)(p_big->p_memory + p_big->used);
+
+    if (n_limbs > (p_big->size - p_big->used) / sizeof(uint32_t))
+    {
+        p_big->status = CALC_BIG_TOO_LARGE;
+        return NULL;
+    }
+    p_big->used += n_limbs * sizeof(uint32_t);
+    if (p_big->used > p_big->peak)
+    {
+        p_big->peak = p_big->used;
+    }
+    return p_limb;
+}
+
+/* The number of limbs without the zero limbs at the top. */
+static size_t
+trim(const uint32_t *p_limb, size_t n_limbs)
+{
+    while ((n_limbs > 0u) && (0u == p_limb[n_limbs - 1u]))
+    {
+        n_limbs--;
+    }
+    return n_limbs;
+}
+
+/* -1, 0 or 1 as a < b, a = b or a > b (neither with zero limbs at the top). */
+static int
+compare_limbs(const uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b)
+{
+    if (n_a != n_b)
+    {
+        return (n_a < n_b) ? -1 : 1;
+    }
+    for (size_t limb_no = n_a; limb_no-- > 0u;)
+    {
+        if (p_a[limb_no] != p_b[limb_no])
+        {
+            return (p_a[limb_no] < p_b[limb_no]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/* sum = a + b, where n_a >= n_b: n_a + 1 limbs. */
+static void
+add_limbs(uint32_t *p_sum, const uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b)
+{
+    uint32_t carry = 0;
+
+    for (size_t limb_no = 0; limb_no < n_a; limb_no++)
+    {
+        uint32_t sum = p_a[limb_no] + ((limb_no < n_b) ? p_b[limb_no] : 0u) + carry;
+
+        carry = (sum >= LIMB_BASE) ? 1u : 0u;
+        p_sum[limb_no] = sum - carry * LIMB_BASE;
+    }
+    p_sum[n_a] = carry;
+}
+
+/* a += b, where a has room for the sum. */
+static void
+add_limbs_in_place(uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b)
+{
+    uint32_t carry = 0;
+
+    for (size_t limb_no = 0; (limb_no < n_a) && ((limb_no < n_b) || (0u != carry)); limb_no++)
+    {
+        uint32_t sum = p_a[limb_no] + ((limb_no < n_b) ? p_b[limb_no] : 0u) + carry;
+
+        carry = (sum >= LIMB_BASE) ? 1u : 0u;
+        p_a[limb_no] = sum - carry * LIMB_BASE;
+    }
+}
+
+/* a -= b, where a >= b. */
+static void
+subtract_limbs(uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b)
+{
+    uint32_t borrow = 0;
+
+    for (size_t limb_no = 0; (limb_no < n_a) && ((limb_no < n_b) || (0u != borrow)); limb_no++)
+    {
+        uint32_t subtrahend = ((limb_no < n_b) ? p_b[limb_no] : 0u) + borrow;
+
+        borrow = (p_a[limb_no] < subtrahend) ? 1u : 0u;
+        p_a[limb_no] = p_a[limb_no] + borrow * LIMB_BASE - subtrahend;
+    }
+}
+
+/* product = a x factor (factor below LIMB_BASE) in n_a limbs; the carry out is returned. */
+static uint32_t
+multiply_small(uint32_t *p_product, const uint32_t *p_a, size_t n_a, uint32_t factor)
+{
+    uint64_t carry = 0;
+
+    for (size_t limb_no = 0; limb_no < n_a; limb_no++)
+    {
+        uint64_t product = (uint64_t)p_a[limb_no] * factor + carry;
+
+        carry = product / LIMB_BASE;
+        p_product[limb_no] = (uint32_t)(product - carry * LIMB_BASE);
+    }
+    return (uint32_t)carry;
+}
+
+/**
+ * @brief   product = a x b: schoolbook if either has fewer than CALC_BIG_KARATSUBA_LIMBS
+ * limbs, else Karatsuba. Each half is split again, so the split ends in schoolbook.
+ * @param   [in,out] p_big The evaluator (for scratch, given back before returning).
+ * @param   [out] p_product Room for n_a + n_b limbs (all of them are written).
+ * @param   [in] p_a, n_a The first factor.
+ * @param   [in] p_b, n_b The second factor.
+ * @return  false if the arena is full.
+ **/
+static bool
+multiply_limbs(CalcBig_t *p_big, uint32_t *p_product, const uint32_t *p_a, size_t n_a, const uint32_t *p_b,
+               size_t n_b)
+{
+    size_t    mark = p_big->used;
+    size_t    half;
+    uint32_t *p_scratch;
+
+    if (n_a < n_b)
+    {
+        const uint32_t *p_swap = p_a;
+        size_t          n_swap = n_a;
+
+        p_a = p_b;
+        n_a = n_b;
+        p_b = p_swap;
+        n_b = n_swap;
+    }
+    if (n_b < CALC_BIG_KARATSUBA_LIMBS)
+    {
+        multiply_schoolbook(p_product, p_a, n_a, p_b, n_b);
+        return true;
+    }
+
+    half = (n_a + 1u) / 2u;
+    if (n_b <= half)
+    {
+        /* b fits in a half: a's halves times b, the high product added in above the low. */
+        p_scratch = allocate(p_big, n_a - half + n_b);
+        if ((NULL == p_scratch) || !multiply_limbs(p_big, p_product, p_a, half, p_b, n_b) ||
+            !multiply_limbs(p_big, p_scratch, &p_a[half], n_a - half, p_b, n_b))
+        {
+            return false;
+        }
+        memset(&p_product[half + n_b], 0, (n_a - half) * sizeof(uint32_t));
+        add_limbs_in_place(&p_product[half], n_a + n_b - half, p_scratch, n_a - half + n_b);
+    }
+    else
+    {
+        /* a0 b0 below, a1 b1 above, and (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 added in the
+           middle. */
+        uint32_t *p_sum_a = allocate(p_big, half + 1u);
+        uint32_t *p_sum_b = allocate(p_big, half + 1u);
+        size_t    n_high = n_a + n_b - 2u * half;
+
+        p_scratch = allocate(p_big, 2u * half + 2u);
+        if ((NULL == p_sum_a) || (NULL == p_sum_b) || (NULL == p_scratch) || !multiply_limbs(p_big, p_product, p_a, half, p_b, half) ||
+            !multiply_limbs(p_big, &p_product[2u * half], &p_a[half], n_a - half, &p_b[half], n_b - half))
+        {
+            return false;
+        }
+        add_limbs(p_sum_a, p_a, half, &p_a[half], n_a - half);
+        add_limbs(p_sum_b, p_b, half, &p_b[half], n_b - half);
+        if (!multiply_limbs(p_big, p_scratch, p_sum_a, half + 1u, p_sum_b, half + 1u))
+        {
+            return false;
+        }
+        subtract_limbs(p_scratch, 2u * half + 2u, p_product, 2u * half);
+        subtract_limbs(p_scratch, 2u * half + 2u, &p_product[2u * half], n_high);
+        add_limbs_in_place(&p_product[half], n_a + n_b - half, p_scratch, trim(p_scratch, 2u * half + 2u));
+    }
+
+    p_big->used = mark;
+    return true;
+}
+
+/* product = a x b: n_a + n_b limbs. Each limb of the product is a column of products of
+   limbs, added up in 64 bits with one carry per column (16 products of limbs below 10^9
+   and the carry fit), so the multiplies do not wait on each other's carries. */
+static void
+multiply_schoolbook(uint32_t *p_product, const uint32_t *p_a, size_t n_a, const uint32_t *p_b, size_t n_b)
+{
+    uint64_t carry = 0;
+
+    for (size_t column = 0; column + 1u < n_a + n_b; column++)
+    {
+        size_t a_no = (column < n_b) ? 0u : column - n_b + 1u;
+        size_t a_end = (column < n_a) ? column + 1u : n_a;
+
+        if (a_end - a_no <= 16u)
+        {
+            uint64_t sum = carry;
+
+            for (; a_no < a_end; a_no++)
+            {
+                sum += (uint64_t)p_a[a_no] * p_b[column - a_no];
+            }
+            carry = sum / LIMB_BASE;
+            p_product[column] = (uint32_t)(sum - carry * LIMB_BASE);
+        }
+        else
+        {
+            /* A long column in chunks of 16, each split into limbs and carries. */
+            uint64_t low = carry;
+            uint64_t high = 0;
+
+            while (a_no < a_end)
+            {
+                size_t   chunk_end = (a_end - a_no > 16u) ? a_no + 16u : a_end;
+                uint64_t sum = 0;
+
+                for (; a_no < chunk_end; a_no++)
+                {
+                    sum += (uint64_t)p_a[a_no] * p_b[column - a_no];
+                }
+                high += sum / LIMB_BASE;
+                low += sum % LIMB_BASE;
+            }
+            carry = high + low / LIMB_BASE;
+            p_product[column] = (uint32_t)(low % LIMB_BASE);
+        }
+    }
+    p_product[n_a + n_b - 1u] = (uint32_t)carry;
+}
+
+/**
+ * @brief   quotient = u / v, cut toward zero (Knuth's algorithm D, in base 10^9).
+ * @param   [in,out] p_big The evaluator (for scratch, given back before returning).
+ * @param   [out] p_quotient Room for n_u - n_v + 1 limbs.
+ * @param   [in] p_u, n_u The dividend (n_u >= n_v).
+ * @param   [in] p_v, n_v The divisor (no zero limb at the top).
+ * @param   [out] p_b_remainder Whether anything is left over.
+ * @return  false if the arena is full.
+ **/
+static bool
+divide_limbs(CalcBig_t *p_big, uint32_t *p_quotient, const uint32_t *p_u, size_t n_u, const uint32_t *p_v,
+             size_t n_v, bool *p_b_remainder)
+{
+    size_t    mark = p_big->used;
+    uint32_t *p_un;
+    uint32_t *p_vn;
+    uint32_t  scale;
+    uint32_t  v_top;
+    uint32_t  v_next;
+
+    if (1u == n_v)
+    {
+        uint64_t remainder = 0;
+
+        for (size_t limb_no = n_u; limb_no-- > 0u;)
+        {
+            uint64_t dividend = remainder * LIMB_BASE + p_u[limb_no];
+
+            p_quotient[limb_no] = (uint32_t)(dividend / p_v[0]);
+            remainder = dividend % p_v[0];
+        }
+        *p_b_remainder = (0u != remainder);
+        return true;
+    }
+
+    /* Scale both so the divisor's top limb is at least half the base: then each guess at
+       a quotient limb, from the top two limbs, is at most 2 too large. */
+    p_un = allocate(p_big, n_u + 1u);
+    p_vn = allocate(p_big, n_v);
+    if ((NULL == p_un) || (NULL == p_vn))
+    {
+        return false;
+    }
+    scale = LIMB_BASE / (p_v[n_v - 1u] + 1u);
+    p_un[n_u] = multiply_small(p_un, p_u, n_u, scale);
+    (void)multiply_small(p_vn, p_v, n_v, scale);
+    v_top = p_vn[n_v - 1u];
+    v_next = p_vn[n_v - 2u];
+
+    for (size_t limb_no = n_u - n_v + 1u; limb_no-- > 0u;)
+    {
+        uint32_t *p_window = &p_un[limb_no];
+        uint64_t  top = (uint64_t)p_window[n_v] * LIMB_BASE + p_window[n_v - 1u];
+        uint64_t  guess = top / v_top;
+        uint64_t  rest = top % v_top;
+        uint64_t  carry = 0;
+        uint32_t  borrow = 0;
+        uint32_t  subtrahend;
+
+        while ((guess >= LIMB_BASE) || (guess * v_next > rest * LIMB_BASE + p_window[n_v - 2u]))
+        {
+            guess--;
+            rest += v_top;
+            if (rest >= LIMB_BASE)
+            {
+                break;
+            }
+        }
+
+        /* window -= guess x vn */
+        for (size_t v_no = 0; v_no < n_v; v_no++)
+        {
+            uint64_t product = guess * p_vn[v_no] + carry;
+
+            carry = product / LIMB_BASE;
+            subtrahend = (uint32_t)(product - carry * LIMB_BASE) + borrow;
+            borrow = (p_window[v_no] < subtrahend) ? 1u : 0u;
+            p_window[v_no] = p_window[v_no] + borrow * LIMB_BASE - subtrahend;
+        }
+        subtrahend = (uint32_t)carry + borrow;
+        if (p_window[n_v] < subtrahend)
+        {
+            /* Still one too large (rare): add vn back. */
+            uint32_t add_carry = 0;
+
+            guess--;
+            for (size_t v_no = 0; v_no < n_v; v_no++)
+            {
+                uint32_t sum = p_window[v_no] + p_vn[v_no] + add_carry;
+
+                add_carry = (sum >= LIMB_BASE) ? 1u : 0u;
+                p_window[v_no] = sum - add_carry * LIMB_BASE;
+            }
+            p_window[n_v] = p_window[n_v] + add_carry - subtrahend; // 0
+        }
+        else
+        {
+            p_window[n_v] -= subtrahend;
+        }
+        p_quotient[limb_no] = (uint32_t)guess;
+    }
+
+    *p_b_remainder = (0u != trim(p_un, n_v));
+    p_big->used = mark;
+    return true;
+}
+
+/**
+ * @brief   Write a number in decimal: a sign, the digits and a point, without an exponent
+ * and without zeros at the end of the fraction.
+ * @param   [in] p_number The number.
+ * @param   [out] p_text The text.
+ * @param   [in] text_size The room for it, with its null.
+ * @return  false if there is not room for it.
+ **/
+static bool
+format_number(const BigNumber_t *p_number, char *p_text, size_t text_size)
+{
+    uint32_t top = (0u == p_number->n_limbs) ? 0u : p_number->p_limb[p_number->n_limbs - 1u];
+    size_t   n_top_digits = 1;
+    size_t   n_digits;
+    int64_t  n_whole_digits;
+    size_t   length;
+    char    *p_end = p_text;
+
+    if (0u == p_number->n_limbs)
+    {
+        if (text_size < 2u)
+        {
+            return false;
+        }
+        strcpy(p_text, "0");
+        return true;
+    }
+
+    while ((n_top_digits < LIMB_DIGITS) && (top >= powers_of_ten[n_top_digits]))
+    {
+        n_top_digits++;
+    }
+    n_digits = (p_number->n_limbs - 1u) * LIMB_DIGITS + n_top_digits;
+    n_whole_digits = (int64_t)n_digits + p_number->exponent; // Before the point
+
+    length = p_number->b_negative ? 1u : 0u;
+    if (p_number->exponent >= 0)
+    {
+        length += n_digits + (size_t)p_number->exponent;
+    }
+    else if (n_whole_digits > 0)
+    {
+        length += n_digits + 1u;
+    }
+    else
+    {
+        length += 2u + (size_t)-n_whole_digits + n_digits;
+    }
+    if (length >= text_size)
+    {
+        return false;
+    }
+
+    if (p_number->b_negative)
+    {
+        *p_end++ = '-';
+    }
+    if (n_whole_digits <= 0)
+    {
+        *p_end++ = '0';
+        *p_end++ = '.';
+        memset(p_end, '0', (size_t)-n_whole_digits);
+        p_end += -n_whole_digits;
+    }
+    p_end = write_digits(p_end, p_number->p_limb, p_number->n_limbs);
+    if (p_number->exponent >= 0)
+    {
+        memset(p_end, '0', (size_t)p_number->exponent);
+        p_end += p_number->exponent;
+    }
+    else
+    {
+        if (n_whole_digits > 0)
+        {
+            /* Open a gap for the point. */
+            char *p_point = p_end - (n_digits - (size_t)n_whole_digits);
+
+            memmove(p_point + 1, p_point, (size_t)(p_end - p_point));
+            *p_point = '.';
+            p_end++;
+        }
+        while ('0' == p_end[-1])
+        {
+            p_end--;
+        }
+        if ('.' == p_end[-1])
+        {
+            p_end--;
+        }
+    }
+    *p_end = '\0';
+    return true;
+}
+
+/* Write a coefficient's digits, most significant first; the end is returned. */
+static char *
+write_digits(char *p_text, const uint32_t *p_limb, size_t n_limbs)
+{
+    char     top_digits[LIMB_DIGITS];
+    size_t   n_top_digits = 0;
+    uint32_t limb = p_limb[n_limbs - 1u];
+
+    do
+    {
+        top_digits[n_top_digits++] = (char)('0' + limb % 10u);
+        limb /= 10u;
+    } while (0u != limb);
+    while (n_top_digits > 0u)
+    {
+        *p_text++ = top_digits[--n_top_digits];
+    }
+
+    for (size_t limb_no = n_limbs - 1u; limb_no-- > 0u;)
+    {
+        limb = p_limb[limb_no];
+        for (size_t digit_no = LIMB_DIGITS; digit_no-- > 0u;)
+        {
+            p_text[digit_no] = (char)('0' + limb % 10u);
+            limb /= 10u;
+        }
+        p_text += LIMB_DIGITS;
+    }
+    return p_text;
+}
+
+/* The engine's operators. */
+static bool
+is_operator(char character)
+{
+    return ('+' == character) || ('-' == character) || ('x' == character) || ('/' == character) ||
+           ('E' == character);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
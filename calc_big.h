@@ -0,0 +1,104 @@
+/**
+ * $File: calc_big.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_big.h
+ *
+ *  @brief     Exact evaluation: the engine's expressions worked out in decimal numbers of
+ *             any length instead of doubles, for results that must add up to the last
+ *             digit.
+ *
+ *             A number is a sign, a coefficient and a power of ten: the coefficient is
+ *             held in limbs of 9 decimal digits (base 10^9), so "0.1" is 1 and -1 exactly,
+ *             and an E only moves the power. Adding and subtracting line up the powers;
+ *             multiplying is exact, schoolbook below CALC_BIG_KARATSUBA_LIMBS limbs and
+ *             Karatsuba above. Only dividing rounds: a quotient keeps the scale's digits
+ *             after the point and the rest is cut off, as bc does. The operators are
+ *             worked out in the engine's order (E, /, x, +, -, as calc_stream.c folds
+ *             them), and the error numbers are the engine's, except that there is no
+ *             limit on the number of tokens (no error 1).
+ *
+ *             Every number lives in an arena: a block of memory the caller gives to
+ *             calc_big_init(), handed out by bumping an offset. Nothing is freed one by
+ *             one. Each level of the fold (the answer, the run of terms, the product, the
+ *             quotient) sits above the one before it, and a new value is moved down over
+ *             the values it replaces, so the arena only ever holds the live values and
+ *             the scratch of one operation. Each evaluation starts with an empty arena and
+ *             leaves it empty: the answer is written out as text. No other memory is used.
+ *
+ *             Usage:
+ *               static uint32_t memory[16384];
+ *               CalcBig_t       big;
+ *               calc_big_init(&big, memory, sizeof(memory), 20);
+ *               status = calc_big_evaluate(&big, p_expression, length, answer, sizeof(answer),
+ *                                          &error_ref_no);
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#ifndef CALC_BIG_KARATSUBA_LIMBS
+#define CALC_BIG_KARATSUBA_LIMBS 40 //!< Least limbs of both factors for a Karatsuba multiply.
+#endif
+
+#define CALC_BIG_MAX_EXPONENT 100000000 //!< Largest power of ten a number may carry, either way.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+typedef enum
+{
+    CALC_BIG_OK,
+    CALC_BIG_SYNTAX_ERROR,    /* The engine's error number is given. */
+    CALC_BIG_DIVIDE_BY_ZERO,
+    CALC_BIG_TOO_LARGE        /* A number outgrew the arena, CALC_BIG_MAX_EXPONENT or the text. */
+} CalcBigStatus_t;
+
+/* The arena and the options. Only calc_big.c looks inside. */
+typedef struct
+{
+    uint8_t        *p_memory;
+    size_t          size;
+    size_t          used;    /* Bytes handed out in the evaluation under way. */
+    size_t          peak;    /* The most bytes the last evaluation used at once. */
+    uint32_t        scale;   /* Digits a quotient keeps after the point. */
+    bool            b_exact; /* No quotient of the last evaluation was cut. */
+    CalcBigStatus_t status;  /* The first failure of the evaluation under way. */
+} CalcBig_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void            calc_big_init(CalcBig_t *p_big, void *p_memory, size_t size, uint32_t scale);
+CalcBigStatus_t calc_big_evaluate(CalcBig_t *p_big, const char *p_expression, size_t length, char *p_answer,
+                                  size_t answer_size, uint8_t *p_error_ref_no);
+bool            calc_big_exact(const CalcBig_t *p_big);
+size_t          calc_big_peak(const CalcBig_t *p_big);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,175 @@
+/**
+ * $File: calc_incremental.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_incremental.c
+ *
+ *  @brief     Evaluation of the input line as it is typed. See calc_incremental.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_incremental.h"
+#include "profile.h"
+
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static bool is_operator(char character);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Empty the line.
+ * @param   [out] p_line The line.
+ * @return  None.
+ **/
+void
+calc_incremental_clear(CalcIncremental_t *p_line)
+{
+    CalcStream_t finished;
+
+    p_line->length = 0;
+    calc_stream_init(&p_line->stream[0]);
+    finished = p_line->stream[0];
+    p_line->answer[0] = calc_stream_finish(&finished, &p_line->error_ref_no[0]); // Error 2
+}
+
+/**
+ * @brief   Add a typed character to the line and work out the line's answer.
+ * @param   [in,out] p_line The line.
+ * @param   [in] character The character.
+ * @return  false if the line is full (the character is not added).
+ **/
+bool
+calc_incremental_append(CalcIncremental_t *p_line, char character)
+{
+    uint8_t       length = p_line->length;
+    CalcStream_t *p_stream = &p_line->stream[length + 1u];
+    CalcStream_t  finished;
+
+    if (length >= CALC_INCREMENTAL_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    PROFILE_START(PROFILE_STAGE_TYPED_CHAR);
+    *p_stream = p_line->stream[length];
+    PROFILE_START(PROFILE_STAGE_STREAM_FEED);
+    calc_stream_feed(p_stream, &character, 1);
+    PROFILE_STOP(PROFILE_STAGE_STREAM_FEED);
+    finished = *p_stream;
+    PROFILE_START(PROFILE_STAGE_STREAM_FINISH);
+    p_line->answer[length + 1u] = calc_stream_finish(&finished, &p_line->error_ref_no[length + 1u]);
+    PROFILE_STOP(PROFILE_STAGE_STREAM_FINISH);
+    p_line->length = length + 1u;
+    PROFILE_STOP(PROFILE_STAGE_TYPED_CHAR);
+    return true;
+}
+
+/**
+ * @brief   Take the last character off the line, going back to the state before it.
+ * @param   [in,out] p_line The line.
+ * @return  None.
+ **/
+void
+calc_incremental_backspace(CalcIncremental_t *p_line)
+{
+    if (p_line->length > 0u)
+    {
+        p_line->length--;
+    }
+}
+
+/**
+ * @brief   The number of characters in the line.
+ * @param   [in] p_line The line.
+ * @return  The length.
+ **/
+uint8_t
+calc_incremental_length(const CalcIncremental_t *p_line)
+{
+    return p_line->length;
+}
+
+/**
+ * @brief   The answer of the line as it is, as CalculateAnswer() would give it.
+ * @param   [in] p_line The line.
+ * @param   [out] p_error_ref_no The reference number of the error, if any.
+ * @return  The answer, or 0.0 if there is an error.
+ **/
+double
+calc_incremental_answer(const CalcIncremental_t *p_line, uint8_t *p_error_ref_no)
+{
+    *p_error_ref_no = p_line->error_ref_no[p_line->length];
+    return p_line->answer[p_line->length];
+}
+
+/**
+ * @brief   The answer of the line without the operators it ends with, e.g. that of "12+3"
+ * for "12+3x" or "12+3x-".
+ * @param   [in] p_line The line.
+ * @param   [out] p_error_ref_no The reference number of the error, if any (2 if the line
+ * is empty or all operators).
+ * @return  The answer, or 0.0 if there is an error.
+ **/
+double
+calc_incremental_running_answer(const CalcIncremental_t *p_line, uint8_t *p_error_ref_no)
+{
+    uint8_t length = p_line->length;
+
+    /* The state after each character remembers it as the previous one. */
+    while ((length > 0u) && is_operator(p_line->stream[length].previous))
+    {
+        length--;
+    }
+    *p_error_ref_no = p_line->error_ref_no[length];
+    return p_line->answer[length];
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/* The engine's operators. */
+static bool
+is_operator(char character)
+{
+    return ('+' == character) || ('-' == character) || ('x' == character) || ('/' == character) ||
+           ('E' == character);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,74 @@
+/**
+ * $File: calc_incremental.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_incremental.h
+ *
+ *  @brief     Evaluation of the input line as it is typed, so its answer is known before
+ *             the equals key is pressed.
+ *
+ *             Each key appends one character to a push evaluator (calc_stream.c) and
+ *             finishes a copy of it, so the answer and error number of the line so far
+ *             are kept with every character: the state after each is a checkpoint, and a
+ *             backspace goes back to the one before. Each key costs the same whatever the
+ *             line's length, and the equals key only reads the last answer. The answers
+ *             and error numbers are CalculateAnswer()'s for the same line. The running
+ *             answer leaves out the operators the line ends with, as a preview of the
+ *             answer while the next number is being typed.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_stream.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#define CALC_INCREMENTAL_MAX_LENGTH 32 //!< The input line's characters: two screens.
+#define CALC_INPUT_BUFFER_SIZE (CALC_INCREMENTAL_MAX_LENGTH + 1) //!< A line and its null.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* The line typed so far: entry i is the state after its first i characters. */
+typedef struct
+{
+    CalcStream_t stream[CALC_INCREMENTAL_MAX_LENGTH + 1];
+    double       answer[CALC_INCREMENTAL_MAX_LENGTH + 1];
+    uint8_t      error_ref_no[CALC_INCREMENTAL_MAX_LENGTH + 1];
+    uint8_t      length;
+} CalcIncremental_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void    calc_incremental_clear(CalcIncremental_t *p_line);
+bool    calc_incremental_append(CalcIncremental_t *p_line, char character);
+void    calc_incremental_backspace(CalcIncremental_t *p_line);
+uint8_t calc_incremental_length(const CalcIncremental_t *p_line);
+double  calc_incremental_answer(const CalcIncremental_t *p_line, uint8_t *p_error_ref_no);
+double  calc_incremental_running_answer(const CalcIncremental_t *p_line, uint8_t *p_error_ref_no);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,691 @@
+/**
+ * $File: calc_jit.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_jit.c
+ *
+ *  @brief     x86-64 compiler for expression shapes (host only). See calc_jit.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#define _DEFAULT_SOURCE /* For MAP_ANONYMOUS. */
+#include "calc_jit.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define MAX_SHAPE_CODE     2048                   //!< Longest code for one shape, with room to spare.
+#define CODE_ALIGNMENT     16
+#define SHAPE_OCCUPIED     (1ull << 63)
+#define SHAPE_COUNT_SHIFT  58                     //!< The operator count sits above 19 3-bit operators.
+#define OPERATOR_BITS      3
+#define LITERAL_BITS       3
+
+/* Registers in a ModRM byte. */
+#define REGISTER_RBX       3                      //!< Holds the numbers the steps write.
+#define REGISTER_RBP       5                      //!< Holds the packed literals.
+
+/* SSE2 scalar double opcodes, after F2 0F. */
+#define OPCODE_MOVSD_LOAD  0x10
+#define OPCODE_MOVSD_STORE 0x11
+#define OPCODE_ADDSD       0x58
+#define OPCODE_MULSD       0x59
+#define OPCODE_SUBSD       0x5C
+#define OPCODE_DIVSD       0x5E
+#define OPCODE_CVTSI2SD    0x2A                   //!< After F2 0F: from a 32-bit integer.
+#define OPCODE_CVTSS2SD    0x5A                   //!< After F3 0F: from a float.
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* Compiled code for a shape: reads the numbers from the packed literals, keeps what the
+   steps work out in p_numbers (room for MAX_NUMS_AND_OPS, unset on entry) and returns the
+   answer. */
+typedef double (*CompiledShape_t)(const uint8_t *p_literal, double *p_numbers);
+
+/* A shape in the table. The key holds the operators and encodings themselves, so equal
+   keys are equal shapes and there are no false matches. */
+typedef struct
+{
+    CalcJitShapeKey_t key;
+    uint32_t        count;
+    bool            b_uncompilable;
+    CompiledShape_t p_function;
+} Shape_t;
+
+struct CalcJit
+{
+    uint8_t       *p_code;    /* The code area, or NULL if nothing can be compiled. */
+    size_t         code_size;
+    size_t         code_used;
+    size_t         n_shapes;
+    CalcJitStats_t stats;
+    Shape_t        shapes[CALC_JIT_SHAPE_SLOTS];
+};
+
+/* Code being generated for one shape. */
+typedef struct
+{
+    uint8_t bytes[MAX_SHAPE_CODE];
+    size_t  length;
+} CodeBuffer_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static Shape_t        *find_shape(CalcJit_t *p_jit, const CalcJitShapeKey_t *p_key);
+static CompiledShape_t compile_shape(CalcJit_t *p_jit, const ParsedExpression_t *p_parsed_expression);
+#if defined(__x86_64__)
+static void            emit_bytes(CodeBuffer_t *p_buffer, const uint8_t *p_bytes, size_t length);
+static void            emit_u64(CodeBuffer_t *p_buffer, uint64_t value);
+static void            emit_modrm(CodeBuffer_t *p_buffer, uint8_t reg, uint8_t base, uint32_t displacement);
+static void            emit_sse_slot(CodeBuffer_t *p_buffer, uint8_t opcode, uint8_t xmm, uint8_t slot);
+static void            emit_load_literal(CodeBuffer_t *p_buffer, uint8_t xmm, uint8_t encoding, uint8_t offset);
+static void            emit_load_number(CodeBuffer_t *p_buffer, uint8_t xmm, uint8_t slot, const bool *p_b_written,
+                                        const ParsedExpression_t *p_parsed_expression, const uint8_t *p_offsets);
+static void            generate_code(CodeBuffer_t *p_buffer, const ParsedExpression_t *p_parsed_expression,
+                                     const CalcJitStep_t *p_steps, size_t n_steps);
+#endif
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Create a compiler.
+ * @param   [in] code_bytes The size of the code area (rounded up to whole pages), e.g.
+ * CALC_JIT_DEFAULT_BYTES. Each compiled shape takes up to a few hundred bytes.
+ * @return  The compiler, or NULL if out of memory. On a host that is not x86-64, or if
+ * the code area cannot be mapped, the compiler only interprets.
+ **/
+CalcJit_t *
+calc_jit_create(size_t code_bytes)
+{
+    CalcJit_t *p_jit = calloc(1, sizeof(*p_jit));
+
+    if (NULL == p_jit)
+    {
+        return NULL;
+    }
+
+#if defined(__x86_64__)
+    {
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        void  *p_map;
+
+        p_jit->code_size = (code_bytes + page_size - 1u) / page_size * page_size;
+        p_map = (p_jit->code_size > 0u)
+                    ? mmap(NULL, p_jit->code_size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                    : MAP_FAILED;
+        if (MAP_FAILED != p_map)
+        {
+            p_jit->p_code = p_map;
+        }
+    }
+#else
+    (void)code_bytes;
+#endif
+
+    return p_jit;
+}
+
+/**
+ * @brief   Free a compiler and its code.
+ * @param   [in] p_jit The compiler, or NULL.
+ * @return  None.
+ **/
+void
+calc_jit_destroy(CalcJit_t *p_jit)
+{
+    if (NULL == p_jit)
+    {
+        return;
+    }
+    if (NULL != p_jit->p_code)
+    {
+        munmap(p_jit->p_code, p_jit->code_size);
+    }
+    free(p_jit);
+}
+
+/**
+ * @brief   Evaluate an expression split up by TokeniseExpression(), with compiled code
+ * for its shape if there is (or now should be) some.
+ * @param   [in] p_jit The compiler.
+ * @param   [in] p_parsed_expression The numbers and operators (only read, as by
+ * EvaluateTokens()).
+ * @param   [out] p_error_ref_no The error code, 0 if there is no error.
+ * @return  The answer, exactly as EvaluateTokens() gives it.
+ **/
+double
+calc_jit_evaluate(CalcJit_t *p_jit, const ParsedExpression_t *p_parsed_expression, uint8_t *p_error_ref_no)
+{
+    Shape_t          *p_shape = NULL;
+    CalcJitShapeKey_t key;
+
+    if (calc_jit_shape_key(p_parsed_expression, &key))
+    {
+        p_shape = find_shape(p_jit, &key);
+    }
+
+    if (NULL != p_shape)
+    {
+        if ((NULL == p_shape->p_function) && !p_shape->b_uncompilable && (++p_shape->count >= CALC_JIT_HOT_COUNT))
+        {
+            p_shape->p_function = compile_shape(p_jit, p_parsed_expression);
+            p_shape->b_uncompilable = (NULL == p_shape->p_function);
+        }
+        if (NULL != p_shape->p_function)
+        {
+            double numbers[MAX_NUMS_AND_OPS]; // Written by the code before it is read
+
+            p_jit->stats.compiled_evaluations++;
+            *p_error_ref_no = 0;
+            return p_shape->p_function(p_parsed_expression->literal, numbers);
+        }
+    }
+
+    p_jit->stats.interpreted_evaluations++;
+    return EvaluateTokens(p_parsed_expression, p_error_ref_no);
+}
+
+/**
+ * @brief   Check and evaluate an expression given by its start and length, as
+ * CalculateAnswerSpan() does.
+ * @param   [in] p_jit The compiler.
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [out] p_error_ref_no The error code, 0 if there is no error.
+ * @return  The answer, exactly as CalculateAnswerSpan() gives it.
+ **/
+double
+calc_jit_calculate_span(CalcJit_t *p_jit, const char *p_expression, size_t length, uint8_t *p_error_ref_no)
+{
+    ParsedExpression_t parsed_expression;
+
+    TokeniseExpression(p_expression, length, &parsed_expression, p_error_ref_no);
+    if (0u != *p_error_ref_no)
+    {
+        return 0.0;
+    }
+
+    return calc_jit_evaluate(p_jit, &parsed_expression, p_error_ref_no);
+}
+
+/**
+ * @brief   Read a compiler's counters.
+ * @param   [in] p_jit The compiler.
+ * @param   [out] p_stats The counters.
+ * @return  None.
+ **/
+void
+calc_jit_stats(const CalcJit_t *p_jit, CalcJitStats_t *p_stats)
+{
+    *p_stats = p_jit->stats;
+    p_stats->code_bytes = p_jit->code_used;
+}
+
+/**
+ * @brief   Pack the shape of an expression into a key: 3 bits per operator, the number
+ * of operators above them and an occupied bit at the top, and 3 bits per number for its
+ * encoding.
+ * @param   [in] p_parsed_expression The tokens.
+ * @param   [out] p_key The key.
+ * @return  false if the tokens do not form a well-formed expression (which is then left
+ * to the interpreter and its error checks).
+ **/
+bool
+calc_jit_shape_key(const ParsedExpression_t *p_parsed_expression, CalcJitShapeKey_t *p_key)
+{
+    int      n_operators = p_parsed_expression->n_infix_operators;
+    uint64_t key = 0;
+    uint64_t literals = 0;
+
+    if ((n_operators < 0) || (n_operators > CALC_JIT_MAX_STEPS) || (p_parsed_expression->n_numbers != n_operators + 1))
+    {
+        return false;
+    }
+
+    for (int index = 0; index < n_operators; index++)
+    {
+        uint64_t code;
+
+        code = PARSED_OPERATOR(p_parsed_expression, index);
+        if ((code < PARSED_OPERATOR_ADD) || (code > PARSED_OPERATOR_E))
+        {
+            return false;
+        }
+        key |= code << (OPERATOR_BITS * index);
+    }
+    for (int index = 0; index <= n_operators; index++)
+    {
+        uint64_t encoding = PARSED_LITERAL(p_parsed_expression, index);
+
+        if (encoding >= PARSED_LITERAL_COUNT)
+        {
+            return false;
+        }
+        literals |= encoding << (LITERAL_BITS * index);
+    }
+
+    p_key->operators = SHAPE_OCCUPIED | ((uint64_t)n_operators << SHAPE_COUNT_SHIFT) | key;
+    p_key->literals = literals;
+    return true;
+}
+
+/**
+ * @brief   Work out the steps of the engine's evaluation for a shape. The operators
+ * are taken in passes (E, /, x, +, -), each left to right; each merges its left number
+ * into the next number not yet merged away, which combines the numbers in the order
+ * evaluate_expression() does.
+ * @param   [in] p_parsed_expression The tokens, as accepted by calc_jit_shape_key().
+ * @param   [out] p_steps The steps, one per operator.
+ * @return  The number of steps.
+ **/
+size_t
+calc_jit_plan_steps(const ParsedExpression_t *p_parsed_expression, CalcJitStep_t *p_steps)
+{
+    static const char pass_operators[] = {'E', '/', 'x', '+', '-'};
+    static const int  pass_codes[] = {PARSED_OPERATOR_E, PARSED_OPERATOR_DIVIDE, PARSED_OPERATOR_MULTIPLY,
+                                      PARSED_OPERATOR_ADD, PARSED_OPERATOR_SUBTRACT};
+    bool              b_used[MAX_NUMS_AND_OPS] = {false};
+    size_t            n_steps = 0;
+
+    for (size_t pass = 0; pass < sizeof(pass_operators); pass++)
+    {
+        for (int left = 0; left < p_parsed_expression->n_infix_operators; left++)
+        {
+            int right = left + 1;
+
+            if (PARSED_OPERATOR(p_parsed_expression, left) != pass_codes[pass])
+            {
+                continue;
+            }
+            while (b_used[right]) // The last number is never merged away, so this stops
+            {
+                right++;
+            }
+            p_steps[n_steps].operator = pass_operators[pass];
+            p_steps[n_steps].left = (uint8_t)left;
+            p_steps[n_steps].right = (uint8_t)right;
+            n_steps++;
+            b_used[left] = true;
+        }
+    }
+
+    return n_steps;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Find a shape in the table, adding it if it is new and there is room.
+ * @param   [in] p_jit The compiler.
+ * @param   [in] p_key The shape's key.
+ * @return  The shape, or NULL if it is new and the table is three-quarters full.
+ **/
+static Shape_t *
+find_shape(CalcJit_t *p_jit, const CalcJitShapeKey_t *p_key)
+{
+    uint64_t hash = (p_key->operators ^ (p_key->literals * 0xC2B2AE3D27D4EB4Full)) * 0x9E3779B97F4A7C15ull;
+    size_t   slot = (size_t)(hash >> 54) & (CALC_JIT_SHAPE_SLOTS - 1u);
+
+    while (0u != p_jit->shapes[slot].key.operators) // An occupied key is never 0
+    {
+        if ((p_jit->shapes[slot].key.operators == p_key->operators) &&
+            (p_jit->shapes[slot].key.literals == p_key->literals))
+        {
+            return &p_jit->shapes[slot];
+        }
+        slot = (slot + 1u) & (CALC_JIT_SHAPE_SLOTS - 1u);
+    }
+
+    if (p_jit->n_shapes >= CALC_JIT_SHAPE_SLOTS / 4u * 3u)
+    {
+        return NULL;
+    }
+    p_jit->n_shapes++;
+    p_jit->stats.shapes_seen++;
+    p_jit->shapes[slot].key = *p_key;
+    return &p_jit->shapes[slot];
+}
+
+/**
+ * @brief   Compile a shape into the code area.
+ * @param   [in] p_jit The compiler.
+ * @param   [in] p_parsed_expression An expression of the shape.
+ * @return  The code, or NULL if it cannot be compiled (the area is full, or the host is
+ * not x86-64).
+ **/
+static CompiledShape_t
+compile_shape(CalcJit_t *p_jit, const ParsedExpression_t *p_parsed_expression)
+{
+#if defined(__x86_64__)
+    CodeBuffer_t        buffer;
+    CalcJitStep_t       steps[CALC_JIT_MAX_STEPS];
+    size_t              n_steps = calc_jit_plan_steps(p_parsed_expression, steps);
+    size_t              start = (p_jit->code_used + CODE_ALIGNMENT - 1u) & ~(size_t)(CODE_ALIGNMENT - 1u);
+    uint8_t            *p_start;
+    CompiledShape_t     p_function;
+
+    if (NULL == p_jit->p_code)
+    {
+        return NULL;
+    }
+
+    buffer.length = 0;
+    generate_code(&buffer, p_parsed_expression, steps, n_steps);
+    if (start + buffer.length > p_jit->code_size)
+    {
+        return NULL;
+    }
+
+    /* The area is never writable and executable at once. */
+    p_start = p_jit->p_code + start;
+    if (0 != mprotect(p_jit->p_code, p_jit->code_size, PROT_READ | PROT_WRITE))
+    {
+        return NULL;
+    }
+    memcpy(p_start, buffer.bytes, buffer.length);
+    if (0 != mprotect(p_jit->p_code, p_jit->code_size, PROT_READ | PROT_EXEC))
+    {
+        return NULL;
+    }
+    __builtin___clear_cache((char *)p_start, (char *)p_start + buffer.length);
+
+    p_jit->code_used = start + buffer.length;
+    p_jit->stats.shapes_compiled++;
+    memcpy(&p_function, &p_start, sizeof(p_function)); // Object to function pointer, as POSIX allows
+    return p_function;
+#else
+    (void)p_jit;
+    (void)p_parsed_expression;
+    return NULL;
+#endif
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief   Append bytes to the code.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] p_bytes The bytes.
+ * @param   [in] length The number of bytes.
+ * @return  None.
+ **/
+static void
+emit_bytes(CodeBuffer_t *p_buffer, const uint8_t *p_bytes, size_t length)
+{
+    memcpy(&p_buffer->bytes[p_buffer->length], p_bytes, length);
+    p_buffer->length += length;
+}
+
+/**
+ * @brief   Append a little-endian 64-bit immediate to the code.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] value The value.
+ * @return  None.
+ **/
+static void
+emit_u64(CodeBuffer_t *p_buffer, uint64_t value)
+{
+    for (int byte = 0; byte < 8; byte++)
+    {
+        p_buffer->bytes[p_buffer->length++] = (uint8_t)(value >> (8 * byte));
+    }
+}
+
+/**
+ * @brief   Append a ModRM byte addressing memory from a base register, with an 8- or
+ * 32-bit displacement.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] reg The register operand (0-7).
+ * @param   [in] base The base register, REGISTER_RBX or REGISTER_RBP.
+ * @param   [in] displacement The displacement.
+ * @return  None.
+ **/
+static void
+emit_modrm(CodeBuffer_t *p_buffer, uint8_t reg, uint8_t base, uint32_t displacement)
+{
+    if (displacement < 0x80u)
+    {
+        p_buffer->bytes[p_buffer->length++] = (uint8_t)(0x40u | (reg << 3) | base); // [base + disp8]
+        p_buffer->bytes[p_buffer->length++] = (uint8_t)displacement;
+    }
+    else
+    {
+        p_buffer->bytes[p_buffer->length++] = (uint8_t)(0x80u | (reg << 3) | base); // [base + disp32]
+        for (int byte = 0; byte < 4; byte++)
+        {
+            p_buffer->bytes[p_buffer->length++] = (uint8_t)(displacement >> (8 * byte));
+        }
+    }
+}
+
+/**
+ * @brief   Append an SSE2 scalar double instruction between an XMM register and one of
+ * the numbers the steps write, which are addressed from RBX: F2 0F opcode, then ModRM.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] opcode The opcode, e.g. OPCODE_ADDSD.
+ * @param   [in] xmm The register (0-7).
+ * @param   [in] slot The index of the number.
+ * @return  None.
+ **/
+static void
+emit_sse_slot(CodeBuffer_t *p_buffer, uint8_t opcode, uint8_t xmm, uint8_t slot)
+{
+    const uint8_t prefix[] = {0xF2, 0x0F, opcode};
+
+    emit_bytes(p_buffer, prefix, sizeof(prefix));
+    emit_modrm(p_buffer, xmm, REGISTER_RBX, (uint32_t)slot * sizeof(double));
+}
+
+/**
+ * @brief   Append the load of a packed number, addressed from RBP, into an XMM register
+ * as a double, converted as unpack_number() converts it (exactly). The register is
+ * zeroed before a conversion, which would otherwise wait for its last value.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] xmm The register (0-7).
+ * @param   [in] encoding The number's PARSED_LITERAL_ encoding.
+ * @param   [in] offset The number's offset in literal[].
+ * @return  None.
+ **/
+static void
+emit_load_literal(CodeBuffer_t *p_buffer, uint8_t xmm, uint8_t encoding, uint8_t offset)
+{
+    const uint8_t xorps_xmm[] = {0x0F, 0x57, (uint8_t)(0xC0u | (xmm << 3) | xmm)};
+    const uint8_t cvtsi2sd_xmm_eax[] = {0xF2, 0x0F, OPCODE_CVTSI2SD, (uint8_t)(0xC0u | (xmm << 3))};
+    const uint8_t movzx_byte[] = {0x0F, 0xB6};
+    const uint8_t movzx_word[] = {0x0F, 0xB7};
+    const uint8_t cvtsi2sd[] = {0xF2, 0x0F, OPCODE_CVTSI2SD};
+    const uint8_t cvtss2sd[] = {0xF3, 0x0F, OPCODE_CVTSS2SD};
+    const uint8_t movsd[] = {0xF2, 0x0F, OPCODE_MOVSD_LOAD};
+
+    switch (encoding)
+    {
+        case PARSED_LITERAL_UINT8: // movzx eax, byte [rbp + offset]; cvtsi2sd xmm, eax
+        case PARSED_LITERAL_UINT16: // movzx eax, word [rbp + offset]; cvtsi2sd xmm, eax
+            emit_bytes(p_buffer, xorps_xmm, sizeof(xorps_xmm));
+            emit_bytes(p_buffer, (PARSED_LITERAL_UINT8 == encoding) ? movzx_byte : movzx_word, sizeof(movzx_byte));
+            emit_modrm(p_buffer, 0, REGISTER_RBP, offset);
+            emit_bytes(p_buffer, cvtsi2sd_xmm_eax, sizeof(cvtsi2sd_xmm_eax));
+            break;
+        case PARSED_LITERAL_INT32: // cvtsi2sd xmm, dword [rbp + offset]
+            emit_bytes(p_buffer, xorps_xmm, sizeof(xorps_xmm));
+            emit_bytes(p_buffer, cvtsi2sd, sizeof(cvtsi2sd));
+            emit_modrm(p_buffer, xmm, REGISTER_RBP, offset);
+            break;
+        case PARSED_LITERAL_FLOAT: // cvtss2sd xmm, dword [rbp + offset]
+            emit_bytes(p_buffer, xorps_xmm, sizeof(xorps_xmm));
+            emit_bytes(p_buffer, cvtss2sd, sizeof(cvtss2sd));
+            emit_modrm(p_buffer, xmm, REGISTER_RBP, offset);
+            break;
+        default: // movsd xmm, [rbp + offset]
+            emit_bytes(p_buffer, movsd, sizeof(movsd));
+            emit_modrm(p_buffer, xmm, REGISTER_RBP, offset);
+            break;
+    }
+}
+
+/**
+ * @brief   Append the load of a number into an XMM register: from the numbers the steps
+ * write if a step has written it, otherwise from the packed literals.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] xmm The register (0-7).
+ * @param   [in] slot The index of the number.
+ * @param   [in] p_b_written Which numbers a step has written so far.
+ * @param   [in] p_parsed_expression An expression of the shape (for the encodings).
+ * @param   [in] p_offsets Each number's offset in literal[].
+ * @return  None.
+ **/
+static void
+emit_load_number(CodeBuffer_t *p_buffer, uint8_t xmm, uint8_t slot, const bool *p_b_written,
+                 const ParsedExpression_t *p_parsed_expression, const uint8_t *p_offsets)
+{
+    if (p_b_written[slot])
+    {
+        emit_sse_slot(p_buffer, OPCODE_MOVSD_LOAD, xmm, slot);
+    }
+    else
+    {
+        emit_load_literal(p_buffer, xmm, PARSED_LITERAL(p_parsed_expression, slot), p_offsets[slot]);
+    }
+}
+
+/**
+ * @brief   Generate the code for a shape: double f(const uint8_t *p_literal, double
+ * *p_numbers), with the literals addressed from RBP, the numbers the steps write from
+ * RBX, and the running value kept in XMM0, so a chain of steps on the same number is not
+ * reloaded. A number no step has written yet is read from the literals (a double
+ * operand straight from memory); each step's result is stored, as a later step may read
+ * it.
+ * @param   [in,out] p_buffer The code.
+ * @param   [in] p_parsed_expression An expression of the shape.
+ * @param   [in] p_steps The steps, from calc_jit_plan_steps().
+ * @param   [in] n_steps The number of steps.
+ * @return  None.
+ **/
+static void
+generate_code(CodeBuffer_t *p_buffer, const ParsedExpression_t *p_parsed_expression, const CalcJitStep_t *p_steps,
+              size_t n_steps)
+{
+    /* push rbx; push rbp; mov rbp, rdi; mov rbx, rsi; sub rsp, 8 (which aligns the stack for pow()) */
+    static const uint8_t prologue[] = {0x53, 0x55, 0x48, 0x89, 0xFD, 0x48, 0x89, 0xF3, 0x48, 0x83, 0xEC, 0x08};
+    static const uint8_t epilogue[] = {0x48, 0x83, 0xC4, 0x08, 0x5D, 0x5B, 0xC3}; // add rsp, 8; pop rbp; pop rbx; ret
+    static const uint8_t mov_rax_imm64[] = {0x48, 0xB8};
+    static const uint8_t movq_xmm0_rax[] = {0x66, 0x48, 0x0F, 0x6E, 0xC0};
+    static const uint8_t call_rax[] = {0xFF, 0xD0};
+    static const uint8_t movapd_xmm1_xmm0[] = {0x66, 0x0F, 0x28, 0xC8};
+    static const uint8_t mulsd_xmm0_xmm1[] = {0xF2, 0x0F, 0x59, 0xC1};
+    const double         ten = 10.0;
+    double (*p_pow)(double, double) = pow;
+    uint64_t             bits;
+    int                  in_xmm0 = -1; // The number XMM0 holds, if any
+    uint8_t              result_slot = (uint8_t)(p_parsed_expression->n_numbers - 1);
+    uint8_t              offsets[MAX_NUMS_AND_OPS];
+    bool                 b_written[MAX_NUMS_AND_OPS] = {false};
+    uint8_t              offset = 0;
+
+    for (int number = 0; number < p_parsed_expression->n_numbers; number++)
+    {
+        offsets[number] = offset;
+        offset = (uint8_t)(offset + parsed_literal_sizes[PARSED_LITERAL(p_parsed_expression, number)]);
+    }
+
+    emit_bytes(p_buffer, prologue, sizeof(prologue));
+
+    for (size_t step = 0; step < n_steps; step++)
+    {
+        const CalcJitStep_t *p_step = &p_steps[step];
+        uint8_t              opcode;
+
+        switch (p_step->operator)
+        {
+            case 'E': // left * pow(10.0, right), multiplied in that order
+                emit_load_number(p_buffer, 1, p_step->right, b_written, p_parsed_expression, offsets);
+                memcpy(&bits, &ten, sizeof(bits));
+                emit_bytes(p_buffer, mov_rax_imm64, sizeof(mov_rax_imm64));
+                emit_u64(p_buffer, bits);
+                emit_bytes(p_buffer, movq_xmm0_rax, sizeof(movq_xmm0_rax));
+                memcpy(&bits, &p_pow, sizeof(bits));
+                emit_bytes(p_buffer, mov_rax_imm64, sizeof(mov_rax_imm64));
+                emit_u64(p_buffer, bits);
+                emit_bytes(p_buffer, call_rax, sizeof(call_rax));
+                emit_bytes(p_buffer, movapd_xmm1_xmm0, sizeof(movapd_xmm1_xmm0));
+                emit_load_number(p_buffer, 0, p_step->left, b_written, p_parsed_expression, offsets);
+                emit_bytes(p_buffer, mulsd_xmm0_xmm1, sizeof(mulsd_xmm0_xmm1));
+                break;
+
+            default:
+                opcode = ('+' == p_step->operator)   ? OPCODE_ADDSD
+                         : ('-' == p_step->operator) ? OPCODE_SUBSD
+                         : ('x' == p_step->operator) ? OPCODE_MULSD
+                                                     : OPCODE_DIVSD;
+                if (in_xmm0 != p_step->left)
+                {
+                    emit_load_number(p_buffer, 0, p_step->left, b_written, p_parsed_expression, offsets);
+                }
+                if (b_written[p_step->right])
+                {
+                    emit_sse_slot(p_buffer, opcode, 0, p_step->right);
+                }
+                else if (PARSED_LITERAL_DOUBLE == PARSED_LITERAL(p_parsed_expression, p_step->right))
+                {
+                    const uint8_t prefix[] = {0xF2, 0x0F, opcode};
+
+                    emit_bytes(p_buffer, prefix, sizeof(prefix));
+                    emit_modrm(p_buffer, 0, REGISTER_RBP, offsets[p_step->right]);
+                }
+                else
+                {
+                    const uint8_t xmm0_xmm1[] = {0xF2, 0x0F, opcode, 0xC1};
+
+                    emit_load_literal(p_buffer, 1, PARSED_LITERAL(p_parsed_expression, p_step->right),
+                                      offsets[p_step->right]);
+                    emit_bytes(p_buffer, xmm0_xmm1, sizeof(xmm0_xmm1));
+                }
+                break;
+        }
+        emit_sse_slot(p_buffer, OPCODE_MOVSD_STORE, 0, p_step->right);
+        b_written[p_step->right] = true;
+        in_xmm0 = p_step->right;
+    }
+
+    if (in_xmm0 != result_slot)
+    {
+        emit_load_number(p_buffer, 0, result_slot, b_written, p_parsed_expression, offsets);
+    }
+    emit_bytes(p_buffer, epilogue, sizeof(epilogue));
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
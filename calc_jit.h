@@ -0,0 +1,112 @@
+/**
+ * $File: calc_jit.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_jit.h
+ *
+ *  @brief     A small x86-64 compiler for the host tools: evaluates an expression with
+ *             native code made for its shape (its sequence of operators), so bulk
+ *             workloads that repeat a few shapes over many operand sets skip the
+ *             interpreter's passes over the operators.
+ *
+ *             An expression is checked and split into tokens by TokeniseExpression() as
+ *             usual. Its shape (its operators and the encoding of each packed number) is
+ *             looked up in a table; once a shape has been seen CALC_JIT_HOT_COUNT times it
+ *             is compiled. The compiled code reads each number straight from the packed
+ *             literals, with the load and conversion its encoding needs, and does exactly
+ *             the arithmetic evaluate_expression() does, in the same order, with SSE2
+ *             scalar instructions (and pow() for E), so the answers are bit-identical.
+ *             Anything not compiled (a cold shape, a full code area, or a host that is not
+ *             x86-64) is evaluated by EvaluateTokens().
+ *
+ *             The code lives in pages that are writable or executable, never both. A
+ *             compiler is not thread safe: give each thread its own.
+ *
+ *             calc_jit_shape_key() and calc_jit_plan_steps() need no compiler and work on
+ *             any host.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calculate_answer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#if defined(__arm__)
+#error "calc_jit.c is for the host build only"
+#endif
+
+#define CALC_JIT_HOT_COUNT     8    //!< Evaluations of a shape before it is compiled.
+#define CALC_JIT_SHAPE_SLOTS   1024 //!< Shapes the table can hold (a power of two).
+#define CALC_JIT_DEFAULT_BYTES (256u * 1024u)
+#define CALC_JIT_MAX_STEPS     (MAX_NUMS_AND_OPS - 1) //!< One per operator.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+typedef struct CalcJit CalcJit_t;
+
+/* A shape: its operators and the encoding of each number, so every expression of a shape
+   has its numbers at the same offsets in literal[]. Equal keys are equal shapes. */
+typedef struct
+{
+    uint64_t operators; /* 3 bits per operator, their count above them and an occupied bit at the top. */
+    uint64_t literals;  /* 3 bits per number, its PARSED_LITERAL_ encoding. */
+} CalcJitShapeKey_t;
+
+/* One arithmetic step of an evaluation: number[right] = number[left] operator number[right]. */
+typedef struct
+{
+    char    operator;
+    uint8_t left;
+    uint8_t right;
+} CalcJitStep_t;
+
+/* What a compiler has done since it was created. */
+typedef struct
+{
+    uint64_t compiled_evaluations;    /* Evaluated by compiled code. */
+    uint64_t interpreted_evaluations; /* Evaluated by EvaluateTokens(). */
+    uint64_t shapes_seen;
+    uint64_t shapes_compiled;
+    uint64_t code_bytes;              /* Used of the code area. */
+} CalcJitStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+CalcJit_t *calc_jit_create(size_t code_bytes);
+void       calc_jit_destroy(CalcJit_t *p_jit);
+double     calc_jit_evaluate(CalcJit_t *p_jit, const ParsedExpression_t *p_parsed_expression,
+                             uint8_t *p_error_ref_no);
+double     calc_jit_calculate_span(CalcJit_t *p_jit, const char *p_expression, size_t length,
+                                   uint8_t *p_error_ref_no);
+void       calc_jit_stats(const CalcJit_t *p_jit, CalcJitStats_t *p_stats);
+bool       calc_jit_shape_key(const ParsedExpression_t *p_parsed_expression, CalcJitShapeKey_t *p_key);
+size_t     calc_jit_plan_steps(const ParsedExpression_t *p_parsed_expression, CalcJitStep_t *p_steps);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
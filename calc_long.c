@@ -0,0 +1,672 @@
+/**
+ * $File: calc_long.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_long.c
+ *
+ *  @brief     Parallel evaluation of very long expressions (host only). See calc_long.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_long.h"
+#include "calc_validate.h"
+#include "calculate_answer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define INITIAL_TERMS 1024 //!< First allocation of a chunk's term list.
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* A part of the text between two top-level + or - signs (or an end), and its results. */
+typedef struct
+{
+    const char *p_text;
+    size_t      length;
+    char        leading_operator; /* The + or - before the chunk ('+' for the first). */
+    bool        b_store_terms;    /* Keep each term (not needed by CALC_LONG_PER_THREAD). */
+    pthread_t   thread;
+    bool        b_threaded;
+    uint8_t     syntax_error;     /* From calc_validate(). */
+    uint8_t     token_error;      /* The first 6 or 7 found while splitting into tokens. */
+    bool        b_adjacent_e;     /* Error 10 (only reported if there is no token error). */
+    bool        b_out_of_memory;
+    double     *p_values;         /* Each term's value... */
+    bool       *p_minus;          /* ...and whether it follows a - sign. */
+    size_t      n_terms;
+    size_t      capacity;
+    bool        b_has_minus;      /* A - sign leads one of the terms. */
+    double      head_sum;         /* The terms before the first - sign, added in order. */
+    double      tail_sum;         /* The terms from the first - sign on, added in order. */
+} Chunk_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static size_t cut_chunks(const char *p_expression, size_t length, size_t n_chunks, bool b_store_terms,
+                         Chunk_t *p_chunks);
+static void  *chunk_main(void *p_argument);
+static void   evaluate_chunk(Chunk_t *p_chunk);
+static void   add_term(Chunk_t *p_chunk, const char *p_term, size_t length, size_t n_numbers, char operator);
+static double evaluate_term(const char *p_term, size_t length, size_t n_numbers, const char *p_split_operators);
+static uint8_t combine_errors(const Chunk_t *p_chunks, size_t n_chunks);
+static double reduce_sequential(const Chunk_t *p_chunks, size_t n_chunks);
+static double reduce_pairwise(const Chunk_t *p_chunks, size_t n_chunks, size_t n_terms, uint8_t *p_error_ref_no);
+static double reduce_per_thread(const Chunk_t *p_chunks, size_t n_chunks);
+static double pairwise_sum(const double *p_values, size_t count);
+static bool   is_number_character(char character);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check and evaluate a long expression, using up to n_threads threads.
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [in] n_threads The most threads to use (0 is taken as 1). Each gets at least
+ * CALC_LONG_MIN_CHUNK bytes of the text, so a short expression uses fewer.
+ * @param   [in] reduction The order in which the terms are added up (see calc_long.h).
+ * @param   [out] p_error_ref_no The reference number of the error, if any.
+ * @param   [out] p_stats What was done, or NULL.
+ * @return  The answer, or 0.0 if there was an error.
+ **/
+double
+calc_long_evaluate(const char *p_expression, size_t length, unsigned n_threads, CalcLongReduction_t reduction,
+                   uint8_t *p_error_ref_no, CalcLongStats_t *p_stats)
+{
+    Chunk_t chunks[CALC_LONG_MAX_THREADS];
+    size_t  n_chunks = length / CALC_LONG_MIN_CHUNK;
+    size_t  n_terms = 0;
+    double  answer = 0.0;
+
+    if (n_chunks > n_threads)
+    {
+        n_chunks = n_threads;
+    }
+    if (n_chunks > CALC_LONG_MAX_THREADS)
+    {
+        n_chunks = CALC_LONG_MAX_THREADS;
+    }
+    if (0u == n_chunks)
+    {
+        n_chunks = 1;
+    }
+    n_chunks = cut_chunks(p_expression, length, n_chunks, (CALC_LONG_PER_THREAD != reduction), chunks);
+
+    /* The first chunk is done by this thread; a chunk whose thread cannot be started is
+     * done here as well. */
+    for (size_t chunk_no = 1; chunk_no < n_chunks; chunk_no++)
+    {
+        chunks[chunk_no].b_threaded =
+            (0 == pthread_create(&chunks[chunk_no].thread, NULL, chunk_main, &chunks[chunk_no]));
+    }
+    evaluate_chunk(&chunks[0]);
+    for (size_t chunk_no = 1; chunk_no < n_chunks; chunk_no++)
+    {
+        if (chunks[chunk_no].b_threaded)
+        {
+            pthread_join(chunks[chunk_no].thread, NULL);
+        }
+        else
+        {
+            evaluate_chunk(&chunks[chunk_no]);
+        }
+    }
+
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        n_terms += chunks[chunk_no].n_terms;
+    }
+
+    *p_error_ref_no = combine_errors(chunks, n_chunks);
+    if (0u == *p_error_ref_no)
+    {
+        switch (reduction)
+        {
+            case CALC_LONG_SEQUENTIAL:
+                answer = reduce_sequential(chunks, n_chunks);
+                break;
+            case CALC_LONG_PAIRWISE:
+                answer = reduce_pairwise(chunks, n_chunks, n_terms, p_error_ref_no);
+                break;
+            default: // CALC_LONG_PER_THREAD
+                answer = reduce_per_thread(chunks, n_chunks);
+                break;
+        }
+    }
+
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        free(chunks[chunk_no].p_values);
+        free(chunks[chunk_no].p_minus);
+    }
+    if (NULL != p_stats)
+    {
+        p_stats->terms = n_terms;
+        p_stats->chunks = n_chunks;
+    }
+
+    return answer;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Cut the text into chunks at top-level + and - signs.
+ *
+ * A chunk boundary is a + or - with a digit or '.' on each side, so it is a top-level
+ * sign whatever else is wrong with the text, and each chunk starts and ends with part
+ * of a number. The character checks can then be run on each chunk separately and give
+ * what they give for the whole text (see combine_errors()). If no such sign is found
+ * after the place a boundary should be, there are fewer chunks.
+ *
+ * @param   [in] p_expression The text.
+ * @param   [in] length The number of characters.
+ * @param   [in] n_chunks The number of chunks wanted.
+ * @param   [in] b_store_terms Whether the chunks keep each term.
+ * @param   [out] p_chunks The chunks.
+ * @return  The number of chunks made (at least 1).
+ **/
+static size_t
+cut_chunks(const char *p_expression, size_t length, size_t n_chunks, bool b_store_terms, Chunk_t *p_chunks)
+{
+    size_t n_made = 0;
+    size_t start = 0;
+    char   leading_operator = '+';
+
+    for (size_t chunk_no = 1; chunk_no <= n_chunks; chunk_no++)
+    {
+        size_t end = length;
+
+        if (chunk_no < n_chunks)
+        {
+            size_t position = (length / n_chunks) * chunk_no;
+
+            if (position <= start)
+            {
+                position = start + 1u;
+            }
+            for (; position + 1u < length; position++)
+            {
+                if ((('+' == p_expression[position]) || ('-' == p_expression[position])) &&
+                    is_number_character(p_expression[position - 1u]) &&
+                    is_number_character(p_expression[position + 1u]))
+                {
+                    break;
+                }
+            }
+            if (position + 1u < length)
+            {
+                end = position;
+            }
+        }
+
+        p_chunks[n_made].p_text = &p_expression[start];
+        p_chunks[n_made].length = end - start;
+        p_chunks[n_made].leading_operator = leading_operator;
+        p_chunks[n_made].b_store_terms = b_store_terms;
+        p_chunks[n_made].b_threaded = false;
+        p_chunks[n_made].syntax_error = 0;
+        p_chunks[n_made].token_error = 0;
+        p_chunks[n_made].b_adjacent_e = false;
+        p_chunks[n_made].b_out_of_memory = false;
+        p_chunks[n_made].p_values = NULL;
+        p_chunks[n_made].p_minus = NULL;
+        p_chunks[n_made].n_terms = 0;
+        p_chunks[n_made].capacity = 0;
+        p_chunks[n_made].b_has_minus = false;
+        p_chunks[n_made].head_sum = 0.0;
+        p_chunks[n_made].tail_sum = 0.0;
+        n_made++;
+
+        if (end == length)
+        {
+            break;
+        }
+        leading_operator = p_expression[end];
+        start = end + 1u;
+    }
+
+    return n_made;
+}
+
+/* The body of each extra thread. */
+static void *
+chunk_main(void *p_argument)
+{
+    evaluate_chunk(p_argument);
+    return NULL;
+}
+
+/**
+ * @brief   Check a chunk and evaluate its terms.
+ *
+ * After the character checks, the chunk is split into tokens as identify_tokens()
+ * does it: a number (at most MAX_NUMBER_STRING_LENGTH - 1 characters, or error 7),
+ * then an operator or the end. Anything else where a number must be is error 6: after
+ * the character checks that can only be a - after an operator, or at the start. Two
+ * E operators in a row are error 10, which is only reported if no token error is
+ * found anywhere, so the splitting goes on.
+ *
+ * @param   [in,out] p_chunk The chunk.
+ * @return  None.
+ **/
+static void
+evaluate_chunk(Chunk_t *p_chunk)
+{
+    const char *p_text = p_chunk->p_text;
+    size_t      length = p_chunk->length;
+    size_t      position = 0;
+    size_t      term_start = 0;
+    size_t      n_numbers = 0;
+    char        term_operator = p_chunk->leading_operator;
+    char        previous_operator = '\0';
+
+    calc_validate(p_text, length, &p_chunk->syntax_error);
+    if (0u != p_chunk->syntax_error)
+    {
+        return;
+    }
+
+    while (position < length)
+    {
+        size_t number_length = 0;
+
+        if (!is_number_character(p_text[position]))
+        {
+            p_chunk->token_error = 6;
+            return;
+        }
+        while ((position < length) && (number_length < MAX_NUMBER_STRING_LENGTH - 1) &&
+               is_number_character(p_text[position]))
+        {
+            position++;
+            number_length++;
+        }
+        n_numbers++;
+        if (position == length)
+        {
+            break;
+        }
+        if (is_number_character(p_text[position]))
+        {
+            p_chunk->token_error = 7; // The number is too long
+            return;
+        }
+
+        /* The character checks leave only an operator here. */
+        if (('+' == p_text[position]) || ('-' == p_text[position]))
+        {
+            add_term(p_chunk, &p_text[term_start], position - term_start, n_numbers, term_operator);
+            term_operator = p_text[position];
+            term_start = position + 1u;
+            n_numbers = 0;
+        }
+        else if (('E' == p_text[position]) && ('E' == previous_operator))
+        {
+            p_chunk->b_adjacent_e = true;
+        }
+        previous_operator = p_text[position];
+        position++;
+    }
+
+    add_term(p_chunk, &p_text[term_start], length - term_start, n_numbers, term_operator);
+}
+
+/**
+ * @brief   Evaluate a term of a chunk and add it to the chunk's list and sums.
+ * @param   [in,out] p_chunk The chunk.
+ * @param   [in] p_term The term's text.
+ * @param   [in] length Its length.
+ * @param   [in] n_numbers The numbers in it.
+ * @param   [in] operator The + or - before it.
+ * @return  None.
+ **/
+static void
+add_term(Chunk_t *p_chunk, const char *p_term, size_t length, size_t n_numbers, char operator)
+{
+    double value;
+
+    /* After an error the answer is not used. */
+    if (p_chunk->b_adjacent_e || p_chunk->b_out_of_memory)
+    {
+        return;
+    }
+
+    value = evaluate_term(p_term, length, n_numbers, "x/");
+    if ('-' == operator)
+    {
+        p_chunk->b_has_minus = true;
+    }
+    if (p_chunk->b_has_minus)
+    {
+        p_chunk->tail_sum += value;
+    }
+    else
+    {
+        p_chunk->head_sum += value;
+    }
+
+    if (p_chunk->b_store_terms)
+    {
+        if (p_chunk->n_terms == p_chunk->capacity)
+        {
+            size_t  capacity = (0u == p_chunk->capacity) ? INITIAL_TERMS : 2u * p_chunk->capacity;
+            double *p_values = realloc(p_chunk->p_values, capacity * sizeof(double));
+            bool   *p_minus;
+
+            if (NULL != p_values)
+            {
+                p_chunk->p_values = p_values;
+            }
+            p_minus = realloc(p_chunk->p_minus, capacity * sizeof(bool));
+            if (NULL != p_minus)
+            {
+                p_chunk->p_minus = p_minus;
+            }
+            if ((NULL == p_values) || (NULL == p_minus))
+            {
+                p_chunk->b_out_of_memory = true;
+                return;
+            }
+            p_chunk->capacity = capacity;
+        }
+        p_chunk->p_values[p_chunk->n_terms] = value;
+        p_chunk->p_minus[p_chunk->n_terms] = ('-' == operator);
+    }
+    p_chunk->n_terms++;
+}
+
+/**
+ * @brief   Evaluate a term (a product chain, with no + or -) as the engine's E, / and x
+ * passes would.
+ *
+ * A term the engine can hold is given to CalculateAnswerSpan(). A longer one is split
+ * at its x signs, and a part that is still too long at its / signs. Each pass of the
+ * engine works from left to right, always putting the result in the right-hand number,
+ * so the term is the parts combined from the left: ((p0 x p1) x p2)... Without two E
+ * operators in a row, a part between / signs has at most two numbers.
+ *
+ * @param   [in] p_term The term's text (already checked).
+ * @param   [in] length Its length.
+ * @param   [in] n_numbers The numbers in it.
+ * @param   [in] p_split_operators The operators still to split at, in order.
+ * @return  The value.
+ **/
+static double
+evaluate_term(const char *p_term, size_t length, size_t n_numbers, const char *p_split_operators)
+{
+    uint8_t error_ref_no;
+    double  value = 0.0;
+    size_t  part_start = 0;
+    size_t  part_numbers = 1;
+    bool    b_first_part = true;
+
+    if ((n_numbers <= MAX_NUMS_AND_OPS) || ('\0' == p_split_operators[0]))
+    {
+        return CalculateAnswerSpan(p_term, length, &error_ref_no);
+    }
+
+    for (size_t position = 0; position <= length; position++)
+    {
+        if ((position == length) || (p_split_operators[0] == p_term[position]))
+        {
+            double part = evaluate_term(&p_term[part_start], position - part_start, part_numbers,
+                                        &p_split_operators[1]);
+
+            if (b_first_part)
+            {
+                value = part;
+                b_first_part = false;
+            }
+            else
+            {
+                value = ('x' == p_split_operators[0]) ? value * part : value / part;
+            }
+            part_start = position + 1u;
+            part_numbers = 1;
+        }
+        else if (!is_number_character(p_term[position]))
+        {
+            part_numbers++;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief   Find the error the engine would report for the whole text.
+ *
+ * The engine runs the character checks on the whole text (an invalid character, 4,
+ * before a bad first character, 7, before a bad last character, 8, before two
+ * adjacent operators, 9, before an E followed by a fraction, 11), then splits it into
+ * tokens from left to right (6 or 7), then looks for two E operators in a row (10).
+ * With the chunks cut as cut_chunks() cuts them, only the first chunk can find a bad
+ * first character and only the last a bad last character, so the first error of the
+ * whole text is the chunks' error that comes first in that list.
+ *
+ * @param   [in] p_chunks The evaluated chunks.
+ * @param   [in] n_chunks The number of them.
+ * @return  The error reference number, or 0.
+ **/
+static uint8_t
+combine_errors(const Chunk_t *p_chunks, size_t n_chunks)
+{
+    static const uint8_t syntax_errors[] = {2, 4, 7, 8, 9, 11};
+
+    for (size_t error_no = 0; error_no < sizeof(syntax_errors); error_no++)
+    {
+        for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+        {
+            if (syntax_errors[error_no] == p_chunks[chunk_no].syntax_error)
+            {
+                return syntax_errors[error_no];
+            }
+        }
+    }
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        if (0u != p_chunks[chunk_no].token_error)
+        {
+            return p_chunks[chunk_no].token_error;
+        }
+    }
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        if (p_chunks[chunk_no].b_adjacent_e)
+        {
+            return 10; // "Two adjacent" "E operators"
+        }
+    }
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        if (p_chunks[chunk_no].b_out_of_memory)
+        {
+            return 1; // "Unidentified" "error"
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief   Add up the terms as the engine's + and - passes do.
+ *
+ * The + pass adds each run of terms joined by + from the left; the - pass then
+ * subtracts each run from the result so far: (t0 + t1) - (t2 + t3) - t4.
+ *
+ * @param   [in] p_chunks The evaluated chunks, with their terms.
+ * @param   [in] n_chunks The number of them.
+ * @return  The answer.
+ **/
+static double
+reduce_sequential(const Chunk_t *p_chunks, size_t n_chunks)
+{
+    double answer = 0.0;
+    double run = 0.0;
+    bool   b_first_term = true;
+    bool   b_first_run = true;
+
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        for (size_t term_no = 0; term_no < p_chunks[chunk_no].n_terms; term_no++)
+        {
+            double value = p_chunks[chunk_no].p_values[term_no];
+
+            if (b_first_term)
+            {
+                run = value;
+                b_first_term = false;
+            }
+            else if (!p_chunks[chunk_no].p_minus[term_no])
+            {
+                run = run + value;
+            }
+            else
+            {
+                answer = b_first_run ? run : answer - run;
+                b_first_run = false;
+                run = value;
+            }
+        }
+    }
+
+    return b_first_run ? run : answer - run;
+}
+
+/**
+ * @brief   Add up the terms in a tree fixed by the number of terms alone.
+ *
+ * Every term after the first - sign is subtracted. The signed terms are added in
+ * order in blocks of CALC_LONG_BLOCK_TERMS, and the blocks' sums in pairs.
+ *
+ * @param   [in] p_chunks The evaluated chunks, with their terms.
+ * @param   [in] n_chunks The number of them.
+ * @param   [in] n_terms The number of terms in all of them.
+ * @param   [out] p_error_ref_no Set to 1 if out of memory.
+ * @return  The answer.
+ **/
+static double
+reduce_pairwise(const Chunk_t *p_chunks, size_t n_chunks, size_t n_terms, uint8_t *p_error_ref_no)
+{
+    size_t  n_blocks = (n_terms + CALC_LONG_BLOCK_TERMS - 1u) / CALC_LONG_BLOCK_TERMS;
+    double *p_block_sums = malloc(n_blocks * sizeof(double));
+    size_t  block_no = 0;
+    size_t  in_block = 0;
+    bool    b_minus = false;
+    double  answer;
+
+    if (NULL == p_block_sums)
+    {
+        *p_error_ref_no = 1; // "Unidentified" "error"
+        return 0.0;
+    }
+
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        for (size_t term_no = 0; term_no < p_chunks[chunk_no].n_terms; term_no++)
+        {
+            double value = p_chunks[chunk_no].p_values[term_no];
+
+            b_minus = b_minus || p_chunks[chunk_no].p_minus[term_no];
+            value = b_minus ? -value : value;
+            p_block_sums[block_no] = (0u == in_block) ? value : p_block_sums[block_no] + value;
+            if (CALC_LONG_BLOCK_TERMS == ++in_block)
+            {
+                block_no++;
+                in_block = 0;
+            }
+        }
+    }
+
+    answer = pairwise_sum(p_block_sums, n_blocks);
+    free(p_block_sums);
+    return answer;
+}
+
+/**
+ * @brief   Add up each chunk's sums, then the chunks' results in pairs.
+ *
+ * A chunk's terms before its first - sign are subtracted too if an earlier chunk has
+ * a - sign.
+ *
+ * @param   [in] p_chunks The evaluated chunks.
+ * @param   [in] n_chunks The number of them.
+ * @return  The answer.
+ **/
+static double
+reduce_per_thread(const Chunk_t *p_chunks, size_t n_chunks)
+{
+    double partials[CALC_LONG_MAX_THREADS];
+    bool   b_minus = false;
+
+    for (size_t chunk_no = 0; chunk_no < n_chunks; chunk_no++)
+    {
+        double head_sum = b_minus ? -p_chunks[chunk_no].head_sum : p_chunks[chunk_no].head_sum;
+
+        partials[chunk_no] = head_sum - p_chunks[chunk_no].tail_sum;
+        b_minus = b_minus || p_chunks[chunk_no].b_has_minus;
+    }
+
+    return pairwise_sum(partials, n_chunks);
+}
+
+/**
+ * @brief   Add numbers in pairs: the two halves are added up separately, then together.
+ * @param   [in] p_values The numbers.
+ * @param   [in] count How many there are.
+ * @return  The sum (0.0 for none).
+ **/
+static double
+pairwise_sum(const double *p_values, size_t count)
+{
+    if (0u == count)
+    {
+        return 0.0;
+    }
+    if (1u == count)
+    {
+        return p_values[0];
+    }
+    return pairwise_sum(p_values, count / 2u) + pairwise_sum(&p_values[count / 2u], count - count / 2u);
+}
+
+/* A character that is part of a number. */
+static bool
+is_number_character(char character)
+{
+    return ((character >= '0') && (character <= '9')) || ('.' == character);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,91 @@
+/**
+ * $File: calc_long.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_long.h
+ *
+ *  @brief     Evaluation of very long expressions for the host tools: thousands or millions
+ *             of terms, with no MAX_NUMS_AND_OPS limit, split across threads.
+ *
+ *             The engine's passes (E, /, x, +, -) make an expression a list of product
+ *             chains (terms) joined by + and -: every term is independent until the +
+ *             and - passes add the terms up. So the text is cut at top-level + and -
+ *             signs into one chunk per thread. Each thread checks its chunk and evaluates
+ *             each term of it with CalculateAnswerSpan() (a term of more than
+ *             MAX_NUMS_AND_OPS numbers is split again at its x and / signs). The terms are
+ *             then added up in one of three orders:
+ *               CALC_LONG_SEQUENTIAL  The engine's order, one term after another: the
+ *                                     answer is bit-identical to the engine's (were it
+ *                                     built with room for the tokens), whatever the
+ *                                     number of threads.
+ *               CALC_LONG_PAIRWISE    A fixed tree: blocks of CALC_LONG_BLOCK_TERMS terms,
+ *                                     then pairs of blocks. The answer is the same for any
+ *                                     number of threads, and usually more accurate.
+ *               CALC_LONG_PER_THREAD  Each thread adds up its own terms, then the threads'
+ *                                     sums are added in pairs. Nothing is stored per term,
+ *                                     but the answer depends on the number of threads.
+ *
+ *             The error numbers are those of the engine, found in the same order, except
+ *             that there is no "too many numbers" error. Error 1 here means out of memory.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#if defined(__arm__)
+#error "calc_long.c is for the host build only"
+#endif
+
+#define CALC_LONG_MAX_THREADS 64
+#define CALC_LONG_MIN_CHUNK   16384 //!< Least text per thread, in bytes.
+#define CALC_LONG_BLOCK_TERMS 1024  //!< Terms added in order at the leaves of the pairwise tree.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+typedef enum
+{
+    CALC_LONG_SEQUENTIAL,
+    CALC_LONG_PAIRWISE,
+    CALC_LONG_PER_THREAD
+} CalcLongReduction_t;
+
+/* What one evaluation did. */
+typedef struct
+{
+    size_t terms;  /* Terms evaluated. */
+    size_t chunks; /* Chunks the text was cut into, one per thread. */
+} CalcLongStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+double calc_long_evaluate(const char *p_expression, size_t length, unsigned n_threads,
+                          CalcLongReduction_t reduction, uint8_t *p_error_ref_no, CalcLongStats_t *p_stats);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,468 @@
+/**
+ * $File: calc_prefix.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_prefix.c
+ *
+ *  @brief     Batch evaluator with shared-prefix reuse (host only). See calc_prefix.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_prefix.h"
+#include "answer_cache.h"
+#include "calculate_answer.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define ROOT    0u         //!< The empty prefix; nodes are numbered from 1 (their slot + 1).
+#define NO_NODE UINT32_MAX //!< A prefix that is not in the trie.
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* The state of the engine's + and - passes after a prefix that ends with a sign: the
+   result of the runs of terms finished by a - sign, the run being added up, and the sign
+   the next term follows. */
+typedef struct
+{
+    double answer;
+    double run;
+    bool   b_first_term;
+    bool   b_first_run;
+    char   sign;
+} FoldState_t;
+
+/* A prefix: its parent's prefix, one more term and a sign. */
+typedef struct
+{
+    uint32_t    parent;
+    uint8_t     length;    /* Of the term; 0 for an empty slot. */
+    uint8_t     n_numbers; /* In the whole prefix. */
+    bool        b_ready;   /* The state is known; a prefix seen once only holds its key. */
+    char        term[CALC_PREFIX_TERM_SIZE];
+    FoldState_t state;     /* After the sign. */
+} PrefixNode_t;
+
+struct CalcPrefix
+{
+    CalcPrefixStats_t stats;
+    PrefixNode_t      nodes[CALC_PREFIX_SLOTS];
+};
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static double    evaluate_item(CalcPrefix_t *p_prefix, const char *p_input, size_t length, uint8_t *p_error_ref_no);
+static uint32_t  find_node(const CalcPrefix_t *p_prefix, uint32_t parent, const char *p_term, size_t length,
+                           char sign, uint32_t *p_slot);
+static void      insert_node(CalcPrefix_t *p_prefix, uint32_t slot, uint32_t parent, const char *p_term,
+                             size_t length, char sign, size_t n_numbers, const FoldState_t *p_state);
+static uint32_t  node_hash(uint32_t parent, const char *p_term, size_t length, char sign);
+static void      add_term(FoldState_t *p_state, double value);
+static void      add_sign(FoldState_t *p_state, char sign);
+static size_t    count_numbers(const char *p_term, size_t length);
+static bool      is_number_character(char character);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Create an evaluator with an empty trie.
+ * @param   None.
+ * @return  The evaluator, or NULL if out of memory.
+ **/
+CalcPrefix_t *
+calc_prefix_create(void)
+{
+    return calloc(1, sizeof(CalcPrefix_t));
+}
+
+/**
+ * @brief   Free an evaluator.
+ * @param   [in] p_prefix The evaluator, or NULL.
+ * @return  None.
+ **/
+void
+calc_prefix_destroy(CalcPrefix_t *p_prefix)
+{
+    free(p_prefix);
+}
+
+/**
+ * @brief   Evaluate an array of expressions as CalculateAnswerBatch() does, reusing the
+ * completed terms of prefixes seen before.
+ * @param   [in] p_prefix The evaluator.
+ * @param   [in] pp_inputs The null-terminated expressions.
+ * @param   [in] n_items The number of expressions.
+ * @param   [in] input_buffer_size The size of the buffer each expression is in (a null
+ * must be found within it).
+ * @param   [out] p_answers n_items answers (0.0 for an error).
+ * @param   [out] p_error_ref_nos n_items error reference numbers (0 for none).
+ * @return  The number of expressions evaluated without an error.
+ **/
+size_t
+calc_prefix_batch(CalcPrefix_t *p_prefix, const char *const *pp_inputs, size_t n_items, uint8_t input_buffer_size,
+                  double *p_answers, uint8_t *p_error_ref_nos)
+{
+    size_t n_valid = 0;
+
+    for (size_t item = 0; item < n_items; item++)
+    {
+        const char *p_input = pp_inputs[item];
+        size_t      length = 0;
+
+        p_answers[item] = 0.0;
+        p_error_ref_nos[item] = 0;
+
+        /* As find_length(): an empty string is left for the syntax checks to report. */
+        if ('\0' != p_input[0])
+        {
+            while ((length < input_buffer_size) && ('\0' != p_input[length]))
+            {
+                length++;
+            }
+            if (length == input_buffer_size)
+            {
+                p_error_ref_nos[item] = 3; // "No null or too" "long I/P string"
+                continue;
+            }
+        }
+
+        p_answers[item] = evaluate_item(p_prefix, p_input, length, &p_error_ref_nos[item]);
+        n_valid += (0u == p_error_ref_nos[item]);
+    }
+    p_prefix->stats.items += n_items;
+
+    return n_valid;
+}
+
+/**
+ * @brief   Check and evaluate an expression given by its start and length, as
+ * CalculateAnswerSpan() does, reusing the completed terms of prefixes seen before.
+ * @param   [in] p_prefix The evaluator.
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [out] p_error_ref_no The error code, 0 if there is no error.
+ * @return  The answer, exactly as CalculateAnswerSpan() gives it.
+ **/
+double
+calc_prefix_calculate_span(CalcPrefix_t *p_prefix, const char *p_expression, size_t length, uint8_t *p_error_ref_no)
+{
+    *p_error_ref_no = 0;
+    p_prefix->stats.items++;
+    return evaluate_item(p_prefix, p_expression, length, p_error_ref_no);
+}
+
+/**
+ * @brief   Read an evaluator's counters.
+ * @param   [in] p_prefix The evaluator.
+ * @param   [out] p_stats The counters.
+ * @return  None.
+ **/
+void
+calc_prefix_stats(const CalcPrefix_t *p_prefix, CalcPrefixStats_t *p_stats)
+{
+    *p_stats = p_prefix->stats;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Evaluate one expression term by term, from the longest prefix in the trie.
+ *
+ * A top-level sign is a + or - after a digit or '.'; any other + or - is left in its
+ * term, where it is an error. If every term passes CalculateAnswerSpan() on its own,
+ * and there are no more numbers than the engine holds, the whole expression passes
+ * the engine's checks too: the terms start and end with numbers, so the signs between
+ * them break none of the rules. The answer is then the terms' values added up as the
+ * + and - passes do (see add_term()), which is bit-identical. Otherwise the engine
+ * evaluates the whole expression, to report its first error.
+ *
+ * @param   [in,out] p_prefix The evaluator.
+ * @param   [in] p_input The expression.
+ * @param   [in] length Its length.
+ * @param   [out] p_error_ref_no The reference number of the error, if any.
+ * @return  The answer, or 0.0 if there was an error.
+ **/
+static double
+evaluate_item(CalcPrefix_t *p_prefix, const char *p_input, size_t length, uint8_t *p_error_ref_no)
+{
+    FoldState_t state = {0.0, 0.0, true, true, '+'};
+    uint32_t    node = ROOT;
+    size_t      n_numbers = 0;
+    size_t      term_start = 0;
+    double      value = 0.0;
+
+    p_prefix->stats.bytes += length;
+
+    /* Keep room for every term of this item, so no node it uses goes while it is used. */
+    if (p_prefix->stats.nodes + MAX_NUMS_AND_OPS > CALC_PREFIX_NODES)
+    {
+        for (size_t slot = 0; slot < CALC_PREFIX_SLOTS; slot++)
+        {
+            p_prefix->nodes[slot].length = 0;
+        }
+        p_prefix->stats.nodes = 0;
+        p_prefix->stats.resets++;
+    }
+
+    for (size_t position = 1; position < length; position++)
+    {
+        const char *p_term = &p_input[term_start];
+        size_t      term_length = position - term_start;
+        char        sign = p_input[position];
+        uint32_t    slot;
+        uint32_t    child;
+
+        if ((('+' != sign) && ('-' != sign)) || !is_number_character(p_input[position - 1u]))
+        {
+            continue;
+        }
+
+        child = find_node(p_prefix, node, p_term, term_length, sign, &slot);
+        if ((ROOT != child) && p_prefix->nodes[child - 1u].b_ready)
+        {
+            state = p_prefix->nodes[child - 1u].state;
+            n_numbers = p_prefix->nodes[child - 1u].n_numbers;
+            p_prefix->stats.terms_reused++;
+            p_prefix->stats.bytes_reused += term_length + 1u;
+            node = child;
+            term_start = position + 1u;
+            continue;
+        }
+        if ((ROOT == child) && (0u == term_start))
+        {
+            /* The first sight of this first term: note it and leave the item to the engine.
+               Splitting the item costs more than it saves unless the term comes again. */
+            if (CALC_PREFIX_SLOTS != slot)
+            {
+                insert_node(p_prefix, slot, node, p_term, term_length, sign, 0, NULL);
+            }
+            break;
+        }
+
+        value = CalculateAnswerSpan(p_term, term_length, p_error_ref_no);
+        p_prefix->stats.terms_evaluated++;
+        if (0u != *p_error_ref_no)
+        {
+            break;
+        }
+        add_term(&state, value);
+        add_sign(&state, sign);
+        n_numbers += count_numbers(p_term, term_length);
+
+        if (n_numbers > MAX_NUMS_AND_OPS)
+        {
+            child = NO_NODE;
+        }
+        else if (ROOT != child)
+        {
+            insert_node(p_prefix, child - 1u, node, p_term, term_length, sign, n_numbers, &state); // Seen again
+        }
+        else if (CALC_PREFIX_SLOTS != slot)
+        {
+            insert_node(p_prefix, slot, node, p_term, term_length, sign, n_numbers, &state);
+            child = slot + 1u;
+        }
+        else
+        {
+            child = NO_NODE;
+        }
+        node = child;
+        term_start = position + 1u;
+    }
+
+    if ((0u == term_start) || (0u != *p_error_ref_no))
+    {
+        p_prefix->stats.whole_items++;
+        return CalculateAnswerSpan(p_input, length, p_error_ref_no);
+    }
+
+    value = CalculateAnswerSpan(&p_input[term_start], length - term_start, p_error_ref_no);
+    p_prefix->stats.terms_evaluated++;
+    n_numbers += count_numbers(&p_input[term_start], length - term_start);
+    if ((0u != *p_error_ref_no) || (n_numbers > MAX_NUMS_AND_OPS))
+    {
+        p_prefix->stats.whole_items++;
+        return CalculateAnswerSpan(p_input, length, p_error_ref_no);
+    }
+
+    add_term(&state, value);
+    return state.b_first_run ? state.run : state.answer - state.run;
+}
+
+/**
+ * @brief   Look a prefix up in the trie.
+ * @param   [in] p_prefix The evaluator.
+ * @param   [in] parent The prefix before the term: ROOT, a node, or NO_NODE.
+ * @param   [in] p_term The term.
+ * @param   [in] length Its length.
+ * @param   [in] sign The sign after it.
+ * @param   [out] p_slot The empty slot where the prefix would go, or CALC_PREFIX_SLOTS if
+ * it cannot be kept (the parent is not in the trie, or the term is too long).
+ * @return  The prefix's node, or ROOT if it is not in the trie.
+ **/
+static uint32_t
+find_node(const CalcPrefix_t *p_prefix, uint32_t parent, const char *p_term, size_t length, char sign,
+          uint32_t *p_slot)
+{
+    uint32_t slot;
+
+    *p_slot = CALC_PREFIX_SLOTS;
+    if ((NO_NODE == parent) || (length > CALC_PREFIX_TERM_SIZE))
+    {
+        return ROOT;
+    }
+
+    slot = node_hash(parent, p_term, length, sign) & (CALC_PREFIX_SLOTS - 1u);
+    for (;;)
+    {
+        const PrefixNode_t *p_node = &p_prefix->nodes[slot];
+
+        if (0u == p_node->length)
+        {
+            *p_slot = slot;
+            return ROOT;
+        }
+        if ((p_node->parent == parent) && (p_node->length == length) && (p_node->state.sign == sign) &&
+            (0 == memcmp(p_node->term, p_term, length)))
+        {
+            return slot + 1u;
+        }
+        slot = (slot + 1u) & (CALC_PREFIX_SLOTS - 1u); // The table is never full
+    }
+}
+
+/**
+ * @brief   Put a prefix in the trie, or give a prefix already there its state.
+ * @param   [in,out] p_prefix The evaluator.
+ * @param   [in] slot The slot, from find_node().
+ * @param   [in] parent The prefix before the term.
+ * @param   [in] p_term The term.
+ * @param   [in] length Its length.
+ * @param   [in] sign The sign after it.
+ * @param   [in] n_numbers The numbers in the whole prefix.
+ * @param   [in] p_state The state after the sign, or NULL if not known yet.
+ * @return  None.
+ **/
+static void
+insert_node(CalcPrefix_t *p_prefix, uint32_t slot, uint32_t parent, const char *p_term, size_t length,
+            char sign, size_t n_numbers, const FoldState_t *p_state)
+{
+    PrefixNode_t *p_node = &p_prefix->nodes[slot];
+
+    if (0u == p_node->length)
+    {
+        p_node->parent = parent;
+        p_node->length = (uint8_t)length;
+        memcpy(p_node->term, p_term, length);
+        p_node->state.sign = sign;
+        p_prefix->stats.nodes++;
+    }
+    p_node->b_ready = (NULL != p_state);
+    if (p_node->b_ready)
+    {
+        p_node->n_numbers = (uint8_t)n_numbers;
+        p_node->state = *p_state;
+    }
+}
+
+/* Hash of a trie edge: the parent, the term and the sign after it. */
+static uint32_t
+node_hash(uint32_t parent, const char *p_term, size_t length, char sign)
+{
+    uint32_t hash = answer_cache_hash(p_term, length) ^ (parent * 0x9E3779B1u);
+
+    return ('-' == sign) ? hash ^ 0x5BD1E995u : hash;
+}
+
+/**
+ * @brief   Add a term's value to the state, as the + pass does: a term after a + sign is
+ * added to the run, and a term after a - sign starts a new run.
+ * @param   [in,out] p_state The state.
+ * @param   [in] value The term's value.
+ * @return  None.
+ **/
+static void
+add_term(FoldState_t *p_state, double value)
+{
+    if (p_state->b_first_term || ('-' == p_state->sign))
+    {
+        p_state->run = value;
+    }
+    else
+    {
+        p_state->run = p_state->run + value;
+    }
+    p_state->b_first_term = false;
+}
+
+/**
+ * @brief   Add a sign to the state. A - sign finishes the run, which the - pass then
+ * subtracts from the runs before it: (t0 + t1) - (t2 + t3) - t4.
+ * @param   [in,out] p_state The state.
+ * @param   [in] sign The sign.
+ * @return  None.
+ **/
+static void
+add_sign(FoldState_t *p_state, char sign)
+{
+    if ('-' == sign)
+    {
+        p_state->answer = p_state->b_first_run ? p_state->run : p_state->answer - p_state->run;
+        p_state->b_first_run = false;
+    }
+    p_state->sign = sign;
+}
+
+/* The numbers in a term that passed the checks: one more than its operators. */
+static size_t
+count_numbers(const char *p_term, size_t length)
+{
+    size_t n_numbers = 1;
+
+    for (size_t position = 0; position < length; position++)
+    {
+        n_numbers += !is_number_character(p_term[position]);
+    }
+    return n_numbers;
+}
+
+/* A character that is part of a number. */
+static bool
+is_number_character(char character)
+{
+    return ((character >= '0') && (character <= '9')) || ('.' == character);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,352 @@
+/**
+ * $File: calc_stream.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_stream.c
+ *
+ *  @brief     Push evaluation of expressions of any length in constant memory. See
+ *             calc_stream.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_stream.h"
+#include "calculate_answer.h"
+#include <math.h>
+
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define PHASE_INTEGER  0u //!< Digits before the dot.
+#define PHASE_FRACTION 1u //!< Digits after it.
+#define PHASE_IGNORED  2u //!< After a second dot, which simple_atof() stops at.
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void   check_character(CalcStream_t *p_stream, char character);
+static void   read_character(CalcStream_t *p_stream, char character);
+static void   end_number(CalcStream_t *p_stream);
+static void   fold_operator(CalcStream_t *p_stream, char operator);
+static bool   is_operator(char character);
+static bool   is_valid_character(char character);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Start a new expression.
+ * @param   [out] p_stream The state to start.
+ * @return  None.
+ **/
+void
+calc_stream_init(CalcStream_t *p_stream)
+{
+    *p_stream = (CalcStream_t){0};
+    p_stream->b_first_product = true;
+    p_stream->b_first_run = true;
+}
+
+/**
+ * @brief   Check and evaluate the next characters of the expression.
+ * @param   [in,out] p_stream The expression so far.
+ * @param   [in] p_chunk The characters (no null is needed; a null is an invalid character).
+ * @param   [in] length The number of characters (0 is allowed).
+ * @return  None.
+ **/
+void
+calc_stream_feed(CalcStream_t *p_stream, const char *p_chunk, size_t length)
+{
+    for (size_t index = 0; index < length; index++)
+    {
+        /* Error 4 outranks every other error, so once it is found only the length counts. */
+        if (p_stream->b_invalid)
+        {
+            p_stream->length += length - index;
+            return;
+        }
+
+        check_character(p_stream, p_chunk[index]);
+        if (!(p_stream->b_invalid || p_stream->b_bad_start || p_stream->b_adjacent || p_stream->b_e_fraction ||
+              (0u != p_stream->token_error)))
+        {
+            read_character(p_stream, p_chunk[index]);
+        }
+        p_stream->previous = p_chunk[index];
+        p_stream->length++;
+    }
+}
+
+/**
+ * @brief   End the expression and give its answer.
+ * @param   [in,out] p_stream The expression (start it again to use it for another).
+ * @param   [out] p_error_ref_no The reference number of the error, if any: the one the
+ * engine gives for the same characters.
+ * @return  The answer, or 0.0 if there was an error.
+ **/
+double
+calc_stream_finish(CalcStream_t *p_stream, uint8_t *p_error_ref_no)
+{
+    /* The engine's order: stage 1, stage 2, the tokens, stage 3. */
+    if (0u == p_stream->length)
+    {
+        *p_error_ref_no = 2; // "SOFT BUG: Empty"
+    }
+    else if (p_stream->b_invalid)
+    {
+        *p_error_ref_no = 4; // "Invalid char"
+    }
+    else if (p_stream->b_bad_start)
+    {
+        *p_error_ref_no = 7; // "May not start"
+    }
+    else if (is_operator(p_stream->previous))
+    {
+        *p_error_ref_no = 8; // "May not end"
+    }
+    else if (p_stream->b_adjacent)
+    {
+        *p_error_ref_no = 9; // "Two adjacent" "operators"
+    }
+    else if (p_stream->b_e_fraction)
+    {
+        *p_error_ref_no = 11; // "E must be foll-" "owed by integer"
+    }
+    else if (0u != p_stream->token_error)
+    {
+        *p_error_ref_no = p_stream->token_error;
+    }
+    else if (p_stream->b_adjacent_e)
+    {
+        *p_error_ref_no = 10; // "Two adjacent" "E operators"
+    }
+    else
+    {
+        *p_error_ref_no = 0;
+        end_number(p_stream);
+        fold_operator(p_stream, '\0');
+        return p_stream->b_first_run ? p_stream->run : p_stream->answer - p_stream->run;
+    }
+
+    return 0.0;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   The engine's character checks (stages 1 and 2), one character at a time.
+ * @param   [in,out] p_stream The expression so far.
+ * @param   [in] character The next character.
+ * @return  None.
+ **/
+static void
+check_character(CalcStream_t *p_stream, char character)
+{
+    bool b_operator = is_operator(character);
+
+    if (!is_valid_character(character))
+    {
+        p_stream->b_invalid = true;
+        return;
+    }
+
+    if (0u == p_stream->length)
+    {
+        p_stream->b_bad_start = b_operator && ('-' != character);
+    }
+    else if (b_operator && is_operator(p_stream->previous) &&
+             !(('-' == character) && (('x' == p_stream->previous) || ('/' == p_stream->previous) ||
+                                      ('E' == p_stream->previous))))
+    {
+        p_stream->b_adjacent = true;
+    }
+
+    if (b_operator)
+    {
+        p_stream->b_after_e = ('E' == character);
+    }
+    else if (('.' == character) && p_stream->b_after_e)
+    {
+        p_stream->b_e_fraction = true;
+    }
+}
+
+/**
+ * @brief   Read a character into the tokens and fold them, as identify_tokens() and the
+ * evaluation passes would. Only called while no error has been found.
+ * @param   [in,out] p_stream The expression so far.
+ * @param   [in] character The next character (a valid one).
+ * @return  None.
+ **/
+static void
+read_character(CalcStream_t *p_stream, char character)
+{
+    if (is_operator(character))
+    {
+        if (!p_stream->b_in_number)
+        {
+            /* A number was expected: a leading -, or a - after x, / or E. */
+            p_stream->token_error = 6; // "Invalid number"
+            return;
+        }
+        end_number(p_stream);
+        fold_operator(p_stream, character);
+        return;
+    }
+
+    if (!p_stream->b_in_number)
+    {
+        p_stream->b_in_number = true;
+        p_stream->int_part = 0;
+        p_stream->frac_part = 0.0;
+        p_stream->divisor = 10.0;
+        p_stream->number_phase = PHASE_INTEGER;
+        p_stream->number_length = 0;
+    }
+    else if (p_stream->number_length >= (MAX_NUMBER_STRING_LENGTH - 1))
+    {
+        /* extract_number() stops here, and the next token must be an operator. */
+        p_stream->token_error = 7;
+        return;
+    }
+    p_stream->number_length++;
+
+    if ('.' == character)
+    {
+        p_stream->number_phase = (PHASE_INTEGER == p_stream->number_phase) ? PHASE_FRACTION : PHASE_IGNORED;
+    }
+    else if (PHASE_INTEGER == p_stream->number_phase)
+    {
+        p_stream->int_part = p_stream->int_part * 10 + (character - '0');
+    }
+    else if (PHASE_FRACTION == p_stream->number_phase)
+    {
+        p_stream->frac_part += (character - '0') / p_stream->divisor;
+        p_stream->divisor *= 10;
+    }
+}
+
+/**
+ * @brief   Take the number just read as the factor (or as the exponent of one).
+ * @param   [in,out] p_stream The expression so far.
+ * @return  None.
+ **/
+static void
+end_number(CalcStream_t *p_stream)
+{
+    double number = p_stream->int_part + p_stream->frac_part;
+
+    p_stream->b_in_number = false;
+    if ('E' == p_stream->previous_operator)
+    {
+        p_stream->factor = p_stream->factor * pow(10.0, number);
+    }
+    else
+    {
+        p_stream->factor = number;
+    }
+}
+
+/**
+ * @brief   Fold the factor into the levels the operator after it ends.
+ *
+ * An E keeps the factor as the base of the next number. x and / end the factor; + and -
+ * (and the end, '\0') end the term as well, and - ends the run of terms added since the
+ * last - sign, as the engine's + pass runs before its - pass.
+ *
+ * @param   [in,out] p_stream The expression so far.
+ * @param   [in] operator The operator after the factor, or '\0' at the end.
+ * @return  None.
+ **/
+static void
+fold_operator(CalcStream_t *p_stream, char operator)
+{
+    double term;
+
+    if ('E' == operator)
+    {
+        p_stream->b_adjacent_e = p_stream->b_adjacent_e || ('E' == p_stream->previous_operator);
+        p_stream->previous_operator = operator;
+        return;
+    }
+    p_stream->previous_operator = operator;
+
+    if ('/' == p_stream->factor_operator)
+    {
+        p_stream->quotient = p_stream->quotient / p_stream->factor;
+    }
+    else
+    {
+        if ('x' == p_stream->factor_operator)
+        {
+            p_stream->product =
+                p_stream->b_first_product ? p_stream->quotient : p_stream->product * p_stream->quotient;
+            p_stream->b_first_product = false;
+        }
+        p_stream->quotient = p_stream->factor;
+    }
+
+    if (('x' == operator) || ('/' == operator))
+    {
+        p_stream->factor_operator = operator;
+        return;
+    }
+
+    term = p_stream->b_first_product ? p_stream->quotient : p_stream->product * p_stream->quotient;
+    p_stream->run = ('+' == p_stream->term_sign) ? p_stream->run + term : term;
+    if ('-' == operator)
+    {
+        p_stream->answer = p_stream->b_first_run ? p_stream->run : p_stream->answer - p_stream->run;
+        p_stream->b_first_run = false;
+    }
+    p_stream->term_sign = operator;
+    p_stream->factor_operator = '\0';
+    p_stream->b_first_product = true;
+}
+
+/* The engine's operators. */
+static bool
+is_operator(char character)
+{
+    return ('+' == character) || ('-' == character) || ('x' == character) || ('/' == character) ||
+           ('E' == character);
+}
+
+/* The characters syntax_check_stage1() allows. */
+static bool
+is_valid_character(char character)
+{
+    return ((character >= '0') && (character <= '9')) || ('.' == character) || is_operator(character);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,106 @@
+/**
+ * $File: calc_stream.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_stream.h
+ *
+ *  @brief     A push evaluator: an expression of any length is fed in as it arrives (from
+ *             a UART, a file, a socket) and checked and evaluated on the way, in a fixed
+ *             CalcStream_t of a few dozen bytes. No text and no token list is kept.
+ *
+ *             The engine's passes (E, /, x, +, -) give each operator a fixed level, so
+ *             a left-to-right fold needs one value per level: the number being read, the
+ *             E factor, the quotient run, the product of quotient runs (a term), the sum
+ *             of terms since the last - sign, and the answer so far. Each is combined in
+ *             the engine's order, so the answer is bit-identical to CalculateAnswerSpan()
+ *             for the same characters.
+ *
+ *             The error numbers are the engine's, chosen in the engine's order: each check
+ *             keeps a flag, and calc_stream_finish() reports the first that applies
+ *             (2, 4, 7, 8, 9, 11, then the first token error 6 or 7, then 10). There is
+ *             no MAX_NUMS_AND_OPS limit, so error 1 is never given; a number of
+ *             MAX_NUMBER_STRING_LENGTH or more characters is still error 7.
+ *
+ *             Usage:
+ *               CalcStream_t stream;
+ *               calc_stream_init(&stream);
+ *               calc_stream_feed(&stream, p_chunk, chunk_length);    (as often as needed)
+ *               answer = calc_stream_finish(&stream, &error_ref_no);
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* The state of one expression being fed in. Only calc_stream.c looks inside. */
+typedef struct
+{
+    /* The number being read, as simple_atof() reads it. */
+    int      int_part;
+    double   frac_part;
+    double   divisor;
+    uint8_t  number_phase;      /* Integer part, fraction, or ignored (after a second dot). */
+    uint8_t  number_length;     /* Characters so far. */
+
+    /* The fold, one value per level. */
+    double   factor;            /* The last number, or the base before an E. */
+    double   quotient;          /* The quotient run the factor is divided into. */
+    double   product;           /* The term's complete quotient runs, multiplied. */
+    double   run;               /* The terms since the last - sign, added. */
+    double   answer;            /* The runs before it, subtracted. */
+    char     factor_operator;   /* x or / before the factor, or '\0' at a term's start. */
+    char     term_sign;         /* + or - before the term, or '\0' for the first. */
+    char     previous_operator; /* The last operator token (for E and error 10). */
+    bool     b_first_product;   /* No quotient run of the term is complete. */
+    bool     b_first_run;       /* No - sign yet. */
+
+    /* The checks. */
+    uint64_t length;
+    char     previous;          /* The last character. */
+    bool     b_in_number;
+    bool     b_after_e;         /* An E, and no operator since. */
+    bool     b_invalid;         /* Error 4. */
+    bool     b_bad_start;       /* Error 7 (an operator first). */
+    bool     b_adjacent;        /* Error 9. */
+    bool     b_e_fraction;      /* Error 11. */
+    bool     b_adjacent_e;      /* Error 10. */
+    uint8_t  token_error;       /* The first 6 or 7 found while reading tokens. */
+} CalcStream_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void   calc_stream_init(CalcStream_t *p_stream);
+void   calc_stream_feed(CalcStream_t *p_stream, const char *p_chunk, size_t length);
+double calc_stream_finish(CalcStream_t *p_stream, uint8_t *p_error_ref_no);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
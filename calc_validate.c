@@ -0,0 +1,468 @@
+/**
+ * $File: calc_validate.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_validate.c
+ *
+ *  @brief     The engine's character checks, many bytes at a time. See calc_validate.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "calc_validate.h"
+#include "calculate_answer.h"
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define BLOCK_SIZE 64 //!< Bytes per mask.
+
+/* The classes of a byte, one bit each; a byte of no class is an invalid character. */
+#define CLASS_DIGIT 0x01u
+#define CLASS_PLUS  0x02u
+#define CLASS_MINUS 0x04u
+#define CLASS_DOT   0x08u
+#define CLASS_SLASH 0x10u
+#define CLASS_E     0x20u
+#define CLASS_X     0x40u
+#define CLASS_OPERATOR     (CLASS_PLUS | CLASS_MINUS | CLASS_SLASH | CLASS_E | CLASS_X)
+#define CLASS_BEFORE_MINUS (CLASS_SLASH | CLASS_E | CLASS_X) //!< May be followed by a minus.
+
+/* SWAR: a byte in each lane of a 64-bit word. */
+#define SWAR_ONES  0x0101010101010101ull
+#define SWAR_LOW7  0x7F7F7F7F7F7F7F7Full
+#define SWAR_HIGHS 0x8080808080808080ull
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* A block's bytes by class: bit i is byte i. */
+typedef struct
+{
+    uint64_t valid;        /* Bytes of any class. */
+    uint64_t operator;     /* + - x / E */
+    uint64_t minus;
+    uint64_t before_minus; /* x / E */
+    uint64_t e;
+    uint64_t dot;
+} ClassMasks_t;
+
+/* What the checks of one block need from the block before. */
+typedef struct
+{
+    uint64_t operator;     /* The last byte was an operator, */
+    uint64_t before_minus; /* x, / or E, */
+    uint64_t e;            /* or E. */
+    uint64_t run;          /* The run after an E went on to the last byte. */
+} BlockCarry_t;
+
+typedef void (*Classify_t)(const char *p_block, ClassMasks_t *p_masks);
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void     validate_blocks(Classify_t classify, const char *p_expression, size_t length,
+                                uint8_t *p_error_ref_no);
+static bool     block_has_error(const ClassMasks_t *p_masks, uint64_t in_range, BlockCarry_t *p_carry);
+static void     classify_swar(const char *p_block, ClassMasks_t *p_masks);
+static uint64_t swar_equal(uint64_t word, uint8_t byte);
+static uint64_t swar_digit(uint64_t word);
+static uint64_t swar_bits(uint64_t highs);
+#if defined(__x86_64__)
+static void     classify_ssse3(const char *p_block, ClassMasks_t *p_masks);
+static void     classify_avx2(const char *p_block, ClassMasks_t *p_masks);
+#endif
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const char *const kernel_names[CALC_VALIDATE_KERNEL_COUNT] = {
+    "scalar", "swar", "ssse3", "avx2",
+};
+
+#if defined(__x86_64__)
+/* The classes a low nibble and a high nibble allow: a byte's class is both. */
+static const uint8_t low_nibble_classes[16] = {
+    CLASS_DIGIT, CLASS_DIGIT, CLASS_DIGIT, CLASS_DIGIT, CLASS_DIGIT,
+    CLASS_DIGIT | CLASS_E, // '5', 'E'
+    CLASS_DIGIT, CLASS_DIGIT,
+    CLASS_DIGIT | CLASS_X, // '8', 'x'
+    CLASS_DIGIT, 0, CLASS_PLUS, 0, CLASS_MINUS, CLASS_DOT, CLASS_SLASH,
+};
+static const uint8_t high_nibble_classes[16] = {
+    0, 0, CLASS_PLUS | CLASS_MINUS | CLASS_DOT | CLASS_SLASH, CLASS_DIGIT, CLASS_E, 0, 0, CLASS_X,
+    0, 0, 0, 0, 0, 0, 0, 0,
+};
+#endif
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Run the engine's character checks with the fastest kernel the CPU has.
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [out] p_error_ref_no The reference number of the first error, as
+ * CheckExpressionSyntax() gives it, or 0.
+ * @return  None.
+ **/
+void
+calc_validate(const char *p_expression, size_t length, uint8_t *p_error_ref_no)
+{
+    calc_validate_with(calc_validate_best_kernel(), p_expression, length, p_error_ref_no);
+}
+
+/**
+ * @brief   Run the engine's character checks with a given kernel.
+ * @param   [in] kernel The kernel (one the CPU has; see calc_validate_kernel_supported()).
+ * @param   [in] p_expression The first character (no null is needed).
+ * @param   [in] length The number of characters.
+ * @param   [out] p_error_ref_no The reference number of the first error, or 0.
+ * @return  None.
+ **/
+void
+calc_validate_with(CalcValidateKernel_t kernel, const char *p_expression, size_t length, uint8_t *p_error_ref_no)
+{
+    switch (kernel)
+    {
+        case CALC_VALIDATE_SWAR:
+            validate_blocks(classify_swar, p_expression, length, p_error_ref_no);
+            break;
+#if defined(__x86_64__)
+        case CALC_VALIDATE_SSSE3:
+            validate_blocks(classify_ssse3, p_expression, length, p_error_ref_no);
+            break;
+        case CALC_VALIDATE_AVX2:
+            validate_blocks(classify_avx2, p_expression, length, p_error_ref_no);
+            break;
+#endif
+        default:
+            CheckExpressionSyntax(p_expression, length, p_error_ref_no);
+            break;
+    }
+}
+
+/**
+ * @brief   The fastest kernel the CPU has.
+ * @param   None.
+ * @return  The kernel.
+ **/
+CalcValidateKernel_t
+calc_validate_best_kernel(void)
+{
+    for (int kernel = CALC_VALIDATE_KERNEL_COUNT - 1; kernel > CALC_VALIDATE_SCALAR; kernel--)
+    {
+        if (calc_validate_kernel_supported((CalcValidateKernel_t)kernel))
+        {
+            return (CalcValidateKernel_t)kernel;
+        }
+    }
+    return CALC_VALIDATE_SCALAR;
+}
+
+/**
+ * @brief   Whether the CPU can run a kernel.
+ * @param   [in] kernel The kernel.
+ * @return  true if it can.
+ **/
+bool
+calc_validate_kernel_supported(CalcValidateKernel_t kernel)
+{
+    switch (kernel)
+    {
+        case CALC_VALIDATE_SCALAR:
+        case CALC_VALIDATE_SWAR:
+            return true;
+#if defined(__x86_64__)
+        case CALC_VALIDATE_SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case CALC_VALIDATE_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief   The name of a kernel, for reports.
+ * @param   [in] kernel The kernel.
+ * @return  The name.
+ **/
+const char *
+calc_validate_kernel_name(CalcValidateKernel_t kernel)
+{
+    return (kernel < CALC_VALIDATE_KERNEL_COUNT) ? kernel_names[kernel] : "?";
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check an expression a block at a time, and find the engine's error with
+ * CheckExpressionSyntax() if any check fails.
+ * @param   [in] classify The kernel's classification of a block.
+ * @param   [in] p_expression The first character.
+ * @param   [in] length The number of characters.
+ * @param   [out] p_error_ref_no The reference number of the first error, or 0.
+ * @return  None.
+ **/
+static void
+validate_blocks(Classify_t classify, const char *p_expression, size_t length, uint8_t *p_error_ref_no)
+{
+    BlockCarry_t carry = {0};
+    ClassMasks_t masks;
+    char         tail[BLOCK_SIZE];
+    size_t       offset;
+
+    *p_error_ref_no = 0;
+    if (0u == length)
+    {
+        CheckExpressionSyntax(p_expression, length, p_error_ref_no); // Error 2
+        return;
+    }
+
+    for (offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        const char *p_block = &p_expression[offset];
+        size_t      n_bytes = length - offset;
+        uint64_t    in_range = ~0ull;
+
+        if (n_bytes < BLOCK_SIZE)
+        {
+            /* The kernels read whole blocks; a zero byte is of no class, and is out of range. */
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, p_block, n_bytes);
+            p_block = tail;
+            in_range = (1ull << n_bytes) - 1u;
+        }
+        classify(p_block, &masks);
+
+        if ((0u == offset) && (0u != (masks.operator & ~masks.minus & 1u)))
+        {
+            break; // Error 7: an operator other than - first
+        }
+        if (block_has_error(&masks, in_range, &carry))
+        {
+            break;
+        }
+        if ((n_bytes <= BLOCK_SIZE) && (0u != ((masks.operator >> (n_bytes - 1u)) & 1u)))
+        {
+            break; // Error 8: an operator last
+        }
+    }
+
+    if (offset < length)
+    {
+        CheckExpressionSyntax(p_expression, length, p_error_ref_no);
+    }
+}
+
+/**
+ * @brief   Look for invalid characters, adjacent operators and dots after an E in a block.
+ * @param   [in] p_masks The block's classes.
+ * @param   [in] in_range The bits of the bytes in the expression.
+ * @param   [in,out] p_carry From the block before; set for the block after.
+ * @return  true if any is found.
+ **/
+static bool
+block_has_error(const ClassMasks_t *p_masks, uint64_t in_range, BlockCarry_t *p_carry)
+{
+    uint64_t non_operator = ~p_masks->operator & in_range;
+    uint64_t operator_before = (p_masks->operator << 1) | p_carry->operator;
+    uint64_t before_minus_before = (p_masks->before_minus << 1) | p_carry->before_minus;
+    uint64_t run_starts = ((p_masks->e << 1) | p_carry->e) & non_operator;
+    uint64_t sum;
+    bool     b_carry = __builtin_add_overflow(non_operator, run_starts, &sum);
+    uint64_t after_e;
+    uint64_t errors;
+
+    /* A run continued from the block before starts at bit 0 (no E can start one there too,
+       as an E before it would have ended that run). */
+    b_carry = __builtin_add_overflow(sum, p_carry->run, &sum) || b_carry;
+    after_e = (sum ^ non_operator) & non_operator; // The bits the carries ran through
+
+    errors = (~p_masks->valid & in_range) |
+             (p_masks->operator & operator_before & ~(p_masks->minus & before_minus_before)) |
+             (p_masks->dot & after_e);
+
+    p_carry->operator = p_masks->operator >> 63;
+    p_carry->before_minus = p_masks->before_minus >> 63;
+    p_carry->e = p_masks->e >> 63;
+    p_carry->run = b_carry ? 1u : 0u;
+
+    return 0u != errors;
+}
+
+/**
+ * @brief   Classify a block 8 bytes at a time with SWAR compares.
+ * @param   [in] p_block The 64 bytes.
+ * @param   [out] p_masks Their classes.
+ * @return  None.
+ **/
+static void
+classify_swar(const char *p_block, ClassMasks_t *p_masks)
+{
+    memset(p_masks, 0, sizeof(*p_masks));
+
+    for (unsigned word_no = 0; word_no < BLOCK_SIZE / 8u; word_no++)
+    {
+        uint64_t word;
+        uint64_t minus;
+        uint64_t before_minus;
+        uint64_t e;
+        uint64_t operator;
+        uint64_t dot;
+        unsigned shift = word_no * 8u;
+
+        memcpy(&word, &p_block[shift], sizeof(word)); // Little-endian: byte 0 is the low byte
+        e = swar_equal(word, 'E');
+        minus = swar_equal(word, '-');
+        before_minus = swar_equal(word, 'x') | swar_equal(word, '/') | e;
+        operator = before_minus | minus | swar_equal(word, '+');
+        dot = swar_equal(word, '.');
+
+        p_masks->valid |= swar_bits(operator | dot | swar_digit(word)) << shift;
+        p_masks->operator |= swar_bits(operator) << shift;
+        p_masks->minus |= swar_bits(minus) << shift;
+        p_masks->before_minus |= swar_bits(before_minus) << shift;
+        p_masks->e |= swar_bits(e) << shift;
+        p_masks->dot |= swar_bits(dot) << shift;
+    }
+}
+
+/* The high bit of each byte of the word that equals the given byte. The 7-bit addition
+   cannot carry from one byte into the next, so every byte is exact. */
+static uint64_t
+swar_equal(uint64_t word, uint8_t byte)
+{
+    uint64_t difference = word ^ (SWAR_ONES * byte);
+
+    return ~(((difference & SWAR_LOW7) + SWAR_LOW7) | difference) & SWAR_HIGHS;
+}
+
+/* The high bit of each byte of the word that is '0' to '9'. */
+static uint64_t
+swar_digit(uint64_t word)
+{
+    uint64_t low7 = word & SWAR_LOW7;
+    uint64_t at_least_0 = low7 + SWAR_ONES * (0x80u - '0');
+    uint64_t above_9 = low7 + SWAR_ONES * (0x80u - ('9' + 1u));
+
+    return at_least_0 & ~above_9 & ~word & SWAR_HIGHS;
+}
+
+/* Gather the high bits of the bytes into the low 8 bits, byte i to bit i. */
+static uint64_t
+swar_bits(uint64_t highs)
+{
+    return ((highs >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief   Classify a block 16 bytes at a time with SSSE3.
+ * @param   [in] p_block The 64 bytes.
+ * @param   [out] p_masks Their classes.
+ * @return  None.
+ **/
+__attribute__((target("ssse3"))) static void
+classify_ssse3(const char *p_block, ClassMasks_t *p_masks)
+{
+    const __m128i low_table = _mm_loadu_si128((const __m128i *)low_nibble_classes);
+    const __m128i high_table = _mm_loadu_si128((const __m128i *)high_nibble_classes);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+
+    memset(p_masks, 0, sizeof(*p_masks));
+
+    for (unsigned vector_no = 0; vector_no < BLOCK_SIZE / 16u; vector_no++)
+    {
+        __m128i  bytes = _mm_loadu_si128((const __m128i *)&p_block[vector_no * 16u]);
+        __m128i  classes = _mm_and_si128(_mm_shuffle_epi8(low_table, _mm_and_si128(bytes, nibble)),
+                                         _mm_shuffle_epi8(high_table,
+                                                          _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble)));
+        unsigned shift = vector_no * 16u;
+
+/* The bytes with any of the class bits, as 16 bits. */
+#define CLASS_BITS_SSSE3(bits)                                                                          \
+    ((uint64_t)(~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(classes, _mm_set1_epi8(bits)), zero)) & \
+                0xFFFF) << shift)
+
+        p_masks->valid |= CLASS_BITS_SSSE3(0x7F);
+        p_masks->operator |= CLASS_BITS_SSSE3(CLASS_OPERATOR);
+        p_masks->minus |= CLASS_BITS_SSSE3(CLASS_MINUS);
+        p_masks->before_minus |= CLASS_BITS_SSSE3(CLASS_BEFORE_MINUS);
+        p_masks->e |= CLASS_BITS_SSSE3(CLASS_E);
+        p_masks->dot |= CLASS_BITS_SSSE3(CLASS_DOT);
+#undef CLASS_BITS_SSSE3
+    }
+}
+
+/**
+ * @brief   Classify a block 32 bytes at a time with AVX2 (whose pshufb looks up each
+ * 16-byte half in its own copy of the table).
+ * @param   [in] p_block The 64 bytes.
+ * @param   [out] p_masks Their classes.
+ * @return  None.
+ **/
+__attribute__((target("avx2"))) static void
+classify_avx2(const char *p_block, ClassMasks_t *p_masks)
+{
+    const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)low_nibble_classes));
+    const __m256i high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)high_nibble_classes));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    memset(p_masks, 0, sizeof(*p_masks));
+
+    for (unsigned vector_no = 0; vector_no < BLOCK_SIZE / 32u; vector_no++)
+    {
+        __m256i  bytes = _mm256_loadu_si256((const __m256i *)&p_block[vector_no * 32u]);
+        __m256i  classes =
+            _mm256_and_si256(_mm256_shuffle_epi8(low_table, _mm256_and_si256(bytes, nibble)),
+                             _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble)));
+        unsigned shift = vector_no * 32u;
+
+/* The bytes with any of the class bits, as 32 bits. */
+#define CLASS_BITS_AVX2(bits)                                                                                   \
+    ((uint64_t)(uint32_t)~_mm256_movemask_epi8(                                                                 \
+         _mm256_cmpeq_epi8(_mm256_and_si256(classes, _mm256_set1_epi8(bits)), zero)) << shift)
+
+        p_masks->valid |= CLASS_BITS_AVX2(0x7F);
+        p_masks->operator |= CLASS_BITS_AVX2(CLASS_OPERATOR);
+        p_masks->minus |= CLASS_BITS_AVX2(CLASS_MINUS);
+        p_masks->before_minus |= CLASS_BITS_AVX2(CLASS_BEFORE_MINUS);
+        p_masks->e |= CLASS_BITS_AVX2(CLASS_E);
+        p_masks->dot |= CLASS_BITS_AVX2(CLASS_DOT);
+#undef CLASS_BITS_AVX2
+    }
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,84 @@
+/**
+ * $File: calc_validate.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_validate.h
+ *
+ *  @brief     The engine's character checks (CheckExpressionSyntax()) for the host tools,
+ *             many bytes at a time.
+ *
+ *             Each kernel sorts 64 bytes at a time into classes (digit, dot, minus, the
+ *             other operators, E, x and /) and keeps one bit per byte for each class: 8
+ *             bytes at a time with SWAR compares on 64-bit words, or 16 with SSSE3 and 32
+ *             with AVX2 by looking the class up by the low and the high nibble of each
+ *             byte (pshufb). The checks are then bit operations on the masks. An invalid
+ *             character is a byte of no class. Two adjacent operators are an operator bit
+ *             with the operator bit before it, unless a minus follows x, / or E. A dot after
+ *             an E is a dot in the run of non-operators that starts after an E, which an
+ *             addition of the run's start to the non-operator mask marks: the carry runs
+ *             along the run and stops at the next operator. The bits before each block
+ *             (the last byte's classes and the addition's carry) carry into the next.
+ *
+ *             Only a clean expression is decided this way. If any check fails,
+ *             CheckExpressionSyntax() is run to find the error the engine reports first,
+ *             so the error numbers are always the engine's. The kernel is picked at run
+ *             time from what the CPU has.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#if defined(__arm__)
+#error "calc_validate.c is for the host build only"
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* The ways of checking an expression, slowest first. */
+typedef enum
+{
+    CALC_VALIDATE_SCALAR, /* CheckExpressionSyntax() itself. */
+    CALC_VALIDATE_SWAR,   /* 8 bytes per 64-bit word, on any CPU. */
+    CALC_VALIDATE_SSSE3,  /* 16 bytes per vector (x86-64). */
+    CALC_VALIDATE_AVX2,   /* 32 bytes per vector (x86-64). */
+    CALC_VALIDATE_KERNEL_COUNT
+} CalcValidateKernel_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void                 calc_validate(const char *p_expression, size_t length, uint8_t *p_error_ref_no);
+void                 calc_validate_with(CalcValidateKernel_t kernel, const char *p_expression, size_t length,
+                                        uint8_t *p_error_ref_no);
+CalcValidateKernel_t calc_validate_best_kernel(void);
+bool                 calc_validate_kernel_supported(CalcValidateKernel_t kernel);
+const char          *calc_validate_kernel_name(CalcValidateKernel_t kernel);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
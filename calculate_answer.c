@@ -15,6 +15,8 @@
  * Module includes
  **********************************************************************************************/
 #include "calculate_answer.h"
+#include "profile.h"
+#include "ram_funcs.h"
 #include <ctype.h>
 #include <math.h>
 #include <stdbool.h>
@@ -51,52 +53,62 @@ const char error_message_line2[MAX_ERROR_MESSAGES][17] = {
     "E operators",
     "owed by integer",
 };
+const uint8_t parsed_literal_sizes[PARSED_LITERAL_COUNT] = {1, 2, 4, 4, 8};
 
 /**********************************************************************************************
  * Private constant definitions
  **********************************************************************************************/
-#define MAX_NUMS_AND_OPS 20
-#define MAX_NUMBER_STRING_LENGTH 50 // Added bounds checking constant
-
 /**********************************************************************************************
  * Private type definitions
  **********************************************************************************************/
-typedef struct {
-  double number[MAX_NUMS_AND_OPS];
-  int n_numbers;
-  char infix_operator[MAX_NUMS_AND_OPS];
-  int n_infix_operators;
-  char num_and_op_used[MAX_NUMS_AND_OPS];
-} ParsedExpression_t;
 
 /**********************************************************************************************
  * Private function declarations
  **********************************************************************************************/
-static bool is_operator(char character);
-static void syntax_check_stage1(char *p_input_buffer, uint8_t max_buffer_size,
-                                uint8_t *p_error_ref_no);
-static void syntax_check_stage2(char *p_input_buffer, uint8_t *p_error_ref_no);
-static double simple_atof(const char *p_string);
-static void extract_number(char *p_input_buffer, uint8_t *p_ch_no,
-                           uint8_t buf_len,
-                           ParsedExpression_t *p_parsed_expression,
-                           uint8_t *p_error_ref_no);
-static void extract_operator(char *p_input_buffer, uint8_t *p_ch_no,
-                             uint8_t buf_len,
-                             ParsedExpression_t *p_parsed_expression,
-                             uint8_t *p_error_ref_no);
-static void identify_tokens(char *p_input_buffer, uint8_t *p_error_ref_no,
-                            ParsedExpression_t *p_parsed_expression);
-static void syntax_check_stage3(ParsedExpression_t parsed_expression,
-                                uint8_t *p_error_ref_no);
-static void merge_numbers(ParsedExpression_t *p_parsed_expression,
-                          uint8_t current_index, uint8_t next_index,
-                          char operator);
-static void
-evaluate_expression_one_operator(ParsedExpression_t *p_parsed_expression,
-                                 char operator, uint8_t * p_error_ref_no);
-static double evaluate_expression(ParsedExpression_t p_parsed_expression,
-                                  uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE double
+calculate_expression(const char *p_input_buffer, uint8_t input_buffer_size,
+                     ParsedExpression_t *p_parsed_expression,
+                     uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE double
+calculate_span(const char *p_expression, size_t length,
+               ParsedExpression_t *p_parsed_expression,
+               uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE void
+tokenise_span(const char *p_expression, size_t length,
+              ParsedExpression_t *p_parsed_expression, uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE size_t find_length(const char *p_input_buffer,
+                                         uint8_t max_buffer_size,
+                                         uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE bool is_operator(char character);
+static RAMFUNC_ENGINE void syntax_check_stage1(const char *p_input_buffer,
+                                               size_t length,
+                                               uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE void syntax_check_stage2(const char *p_input_buffer,
+                                               size_t length,
+                                               uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE double simple_atof(const char *p_string, size_t length);
+static RAMFUNC_ENGINE void
+extract_number(const char *p_input_buffer, size_t *p_ch_no, size_t buf_len,
+               ParsedExpression_t *p_parsed_expression,
+               uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE void
+extract_operator(const char *p_input_buffer, size_t *p_ch_no, size_t buf_len,
+                 ParsedExpression_t *p_parsed_expression,
+                 uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE void
+identify_tokens(const char *p_input_buffer, size_t length,
+                uint8_t *p_error_ref_no,
+                ParsedExpression_t *p_parsed_expression);
+static RAMFUNC_ENGINE void
+syntax_check_stage3(const ParsedExpression_t *p_parsed_expression,
+                    uint8_t *p_error_ref_no);
+static RAMFUNC_ENGINE void pack_number(ParsedExpression_t *p_parsed_expression,
+                                       double number);
+static RAMFUNC_ENGINE double unpack_number(const uint8_t *p_literal,
+                                           uint8_t encoding);
+static RAMFUNC_ENGINE double
+evaluate_expression(const ParsedExpression_t *p_parsed_expression,
+                    uint8_t *p_error_ref_no);
 
 /**********************************************************************************************
  * Private variable definitions
@@ -115,53 +127,279 @@ static double evaluate_expression(ParsedExpression_t p_parsed_expression,
  * @return  If there was no error, the result of the calculation is returned.
  * 		If there was an error, 0.0 is returned.
  **/
-double CalculateAnswer(char *p_input_buffer, uint8_t input_buffer_size,
-                       uint8_t *p_error_ref_no) {
-  double answer = 0.0;
+RAMFUNC_ENGINE double CalculateAnswer(char *p_input_buffer,
+                                      uint8_t input_buffer_size,
+                                      uint8_t *p_error_ref_no) {
   ParsedExpression_t parsed_expression;
-  *p_error_ref_no = 0;
 
-  // Basic syntax checks:
-  syntax_check_stage1(p_input_buffer, input_buffer_size, p_error_ref_no);
+  return calculate_expression(p_input_buffer, input_buffer_size,
+                              &parsed_expression, p_error_ref_no);
+}
 
-  if (0u != *p_error_ref_no) {
-    return 0.0; // Even if it won't be used, the result should be defined.
+/**
+ * @brief   Evaluate an array of expressions, as CalculateAnswer() would one by
+ * one.
+ *
+ * The inputs are only read, so recorded expressions can be evaluated where
+ * they are without first copying each into a writable buffer. One parsed
+ * expression is reused for every item and nothing is allocated. Each answer
+ * and error number is exactly what CalculateAnswer() returns for the same
+ * input and buffer size.
+ *
+ * @param[in]  pp_inputs          The null-terminated expressions.
+ * @param[in]  n_items            The number of expressions.
+ * @param[in]  input_buffer_size  The size of the buffer each expression is in
+ * (as for CalculateAnswer(): a null must be found within it).
+ * @param[out] p_answers          n_items answers (0.0 for an error).
+ * @param[out] p_error_ref_nos    n_items error reference numbers (0 for none).
+ * @return     The number of expressions evaluated without an error.
+ **/
+size_t CalculateAnswerBatch(const char *const *pp_inputs, size_t n_items,
+                            uint8_t input_buffer_size, double *p_answers,
+                            uint8_t *p_error_ref_nos) {
+  ParsedExpression_t parsed_expression;
+  size_t n_valid = 0;
+
+  for (size_t item = 0; item < n_items; item++) {
+    p_answers[item] =
+        calculate_expression(pp_inputs[item], input_buffer_size,
+                             &parsed_expression, &p_error_ref_nos[item]);
+    n_valid += (0u == p_error_ref_nos[item]);
   }
+  return n_valid;
+}
 
-  // No operator errors (e.g. two together):
-  syntax_check_stage2(p_input_buffer, p_error_ref_no);
+/**
+ * @brief   Evaluate expressions packed one after another in a single buffer.
+ *
+ * As CalculateAnswerBatch(), but item i starts at p_packed[p_offsets[i]]. Each
+ * is checked for a null within input_buffer_size characters, and never past
+ * the end of the packed buffer, so an item that runs off the end gets error 3
+ * ("No null or too" "long I/P string").
+ *
+ * @param[in]  p_packed           The expressions, each null-terminated.
+ * @param[in]  packed_size        The size of p_packed.
+ * @param[in]  p_offsets          n_items offsets of the expressions.
+ * @param[in]  n_items            The number of expressions.
+ * @param[in]  input_buffer_size  The longest buffer to search for each null.
+ * @param[out] p_answers          n_items answers (0.0 for an error).
+ * @param[out] p_error_ref_nos    n_items error reference numbers (0 for none).
+ * @return     The number of expressions evaluated without an error.
+ **/
+size_t CalculateAnswerPacked(const char *p_packed, size_t packed_size,
+                             const uint32_t *p_offsets, size_t n_items,
+                             uint8_t input_buffer_size, double *p_answers,
+                             uint8_t *p_error_ref_nos) {
+  ParsedExpression_t parsed_expression;
+  size_t n_valid = 0;
+
+  for (size_t item = 0; item < n_items; item++) {
+    size_t offset = p_offsets[item];
+    size_t remaining = (offset < packed_size) ? packed_size - offset : 0;
+    uint8_t buffer_size = (remaining < input_buffer_size)
+                              ? (uint8_t)remaining
+                              : input_buffer_size;
+
+    if (0 == buffer_size) {
+      p_answers[item] = 0.0;
+      p_error_ref_nos[item] = 3; // "No null or too" "long I/P string"
+      continue;
+    }
+    p_answers[item] =
+        calculate_expression(&p_packed[offset], buffer_size,
+                             &parsed_expression, &p_error_ref_nos[item]);
+    n_valid += (0u == p_error_ref_nos[item]);
+  }
+  return n_valid;
+}
 
+/**
+ * @brief   Evaluate an expression given by its start and length.
+ *
+ * The characters are read in place and need no null after them, so
+ * expressions can be evaluated straight out of a larger buffer (e.g. a line of
+ * a memory-mapped file). Nothing is read past p_expression[length - 1]. The
+ * answer and error number are those CalculateAnswer() gives for the same
+ * characters in a buffer that is large enough, except that error 3 is never
+ * reported: the caller decides how long an expression may be. A null within
+ * the span is an invalid character (error 4).
+ *
+ * @param[in]  p_expression    The first character.
+ * @param[in]  length          The number of characters.
+ * @param[out] p_error_ref_no  The reference number of the error, if any.
+ * @return     If there was no error, the result of the calculation; otherwise
+ * 0.0.
+ **/
+double CalculateAnswerSpan(const char *p_expression, size_t length,
+                           uint8_t *p_error_ref_no) {
+  ParsedExpression_t parsed_expression;
+
+  return calculate_span(p_expression, length, &parsed_expression,
+                        p_error_ref_no);
+}
+
+/**
+ * @brief   Run only the character-level checks on an expression (errors 2, 4,
+ * 7, 8, 9 and 11), as CalculateAnswerSpan() runs them first.
+ *
+ * These checks look at characters and their neighbours, not at tokens, so
+ * they need no ParsedExpression_t and take any length. Tools that split a long
+ * expression and check it piece by piece use them.
+ *
+ * @param[in]  p_expression    The first character (no null is needed).
+ * @param[in]  length          The number of characters.
+ * @param[out] p_error_ref_no  The reference number of the first error, if any.
+ **/
+void CheckExpressionSyntax(const char *p_expression, size_t length,
+                           uint8_t *p_error_ref_no) {
+  *p_error_ref_no = 0;
+  syntax_check_stage1(p_expression, length, p_error_ref_no);
   if (0u != *p_error_ref_no) {
-    return 0.0; // Even if it won't be used, the result should be defined.
+    return;
   }
+  syntax_check_stage2(p_expression, length, p_error_ref_no);
+}
 
-  /* Parse the input string into tokens (representing numbers
-     and operators such as +, x): */
-  parsed_expression.n_numbers = parsed_expression.n_infix_operators = 0;
-  identify_tokens(p_input_buffer, p_error_ref_no, &parsed_expression);
+/**
+ * @brief   Check an expression and split it into numbers and operators, without
+ * evaluating it.
+ *
+ * Runs every check CalculateAnswerSpan() runs, so an expression that passes
+ * here is evaluated by EvaluateTokens() without an error. Tools that evaluate
+ * the same shape of expression many times can look at the operators (e.g. to
+ * pick compiled code for them) before evaluating.
+ *
+ * @param[in]  p_expression         The first character (no null is needed).
+ * @param[in]  length               The number of characters.
+ * @param[out] p_parsed_expression  The numbers and operators.
+ * @param[out] p_error_ref_no       The reference number of the error, if any.
+ **/
+void TokeniseExpression(const char *p_expression, size_t length,
+                        ParsedExpression_t *p_parsed_expression,
+                        uint8_t *p_error_ref_no) {
+  *p_error_ref_no = 0;
+  tokenise_span(p_expression, length, p_parsed_expression, p_error_ref_no);
+}
+
+/**
+ * @brief   Evaluate an expression split up by TokeniseExpression().
+ *
+ * The tokens are only read, so they can be evaluated any number of times. The
+ * answer is exactly what CalculateAnswerSpan() gives for the text.
+ *
+ * @param[in]  p_parsed_expression  The numbers and operators.
+ * @param[out] p_error_ref_no       The reference number of the error, if any.
+ * @return     The answer, or 0.0 if there was an error.
+ **/
+double EvaluateTokens(const ParsedExpression_t *p_parsed_expression,
+                      uint8_t *p_error_ref_no) {
+  *p_error_ref_no = 0;
+  return evaluate_expression(p_parsed_expression, p_error_ref_no);
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
 
+/**
+ * @brief   The body of CalculateAnswer(), shared with the batch functions.
+ * @param[in]  p_input_buffer       The null-terminated expression.
+ * @param[in]  input_buffer_size    The size of the buffer it is in.
+ * @param[out] p_parsed_expression  Working space for the parsed expression.
+ * @param[out] p_error_ref_no       The reference number of the error, if any.
+ * @return     The answer, or 0.0 if there was an error.
+ **/
+static double calculate_expression(const char *p_input_buffer,
+                                   uint8_t input_buffer_size,
+                                   ParsedExpression_t *p_parsed_expression,
+                                   uint8_t *p_error_ref_no) {
+  size_t length;
+
+  *p_error_ref_no = 0;
+  length = find_length(p_input_buffer, input_buffer_size, p_error_ref_no);
   if (0u != *p_error_ref_no) {
     return 0.0; // Even if it won't be used, the result should be defined.
   }
 
-  /* There should not be two E operators following each other
-    (e.g. 12.E3E4). This is easier to test once the input has been
-    parsed into tokens: */
-  syntax_check_stage3(parsed_expression, p_error_ref_no);
+  return calculate_span(p_input_buffer, length, p_parsed_expression,
+                        p_error_ref_no);
+}
+
+/**
+ * @brief   Check and evaluate an expression given by its start and length.
+ * @param[in]  p_expression         The first character (no null is needed).
+ * @param[in]  length               The number of characters.
+ * @param[out] p_parsed_expression  Working space for the parsed expression.
+ * @param[out] p_error_ref_no       The reference number of the error, if any.
+ * @return     The answer, or 0.0 if there was an error.
+ **/
+static double calculate_span(const char *p_expression, size_t length,
+                             ParsedExpression_t *p_parsed_expression,
+                             uint8_t *p_error_ref_no) {
+  double answer = 0.0;
+  *p_error_ref_no = 0;
 
+  tokenise_span(p_expression, length, p_parsed_expression, p_error_ref_no);
   if (0u != *p_error_ref_no) {
     return 0.0; // Even if it won't be used, the result should be defined.
   }
 
   /* The input string is now known to be valid, so evaluate it:*/
-  answer = evaluate_expression(parsed_expression, p_error_ref_no);
+  PROFILE_START(PROFILE_STAGE_EVALUATE);
+  answer = evaluate_expression(p_parsed_expression, p_error_ref_no);
+  PROFILE_STOP(PROFILE_STAGE_EVALUATE);
 
   return answer;
 }
 
-/**********************************************************************************************
- * Private function definitions
- **********************************************************************************************/
+/**
+ * @brief   Run the syntax checks on an expression and split it into tokens.
+ * @param[in]  p_expression         The first character (no null is needed).
+ * @param[in]  length               The number of characters.
+ * @param[out] p_parsed_expression  The numbers and operators.
+ * @param[out] p_error_ref_no       The reference number of the error, if any
+ * (must be 0 on entry).
+ **/
+static void tokenise_span(const char *p_expression, size_t length,
+                          ParsedExpression_t *p_parsed_expression,
+                          uint8_t *p_error_ref_no) {
+  // Basic syntax checks:
+  PROFILE_START(PROFILE_STAGE_SYNTAX_CHECK_1);
+  syntax_check_stage1(p_expression, length, p_error_ref_no);
+  PROFILE_STOP(PROFILE_STAGE_SYNTAX_CHECK_1);
+
+  if (0u != *p_error_ref_no) {
+    return;
+  }
+
+  // No operator errors (e.g. two together):
+  PROFILE_START(PROFILE_STAGE_SYNTAX_CHECK_2);
+  syntax_check_stage2(p_expression, length, p_error_ref_no);
+  PROFILE_STOP(PROFILE_STAGE_SYNTAX_CHECK_2);
+
+  if (0u != *p_error_ref_no) {
+    return;
+  }
+
+  /* Parse the input string into tokens (representing numbers
+     and operators such as +, x): */
+  p_parsed_expression->n_numbers = p_parsed_expression->n_infix_operators = 0;
+  p_parsed_expression->n_literal_bytes = 0;
+  PROFILE_START(PROFILE_STAGE_IDENTIFY_TOKENS);
+  identify_tokens(p_expression, length, p_error_ref_no, p_parsed_expression);
+  PROFILE_STOP(PROFILE_STAGE_IDENTIFY_TOKENS);
+
+  if (0u != *p_error_ref_no) {
+    return;
+  }
+
+  /* There should not be two E operators following each other
+    (e.g. 12.E3E4). This is easier to test once the input has been
+    parsed into tokens: */
+  PROFILE_START(PROFILE_STAGE_SYNTAX_CHECK_3);
+  syntax_check_stage3(p_parsed_expression, p_error_ref_no);
+  PROFILE_STOP(PROFILE_STAGE_SYNTAX_CHECK_3);
+}
 
 /**
  * @brief   Checks if a character is a mathematical operator.
@@ -188,55 +426,69 @@ static bool is_operator(char character) {
 }
 
 /**
- * @brief   Performs basic syntax checks on the input buffer.
- *
- * This function validates the input string by checking for:
- * - Empty strings
- * - Missing null-terminator or string length exceeding buffer size
- * - Invalid characters (only digits, '+', '-', 'x', '/', '.', 'E' are allowed)
- *
- * Only the first encountered error is reported via the error reference number.
+ * @brief   Finds the length of the string in the input buffer.
  *
  * @param[in]  p_input_buffer     Pointer to the input string buffer.
  * @param[in]  max_buffer_size    Maximum allowed buffer size.
  * @param[out] p_error_ref_no     Pointer to a variable where the error code
  * will be stored:
  *                                - 0: No error
- *                                - 2: Empty string
  *                                - 3: Null terminator missing or string too
  * long
- *                                - 4: Invalid character found
- * @return     void
+ * @return     The length of the string (0 if empty, undefined on an error).
  */
-static void syntax_check_stage1(char *p_input_buffer, uint8_t max_buffer_size,
-                                uint8_t *p_error_ref_no) {
+static size_t find_length(const char *p_input_buffer, uint8_t max_buffer_size,
+                          uint8_t *p_error_ref_no) {
   uint8_t index;
-  uint8_t actual_buffer_size;
 
-  // Empty string (should have been handled in main()):
+  /* An empty string is reported by syntax_check_stage1(), even in a buffer
+     of size 0: */
   if ('\0' == p_input_buffer[0]) {
-    *p_error_ref_no = 2; // "SOFT BUG: Empty"
-    return;              // Only report first error, so don't check for more.
+    return 0;
   }
 
   // Null missing or string too long:
-  *p_error_ref_no = 3;
   for (index = 0; index < max_buffer_size; index++) {
     if ('\0' == p_input_buffer[index]) {
-      *p_error_ref_no = 0;
-      break;
+      return index;
     }
   }
+  *p_error_ref_no = 3;
+  return 0;
+}
 
-  if (0u != *p_error_ref_no) {
-    return; // Only report first error, so don't check for more.
-  }
+/**
+ * @brief   Performs basic syntax checks on the input string.
+ *
+ * This function validates the input string by checking for:
+ * - Empty strings
+ * - Invalid characters (only digits, '+', '-', 'x', '/', '.', 'E' are allowed)
+ *
+ * Only the first encountered error is reported via the error reference number.
+ * A missing null or over-long string (error 3) is found by find_length().
+ *
+ * @param[in]  p_input_buffer     Pointer to the input string (no null is
+ * needed).
+ * @param[in]  length             The number of characters in it.
+ * @param[out] p_error_ref_no     Pointer to a variable where the error code
+ * will be stored:
+ *                                - 0: No error
+ *                                - 2: Empty string
+ *                                - 4: Invalid character found
+ * @return     void
+ */
+static void syntax_check_stage1(const char *p_input_buffer, size_t length,
+                                uint8_t *p_error_ref_no) {
+  size_t index;
 
-  actual_buffer_size = strlen(p_input_buffer); /* Null found, so strlen is safe
-                                                  and no need for strnlen. */
+  // Empty string (should have been handled in main()):
+  if (0 == length) {
+    *p_error_ref_no = 2; // "SOFT BUG: Empty"
+    return;              // Only report first error, so don't check for more.
+  }
 
   // Invalid char:
-  for (index = 0; index < actual_buffer_size; index++) {
+  for (index = 0; index < length; index++) {
     switch (p_input_buffer[index]) {
     case '0':
     case '1':
@@ -274,8 +526,9 @@ static void syntax_check_stage1(char *p_input_buffer, uint8_t max_buffer_size,
  *
  * Only the first encountered error is reported via the error reference number.
  *
- * @param[in]  p_input_buffer   Pointer to the input string buffer
- * (null-terminated).
+ * @param[in]  p_input_buffer   Pointer to the input string (no null is
+ * needed).
+ * @param[in]  length           The number of characters in it (at least 1).
  * @param[out] p_error_ref_no   Pointer to a variable where the error code will
  * be stored:
  *                              - 0: No error
@@ -286,9 +539,10 @@ static void syntax_check_stage1(char *p_input_buffer, uint8_t max_buffer_size,
  *                              - 11: 'E' not followed by a valid integer
  * @return     void
  */
-static void syntax_check_stage2(char *p_input_buffer, uint8_t *p_error_ref_no) {
-  uint8_t index;
-  uint8_t buffer_size = strlen(p_input_buffer);
+static void syntax_check_stage2(const char *p_input_buffer, size_t length,
+                                uint8_t *p_error_ref_no) {
+  size_t index;
+  size_t buffer_size = length;
   char ch1 = p_input_buffer[0];
 
   /* First and last characters may not be operators,
@@ -363,39 +617,43 @@ static void syntax_check_stage2(char *p_input_buffer, uint8_t *p_error_ref_no) {
  * - Scientific notation (e.g., "1.23e4")
  * - Invalid characters or error reporting
  *
- * @param[in]  p_string   Pointer to a null-terminated string containing the
- * numeric input.
+ * Parsing stops at the first character that is not part of the number, or
+ * after `length` characters, so the string needs no null after it.
+ *
+ * @param[in]  p_string   Pointer to the numeric input.
+ * @param[in]  length     The most characters to read.
  * @return     The corresponding double-precision floating-point value.
  */
-static double simple_atof(const char *p_string) {
+static double simple_atof(const char *p_string, size_t length) {
+  const char *p_end = p_string + length;
   int sign = 1;
   int int_part = 0;
   double frac_part = 0.0;
   double divisor = 10.0;
 
   // Skip leading whitespace
-  while (' ' == *p_string) {
+  while ((p_string < p_end) && (' ' == *p_string)) {
     p_string++;
   }
 
   // Handle optional sign
-  if ('-' == *p_string) {
+  if ((p_string < p_end) && ('-' == *p_string)) {
     sign = -1;
     p_string++;
-  } else if ('+' == *p_string) {
+  } else if ((p_string < p_end) && ('+' == *p_string)) {
     p_string++;
   }
 
   // Integer part
-  while ((*p_string >= '0') && (*p_string <= '9')) {
+  while ((p_string < p_end) && (*p_string >= '0') && (*p_string <= '9')) {
     int_part = int_part * 10 + (*p_string - '0');
     p_string++;
   }
 
   // Fractional part
-  if ('.' == *p_string) {
+  if ((p_string < p_end) && ('.' == *p_string)) {
     p_string++;
-    while ((*p_string >= '0') && (*p_string <= '9')) {
+    while ((p_string < p_end) && (*p_string >= '0') && (*p_string <= '9')) {
       frac_part += (*p_string - '0') / divisor;
       divisor *= 10;
       p_string++;
@@ -411,8 +669,10 @@ static double simple_atof(const char *p_string) {
  *
  * This function reads characters from the input buffer starting at the
  * specified position and attempts to parse a numeric value (integer or
- * decimal). The extracted number is converted to `double` using `simple_atof()`
- * and added to the `ParsedExpression_t` structure.
+ * decimal). The number is converted to `double` by `simple_atof()` straight
+ * from the input buffer (which stops at the first character that is not part
+ * of it, so no copy is needed) and packed into the `ParsedExpression_t`
+ * structure by `pack_number()`.
  *
  * It performs basic validation, ensuring the number starts with a digit or '.'
  * and stops reading when a non-digit, non-dot character is encountered or the
@@ -433,11 +693,11 @@ static double simple_atof(const char *p_string) {
  *
  * @return        void
  */
-static void extract_number(char *p_input_buffer, uint8_t *p_ch_no,
-                           uint8_t buf_len,
+static void extract_number(const char *p_input_buffer, size_t *p_ch_no,
+                           size_t buf_len,
                            ParsedExpression_t *p_parsed_expression,
                            uint8_t *p_error_ref_no) {
-  char num_as_string[MAX_NUMBER_STRING_LENGTH] = {0};
+  const char *p_number = &p_input_buffer[*p_ch_no];
   int next_ch_no = 0;
 
   // Sanity check: Must start with digit or '.'
@@ -447,25 +707,26 @@ static void extract_number(char *p_input_buffer, uint8_t *p_ch_no,
     return;
   }
 
-  // Extract number characters with bounds checking
+  /* Skip over the number characters with bounds checking. A longer number
+     leaves a digit where an operator must follow, which is reported as 7. */
   while (*p_ch_no < buf_len && next_ch_no < (MAX_NUMBER_STRING_LENGTH - 1) &&
          (isdigit((unsigned char)p_input_buffer[*p_ch_no]) ||
           p_input_buffer[*p_ch_no] == '.')) {
-    num_as_string[next_ch_no++] = p_input_buffer[*p_ch_no];
+    next_ch_no++;
     (*p_ch_no)++;
   }
 
-  num_as_string[next_ch_no] = '\0'; // Null-terminate the number string
-
   if (0 == next_ch_no) {
     *p_error_ref_no = 6;
     return;
   }
 
-  double number_read = simple_atof(num_as_string);
+  PROFILE_START(PROFILE_STAGE_SIMPLE_ATOF);
+  double number_read = simple_atof(p_number, next_ch_no);
+  PROFILE_STOP(PROFILE_STAGE_SIMPLE_ATOF);
 
   if (p_parsed_expression->n_numbers < MAX_NUMS_AND_OPS) {
-    p_parsed_expression->number[p_parsed_expression->n_numbers++] = number_read;
+    pack_number(p_parsed_expression, number_read);
   } else {
     *p_error_ref_no = 1; // Too many numbers
   }
@@ -477,8 +738,9 @@ static void extract_number(char *p_input_buffer, uint8_t *p_ch_no,
  *
  * This function checks whether the current character in the input buffer is a
  * valid infix operator
- * (`+`, `-`, `x`, `/`, `E`). If valid, it stores the operator in the
- * `ParsedExpression_t` structure and advances the character index. If not
+ * (`+`, `-`, `x`, `/`, `E`). If valid, it stores the operator's code in the
+ * high nibble of the `ParsedExpression_t` token of the number before it and
+ * advances the character index. If not
  * valid, it sets an error code.
  *
  * @param[in]     p_input_buffer       Pointer to the input string buffer
@@ -495,8 +757,8 @@ static void extract_number(char *p_input_buffer, uint8_t *p_ch_no,
  *
  * @return        void
  */
-static void extract_operator(char *p_input_buffer, uint8_t *p_ch_no,
-                             uint8_t buf_len,
+static void extract_operator(const char *p_input_buffer, size_t *p_ch_no,
+                             size_t buf_len,
                              ParsedExpression_t *p_parsed_expression,
                              uint8_t *p_error_ref_no) {
   if (*p_ch_no >= buf_len) {
@@ -507,8 +769,15 @@ static void extract_operator(char *p_input_buffer, uint8_t *p_ch_no,
 
   if (('+' == ch) || ('-' == ch) || ('x' == ch) || ('/' == ch) || ('E' == ch)) {
     if (p_parsed_expression->n_infix_operators < MAX_NUMS_AND_OPS) {
-      p_parsed_expression
-          ->infix_operator[p_parsed_expression->n_infix_operators++] = ch;
+      uint8_t code = ('+' == ch)   ? PARSED_OPERATOR_ADD
+                     : ('-' == ch) ? PARSED_OPERATOR_SUBTRACT
+                     : ('x' == ch) ? PARSED_OPERATOR_MULTIPLY
+                     : ('/' == ch) ? PARSED_OPERATOR_DIVIDE
+                                   : PARSED_OPERATOR_E;
+
+      // The number before it is already in the low nibble:
+      p_parsed_expression->token[p_parsed_expression->n_infix_operators++] |=
+          (uint8_t)(code << 4);
       (*p_ch_no)++;
     } else {
       *p_error_ref_no = 1; // Too many operators
@@ -531,8 +800,9 @@ static void extract_operator(char *p_input_buffer, uint8_t *p_ch_no,
  * decimal point, and valid tokens must alternate between number → operator →
  * number, etc.
  *
- * @param[in]      p_input_buffer       Pointer to the input null-terminated
- * expression string.
+ * @param[in]      p_input_buffer       Pointer to the input expression (no
+ * null is needed).
+ * @param[in]      length               The number of characters in it.
  * @param[out]     p_error_ref_no       Pointer to a variable where the error
  * code will be stored:
  *                                      - 0: No error
@@ -545,10 +815,11 @@ static void extract_operator(char *p_input_buffer, uint8_t *p_ch_no,
  *
  * @return         void
  */
-static void identify_tokens(char *p_input_buffer, uint8_t *p_error_ref_no,
+static void identify_tokens(const char *p_input_buffer, size_t length,
+                            uint8_t *p_error_ref_no,
                             ParsedExpression_t *p_parsed_expression) {
-  uint8_t ch_no = 0;
-  uint8_t buf_len = strlen(p_input_buffer);
+  size_t ch_no = 0;
+  size_t buf_len = length;
 
   while (ch_no < buf_len) {
     // Must be number
@@ -609,12 +880,12 @@ static void identify_tokens(char *p_input_buffer, uint8_t *p_error_ref_no,
  *
  * @return      void
  */
-static void syntax_check_stage3(ParsedExpression_t p_parsed_expression,
+static void syntax_check_stage3(const ParsedExpression_t *p_parsed_expression,
                                 uint8_t *p_error_ref_no) {
   int i;
-  for (i = 0; i < p_parsed_expression.n_infix_operators - 1; i++) {
-    if (('E' == p_parsed_expression.infix_operator[i]) &&
-        ('E' == p_parsed_expression.infix_operator[i + 1])) {
+  for (i = 0; i < p_parsed_expression->n_infix_operators - 1; i++) {
+    if ((PARSED_OPERATOR_E == PARSED_OPERATOR(p_parsed_expression, i)) &&
+        (PARSED_OPERATOR_E == PARSED_OPERATOR(p_parsed_expression, i + 1))) {
       *p_error_ref_no = 10;
       return;
     }
@@ -622,188 +893,201 @@ static void syntax_check_stage3(ParsedExpression_t p_parsed_expression,
 }
 
 /**
- * @brief   Merges two numbers in the parsed expression using a specified
- * operator.
- *
- * This function performs an arithmetic operation between two numbers in a
- * `ParsedExpression_t` structure using the given operator. The result of the
- * operation replaces the number at `next_index`. The number at `current_index`
- * is marked as "used" and is ignored in future evaluations.
- *
- * The order of operand selection is determined externally (i.e., the caller
- * decides the correct order), and the indices provided reflect that decision.
- * This function does not sort or validate the operand order.
- *
- * Supported operators:
- * - `+`: Addition
- * - `-`: Subtraction
- * - `x`: Multiplication
- * - `/`: Division
- * - `E`: Scientific notation (num1 * 10^num2)
- *
- * @param[in,out]  p_parsed_expression  Pointer to the parsed expression
- * structure containing numbers and usage flags.
- * @param[in]      current_index        Index of the first number (to be marked
- * as used after the operation).
- * @param[in]      next_index           Index of the second number (to be
- * replaced with the result).
- * @param[in]      operator             Arithmetic operator to apply between the
- * two numbers.
+ * @brief   Packs a number into a parsed expression in the fewest bytes that
+ * hold it exactly.
+ *
+ * The encoding goes in the low nibble of the number's token (which clears the
+ * operator nibble after it) and the bytes after the numbers already in
+ * `literal[]`. Small integers, the commonest numbers, take one or two bytes;
+ * only a number no float holds exactly (e.g. 0.1) takes eight.
+ *
+ * @param[in,out]  p_parsed_expression  The expression, with room for one more
+ * number.
+ * @param[in]      number               The number, from `simple_atof()`.
  *
  * @return         void
  */
-static void merge_numbers(ParsedExpression_t *p_parsed_expression,
-                          uint8_t current_index, uint8_t next_index,
-                          char operator) {
-  double num1 = p_parsed_expression->number[current_index];
-  double num2 = p_parsed_expression->number[next_index];
-  switch (operator) {
-  case '+':
-    p_parsed_expression->number[next_index] = num1 + num2;
-    break;
-  case '-':
-    p_parsed_expression->number[next_index] = num1 - num2;
-    break;
-  case 'x':
-    p_parsed_expression->number[next_index] = num1 * num2;
-    break;
-  case '/':
-    p_parsed_expression->number[next_index] = num1 / num2;
-    break;
-  case 'E':
-    p_parsed_expression->number[next_index] = num1 * pow(10.0, num2);
-    break;
+static void pack_number(ParsedExpression_t *p_parsed_expression,
+                        double number) {
+  uint8_t *p_literal =
+      &p_parsed_expression->literal[p_parsed_expression->n_literal_bytes];
+  uint8_t encoding;
+  size_t size;
+
+  /* The range checks come first, as converting a double that is out of range
+     is undefined. */
+  if ((number >= 0.0) && (number <= UINT8_MAX) &&
+      (number == (double)(uint8_t)number)) {
+    uint8_t value = (uint8_t)number;
+    encoding = PARSED_LITERAL_UINT8;
+    size = sizeof(value);
+    memcpy(p_literal, &value, size);
+  } else if ((number >= 0.0) && (number <= UINT16_MAX) &&
+             (number == (double)(uint16_t)number)) {
+    uint16_t value = (uint16_t)number;
+    encoding = PARSED_LITERAL_UINT16;
+    size = sizeof(value);
+    memcpy(p_literal, &value, size);
+  } else if (number == (double)(float)number) {
+    float value = (float)number;
+    encoding = PARSED_LITERAL_FLOAT;
+    size = sizeof(value);
+    memcpy(p_literal, &value, size);
+  } else if ((number >= INT32_MIN) && (number <= INT32_MAX) &&
+             (number == (double)(int32_t)number)) {
+    int32_t value = (int32_t)number;
+    encoding = PARSED_LITERAL_INT32;
+    size = sizeof(value);
+    memcpy(p_literal, &value, size);
+  } else {
+    encoding = PARSED_LITERAL_DOUBLE;
+    size = sizeof(number);
+    memcpy(p_literal, &number, size);
   }
 
-  p_parsed_expression->num_and_op_used[current_index] = 1; // Record as used.
+  p_parsed_expression->token[p_parsed_expression->n_numbers++] = encoding;
+  p_parsed_expression->n_literal_bytes += (uint8_t)size;
 }
 
 /**
- * @brief   Evaluates all occurrences of a specific operator in a parsed
- * expression.
- *
- * This function processes the parsed mathematical expression and evaluates
- * every instance of the specified infix operator (e.g., `+`, `-`, `x`, `/`,
- * `E`). For each occurrence, it finds the next unused number, performs the
- * arithmetic operation via `merge_numbers()`, and stores the result. The
- * left-hand operand is marked as used, and the result replaces the right-hand
- * operand.
- *
- * The function assumes operator precedence is handled externally — it only
- * processes one operator type at a time.
- *
- * @param[in,out]  p_parsed_expression  Pointer to the parsed expression
- * structure containing numbers, operators, and usage tracking.
- * @param[in]      operator             The operator character to evaluate
- * (e.g., '+', '-', 'x', '/', 'E').
- * @param[out]     p_error_ref_no       Pointer to a variable where an error
- * code is stored if evaluation fails:
- *                                      - 0: No error
- *                                      - 1: Evaluation error (e.g., missing
- * operand)
+ * @brief   Reads a number packed by `pack_number()`.
  *
- * @return         void
+ * @param[in]  p_literal  The number's first byte (it takes
+ * `parsed_literal_sizes[encoding]` bytes).
+ * @param[in]  encoding   The number's encoding (the low nibble of its token).
+ *
+ * @return     The number, exactly as it was packed.
  */
-static void
-evaluate_expression_one_operator(ParsedExpression_t *p_parsed_expression,
-                                 char operator, uint8_t * p_error_ref_no) {
-  uint8_t this_index;
-  uint8_t next_index;
-  bool b_found;
-
-  for (this_index = 0; this_index < p_parsed_expression->n_infix_operators;
-       this_index++) {
-    // Is it the right operator?
-    if (p_parsed_expression->infix_operator[this_index] != operator) {
-      continue;
-    }
-
-    // Find the next unused number to merge into it:
-    b_found = false;
-    for (next_index = this_index + 1;
-         next_index < p_parsed_expression->n_numbers; next_index++) {
-      if (!p_parsed_expression->num_and_op_used[next_index]) {
-        b_found = true;
-        break;
-      }
-    }
-
-    // Error check:
-    if (false == b_found) {
-      *p_error_ref_no = 1; // Unidentified error.
-      return;
-    }
-
-    /* We have now found the next two numbers to merge by
-     * performing the arithmetic operation: */
-    merge_numbers(p_parsed_expression, this_index, next_index, operator);
+static double unpack_number(const uint8_t *p_literal, uint8_t encoding) {
+  uint16_t value16;
+  float value_float;
+  int32_t value32;
+  double number;
+
+  switch (encoding) {
+  case PARSED_LITERAL_UINT8:
+    number = *p_literal;
+    break;
+  case PARSED_LITERAL_UINT16:
+    memcpy(&value16, p_literal, sizeof(value16));
+    number = value16;
+    break;
+  case PARSED_LITERAL_FLOAT:
+    memcpy(&value_float, p_literal, sizeof(value_float));
+    number = value_float;
+    break;
+  case PARSED_LITERAL_INT32:
+    memcpy(&value32, p_literal, sizeof(value32));
+    number = value32;
+    break;
+  default:
+    memcpy(&number, p_literal, sizeof(number));
+    break;
   }
+
+  return number;
 }
 
 /**
  * @brief   Evaluates a parsed mathematical expression according to standard
  * operator precedence.
  *
- * This function processes a `ParsedExpression_t` structure, which contains
- * numbers and infix operators, and evaluates the entire expression in-place. It
- * uses a left-to-right strategy within each precedence level and respects
- * standard operator precedence in the following order:
+ * The operators are applied in the order:
  * - `'E'` (scientific notation exponent)
  * - `'/'` (division)
  * - `'x'` (multiplication)
  * - `'+'` (addition)
  * - `'-'` (subtraction)
+ * each left to right, with `a - b + c` taken as `a - (b + c)`.
  *
- * Intermediate results replace operands in the expression, and used numbers are
- * marked in a dedicated `num_and_op_used[]` array to ensure correct
- * left-to-right association.
+ * Each level ends where an operator of a lower level (or the end) comes, so
+ * the tokens are read once, left to right, keeping one value per level: the
+ * factor (a number, or a number E an integer), the quotient run the factors
+ * are divided into, the product of the term's quotient runs, the sum of the
+ * terms since the last `-`, and the answer so far. Each is combined in the
+ * order the separate passes would combine it, so the answer is the same to
+ * the bit.
  *
  * @note The function assumes the parsed expression is valid and properly
  * structured. It does not handle parentheses or nested expressions.
+ * The tokens are only read.
  *
  * @param[in]   p_parsed_expression   Parsed expression structure containing
- * numbers, operators, and state.
+ * numbers and operators.
  * @param[out]  p_error_ref_no        Pointer to a variable where error code
  * will be stored:
  *                                    - 0: No error
- *                                    - 1: Evaluation error (e.g., missing
- * operands)
+ *                                    - 1: Evaluation error (the numbers and
+ * operators do not alternate)
  *
- * @return      The final computed value as a `double`. If an error occurs, the
- * return value may be undefined.
+ * @return      The final computed value as a `double`, or 0.0 on an error.
  */
-static double evaluate_expression(ParsedExpression_t p_parsed_expression,
+static double evaluate_expression(const ParsedExpression_t *p_parsed_expression,
                                   uint8_t *p_error_ref_no) {
-  // Init the number_used array to show no numbers have been used.
-  for (size_t index = 0; index < MAX_NUMS_AND_OPS; index++) {
-    p_parsed_expression.num_and_op_used[index] = 0;
-  }
-
-  // Evaluate in order:
-  evaluate_expression_one_operator(&p_parsed_expression, 'E', p_error_ref_no);
-  if (0u != *p_error_ref_no)
-    return 0.0;
-
-  evaluate_expression_one_operator(&p_parsed_expression, '/', p_error_ref_no);
-  if (0u != *p_error_ref_no)
+  const uint8_t *p_literal = p_parsed_expression->literal;
+  double factor = 0.0;
+  double quotient = 0.0;
+  double product = 0.0;
+  double run = 0.0;
+  double answer = 0.0;
+  uint8_t factor_operator = PARSED_OPERATOR_NONE; // x or / before the factor
+  uint8_t term_sign = PARSED_OPERATOR_NONE;       // + or - before the term
+  uint8_t previous_operator = PARSED_OPERATOR_NONE;
+  bool b_first_product = true;
+  bool b_first_run = true;
+
+  // Error check:
+  if ((0 == p_parsed_expression->n_numbers) ||
+      (p_parsed_expression->n_infix_operators + 1 !=
+       p_parsed_expression->n_numbers)) {
+    *p_error_ref_no = 1; // Unidentified error.
     return 0.0;
+  }
 
-  evaluate_expression_one_operator(&p_parsed_expression, 'x', p_error_ref_no);
-  if (0u != *p_error_ref_no)
-    return 0.0;
+  for (size_t index = 0; index < p_parsed_expression->n_numbers; index++) {
+    uint8_t token = p_parsed_expression->token[index];
+    uint8_t operator = token >> 4;
+    double number = unpack_number(p_literal, token & PARSED_LITERAL_MASK);
+
+    p_literal += parsed_literal_sizes[token & PARSED_LITERAL_MASK];
+    // The factor, or the exponent of the base before an E:
+    factor = (PARSED_OPERATOR_E == previous_operator)
+                 ? factor * pow(10.0, number)
+                 : number;
+    previous_operator = operator;
+    if (PARSED_OPERATOR_E == operator) {
+      continue; // The factor is the next number's base.
+    }
 
-  evaluate_expression_one_operator(&p_parsed_expression, '+', p_error_ref_no);
-  if (0u != *p_error_ref_no)
-    return 0.0;
+    // The factor ends:
+    if (PARSED_OPERATOR_DIVIDE == factor_operator) {
+      quotient = quotient / factor;
+    } else {
+      if (PARSED_OPERATOR_MULTIPLY == factor_operator) {
+        product = b_first_product ? quotient : product * quotient;
+        b_first_product = false;
+      }
+      quotient = factor;
+    }
+    if ((PARSED_OPERATOR_MULTIPLY == operator) ||
+        (PARSED_OPERATOR_DIVIDE == operator)) {
+      factor_operator = operator;
+      continue;
+    }
 
-  evaluate_expression_one_operator(&p_parsed_expression, '-', p_error_ref_no);
-  if (0u != *p_error_ref_no)
-    return 0.0;
+    // The term ends (at a +, a - or the end):
+    double term = b_first_product ? quotient : product * quotient;
+    run = (PARSED_OPERATOR_ADD == term_sign) ? run + term : term;
+    if (PARSED_OPERATOR_SUBTRACT == operator) {
+      answer = b_first_run ? run : answer - run;
+      b_first_run = false;
+    }
+    term_sign = operator;
+    factor_operator = PARSED_OPERATOR_NONE;
+    b_first_product = true;
+  }
 
-  /* There should now be nothing left except the number in the last
-   * element of parsed_expression.number, which is the answer.
-   */
-  return p_parsed_expression.number[p_parsed_expression.n_numbers - 1];
+  return b_first_run ? run : answer - run;
 }
 
 /**********************************************************************************************
@@ -19,28 +19,79 @@ extern "C" {
 /**********************************************************************************************
  * Module includes
  **********************************************************************************************/
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 /**********************************************************************************************
  * Public constant definitions
  **********************************************************************************************/
-#define MAX_ERROR_MESSAGES 20 //!< Size of the error message arrays.
+#define MAX_ERROR_MESSAGES       20 //!< Size of the error message arrays.
+#define MAX_NUMS_AND_OPS         20 //!< Most numbers (and operators) in a parsed expression.
+#define MAX_NUMBER_STRING_LENGTH 50 //!< Longest number accepted is one less.
+#define MAX_LITERAL_BYTES        (MAX_NUMS_AND_OPS * 8) //!< Room for every number as a double.
+
+/* The operator codes of a parsed expression (the high nibble of a token). */
+#define PARSED_OPERATOR_NONE     0 //!< After the last number.
+#define PARSED_OPERATOR_ADD      1
+#define PARSED_OPERATOR_SUBTRACT 2
+#define PARSED_OPERATOR_MULTIPLY 3
+#define PARSED_OPERATOR_DIVIDE   4
+#define PARSED_OPERATOR_E        5
+
+/* The operator after number i of a parsed expression, as a PARSED_OPERATOR_ code. */
+#define PARSED_OPERATOR(p_parsed_expression, i) ((p_parsed_expression)->token[i] >> 4)
+
+/* The encodings of a number in a parsed expression (the low nibble of a token). */
+#define PARSED_LITERAL_UINT8  0 //!< 1 byte.
+#define PARSED_LITERAL_UINT16 1 //!< 2 bytes.
+#define PARSED_LITERAL_FLOAT  2 //!< 4 bytes, when the float is the number exactly.
+#define PARSED_LITERAL_INT32  3 //!< 4 bytes (an integer too large for a float).
+#define PARSED_LITERAL_DOUBLE 4 //!< 8 bytes.
+#define PARSED_LITERAL_COUNT  5
+#define PARSED_LITERAL_MASK   0x0Fu
+
+/* The encoding of number i of a parsed expression, as a PARSED_LITERAL_ code. */
+#define PARSED_LITERAL(p_parsed_expression, i) ((p_parsed_expression)->token[i] & PARSED_LITERAL_MASK)
 
 /**********************************************************************************************
  * Public type definitions
  **********************************************************************************************/
+/* An expression split into tokens, packed. token[i] holds the operator after number i in its
+   high nibble (a PARSED_OPERATOR_ code) and the encoding of number i in its low nibble. The
+   numbers follow each other in literal[], each in the fewest bytes that hold it exactly: an
+   8 or 16-bit integer, a float, a 32-bit integer, or a double. The evaluation only reads
+   the tokens, so they can be evaluated again without a copy. */
+typedef struct
+{
+    uint8_t n_numbers;
+    uint8_t n_infix_operators;
+    uint8_t n_literal_bytes;
+    uint8_t token[MAX_NUMS_AND_OPS];
+    uint8_t literal[MAX_LITERAL_BYTES];
+} ParsedExpression_t;
 
 /**********************************************************************************************
  * Public function declarations
  **********************************************************************************************/
 double CalculateAnswer(char *p_input_buffer, uint8_t input_buffer_size, uint8_t *p_error_ref_no);
+size_t CalculateAnswerBatch(const char *const *pp_inputs, size_t n_items, uint8_t input_buffer_size,
+                            double *p_answers, uint8_t *p_error_ref_nos);
+size_t CalculateAnswerPacked(const char *p_packed, size_t packed_size, const uint32_t *p_offsets,
+                             size_t n_items, uint8_t input_buffer_size, double *p_answers,
+                             uint8_t *p_error_ref_nos);
+double CalculateAnswerSpan(const char *p_expression, size_t length, uint8_t *p_error_ref_no);
+void   CheckExpressionSyntax(const char *p_expression, size_t length, uint8_t *p_error_ref_no);
+void   TokeniseExpression(const char *p_expression, size_t length, ParsedExpression_t *p_parsed_expression,
+                          uint8_t *p_error_ref_no);
+double EvaluateTokens(const ParsedExpression_t *p_parsed_expression, uint8_t *p_error_ref_no);
 
 /**********************************************************************************************
  * Global variable declarations
  **********************************************************************************************/
 extern const char error_message_line1[MAX_ERROR_MESSAGES][17];
 extern const char error_message_line2[MAX_ERROR_MESSAGES][17];
+extern const uint8_t parsed_literal_sizes[PARSED_LITERAL_COUNT]; //!< The bytes each encoding takes.
 
 #ifdef __cplusplus
 }
@@ -16,9 +16,12 @@
  * Module includes
  **********************************************************************************************/
 #include "high_level_funcs.h"
+#include "latency_histogram.h"
 #include "mid_level_funcs.h"
 #include "low_level_funcs_tiva.h"
-#include <stdio.h>
+#include "ram_funcs.h"
+#include "trace.h"
+#include <string.h>
 
 /**********************************************************************************************
  * Referenced external functions
@@ -35,18 +38,37 @@
 /**********************************************************************************************
  * Private constant definitions
  **********************************************************************************************/
+#define RESULT_STRING_SIZE 20
+#define RESULT_POSITION    1  // Column of the result (and its preview) on line 2, in the view
+#define LCD_COLUMNS        16 // Columns shown of the 40 in each line of the display's memory
 
 /**********************************************************************************************
  * Private type definitions
  **********************************************************************************************/
+/* The running result previewed on line 2 while typing. Columns are those of the
+   display's memory, as the view may be shifted. */
+typedef struct
+{
+    uint8_t shown_column; // Column of what is on line 2, which a new preview
+    uint8_t n_shown;      // must cover, and its characters
+} LivePreview_t;
 
 /**********************************************************************************************
  * Private function declarations
  **********************************************************************************************/
+static RAMFUNC_ENGINE void format_answer(double answer, char *p_result_str, int result_str_size);
+static RAMFUNC_ENGINE int  append_char(char *p_str, int str_size, int length, char ch);
+static RAMFUNC_ENGINE int  append_decimal(char *p_str, int str_size, int length, int value, int min_width);
+static void                draw_preview(const CalcIncremental_t *p_typed_line, int cursor_pos);
+static void                echo_char(int column, char ch);
+static void                erase_char(int column);
+static void                scroll_to_cursor(int cursor_pos);
 
 /**********************************************************************************************
  * Private variable definitions
  **********************************************************************************************/
+static LivePreview_t live_preview;
+static uint8_t       view_column = 0; // First column shown of the display's memory
 
 /**********************************************************************************************
  * Public function definitions
@@ -61,11 +83,22 @@
  * ends input on receiving the '*' character. The input is stored in the provided
  * buffer.
  *
+ * Each character is also given to the incremental evaluator once it has been
+ * echoed, so the line's answer is known when '*' is pressed. Its running result
+ * is then previewed on line 2, before the key's debounce wait, so the echo never
+ * waits for the preview.
+ *
+ * The line may be longer than the display: the view is shifted with the display's
+ * own shift instruction to keep the cursor in sight, so a key only sends its own
+ * character (and a shift), never the whole line. A full line takes no more
+ * characters, only '*', a backspace or a clear.
+ *
  * @param[out] input_buffer Pointer to the buffer where the input will be stored.
  * @param[in] input_buffer_size Size of the input buffer (maximum characters to store).
+ * @param[out] p_typed_line The line as typed, evaluated key by key.
  */
 void
-ReadAndEchoInput(char *input_buffer, int input_buffer_size)
+ReadAndEchoInput(char *input_buffer, int input_buffer_size, CalcIncremental_t *p_typed_line)
 {
     int  j = 0;
     bool b_shift_key_pressed = false;
@@ -73,21 +106,23 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
 	bool b_cleared = false;
 
     turn_cursor_on_off(1);
+    calc_incremental_clear(p_typed_line);
+    live_preview.n_shown = 0; // Line 2 is cleared with the display by the first key
 
     while (1)
     {
         wait_microsec(1000);
         key = get_keyboard_char();
 
-        if (j >= input_buffer_size - 1)
+        if ((j >= input_buffer_size - 1) && ((('0' <= key) && (key <= '9')) || (('A' <= key) && (key <= 'C'))))
         {
-            j = input_buffer_size - 1;
-            break; // Prevent buffer overflow
+            continue; // The line is full: it waits for '*', a backspace or a clear
         }
 
 		if ((key != '?') && false == b_cleared)
 		{
 			clear_display();
+			view_column = 0;
 			b_cleared = true;
 		}
         switch (key)
@@ -103,13 +138,12 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
             case '7':
             case '8':
             case '9':
-                if (j < 16)
-                {
-                    input_buffer[j++] = key;
-                    input_buffer[j] = '\0';
-                    print_string(1, 0, input_buffer);
-                }
-
+                input_buffer[j++] = key;
+                input_buffer[j] = '\0';
+                echo_char(j - 1, key);
+                latency_record_since_key_edge(LATENCY_KEY_TO_ECHO);
+                calc_incremental_append(p_typed_line, key);
+                draw_preview(p_typed_line, j);
                 b_shift_key_pressed = false;
                 wait_microsec(1000000);
                 break;
@@ -118,7 +152,10 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
             case 'A':
                 input_buffer[j++] = (b_shift_key_pressed ? 'x' : '+');
                 input_buffer[j] = '\0';
-                print_string(1, 0, input_buffer);
+                echo_char(j - 1, input_buffer[j - 1]);
+                latency_record_since_key_edge(LATENCY_KEY_TO_ECHO);
+                calc_incremental_append(p_typed_line, input_buffer[j - 1]);
+                draw_preview(p_typed_line, j);
                 b_shift_key_pressed = false;
                 wait_microsec(1000000);
                 break;
@@ -126,7 +163,10 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
             case 'B':
                 input_buffer[j++] = (b_shift_key_pressed ? '/' : '-');
                 input_buffer[j] = '\0';
-                print_string(1, 0, input_buffer);
+                echo_char(j - 1, input_buffer[j - 1]);
+                latency_record_since_key_edge(LATENCY_KEY_TO_ECHO);
+                calc_incremental_append(p_typed_line, input_buffer[j - 1]);
+                draw_preview(p_typed_line, j);
                 b_shift_key_pressed = false;
                 wait_microsec(1000000);
                 break;
@@ -134,7 +174,10 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
             case 'C':
                 input_buffer[j++] = (b_shift_key_pressed ? 'E' : '.');
                 input_buffer[j] = '\0';
-                print_string(1, 0, input_buffer);
+                echo_char(j - 1, input_buffer[j - 1]);
+                latency_record_since_key_edge(LATENCY_KEY_TO_ECHO);
+                calc_incremental_append(p_typed_line, input_buffer[j - 1]);
+                draw_preview(p_typed_line, j);
                 b_shift_key_pressed = false;
                 wait_microsec(1000000);
                 break;
@@ -150,15 +193,19 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
                     {
                         j--;
                         input_buffer[j] = '\0';
-                        print_string(1, 0, input_buffer);
-                        print_char(0x20);
-                        set_print_position(1, j);
+                        erase_char(j);
+                        latency_record_since_key_edge(LATENCY_KEY_TO_ECHO);
+                        calc_incremental_backspace(p_typed_line);
+                        draw_preview(p_typed_line, j);
                     }
                 }
                 else
                 {
                     j = 0;
                     clear_display();
+                    view_column = 0;
+                    calc_incremental_clear(p_typed_line);
+                    live_preview.n_shown = 0;
                 }
                 b_shift_key_pressed = false;
                 wait_microsec(1000000);
@@ -186,17 +233,13 @@ ReadAndEchoInput(char *input_buffer, int input_buffer_size)
 void
 DisplayResult(double answer)
 {
-    //char result[16];
-	int int_part = (int)answer;
-	int frac_part = (int)((answer - int_part) * 100);  // 2 decimal places
-	char result_str[20];
+	char result_str[RESULT_STRING_SIZE];
 
     turn_cursor_on_off(0); // Turns cursor off
-	if (frac_part < 0) frac_part = -frac_part;
-
-	snprintf(result_str, sizeof(result_str), "%d.%02d", int_part, frac_part);
+	format_answer(answer, result_str, sizeof(result_str));
 
-	print_string(2, 1, result_str);		   // Prints the answer in the second line
+	print_string(2, view_column + RESULT_POSITION, result_str); // Prints the answer in the second line, in view
+	latency_record_since_key_edge(LATENCY_EQUALS_TO_RESULT);
 }
 /**
  * @brief Displays a two-line error message on the screen.
@@ -211,15 +254,218 @@ void
 DisplayErrorMessage(const char *error_message_line1, const char *error_message_line2)
 {
     clear_display();                         // clear display
+    view_column = 0;                         // which also undoes any shift
     turn_cursor_on_off(0);                   // Turns cursor off
     print_string(1, 0, error_message_line1); // Display error message on line 1
     print_string(2, 0, error_message_line2); // Display error message on line 2
+    latency_record_since_key_edge(LATENCY_EQUALS_TO_RESULT);
 }
 
 /**********************************************************************************************
  * Private function definitions
  **********************************************************************************************/
 
+/**
+ * @brief Formats a result to two decimal places for the display.
+ *
+ * The output is the same as snprintf() with "%d.%02d", but printf is not used:
+ * its stack frame would be the deepest on the path from main().
+ *
+ * @param[in]  answer          The floating-point value to be formatted.
+ * @param[out] p_result_str    Buffer receiving the formatted string.
+ * @param[in]  result_str_size Size of the buffer.
+ */
+static void
+format_answer(double answer, char *p_result_str, int result_str_size)
+{
+	int int_part = (int)answer;
+	int frac_part = (int)((answer - int_part) * 100);  // 2 decimal places
+	int length = 0;
+
+	if (frac_part < 0) frac_part = -frac_part;
+
+	length = append_decimal(p_result_str, result_str_size, length, int_part, 1);
+	length = append_char(p_result_str, result_str_size, length, '.');
+	length = append_decimal(p_result_str, result_str_size, length, frac_part, 2);
+	p_result_str[length] = '\0';
+}
+
+/**
+ * @brief Appends a character to a string if there is room, truncating like snprintf().
+ *
+ * @param[out] p_str    The string (not null-terminated here).
+ * @param[in]  str_size Size of the buffer, including room for the null.
+ * @param[in]  length   Characters already in the string.
+ * @param[in]  ch       The character to append.
+ * @return The new length.
+ */
+static int
+append_char(char *p_str, int str_size, int length, char ch)
+{
+    if (length < str_size - 1)
+    {
+        p_str[length++] = ch;
+    }
+    return length;
+}
+
+/**
+ * @brief Appends a signed integer in decimal, like "%0*d" with min_width.
+ *
+ * @param[out] p_str     The string (not null-terminated here).
+ * @param[in]  str_size  Size of the buffer, including room for the null.
+ * @param[in]  length    Characters already in the string.
+ * @param[in]  value     The integer.
+ * @param[in]  min_width Minimum number of characters (sign included), padded with zeros.
+ * @return The new length.
+ */
+static int
+append_decimal(char *p_str, int str_size, int length, int value, int min_width)
+{
+    char     digits[10];
+    int      n_digits = 0;
+    unsigned magnitude = (value < 0) ? 0u - (unsigned)value : (unsigned)value;
+
+    do
+    {
+        digits[n_digits++] = (char)('0' + (magnitude % 10u));
+        magnitude /= 10u;
+    } while (magnitude > 0u);
+
+    if (value < 0)
+    {
+        length = append_char(p_str, str_size, length, '-');
+        min_width--;
+    }
+    for (int pad = n_digits; pad < min_width; pad++)
+    {
+        length = append_char(p_str, str_size, length, '0');
+    }
+    while (n_digits > 0)
+    {
+        length = append_char(p_str, str_size, length, digits[--n_digits]);
+    }
+    return length;
+}
+
+/**
+ * @brief Draws a preview of the line's running result on line 2.
+ *
+ * The running result leaves out the operators the line ends with. If it is an
+ * error (or the line is empty), the last preview is blanked out instead. The value
+ * goes under the view; the spaces around it cover the last preview, which a shift
+ * of the view may have left a column either side. The preview's LCD bytes (at most
+ * 21, under a millisecond) are sent after the key's echo and before its debounce
+ * wait, in which no key is read, so a preview is always drawn in full.
+ *
+ * @param[in] p_typed_line The line as typed.
+ * @param[in] cursor_pos   Cursor column on line 1, restored after the preview.
+ */
+static void
+draw_preview(const CalcIncremental_t *p_typed_line, int cursor_pos)
+{
+#if LIVE_PREVIEW_ENABLE
+    char    text[RESULT_STRING_SIZE]; // The value, with spaces over the rest of the last one
+    uint8_t error_ref_no;
+    double  answer = calc_incremental_running_answer(p_typed_line, &error_ref_no);
+    uint8_t value_column = view_column + RESULT_POSITION;
+    uint8_t column = value_column;
+    uint8_t end = 0;
+    uint8_t length = 0;
+    uint8_t n_value = 0;
+
+    if (0u != live_preview.n_shown)
+    {
+        column = (live_preview.shown_column < value_column) ? live_preview.shown_column : value_column;
+        end = live_preview.shown_column + live_preview.n_shown;
+    }
+    while (column + length < value_column)
+    {
+        text[length++] = ' ';
+    }
+    if (0u == error_ref_no)
+    {
+        format_answer(answer, &text[length], sizeof(text) - length);
+        n_value = (uint8_t)strlen(&text[length]);
+        length += n_value;
+    }
+    while ((column + length < end) && (length < sizeof(text) - 1u))
+    {
+        text[length++] = ' ';
+    }
+    if (0u == length)
+    {
+        return; // Nothing shown and nothing to show
+    }
+    text[length] = '\0';
+
+    TRACE(TRACE_EVENT_PREVIEW_START, 0, length);
+    print_string(2, column, text);
+    set_print_position(1, (uint8_t)cursor_pos);
+    live_preview.shown_column = value_column;
+    live_preview.n_shown = n_value;
+    latency_record_since_key_edge(LATENCY_KEY_TO_PREVIEW);
+    TRACE(TRACE_EVENT_PREVIEW_END, 0, 0);
+#else
+    (void)p_typed_line;
+    (void)cursor_pos;
+#endif
+}
+
+/**
+ * @brief Echoes a typed character on line 1, shifting the view to keep the cursor
+ * after it in sight.
+ *
+ * @param[in] column Column of the character in the line.
+ * @param[in] ch     The character.
+ */
+static void
+echo_char(int column, char ch)
+{
+    scroll_to_cursor(column + 1);
+    set_print_position(1, (uint8_t)column);
+    print_char(ch);
+}
+
+/**
+ * @brief Blanks the character a backspace has removed from line 1 and leaves the
+ * cursor there, shifting the view back if the line now fits further right.
+ *
+ * @param[in] column Column of the character in the line.
+ */
+static void
+erase_char(int column)
+{
+    set_print_position(1, (uint8_t)column);
+    print_char(' ');
+    set_print_position(1, (uint8_t)column);
+    scroll_to_cursor(column);
+}
+
+/**
+ * @brief Shifts the view so that it ends at the cursor, or starts at the line's
+ * first column if the line fits: one shift instruction per column moved, whatever
+ * the length of the line.
+ *
+ * @param[in] cursor_pos Cursor column on line 1.
+ */
+static void
+scroll_to_cursor(int cursor_pos)
+{
+    int first_column = (cursor_pos > LCD_COLUMNS - 1) ? cursor_pos - (LCD_COLUMNS - 1) : 0;
+
+    while (view_column < first_column)
+    {
+        shift_display(true);
+        view_column++;
+    }
+    while (view_column > first_column)
+    {
+        shift_display(false);
+        view_column--;
+    }
+}
+
 /**********************************************************************************************
  * End of file
  **********************************************************************************************/
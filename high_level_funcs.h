@@ -19,12 +19,16 @@ extern "C" {
 /**********************************************************************************************
  * Module includes
  **********************************************************************************************/
+#include "calc_incremental.h"
 #include <stdint.h>
 #include <stdbool.h>
 
 /**********************************************************************************************
  * Public constant definitions
  **********************************************************************************************/
+#ifndef LIVE_PREVIEW_ENABLE
+#define LIVE_PREVIEW_ENABLE 1 //!< Set to 0 to leave line 2 blank while typing.
+#endif
 
 /**********************************************************************************************
  * Public type definitions
@@ -33,7 +37,7 @@ extern "C" {
 /**********************************************************************************************
  * Public function declarations
  **********************************************************************************************/
-void ReadAndEchoInput(char *input_buffer, int input_buffer_size);
+void ReadAndEchoInput(char *input_buffer, int input_buffer_size, CalcIncremental_t *p_typed_line);
 void DisplayResult(double answer);
 void DisplayErrorMessage(const char *error_message_line1, const char *error_message_line2);
 
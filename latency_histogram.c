@@ -0,0 +1,226 @@
+/**
+ * $File: latency_histogram.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      latency_histogram.c
+ *
+ *  @brief     UI latency histograms. See latency_histogram.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "latency_histogram.h"
+#include "low_level_funcs_tiva.h"
+#include <stddef.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+LatencyHistogram_t latency_histograms[LATENCY_CHANNEL_COUNT];
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static uint32_t bucket_index(uint32_t cycles);
+static uint32_t bucket_upper_bound(uint32_t index);
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static uint32_t key_edge_cycle = 0;   /* Cycle count of the most recent key edge. */
+static uint8_t  armed_channels = 0;   /* Bit per channel waiting for its end event. */
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Note that the keypad scan has just seen a key go down.
+ * Arms every channel; each is recorded by its own end event.
+ * @param   None.
+ * @return  None.
+ **/
+void
+latency_mark_key_edge(void)
+{
+    key_edge_cycle = read_cycle_count();
+    armed_channels = (1u << LATENCY_CHANNEL_COUNT) - 1u;
+}
+
+/**
+ * @brief   Record the time since the last key edge, if the channel is armed.
+ * Call this after the last LCD byte of the response. Does nothing (so it is
+ * safe to call) when there has been no key edge since the channel was last recorded.
+ * @param   [in] channel The latency being measured.
+ * @return  None.
+ **/
+void
+latency_record_since_key_edge(LatencyChannel_t channel)
+{
+    if (armed_channels & (1u << channel))
+    {
+        armed_channels &= ~(1u << channel);
+        latency_record(channel, read_cycle_count() - key_edge_cycle);
+    }
+}
+
+/**
+ * @brief   Add one value to a histogram.
+ * @param   [in] channel The histogram.
+ * @param   [in] cycles The latency, in system clock cycles.
+ * @return  None.
+ **/
+void
+latency_record(LatencyChannel_t channel, uint32_t cycles)
+{
+    LatencyHistogram_t *p_histogram = &latency_histograms[channel];
+
+    p_histogram->bucket[bucket_index(cycles)]++;
+    p_histogram->count++;
+    if (cycles > p_histogram->max)
+    {
+        p_histogram->max = cycles;
+    }
+}
+
+/**
+ * @brief   Estimate a percentile of a histogram.
+ * The result is the upper bound of the bucket holding the percentile (capped at
+ * the maximum recorded), so it is never below the true value and at most 12.5 % above.
+ * @param   [in] channel The histogram.
+ * @param   [in] per_mille The percentile in tenths of a percent (500 = median, 990 = p99).
+ * @return  The latency in cycles, or 0 if nothing has been recorded.
+ **/
+uint32_t
+latency_percentile(LatencyChannel_t channel, uint16_t per_mille)
+{
+    const LatencyHistogram_t *p_histogram = &latency_histograms[channel];
+    uint64_t                  target;
+    uint32_t                  seen = 0;
+
+    if (0u == p_histogram->count)
+    {
+        return 0;
+    }
+
+    target = ((uint64_t)p_histogram->count * per_mille + 999u) / 1000u; // Rank, rounded up
+    if (0u == target)
+    {
+        target = 1;
+    }
+
+    for (uint32_t index = 0; index < LATENCY_BUCKET_COUNT; index++)
+    {
+        seen += p_histogram->bucket[index];
+        if (seen >= target)
+        {
+            uint32_t upper = bucket_upper_bound(index);
+            return (upper < p_histogram->max) ? upper : p_histogram->max;
+        }
+    }
+
+    return p_histogram->max;
+}
+
+/**
+ * @brief   Clear all histograms.
+ * @param   None.
+ * @return  None.
+ **/
+void
+latency_reset(void)
+{
+    for (size_t channel = 0; channel < LATENCY_CHANNEL_COUNT; channel++)
+    {
+        LatencyHistogram_t *p_histogram = &latency_histograms[channel];
+
+        p_histogram->count = 0;
+        p_histogram->max = 0;
+        for (size_t index = 0; index < LATENCY_BUCKET_COUNT; index++)
+        {
+            p_histogram->bucket[index] = 0;
+        }
+    }
+    armed_channels = 0;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Find the bucket for a value.
+ * Values below LATENCY_SUB_BUCKETS have a bucket each. Above that, the position
+ * of the top set bit picks the power of two and the next bits pick the sub-bucket.
+ * @param   [in] cycles The value.
+ * @return  The bucket index.
+ **/
+static uint32_t
+bucket_index(uint32_t cycles)
+{
+    uint32_t top_bit;
+    uint32_t shift;
+
+    if (cycles < LATENCY_SUB_BUCKETS)
+    {
+        return cycles;
+    }
+
+#if defined(__GNUC__)
+    top_bit = 31u - (uint32_t)__builtin_clz(cycles); // A single CLZ instruction on the Cortex-M4
+#else
+    top_bit = 31u;
+    while (0u == (cycles & (1u << top_bit)))
+    {
+        top_bit--;
+    }
+#endif
+    shift = top_bit - LATENCY_SUB_BUCKET_BITS;
+
+    return ((shift + 1u) << LATENCY_SUB_BUCKET_BITS) + ((cycles >> shift) & (LATENCY_SUB_BUCKETS - 1u));
+}
+
+/**
+ * @brief   Find the largest value that falls in a bucket.
+ * @param   [in] index The bucket index.
+ * @return  The upper bound, in cycles.
+ **/
+static uint32_t
+bucket_upper_bound(uint32_t index)
+{
+    uint32_t shift;
+    uint32_t sub_bucket;
+
+    if (index < LATENCY_SUB_BUCKETS)
+    {
+        return index;
+    }
+
+    shift = (index >> LATENCY_SUB_BUCKET_BITS) - 1u;
+    sub_bucket = index & (LATENCY_SUB_BUCKETS - 1u);
+
+    return ((LATENCY_SUB_BUCKETS + sub_bucket) << shift) + ((1u << shift) - 1u);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,80 @@
+/**
+ * $File: latency_histogram.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      latency_histogram.h
+ *
+ *  @brief     UI latency telemetry: fixed-size log-linear (HDR-style) histograms of the time
+ *             from a key edge in the keypad scan to its echo on line 1, from the equals
+ *             key to the result on line 2, and from a key to the running result previewed
+ *             on line 2.
+ *
+ *             Each power of two is split into LATENCY_SUB_BUCKETS linear buckets, so a
+ *             recorded value is known to within 1/LATENCY_SUB_BUCKETS (12.5 %). Recording is a
+ *             count-leading-zeros, a shift and two increments. The histograms live in
+ *             latency_histograms[] so they can be read from a memory dump.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#define LATENCY_SUB_BUCKET_BITS 3                                //!< log2 of buckets per power of two.
+#define LATENCY_SUB_BUCKETS     (1u << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_COUNT    ((32u - LATENCY_SUB_BUCKET_BITS + 1u) * LATENCY_SUB_BUCKETS)
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* What is being timed. */
+typedef enum
+{
+    LATENCY_KEY_TO_ECHO,      /* Key edge to the last LCD byte of its echo. */
+    LATENCY_EQUALS_TO_RESULT, /* Equals key edge to the last LCD byte of the result. */
+    LATENCY_KEY_TO_PREVIEW,   /* Key edge to the last LCD byte of the running result. */
+    LATENCY_CHANNEL_COUNT
+} LatencyChannel_t;
+
+/* One histogram. Values are in cycles of the system clock. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t max;
+    uint32_t bucket[LATENCY_BUCKET_COUNT];
+} LatencyHistogram_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void     latency_mark_key_edge(void);
+void     latency_record_since_key_edge(LatencyChannel_t channel);
+void     latency_record(LatencyChannel_t channel, uint32_t cycles);
+uint32_t latency_percentile(LatencyChannel_t channel, uint16_t per_mille);
+void     latency_reset(void);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+extern LatencyHistogram_t latency_histograms[LATENCY_CHANNEL_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,823 @@
+/**
+ * $File: low_level_funcs_host.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      low_level_funcs_host.c
+ *
+ *  @brief      Host (Linux) replacement for low_level_funcs_tiva.c.
+ * 				Time is a simulated clock that only moves when the firmware waits or
+ * 				touches a modelled peripheral, so a whole session runs in milliseconds
+ * 				of wall time while reporting the exact simulated device time.
+ * 				The keypad is driven by a script read from stdin (or the file named by
+ * 				CALC_HOST_SCRIPT); the session ends when the script runs out.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "low_level_funcs_tiva.h"
+#include "low_level_funcs_host.h"
+#include "latency_histogram.h"
+#include "profile.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+uint32_t boot_timeline[BOOT_PHASE_COUNT]; /* Cycle count at which each boot phase completed. */
+uint32_t boot_phases_recorded;            /* Bit n set once boot_timeline[n] holds a reading. */
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define MICROSECS_TO_CYCLES(us) ((uint64_t)(us) * HOST_SIM_CYCLES_PER_MICROSEC)
+
+/*Modelled peripheral latencies*/
+#define GPIO_ACCESS_CYCLES          2      /* One APB register access. */
+#define LCD_PULSE_MICROSECS         2      /* lcd_pulse(): 1 us high, 1 us low. */
+#define FLASH_ERASE_MICROSECS       15000  /* Page erase, worst case. */
+#define FLASH_PROGRAM_MICROSECS     50     /* One 32-bit word, worst case. */
+
+/*LCD timings, as in low_level_funcs_tiva.c*/
+#define LCD_POWER_UP_MICROSECS      15000
+#define LCD_FUNCTION_SET1_MICROSECS 4100
+#define LCD_FUNCTION_SET2_MICROSECS 100
+#define LCD_EXECUTE_MICROSECS       37
+#define LCD_CLEAR_HOME_MICROSECS    1520
+
+/*LCD model*/
+#define LCD_DDRAM_LINE_LENGTH       40     /* Characters of DDRAM per line. */
+#define LCD_VISIBLE_COLUMNS         16
+
+/*Keypad script*/
+#define KEY_GAP_MICROSECS           250000 /* Time from one key being read to the next press. */
+#define MAX_SCRIPT_KEYS             1000000
+
+/* Stack painting: a region below init_all_hardware() is painted, standing in for the target's stack. */
+#define STACK_PAINT_PATTERN         0xC5u
+#define STACK_PAINT_BYTES           65536
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void     sim_advance(uint64_t cycles);
+static void     load_key_script(void);
+static bool     append_script_key(char key);
+static void     end_session(void);
+static void     send_display_nibble(unsigned char nibble, unsigned char instruction_or_data);
+static void     send_display_byte(unsigned char byte, unsigned char instruction_or_data);
+static void     write_display_byte(unsigned char byte, unsigned char instruction_or_data);
+static void     lcd_execute(unsigned char byte, unsigned char instruction_or_data);
+static void     finish_display_init(void);
+static void     paint_stack(void);
+#if PROFILE_ENABLE
+static void     write_report_line(const char *p_line);
+#endif
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static uint64_t sim_cycles = 0;         /* The simulated clock. */
+static uint64_t clocks_ready_cycle = 0; /* Simulated time at which the cycle counter started. */
+static struct timespec wall_start;
+#if PROFILE_ENABLE
+static FILE    *p_report_stream = NULL;
+#endif
+
+/* Keypad */
+static char    *p_script_keys = NULL;
+static size_t   n_script_keys = 0;
+static size_t   next_script_key = 0;
+static uint64_t next_key_press_cycle = 0;
+static uint8_t  active_keyboard_col = 0;
+static uint32_t n_keys_read = 0;
+
+/* LCD */
+static bool     b_display_ready = false;
+static uint64_t display_power_up_deadline = 0;
+static uint64_t lcd_busy_until = 0;
+static bool     b_lcd_four_bit_mode = false;
+static bool     b_lcd_high_nibble_sent = false;
+static unsigned char lcd_high_nibble = 0;
+static char     lcd_ddram[2][LCD_DDRAM_LINE_LENGTH];
+static uint8_t  lcd_address_line = 0;
+static uint8_t  lcd_address_col = 0;
+static uint8_t  lcd_display_shift = 0;
+static uint32_t n_lcd_bytes = 0;
+static uint32_t n_lcd_timing_violations = 0;
+
+/* Flash */
+static double   flash_answer = 0.0; /* The simulated flash starts out holding 0.0. */
+static uint32_t n_flash_writes = 0;
+
+static uintptr_t stack_paint_low = 0;   /* Painted region, see paint_stack(). */
+static uintptr_t stack_paint_top = 0;
+static uint32_t  stack_high_water_mark = 0; /* Taken before the end-of-session report uses the stack. */
+
+static const char *const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "clocks ready", "LCD power-up started", "keypad ready",
+    "flash recovered", "LCD ready", "first frame",
+};
+static const char *const latency_channel_names[LATENCY_CHANNEL_COUNT] = {
+    "key to echo", "equals to result", "key to preview",
+};
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief Select which column will be examined when the rows are read by read_keyboard_row().
+ * @param [in] nibble The column, 1 to 4.
+ * @return None.
+ **/
+void
+write_keyboard_col(unsigned char nibble)
+{
+    sim_advance(GPIO_ACCESS_CYCLES);
+    active_keyboard_col = nibble;
+}
+
+/**
+ * @brief Read the rows of the selected column.
+ * The next scripted key is held down from its press time until a scan reads it;
+ * it is then released and the following key is pressed KEY_GAP_MICROSECS later.
+ * Scanning with no keys left in the script ends the session.
+ * @param   None.
+ * @return  The row bit of the pressed key (0x01 top to 0x08 bottom), or 0.
+ **/
+unsigned char
+read_keyboard_row(void)
+{
+    static const char keymap[4][4] = {
+        {'1', '2', '3', 'A'},
+        {'4', '5', '6', 'B'},
+        {'7', '8', '9', 'C'},
+        {'*', '0', '#', 'D'}
+    };
+    uint8_t row;
+
+    sim_advance(GPIO_ACCESS_CYCLES);
+
+    if (next_script_key >= n_script_keys)
+    {
+        end_session();
+    }
+    if ((sim_cycles < next_key_press_cycle) || (active_keyboard_col < 1) || (active_keyboard_col > 4))
+    {
+        return 0;
+    }
+
+    for (row = 0; row < 4; row++)
+    {
+        if (keymap[row][active_keyboard_col - 1] == p_script_keys[next_script_key])
+        {
+            next_script_key++;
+            n_keys_read++;
+            next_key_press_cycle = sim_cycles + MICROSECS_TO_CYCLES(KEY_GAP_MICROSECS);
+            return 1u << row;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Clear the display.
+ * @param   None.
+ * @return  None.
+ **/
+void
+clear_display(void)
+{
+    send_display_byte(0x01, 0);
+}
+
+/**
+ * @brief Turn the cursor on or off.
+ * @param   [in] On 0 for off, any non-zero quantity for on.
+ * @return  None.
+ **/
+void
+turn_cursor_on_off(bool b_on)
+{
+    send_display_byte(b_on ? 0x0F : 0x0C, 0);
+}
+
+/**
+ * @brief Shift both lines of the display one column.
+ * @param   [in] b_left true to move the text left (showing a later column), false right.
+ * @return  None.
+ **/
+void
+shift_display(bool b_left)
+{
+    send_display_byte(b_left ? 0x18 : 0x1C, 0);
+}
+
+/**
+ * @brief Set the print position for the next character printed.
+ * @param   [in] line The line number, 1 for top or 2 for bottom.
+ * @param   [in] char_pos The character position.
+ * @return  None.
+ **/
+void
+set_print_position(uint8_t line, uint8_t char_pos)
+{
+    if (1u == line)
+    {
+        send_display_byte(0x80 + char_pos, 0);
+    }
+    else if (2u == line)
+    {
+        send_display_byte(0xC0 + char_pos, 0);
+    }
+}
+
+/**
+ * @brief Print a character at the current position.
+ * @param   [in] ch The character to be displayed.
+ * @return  None.
+ **/
+void
+print_char(char ch)
+{
+    send_display_byte(ch, 1);
+}
+
+/**
+ * @brief Write a double-precision floating point number to the simulated flash.
+ * @param   [in] number The number to store.
+ * @return  None.
+ **/
+void
+WriteDoubleToFlash(double number)
+{
+    TRACE(TRACE_EVENT_FLASH_ERASE_START, 0, 0);
+    sim_advance(MICROSECS_TO_CYCLES(FLASH_ERASE_MICROSECS));
+    TRACE(TRACE_EVENT_FLASH_ERASE_END, 0, 0);
+    TRACE(TRACE_EVENT_FLASH_PROGRAM_START, 0, sizeof(double));
+    sim_advance(MICROSECS_TO_CYCLES(FLASH_PROGRAM_MICROSECS * (sizeof(double) / sizeof(uint32_t))));
+    TRACE(TRACE_EVENT_FLASH_PROGRAM_END, 0, 0);
+    flash_answer = number;
+    n_flash_writes++;
+
+    if (NULL != getenv("CALC_HOST_VERBOSE"))
+    {
+        printf("%12.6f s  flash <- %.17g\n", (double)sim_cycles / MICROSECS_TO_CYCLES(1000000), number);
+    }
+}
+
+/**
+ * @brief Read the double-precision floating point number from the simulated flash.
+ * @param   None.
+ * @return  number_read The number read.
+ **/
+double
+read_from_flash(void)
+{
+    sim_advance(GPIO_ACCESS_CYCLES * 2);
+    return flash_answer;
+}
+
+/**
+ * @brief Initialise the simulation: load the key script and start the clocks.
+ * The LCD initialisation is deferred to the first display write, as on the target.
+ * @param   None.
+ * @return  None
+ **/
+void
+init_all_hardware(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    load_key_script();
+
+    paint_stack();
+    clocks_ready_cycle = sim_cycles;
+    record_boot_phase(BOOT_PHASE_CLOCKS_READY);
+    display_power_up_deadline = sim_cycles + MICROSECS_TO_CYCLES(LCD_POWER_UP_MICROSECS);
+    memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+    record_boot_phase(BOOT_PHASE_LCD_POWER_UP_STARTED);
+    sim_advance(GPIO_ACCESS_CYCLES * 16); // Keypad port set-up
+    record_boot_phase(BOOT_PHASE_KEYPAD_READY);
+}
+
+/**
+ * @brief Measure the most stack used below main() since start-up.
+ * Approximate: the painted region starts just below the frame of init_all_hardware().
+ * @param   None.
+ * @return  Bytes of stack used.
+ **/
+uint32_t
+get_stack_high_water_mark(void)
+{
+    uintptr_t address = stack_paint_low;
+
+    while ((address < stack_paint_top) && (STACK_PAINT_PATTERN == *(const volatile unsigned char *)address))
+    {
+        address++;
+    }
+    return (uint32_t)(stack_paint_top - address);
+}
+
+/**
+ * @brief Wait a specified number of microseconds of simulated time.
+ * @param   [in] wait_microsecs The time (in microseconds) to delay.
+ * @return  None
+ **/
+void
+wait_microsec(uint32_t wait_microsecs)
+{
+    sim_advance(MICROSECS_TO_CYCLES(wait_microsecs));
+}
+
+/**
+ * @brief Read the simulated cycle counter.
+ * @param   None.
+ * @return  Simulated cycles since the clocks became ready, modulo 2^32.
+ **/
+uint32_t
+read_cycle_count(void)
+{
+    return (uint32_t)(sim_cycles - clocks_ready_cycle);
+}
+
+/**
+ * @brief Record the time at which a boot phase completed.
+ * @param   [in] phase The boot phase that has just completed.
+ * @return  None.
+ **/
+void
+record_boot_phase(BootPhase_t phase)
+{
+    if ((phase < BOOT_PHASE_COUNT) && (0u == (boot_phases_recorded & (1u << phase))))
+    {
+        boot_timeline[phase] = read_cycle_count(); // 0 for CLOCKS_READY, which the counter starts from
+        boot_phases_recorded |= 1u << phase;
+    }
+}
+
+/**
+ * @brief Get the time at which a boot phase completed.
+ * @param   [in] phase The boot phase of interest.
+ * @return  Microseconds from the clocks becoming ready to the end of the phase,
+ *          or 0 if the phase has not completed.
+ **/
+uint32_t
+get_boot_phase_microsec(BootPhase_t phase)
+{
+    if ((phase >= BOOT_PHASE_COUNT) || (0u == (boot_phases_recorded & (1u << phase))))
+    {
+        return 0;
+    }
+    return (boot_timeline[phase] - boot_timeline[BOOT_PHASE_CLOCKS_READY]) / HOST_SIM_CYCLES_PER_MICROSEC;
+}
+
+/**
+ * @brief Get the simulated time since the start of the session.
+ * @param   None.
+ * @return  Simulated cycles at 50 MHz.
+ **/
+uint64_t
+host_sim_get_cycles(void)
+{
+    return sim_cycles;
+}
+
+/**
+ * @brief Get the number of bytes (instructions and data) sent to the LCD so far.
+ * @param   None.
+ * @return  The byte count.
+ **/
+uint32_t
+host_sim_get_lcd_bytes(void)
+{
+    return n_lcd_bytes;
+}
+
+/**
+ * @brief Get the text currently visible on one line of the simulated LCD.
+ * @param   [in]  line The line number, 1 for top or 2 for bottom.
+ * @param   [out] p_text Receives the 16 visible characters and a null.
+ * @return  None.
+ **/
+void
+host_sim_get_lcd_line(uint8_t line, char *p_text)
+{
+    for (uint8_t col = 0; col < LCD_VISIBLE_COLUMNS; col++)
+    {
+        p_text[col] = lcd_ddram[(2u == line) ? 1 : 0][(lcd_display_shift + col) % LCD_DDRAM_LINE_LENGTH];
+    }
+    p_text[LCD_VISIBLE_COLUMNS] = '\0';
+}
+
+/**
+ * @brief Print the session report: simulated and wall time, peripheral activity,
+ * the boot timeline and the final display contents.
+ * @param   [in] p_stream Where to print the report.
+ * @return  None.
+ **/
+void
+host_sim_report(FILE *p_stream)
+{
+    struct timespec wall_now;
+    char            lcd_line[LCD_VISIBLE_COLUMNS + 1];
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_now);
+
+    fprintf(p_stream, "Simulated device time : %.6f s (%llu cycles)\n",
+            (double)sim_cycles / MICROSECS_TO_CYCLES(1000000), (unsigned long long)sim_cycles);
+    fprintf(p_stream, "Wall-clock time       : %.6f s\n",
+            (double)(wall_now.tv_sec - wall_start.tv_sec) + (wall_now.tv_nsec - wall_start.tv_nsec) / 1e9);
+    fprintf(p_stream, "Keys read             : %lu\n", (unsigned long)n_keys_read);
+    fprintf(p_stream, "LCD bytes sent        : %lu (%lu timing violations)\n",
+            (unsigned long)n_lcd_bytes, (unsigned long)n_lcd_timing_violations);
+    fprintf(p_stream, "Flash writes          : %lu\n", (unsigned long)n_flash_writes);
+    fprintf(p_stream, "Stack high-water mark : %lu bytes\n", (unsigned long)stack_high_water_mark);
+
+    fprintf(p_stream, "Boot timeline (us from clock lock):\n");
+    for (int phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+    {
+        fprintf(p_stream, "  %-22s %8lu\n", boot_phase_names[phase],
+                (unsigned long)get_boot_phase_microsec((BootPhase_t)phase));
+    }
+
+    fprintf(p_stream, "Latency (us)          :    count      p50      p90      p99      max\n");
+    for (int channel = 0; channel < LATENCY_CHANNEL_COUNT; channel++)
+    {
+        fprintf(p_stream, "  %-20s: %8lu %8lu %8lu %8lu %8lu\n", latency_channel_names[channel],
+                (unsigned long)latency_histograms[channel].count,
+                (unsigned long)(latency_percentile((LatencyChannel_t)channel, 500) / HOST_SIM_CYCLES_PER_MICROSEC),
+                (unsigned long)(latency_percentile((LatencyChannel_t)channel, 900) / HOST_SIM_CYCLES_PER_MICROSEC),
+                (unsigned long)(latency_percentile((LatencyChannel_t)channel, 990) / HOST_SIM_CYCLES_PER_MICROSEC),
+                (unsigned long)(latency_histograms[channel].max / HOST_SIM_CYCLES_PER_MICROSEC));
+    }
+
+    fprintf(p_stream, "LCD:\n");
+    host_sim_get_lcd_line(1, lcd_line);
+    fprintf(p_stream, "  |%s|\n", lcd_line);
+    host_sim_get_lcd_line(2, lcd_line);
+    fprintf(p_stream, "  |%s|\n", lcd_line);
+
+#if PROFILE_ENABLE
+    fprintf(p_stream, "Stage profile (%s of the host; simulated drivers excluded):\n", profile_tick_unit());
+    p_report_stream = p_stream;
+    profile_dump(write_report_line);
+#endif
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief 	Advance the simulated clock
+ * @param   cycles Number of cycles to advance by
+ * @return  None
+ **/
+static void
+sim_advance(uint64_t cycles)
+{
+    sim_cycles += cycles;
+}
+
+/**
+ * @brief 	Read the keypad script.
+ * Keypad keys (0-9, A-D, * and #) are used as they are. For convenience the
+ * characters + - x / . E = are translated to the key, or SHIFT and key, that
+ * types them. White space is ignored.
+ * @param   None
+ * @return  None
+ **/
+static void
+load_key_script(void)
+{
+    const char *p_path = getenv("CALC_HOST_SCRIPT");
+    FILE       *p_file = (NULL != p_path) ? fopen(p_path, "r") : stdin;
+    int         ch;
+    bool        b_okay = true;
+
+    if (NULL == p_file)
+    {
+        fprintf(stderr, "Cannot open key script %s\n", p_path);
+        exit(EXIT_FAILURE);
+    }
+
+    p_script_keys = malloc(MAX_SCRIPT_KEYS);
+    while (b_okay && (EOF != (ch = fgetc(p_file))))
+    {
+        switch (ch)
+        {
+            case '+': b_okay = append_script_key('A'); break;
+            case '-': b_okay = append_script_key('B'); break;
+            case '.': b_okay = append_script_key('C'); break;
+            case 'x': b_okay = append_script_key('D') && append_script_key('A'); break;
+            case '/': b_okay = append_script_key('D') && append_script_key('B'); break;
+            case 'E': b_okay = append_script_key('D') && append_script_key('C'); break;
+            case '=': b_okay = append_script_key('*'); break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+            default:
+                if (((ch >= '0') && (ch <= '9')) || ((ch >= 'A') && (ch <= 'D')) || ('*' == ch) || ('#' == ch))
+                {
+                    b_okay = append_script_key((char)ch);
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid character '%c' in key script\n", ch);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+        }
+    }
+
+    if (!b_okay)
+    {
+        fprintf(stderr, "Key script longer than %d keys\n", MAX_SCRIPT_KEYS);
+        exit(EXIT_FAILURE);
+    }
+    if (stdin != p_file)
+    {
+        fclose(p_file);
+    }
+}
+
+/**
+ * @brief 	Add one key to the end of the keypad script
+ * @param   key The keypad character
+ * @return  false if the script is full
+ **/
+static bool
+append_script_key(char key)
+{
+    if ((NULL == p_script_keys) || (n_script_keys >= MAX_SCRIPT_KEYS))
+    {
+        return false;
+    }
+    p_script_keys[n_script_keys++] = key;
+    return true;
+}
+
+/**
+ * @brief 	Report on the session and exit.
+ * If CALC_HOST_TRACE names a file, the trace buffer is written to it first, in
+ * the same layout as a RAM dump from the target.
+ * @param   None
+ * @return  Does not return
+ **/
+static void
+end_session(void)
+{
+    const char *p_trace_path = getenv("CALC_HOST_TRACE");
+
+    stack_high_water_mark = get_stack_high_water_mark();
+
+    if (NULL != p_trace_path)
+    {
+        FILE *p_file = fopen(p_trace_path, "wb");
+
+        if ((NULL == p_file) || (1 != fwrite(&trace_buffer, sizeof(trace_buffer), 1, p_file)))
+        {
+            fprintf(stderr, "Cannot write trace to %s\n", p_trace_path);
+        }
+        if (NULL != p_file)
+        {
+            fclose(p_file);
+        }
+    }
+
+    host_sim_report(stdout);
+    free(p_script_keys);
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief 	Send one nibble to the display model.
+ * Before 4-bit mode is selected every nibble is a complete (8-bit) instruction;
+ * afterwards nibbles are paired, high nibble first.
+ * @param   [in] nibble The nibble, in the least four significant bits
+ * @param   [in] instruction_or_data 0 for instruction, 1 for data
+ * @return  None
+ **/
+static void
+send_display_nibble(unsigned char nibble, unsigned char instruction_or_data)
+{
+    sim_advance(MICROSECS_TO_CYCLES(LCD_PULSE_MICROSECS));
+
+    if (!b_lcd_four_bit_mode)
+    {
+        lcd_execute((unsigned char)(nibble << 4), instruction_or_data);
+    }
+    else if (!b_lcd_high_nibble_sent)
+    {
+        lcd_high_nibble = nibble;
+        b_lcd_high_nibble_sent = true;
+    }
+    else
+    {
+        b_lcd_high_nibble_sent = false;
+        lcd_execute((unsigned char)((lcd_high_nibble << 4) | (nibble & 0x0F)), instruction_or_data);
+    }
+}
+
+/**
+ * @brief 	Send one byte to the display, with the same delays as the target.
+ * @param   [in] byte The byte to be sent.
+ * @param   [in] instruction_or_data 0 for instruction, 1 for data
+ * @return  None
+ **/
+static void
+send_display_byte(unsigned char byte, unsigned char instruction_or_data)
+{
+    if (!b_display_ready)
+    {
+        finish_display_init();
+    }
+
+    write_display_byte(byte, instruction_or_data);
+}
+
+/**
+ * @brief 	Write one byte to the display without finishing its initialisation.
+ * @param   [in] byte The byte to be sent.
+ * @param   [in] instruction_or_data 0 for instruction, 1 for data
+ * @return  None
+ **/
+static void
+write_display_byte(unsigned char byte, unsigned char instruction_or_data)
+{
+    TRACE(TRACE_EVENT_LCD_BYTE, byte, instruction_or_data);
+    send_display_nibble((byte & 0xf0) >> 4, instruction_or_data);
+    send_display_nibble((byte & 0x0f), instruction_or_data);
+
+    if ((0 == instruction_or_data) && (byte <= 0x03))
+    {
+        wait_microsec(LCD_CLEAR_HOME_MICROSECS);
+    }
+    else
+    {
+        wait_microsec(LCD_EXECUTE_MICROSECS);
+    }
+}
+
+/**
+ * @brief 	Carry out one complete instruction or data byte in the display model.
+ * Bytes arriving before power-up is complete or while the previous one is still
+ * executing are counted as timing violations.
+ * @param   [in] byte The byte received.
+ * @param   [in] instruction_or_data 0 for instruction, 1 for data
+ * @return  None
+ **/
+static void
+lcd_execute(unsigned char byte, unsigned char instruction_or_data)
+{
+    uint32_t execute_microsecs = LCD_EXECUTE_MICROSECS;
+
+    if ((sim_cycles < display_power_up_deadline) || (sim_cycles < lcd_busy_until))
+    {
+        n_lcd_timing_violations++;
+    }
+    n_lcd_bytes++;
+
+    if (1 == instruction_or_data)
+    {
+        lcd_ddram[lcd_address_line][lcd_address_col] = (char)byte;
+        if (++lcd_address_col >= LCD_DDRAM_LINE_LENGTH)
+        {
+            lcd_address_col = 0;                 // The address runs on into the other line
+            lcd_address_line ^= 1;
+        }
+    }
+    else if (byte & 0x80)
+    {
+        lcd_address_line = (byte & 0x40) ? 1 : 0; // Set DDRAM address
+        lcd_address_col = (byte & 0x3F) % LCD_DDRAM_LINE_LENGTH;
+    }
+    else if (byte & 0x40)
+    {
+        // Set CGRAM address: not modelled
+    }
+    else if (byte & 0x20)
+    {
+        b_lcd_four_bit_mode = (0 == (byte & 0x10)); // Function set
+        b_lcd_high_nibble_sent = false;
+    }
+    else if (byte & 0x10)
+    {
+        if (byte & 0x08)                           // Display shift
+        {
+            lcd_display_shift = (byte & 0x04)
+                                    ? (lcd_display_shift + LCD_DDRAM_LINE_LENGTH - 1) % LCD_DDRAM_LINE_LENGTH
+                                    : (lcd_display_shift + 1) % LCD_DDRAM_LINE_LENGTH;
+        }
+    }
+    else if (byte & 0x0C)
+    {
+        // Display control and entry mode: not modelled (increment, no shift assumed)
+    }
+    else if (byte & 0x02)
+    {
+        lcd_address_line = lcd_address_col = 0;    // Return home
+        lcd_display_shift = 0;
+        execute_microsecs = LCD_CLEAR_HOME_MICROSECS;
+    }
+    else if (byte & 0x01)
+    {
+        memset(lcd_ddram, ' ', sizeof(lcd_ddram)); // Clear display
+        lcd_address_line = lcd_address_col = 0;
+        lcd_display_shift = 0;
+        execute_microsecs = LCD_CLEAR_HOME_MICROSECS;
+    }
+
+    lcd_busy_until = sim_cycles + MICROSECS_TO_CYCLES(execute_microsecs);
+}
+
+#if PROFILE_ENABLE
+/**
+ * @brief 	Print one line of the stage profile in the report
+ * @param   [in] p_line The line
+ * @return  None
+ **/
+static void
+write_report_line(const char *p_line)
+{
+    fprintf(p_report_stream, "  %s\n", p_line);
+}
+#endif
+
+/**
+ * @brief 	Run the LCD initialisation sequence, as the target does on first use.
+ * @param   None
+ * @return  None
+ **/
+static void
+finish_display_init(void)
+{
+    b_display_ready = true;
+
+    if (sim_cycles < display_power_up_deadline)
+    {
+        sim_cycles = display_power_up_deadline;
+    }
+
+    send_display_nibble(0x3, 0);
+    wait_microsec(LCD_FUNCTION_SET1_MICROSECS);
+    send_display_nibble(0x3, 0);
+    wait_microsec(LCD_FUNCTION_SET2_MICROSECS);
+    send_display_nibble(0x3, 0);
+    wait_microsec(LCD_EXECUTE_MICROSECS);
+
+    send_display_nibble(0x2, 0);
+    wait_microsec(LCD_EXECUTE_MICROSECS);
+    write_display_byte(0x28, 0);
+    write_display_byte(0x06, 0);
+    write_display_byte(0x01, 0);
+    write_display_byte(0x0F, 0);
+
+    record_boot_phase(BOOT_PHASE_LCD_READY);
+}
+
+/**
+ * @brief 	Paint a region of the stack below the caller's frame with STACK_PAINT_PATTERN.
+ * The calls that main() makes later reuse this region, so get_stack_high_water_mark()
+ * can find how deep they went.
+ * @param   None
+ * @return  None
+ **/
+static __attribute__((noinline)) void
+paint_stack(void)
+{
+    volatile unsigned char paint[STACK_PAINT_BYTES];
+
+    for (size_t index = 0; index < STACK_PAINT_BYTES; index++)
+    {
+        paint[index] = STACK_PAINT_PATTERN;
+    }
+    stack_paint_low = (uintptr_t)&paint[0];
+    stack_paint_top = (uintptr_t)&paint[STACK_PAINT_BYTES];
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
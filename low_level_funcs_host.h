@@ -0,0 +1,54 @@
+/**
+ * $File: low_level_funcs_host.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      low_level_funcs_host.h
+ *
+ *  @brief     Extra functions provided only by the host (simulated) hardware drivers.
+ *             The drivers themselves implement low_level_funcs_tiva.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#define HOST_SIM_CYCLES_PER_MICROSEC 50 //!< Simulated system clock, as on the target (50 MHz).
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+uint64_t host_sim_get_cycles(void);
+uint32_t host_sim_get_lcd_bytes(void);
+void     host_sim_get_lcd_line(uint8_t line, char *p_text);
+void     host_sim_report(FILE *p_stream);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
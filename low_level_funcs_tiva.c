@@ -18,7 +18,11 @@
  **********************************************************************************************/
 #include "TExaS.h"
 #include "low_level_funcs_tiva.h"
+#include "profile.h"
+#include "trace.h"
+#include "ram_funcs.h"
 #include "_tivaware/driverlib/flash.h"
+#include <stddef.h>
 /**********************************************************************************************
  * Referenced external functions
  **********************************************************************************************/
@@ -26,10 +30,22 @@
 /**********************************************************************************************
  * Referenced external variables
  **********************************************************************************************/
+#if defined(__GNUC__) && defined(__arm__) && !defined(__TI_COMPILER_VERSION__)
+extern uint32_t __ramfunc_load__[];  /* Flash (load) address of .ramfunc, from the linker script. */
+extern uint32_t __ramfunc_start__[]; /* SRAM (run) address of .ramfunc. */
+extern uint32_t __ramfunc_end__[];
+extern uint32_t __stack_start__[];   /* Lowest address of the stack, from the linker script. */
+extern uint32_t __stack_end__[];     /* Initial stack pointer (the stack grows down). */
+#elif defined(__TI_COMPILER_VERSION__)
+extern uint32_t __stack;             /* Start of the .stack section, from the TI linker. */
+extern uint32_t __STACK_END;
+#endif
 
 /**********************************************************************************************
  * Global variable definitions
  **********************************************************************************************/
+uint32_t boot_timeline[BOOT_PHASE_COUNT]; /* Cycle count at which each boot phase completed. */
+uint32_t boot_phases_recorded;            /* Bit n set once boot_timeline[n] holds a reading. */
 
 /**********************************************************************************************
  * Private constant definitions
@@ -97,6 +113,20 @@
 #define NVIC_ST_CTRL_R     (*((volatile unsigned long *)0xE000E010))
 #define NVIC_ST_RELOAD_R   (*((volatile unsigned long *)0xE000E014))
 #define NVIC_ST_CURRENT_R  (*((volatile unsigned long *)0xE000E018))
+#define SYSTICK_MAX_RELOAD 0x00FFFFFF
+
+// Cycle counter (DWT) related Defines
+#define NVIC_DBG_DEMCR_R   (*((volatile unsigned long *)0xE000EDFC))
+#define DWT_CTRL_R         (*((volatile unsigned long *)0xE0001000))
+#define DWT_CYCCNT_R       (*((volatile unsigned long *)0xE0001004))
+#define DEMCR_TRCENA       0x01000000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+
+#define CYCLES_PER_MICROSEC 50 /* System clock is 50 MHz. */
+
+/*Stack painting*/
+#define STACK_PAINT_PATTERN      0xC5C5C5C5u /* Fills the unused stack at start-up. */
+#define STACK_PAINT_MARGIN_WORDS 16          /* Left unpainted below the painting function's frame. */
 
 /*LCD defines*/
 #define LCD_RS                                                                        \
@@ -110,6 +140,13 @@
                                                * EN (ENable data transfer) pin of the LCD. \
                                                */
 #define LCD_DATA (*((volatile unsigned long *)0x400050F0))
+
+/*LCD timings: HD44780 datasheet minimums (fosc = 270 kHz)*/
+#define LCD_POWER_UP_MICROSECS      15000 /* After Vcc rises, before the first instruction. */
+#define LCD_FUNCTION_SET1_MICROSECS 4100  /* After the first 8-bit function set. */
+#define LCD_FUNCTION_SET2_MICROSECS 100   /* After the second 8-bit function set. */
+#define LCD_EXECUTE_MICROSECS       37    /* Execution time of most instructions and data. */
+#define LCD_CLEAR_HOME_MICROSECS    1520  /* Execution time of clear display and return home. */
 /**********************************************************************************************
  * Private type definitions
  **********************************************************************************************/
@@ -121,14 +158,22 @@ static void systick_init(void);
 static void PLL_init(void);
 static void systick_wait(uint32_t delay);
 static void init_keyboard_ports(void);
-static void send_display_nibble(unsigned char byte, unsigned char instruction_or_data);
+static RAMFUNC_LCD void send_display_nibble(unsigned char byte, unsigned char instruction_or_data);
 static void send_display_byte(unsigned char byte, unsigned char instruction_or_data);
+static void write_display_byte(unsigned char byte, unsigned char instruction_or_data);
 static void init_display_port(void);
-static void lcd_pulse(void);
+static RAMFUNC_LCD void lcd_pulse(void);
 static void init_all_other(void);
+static void cycle_counter_init(void);
+static void wait_until_cycle(uint32_t deadline);
+static void finish_display_init(void);
+static void copy_ram_functions(void);
+static void paint_stack(void);
 /**********************************************************************************************
  * Private variable definitions
  **********************************************************************************************/
+static bool     b_display_ready = false;       /* Set once the LCD initialisation sequence has run. */
+static uint32_t display_power_up_deadline = 0; /* Cycle count before which the LCD must not be used. */
 
 /**********************************************************************************************
  * Public function definitions
@@ -152,7 +197,7 @@ static void init_all_other(void);
  * @param [in] nibble The 4-bit quantity to write. Exactly one bit of this should be set.
  * @return None.
  **/
-void
+RAMFUNC_KEYPAD void
 write_keyboard_col(unsigned char nibble)
 {
     static bool b_correct_nibble = true;
@@ -206,7 +251,7 @@ write_keyboard_col(unsigned char nibble)
  * @param   None.
  * @return  Data from port E.
  **/
-unsigned char
+RAMFUNC_KEYPAD unsigned char
 read_keyboard_row(void)
 {
     return GPIO_PORTE_DATA_R; // Reads the Data from port E
@@ -241,6 +286,19 @@ turn_cursor_on_off(bool b_on)
     }
 }
 
+/**
+ * @brief Shift both lines of the display one column, without changing what is in
+ * its memory (40 characters per line, of which 16 are shown). Clearing the display
+ * shifts it back.
+ * @param   [in] b_left true to move the text left (showing a later column), false right.
+ * @return  None.
+ **/
+void
+shift_display(bool b_left)
+{
+    send_display_byte(b_left ? 0x18 : 0x1C, 0); // Cursor/display shift: display, left or right
+}
+
 /**
  * @brief Set the print position for the next character printed.
  * @param   [in] line The line number, 1 for top or 2 for bottom.
@@ -296,10 +354,14 @@ WriteDoubleToFlash(double number)
     uint32_t *p_data = (uint32_t *)&number;
 
     /*Erase the memory address first*/
+    TRACE(TRACE_EVENT_FLASH_ERASE_START, 0, 0);
     FlashErase(ANSWER_FLASH_ADDRESS);
+    TRACE(TRACE_EVENT_FLASH_ERASE_END, 0, 0);
 
     /*FlashProgram() only writes 32-bit words, so write two 32-bit parts*/
+    TRACE(TRACE_EVENT_FLASH_PROGRAM_START, 0, sizeof(double));
     FlashProgram(p_data, ANSWER_FLASH_ADDRESS, sizeof(double));
+    TRACE(TRACE_EVENT_FLASH_PROGRAM_END, 0, 0);
 }
 
 /**
@@ -316,15 +378,26 @@ read_from_flash(void)
 
 /**
  * @brief Initialise everything.
+ *
+ * Steps that do not depend on each other are overlapped: the LCD ports are
+ * configured first so that its power-up wait starts as early as possible, and
+ * the keypad set-up (and, in main(), the flash recovery) runs while the panel
+ * powers up. The rest of the LCD initialisation sequence is deferred until the
+ * first byte is sent to the display.
  * @param   None.
  * @return  None
  **/
 void
 init_all_hardware(void)
 {
+    copy_ram_functions();  // Must come first: the drivers may run from SRAM
+    paint_stack();         // For get_stack_high_water_mark()
     init_all_other();      // Initialisation of clocks
-    init_display_port();   // Initialisation of the LCD
+    record_boot_phase(BOOT_PHASE_CLOCKS_READY);
+    init_display_port();   // Starts the LCD power-up; the rest of its initialisation is deferred
+    record_boot_phase(BOOT_PHASE_LCD_POWER_UP_STARTED);
     init_keyboard_ports(); // Initialisation of the Keypad
+    record_boot_phase(BOOT_PHASE_KEYPAD_READY);
 }
 
 /**
@@ -340,8 +413,94 @@ wait_microsec(uint32_t wait_microsecs)
      * That means each clock cycle is 1 / 50,000,000 = 20 ns.
      * So, 1 microsecond = 1000 ns / 20 ns = 50 cycles.
      * So, 1 µs = 50 cycles at 50 MHz.
+     *
+     * SysTick only counts 24 bits (about 335 ms), so longer waits are split.
     */
-    systick_wait(50 * wait_microsecs);
+    uint32_t cycles = CYCLES_PER_MICROSEC * wait_microsecs;
+
+    while (cycles > SYSTICK_MAX_RELOAD)
+    {
+        systick_wait(SYSTICK_MAX_RELOAD);
+        cycles -= SYSTICK_MAX_RELOAD;
+    }
+    if (cycles > 0)
+    {
+        systick_wait(cycles);
+    }
+}
+
+/**
+ * @brief Read the free-running core cycle counter.
+ * It counts at the system clock (50 MHz) from the end of the clock
+ * initialisation and wraps around after about 85 seconds.
+ * @param   None.
+ * @return  The current cycle count.
+ **/
+uint32_t
+read_cycle_count(void)
+{
+    return DWT_CYCCNT_R;
+}
+
+/**
+ * @brief Record the time at which a boot phase completed.
+ * Only the first completion of each phase is kept.
+ * @param   [in] phase The boot phase that has just completed.
+ * @return  None.
+ **/
+void
+record_boot_phase(BootPhase_t phase)
+{
+    if ((phase < BOOT_PHASE_COUNT) && (0u == (boot_phases_recorded & (1u << phase))))
+    {
+        boot_timeline[phase] = read_cycle_count(); // 0 for CLOCKS_READY, which the counter starts from
+        boot_phases_recorded |= 1u << phase;
+    }
+}
+
+/**
+ * @brief Get the time at which a boot phase completed, for the boot timeline report.
+ * @param   [in] phase The boot phase of interest.
+ * @return  Microseconds from the clocks becoming ready to the end of the phase,
+ *          or 0 if the phase has not completed.
+ **/
+uint32_t
+get_boot_phase_microsec(BootPhase_t phase)
+{
+    if ((phase >= BOOT_PHASE_COUNT) || (0u == (boot_phases_recorded & (1u << phase))))
+    {
+        return 0;
+    }
+    return (boot_timeline[phase] - boot_timeline[BOOT_PHASE_CLOCKS_READY]) / CYCLES_PER_MICROSEC;
+}
+
+/**
+ * @brief Measure the most stack used since start-up.
+ * The stack is filled with a pattern by init_all_hardware(), so the deepest
+ * word that no longer holds it marks the high-water mark. Compare it with the
+ * static bound from tools/stack_usage.py.
+ * @param   None.
+ * @return  Bytes of stack used, or 0 if the stack limits are not known.
+ **/
+uint32_t
+get_stack_high_water_mark(void)
+{
+#if defined(__GNUC__) && defined(__arm__) && !defined(__TI_COMPILER_VERSION__)
+    const uint32_t *p_word = __stack_start__;
+    const uint32_t *p_top = __stack_end__;
+#elif defined(__TI_COMPILER_VERSION__)
+    const uint32_t *p_word = &__stack;
+    const uint32_t *p_top = &__STACK_END;
+#else
+    const uint32_t *p_word = NULL;
+    const uint32_t *p_top = NULL;
+#endif
+
+    while ((p_word < p_top) && (STACK_PAINT_PATTERN == *p_word))
+    {
+        p_word++;
+    }
+    return (uint32_t)((p_top - p_word) * sizeof(uint32_t));
 }
 
 /**********************************************************************************************
@@ -474,10 +633,14 @@ send_display_nibble(unsigned char byte, unsigned char instruction_or_data)
  *
  * A wait of at least 550 ns is needed between the two nibbles.
  * This is because the second EN pulse must not start until at least
- * 1000 ns after the first one starts.
+ * 1000 ns after the first one starts. lcd_pulse() already provides this.
  *
  * A delay of 37 microseconds is needed after the second nibble. This is
- * to allow the display to process the byte.
+ * to allow the display to process the byte. Clear display and return home
+ * need 1.52 ms instead.
+ *
+ * If the deferred part of the display initialisation has not run yet, it is
+ * run first.
  *
  * @param   [in] byte The byte to be sent.
  * @param   [in] instruction_or_data 0 for instruction,
@@ -487,22 +650,57 @@ send_display_nibble(unsigned char byte, unsigned char instruction_or_data)
 static void
 send_display_byte(unsigned char byte, unsigned char instruction_or_data)
 {
+    if (!b_display_ready)
+    {
+        finish_display_init();
+    }
+
+    write_display_byte(byte, instruction_or_data);
+}
+
+/**
+ * @brief 	Write one byte to the display and wait for it to be executed.
+ * Unlike send_display_byte() this does not finish the display initialisation,
+ * so finish_display_init() can use it without recursion (which would leave the
+ * static stack bound, see tools/stack_usage.py, undefined).
+ * @param   [in] byte The byte to be sent.
+ * @param   [in] instruction_or_data 0 for instruction, 1 for data.
+ * @return  None
+ **/
+static void
+write_display_byte(unsigned char byte, unsigned char instruction_or_data)
+{
+    PROFILE_START(PROFILE_STAGE_DISPLAY_BYTE);
+    TRACE(TRACE_EVENT_LCD_BYTE, byte, instruction_or_data);
     send_display_nibble((byte & 0xf0) >> 4, instruction_or_data); // sends the higher nibble and shifts it to the right
-    wait_microsec(100);                                           // Delay of 100 microsecond between the 2 nibbles
     send_display_nibble((byte & 0x0f), instruction_or_data);      // sends the lower nibble
-    wait_microsec(37000);                                         // Delay of 37 ms
+
+    if ((0 == instruction_or_data) && (byte <= 0x03))
+    {
+        wait_microsec(LCD_CLEAR_HOME_MICROSECS); // Clear display and return home are slow
+    }
+    else
+    {
+        wait_microsec(LCD_EXECUTE_MICROSECS);    // Delay of 37 microsec
+    }
+    PROFILE_STOP(PROFILE_STAGE_DISPLAY_BYTE);
 }
 
 /**
  * @brief 	This should perform all the initialisation specific to the port
  * used for output to the LCD display.
+ *
+ * Only the ports are configured here. The LCD needs 15 ms after power-on
+ * before it accepts instructions, so the deadline is recorded and the
+ * instruction sequence is left to finish_display_init(), letting the caller
+ * do other work in the meantime.
  * @param   None
  * @return  None
  **/
 static void
 init_display_port(void)
 {
-    wait_microsec(3000); // Delay of 3 ms
+    display_power_up_deadline = read_cycle_count() + (LCD_POWER_UP_MICROSECS * CYCLES_PER_MICROSEC);
 
     // Port A
     SYSCTL_RCGC2_R |= 0x00000001; // Enables clock for port A
@@ -512,8 +710,6 @@ init_display_port(void)
     GPIO_PORTA_AFSEL_R = 0x00;    // Disables alternate function
     GPIO_PORTA_AMSEL_R = 0x00;    // Disable analog function
 
-    wait_microsec(3000);          // Delay of 3 ms
-
     // Port B
     SYSCTL_RCGC2_R |= 0x00000002; // Enables clock for port B
     GPIO_PORTB_CR_R |= 0x3C;      // Allow changes to PB 2 to 5
@@ -521,28 +717,44 @@ init_display_port(void)
     GPIO_PORTB_DEN_R |= 0x3C;     // Enable digital pins on PB 2 to 5
     GPIO_PORTB_AMSEL_R = 0x00;    // Disable analog function
     GPIO_PORTB_AFSEL_R = 0x00;    // Disables alternate function
+}
 
-    wait_microsec(15000);         // Delay of 15 ms after powering on
+/**
+ * @brief 	Send the LCD initialisation sequence (4-bit mode, two lines).
+ * Called from send_display_byte() the first time the display is used. It only
+ * waits for whatever is left of the power-up time, then uses the datasheet
+ * minimum delays between the steps.
+ * @param   None
+ * @return  None
+ **/
+static void
+finish_display_init(void)
+{
+    b_display_ready = true;
+
+    wait_until_cycle(display_power_up_deadline); // Remainder of the 15 ms after powering on
 
     send_display_nibble(0x3, 0);
-    wait_microsec(4100);         // Delay of 4.1 ms
+    wait_microsec(LCD_FUNCTION_SET1_MICROSECS); // Delay of 4.1 ms
     send_display_nibble(0x3, 0);
-    wait_microsec(100);          // Delay of 100 microsec
+    wait_microsec(LCD_FUNCTION_SET2_MICROSECS); // Delay of 100 microsec
     send_display_nibble(0x3, 0);
-    wait_microsec(37);           // Delay of 37 Microsec
+    wait_microsec(LCD_EXECUTE_MICROSECS);       // Delay of 37 Microsec
+
+    send_display_nibble(0x2, 0);                // Sets the LCD to 4 bit mode
+    wait_microsec(LCD_EXECUTE_MICROSECS);       // Delay of 37 Microsec
+    write_display_byte(0x28, 0);                // Specifies the number of display lines and fonts
+    write_display_byte(0x06, 0);                // Entry Mode Set
+    write_display_byte(0x01, 0);                // Display clear
+    write_display_byte(0x0F, 0);                // Display on, cursor on and blinking
 
-    send_display_nibble(0x2, 0); // Sets the LCD to 4 bit mode
-    wait_microsec(37);           // Delay of 37 Microsec
-    send_display_byte(0x28, 0);  // Specifies the number of display lines and fonts
-    send_display_byte(0x06, 0);  // Display Off
-    send_display_byte(0x01, 0);  // Display clear
-    send_display_byte(0x0F, 0);  // Entry Mode Set
+    record_boot_phase(BOOT_PHASE_LCD_READY);
 
 #if LCD_TESTING    
-    send_display_byte('t', 1);
-    send_display_byte('e', 1);
-    send_display_byte('s', 1);
-    send_display_byte('t', 1);
+    write_display_byte('t', 1);
+    write_display_byte('e', 1);
+    write_display_byte('s', 1);
+    write_display_byte('t', 1);
 #endif /* LCD_TESTING */
 }
 
@@ -568,8 +780,83 @@ lcd_pulse(void)
 static void
 init_all_other(void)
 {
-    PLL_init();     // Initialisation of phase locked loop
-    systick_init(); // Initialisation of SysTick
+    PLL_init();           // Initialisation of phase locked loop
+    systick_init();       // Initialisation of SysTick
+    cycle_counter_init(); // Initialisation of the DWT cycle counter
+}
+
+/**
+ * @brief 	Copy the functions marked RAMFUNC (see ram_funcs.h) from flash to SRAM.
+ * The TI compiler's linker copies its ramfunc section itself, so this only
+ * applies to GCC builds.
+ * @param   None
+ * @return  None
+ **/
+static void
+copy_ram_functions(void)
+{
+#if defined(__GNUC__) && defined(__arm__) && !defined(__TI_COMPILER_VERSION__)
+    const uint32_t *p_source = __ramfunc_load__;
+    uint32_t       *p_destination = __ramfunc_start__;
+
+    while (p_destination < __ramfunc_end__)
+    {
+        *p_destination++ = *p_source++;
+    }
+#endif
+}
+
+/**
+ * @brief 	Fill the unused part of the stack with STACK_PAINT_PATTERN.
+ * Everything from the bottom of the stack up to a margin below this function's
+ * own frame is painted.
+ * @param   None
+ * @return  None
+ **/
+static void
+paint_stack(void)
+{
+#if defined(__GNUC__) && defined(__arm__) && !defined(__TI_COMPILER_VERSION__)
+    uint32_t *p_word = __stack_start__;
+#elif defined(__TI_COMPILER_VERSION__)
+    uint32_t *p_word = &__stack;
+#else
+    uint32_t *p_word = NULL;
+#endif
+    volatile uint32_t frame_marker = 0;
+    uint32_t         *p_limit = (uint32_t *)&frame_marker - STACK_PAINT_MARGIN_WORDS;
+
+    while ((NULL != p_word) && (p_word < p_limit))
+    {
+        *p_word++ = STACK_PAINT_PATTERN;
+    }
+}
+
+/**
+ * @brief 	Start the DWT cycle counter from zero
+ * @param   None
+ * @return  None
+ **/
+static void
+cycle_counter_init(void)
+{
+    NVIC_DBG_DEMCR_R |= DEMCR_TRCENA; // enable the DWT unit
+    DWT_CYCCNT_R = 0;                  // start counting from zero
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;  // enable the cycle counter
+}
+
+/**
+ * @brief 	Busy-wait until the cycle counter reaches a deadline
+ * Returns straight away if the deadline has already passed.
+ * @param   deadline The cycle count to wait for
+ * @return  None
+ **/
+static void
+wait_until_cycle(uint32_t deadline)
+{
+    while ((int32_t)(deadline - DWT_CYCCNT_R) > 0)
+    {
+    }
 }
 
 /**********************************************************************************************
@@ -29,6 +29,17 @@ extern "C" {
 /**********************************************************************************************
  * Public type definitions
  **********************************************************************************************/
+/* Boot phases, in the order they normally complete. */
+typedef enum
+{
+    BOOT_PHASE_CLOCKS_READY,         /* PLL locked, SysTick and cycle counter running. */
+    BOOT_PHASE_LCD_POWER_UP_STARTED, /* LCD ports configured, power-up wait running. */
+    BOOT_PHASE_KEYPAD_READY,         /* Keypad ports configured. */
+    BOOT_PHASE_FLASH_RECOVERED,      /* Previous answer read back from flash. */
+    BOOT_PHASE_LCD_READY,            /* LCD initialisation sequence complete. */
+    BOOT_PHASE_FIRST_FRAME,          /* Previous answer shown on the display. */
+    BOOT_PHASE_COUNT
+} BootPhase_t;
 
 /**********************************************************************************************
  * Public function declarations
@@ -37,15 +48,22 @@ void          write_keyboard_col(unsigned char nibble);
 unsigned char read_keyboard_row(void);
 void          clear_display(void);
 void          turn_cursor_on_off(bool b_on);
+void          shift_display(bool b_left);
 void          set_print_position(uint8_t line, uint8_t char_pos);
 void          print_char(char ch);
 void          WriteDoubleToFlash(double number);
 double        read_from_flash(void);
 void          init_all_hardware(void);
 void          wait_microsec(uint32_t wait_microsecs);
+uint32_t      read_cycle_count(void);
+void          record_boot_phase(BootPhase_t phase);
+uint32_t      get_boot_phase_microsec(BootPhase_t phase);
+uint32_t      get_stack_high_water_mark(void);
 /**********************************************************************************************
  * Global variable declarations
  **********************************************************************************************/
+extern uint32_t boot_timeline[BOOT_PHASE_COUNT];
+extern uint32_t boot_phases_recorded;
 
 #ifdef __cplusplus
 }
@@ -16,7 +16,11 @@
  **********************************************************************************************/
 #include "high_level_funcs.h"
 #include "low_level_funcs_tiva.h"
+#include "answer_cache.h"
+#include "calc_incremental.h"
 #include "calculate_answer.h"
+#include "trace.h"
+#include <string.h>
 /**********************************************************************************************
  * Referenced external functions
  **********************************************************************************************/
@@ -32,7 +36,6 @@
 /**********************************************************************************************
  * Private constant definitions
  **********************************************************************************************/
-#define INPUT_BUFFER_SIZE 17
 
 /**********************************************************************************************
  * Private type definitions
@@ -45,6 +48,8 @@
 /**********************************************************************************************
  * Private variable definitions
  **********************************************************************************************/
+static char              input_buffer[CALC_INPUT_BUFFER_SIZE]; // Static, not on main()'s stack, live throughout
+static CalcIncremental_t typed_line;                          // The same line, evaluated as it is typed
 
 /**********************************************************************************************
  * Public function definitions
@@ -59,22 +64,34 @@ main(void)
 {
     double answer = 0.0;
     init_all_hardware();
-    answer = read_from_flash();
-    DisplayResult(answer);
+    answer = read_from_flash(); // Overlaps the LCD power-up wait
+    record_boot_phase(BOOT_PHASE_FLASH_RECOVERED);
+    DisplayResult(answer);      // Finishes the deferred LCD initialisation
+    record_boot_phase(BOOT_PHASE_FIRST_FRAME);
 
     while (1)
     {
-        char input_buffer[INPUT_BUFFER_SIZE];
-        uint8_t  error_ref_no = 0;
+        uint8_t error_ref_no = 0;
 
-        ReadAndEchoInput(input_buffer, INPUT_BUFFER_SIZE);
+        ReadAndEchoInput(input_buffer, CALC_INPUT_BUFFER_SIZE, &typed_line);
 
         /* If the user typed equals immediately (indicated by an empty
          * buffer), we leave the previous answer to be displayed.
          * Otherwise we calculate it. */
         if (input_buffer[0] != '\0')
         {
-            answer = CalculateAnswer(input_buffer, INPUT_BUFFER_SIZE, &error_ref_no);
+            TRACE(TRACE_EVENT_CALC_START, 0, strlen(input_buffer));
+            /* The typed line has been evaluated already, unless it was cleared and
+             * equals pressed at once: the buffer then still holds the last line. */
+            if (calc_incremental_length(&typed_line) == strlen(input_buffer))
+            {
+                answer = calc_incremental_answer(&typed_line, &error_ref_no);
+            }
+            else
+            {
+                answer = CalculateAnswerCached(input_buffer, CALC_INPUT_BUFFER_SIZE, &error_ref_no);
+            }
+            TRACE(TRACE_EVENT_CALC_END, error_ref_no, 0);
         }
 
         if (error_ref_no == 0)
@@ -16,7 +16,11 @@
  * Module includes
  **********************************************************************************************/
 #include "mid_level_funcs.h"
+#include "latency_histogram.h"
 #include "low_level_funcs_tiva.h"
+#include "profile.h"
+#include "ram_funcs.h"
+#include "trace.h"
 #include <stddef.h>
 /**********************************************************************************************
  * Referenced external functions
@@ -37,6 +41,8 @@
 #define ROW_TWO   0x02
 #define ROW_THREE 0x04
 #define ROW_FOUR  0x08
+
+#define KEY_EDGE_GAP_CYCLES (20000u * 50u) /* 20 ms at 50 MHz: longer than the idle scan, shorter than a debounce. */
 /**********************************************************************************************
  * Private type definitions
  **********************************************************************************************/
@@ -44,11 +50,13 @@
 /**********************************************************************************************
  * Private function declarations
  **********************************************************************************************/
-static void keyboard_read_row_col(uint8_t *p_row, uint8_t *p_col);
+static RAMFUNC_KEYPAD void keyboard_read_row_col(uint8_t *p_row, uint8_t *p_col);
 static char keyboard_row_col_to_char(uint8_t row, uint8_t col);
 /**********************************************************************************************
  * Private variable definitions
  **********************************************************************************************/
+static char     previous_key = '?';  /* What the last scan found, to tell a new press from a held key. */
+static uint32_t previous_scan_cycle; /* When it scanned. */
 
 /**********************************************************************************************
  * Public function definitions
@@ -58,19 +66,40 @@ static char keyboard_row_col_to_char(uint8_t row, uint8_t col);
  * @brief   Get the next character from keyboard.
  * This function reads from the 16-key keypad. It waits until the user has
  * pressed a key and then returns it as an ASCII character.
+ * A scan that finds a key the previous scan did not (no key, or another key) is
+ * reported to the latency histograms as the start of the keypress-to-display time,
+ * as is any key after a gap in the scans (a debounce wait), in which it may have been
+ * released. A key held between close scans is not a new edge, and neither is the
+ * shift key, which has no response of its own: the time of a shifted key runs from
+ * the key pressed after it.
  * @param   None.
  * @return  KeyPressed The character read.
  **/
 char
 get_keyboard_char(void)
 {
-    uint8_t row = 0;
-    uint8_t col = 0;
-    char    key_pressed = '\0';
+    uint8_t  row = 0;
+    uint8_t  col = 0;
+    char     key_pressed = '\0';
+    uint32_t scan_cycle = read_cycle_count();
 
+    PROFILE_START(PROFILE_STAGE_KEYPAD_SCAN);
     keyboard_read_row_col(&row, &col);                // gets what row or coloumn is pressed
+    PROFILE_STOP(PROFILE_STAGE_KEYPAD_SCAN);
     key_pressed = keyboard_row_col_to_char(row, col); // passes	what column or row is pressed and gets the coressponding key
 
+    if ('?' != key_pressed)
+    {
+        TRACE(TRACE_EVENT_KEY_SCANNED, key_pressed, 0);
+        if (((key_pressed != previous_key) || (scan_cycle - previous_scan_cycle > KEY_EDGE_GAP_CYCLES)) &&
+            ('D' != key_pressed))
+        {
+            latency_mark_key_edge(); // Key edge: start of the keypress-to-display time
+        }
+    }
+    previous_key = key_pressed;
+    previous_scan_cycle = scan_cycle;
+
     return key_pressed;
 }
 
@@ -0,0 +1,369 @@
+/**
+ * $File: perf_counters.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      perf_counters.c
+ *
+ *  @brief     Hardware performance counters per profiled stage (Linux host only).
+ *             See perf_counters.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#define _DEFAULT_SOURCE /* For syscall(). */
+#include "perf_counters.h"
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+PerfStats_t perf_stats[PROFILE_STAGE_COUNT];
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define CALIBRATION_READS 64 /* Back-to-back reads used to measure the cost of a read. */
+#define PERF_LINE_SIZE    128 /* Size of each line passed to the perf_counters_dump() callback. */
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* How to ask the kernel for one counter. */
+typedef struct
+{
+    uint32_t type;
+    uint64_t config;
+} PerfEventConfig_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static int  open_event(const PerfEventConfig_t *p_config, int leader_fd);
+static void calibrate_read_overhead(void);
+static void format_per_call(char *p_text, size_t text_size, PerfCounter_t counter, const PerfStats_t *p_stats);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const PerfEventConfig_t event_configs[PERF_COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+static const char *const counter_names[PERF_COUNTER_COUNT] = {
+    "instructions", "cycles", "branch_misses", "l1d_misses",
+};
+static int          event_fds[PERF_COUNTER_COUNT] = {-1, -1, -1, -1};
+static int          leader_fd = -1;                   /* The group is read through its leader. */
+static size_t       n_events_open = 0;
+static size_t       group_position[PERF_COUNTER_COUNT]; /* Where each counter is in a group read. */
+static PerfSample_t read_overhead;                    /* Counted by a read itself; subtracted. */
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Open and start the counters for the calling thread.
+ * Counters that cannot be opened are left out. If none can, the reason is printed
+ * on stderr once and profiling carries on with timing only.
+ * @param   None.
+ * @return  true if at least one counter is running.
+ **/
+bool
+perf_counters_open(void)
+{
+    int first_errno = 0;
+
+    if (n_events_open > 0)
+    {
+        return true;
+    }
+
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+    {
+        int fd = open_event(&event_configs[counter], leader_fd);
+
+        if (fd < 0)
+        {
+            if (0 == first_errno)
+            {
+                first_errno = errno;
+            }
+            continue;
+        }
+        if (leader_fd < 0)
+        {
+            leader_fd = fd;
+        }
+        event_fds[counter] = fd;
+        group_position[counter] = n_events_open++;
+    }
+
+    if (0 == n_events_open)
+    {
+        fprintf(stderr, "Performance counters unavailable (%s)%s; timing only\n", strerror(first_errno),
+                ((EACCES == first_errno) || (EPERM == first_errno)) ? ", see /proc/sys/kernel/perf_event_paranoid"
+                                                                    : "");
+        return false;
+    }
+
+    ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    calibrate_read_overhead();
+    return true;
+}
+
+/**
+ * @brief   Stop and close the counters.
+ * @param   None.
+ * @return  None.
+ **/
+void
+perf_counters_close(void)
+{
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+    {
+        if (event_fds[counter] >= 0)
+        {
+            close(event_fds[counter]);
+            event_fds[counter] = -1;
+        }
+    }
+    leader_fd = -1;
+    n_events_open = 0;
+}
+
+/**
+ * @brief   Check whether a counter is running.
+ * @param   [in] counter The counter.
+ * @return  true if it was opened by perf_counters_open().
+ **/
+bool
+perf_counter_available(PerfCounter_t counter)
+{
+    return event_fds[counter] >= 0;
+}
+
+/**
+ * @brief   Name a counter.
+ * @param   [in] counter The counter.
+ * @return  Its name.
+ **/
+const char *
+perf_counter_name(PerfCounter_t counter)
+{
+    return counter_names[counter];
+}
+
+/**
+ * @brief   Read every counter with a single system call.
+ * @param   [out] p_sample The counter values (0 for counters that are not running).
+ * @return  None.
+ **/
+void
+perf_counters_read(PerfSample_t *p_sample)
+{
+    uint64_t group[1 + PERF_COUNTER_COUNT]; /* PERF_FORMAT_GROUP: the number of values, then the values. */
+
+    memset(p_sample, 0, sizeof(*p_sample));
+    if ((0 == n_events_open) || (read(leader_fd, group, sizeof(group)) < (ssize_t)sizeof(uint64_t)))
+    {
+        return;
+    }
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+    {
+        if (event_fds[counter] >= 0)
+        {
+            p_sample->value[counter] = group[1 + group_position[counter]];
+        }
+    }
+}
+
+/**
+ * @brief   Add the counts since p_start to a stage, less the cost of the reads.
+ * @param   [in] stage The stage.
+ * @param   [in] p_start The counters read at the start of the stage.
+ * @return  None.
+ **/
+void
+perf_counters_record(ProfileStage_t stage, const PerfSample_t *p_start)
+{
+    PerfSample_t now;
+    PerfStats_t *p_stats = &perf_stats[stage];
+
+    if (0 == n_events_open)
+    {
+        return;
+    }
+    perf_counters_read(&now);
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+    {
+        uint64_t delta = now.value[counter] - p_start->value[counter];
+
+        p_stats->total[counter] += (delta > read_overhead.value[counter]) ? delta - read_overhead.value[counter] : 0;
+    }
+    p_stats->count++;
+}
+
+/**
+ * @brief   Clear the counts of every stage.
+ * @param   None.
+ * @return  None.
+ **/
+void
+perf_counters_reset(void)
+{
+    memset(perf_stats, 0, sizeof(perf_stats));
+}
+
+/**
+ * @brief   Dump the counts per call of each stage that has been counted.
+ * @param   [in] p_write_line Called with each null-terminated line (no newline).
+ * @return  None.
+ **/
+void
+perf_counters_dump(void (*p_write_line)(const char *p_line))
+{
+    char line[PERF_LINE_SIZE];
+
+    if (0 == n_events_open)
+    {
+        p_write_line("no hardware counters running");
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%-16s %8s %12s %10s %6s %13s %10s", "stage", "calls", "instructions",
+             "cycles", "IPC", "branch_misses", "l1d_misses");
+    p_write_line(line);
+
+    for (size_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        const PerfStats_t *p_stats = &perf_stats[stage];
+        char               per_call[PERF_COUNTER_COUNT][16];
+        char               ipc[8] = "n/a";
+
+        if (0 == p_stats->count)
+        {
+            continue;
+        }
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+        {
+            format_per_call(per_call[counter], sizeof(per_call[counter]), (PerfCounter_t)counter, p_stats);
+        }
+        if (perf_counter_available(PERF_COUNTER_INSTRUCTIONS) && perf_counter_available(PERF_COUNTER_CYCLES) &&
+            (p_stats->total[PERF_COUNTER_CYCLES] > 0))
+        {
+            snprintf(ipc, sizeof(ipc), "%.2f",
+                     (double)p_stats->total[PERF_COUNTER_INSTRUCTIONS] / (double)p_stats->total[PERF_COUNTER_CYCLES]);
+        }
+        snprintf(line, sizeof(line), "%-16s %8llu %12s %10s %6s %13s %10s", profile_stage_name((ProfileStage_t)stage),
+                 (unsigned long long)p_stats->count, per_call[PERF_COUNTER_INSTRUCTIONS], per_call[PERF_COUNTER_CYCLES],
+                 ipc, per_call[PERF_COUNTER_BRANCH_MISSES], per_call[PERF_COUNTER_L1D_MISSES]);
+        p_write_line(line);
+    }
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Open one user-space counter for the calling thread.
+ * @param   [in] p_config The counter.
+ * @param   [in] leader_fd The group leader, or -1 to make this counter the leader
+ *          (created disabled, to be enabled with the whole group).
+ * @return  The file descriptor, or -1 with errno set.
+ **/
+static int
+open_event(const PerfEventConfig_t *p_config, int leader_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = p_config->type;
+    attr.config = p_config->config;
+    attr.disabled = (leader_fd < 0) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief   Measure what a pair of reads adds to the counts, so it can be subtracted.
+ * The smallest difference between back-to-back reads is taken for each counter.
+ * @param   None.
+ * @return  None.
+ **/
+static void
+calibrate_read_overhead(void)
+{
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+    {
+        read_overhead.value[counter] = UINT64_MAX;
+    }
+    for (int read_no = 0; read_no < CALIBRATION_READS; read_no++)
+    {
+        PerfSample_t first;
+        PerfSample_t second;
+
+        perf_counters_read(&first);
+        perf_counters_read(&second);
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+        {
+            uint64_t delta = second.value[counter] - first.value[counter];
+
+            if (delta < read_overhead.value[counter])
+            {
+                read_overhead.value[counter] = delta;
+            }
+        }
+    }
+}
+
+/**
+ * @brief   Format a counter's mean count per call, or "n/a" if it is not running.
+ * @param   [out] p_text The text.
+ * @param   [in] text_size Size of p_text.
+ * @param   [in] counter The counter.
+ * @param   [in] p_stats The stage's counts.
+ * @return  None.
+ **/
+static void
+format_per_call(char *p_text, size_t text_size, PerfCounter_t counter, const PerfStats_t *p_stats)
+{
+    if (!perf_counter_available(counter))
+    {
+        snprintf(p_text, text_size, "n/a");
+        return;
+    }
+    snprintf(p_text, text_size, "%.1f", (double)p_stats->total[counter] / (double)p_stats->count);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,93 @@
+/**
+ * $File: perf_counters.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      perf_counters.h
+ *
+ *  @brief     Host-only (Linux) hardware performance counters per profiled stage.
+ *
+ *             With PROFILE_ENABLE and PROFILE_PERF_COUNTERS both 1, PROFILE_START() and
+ *             PROFILE_STOP() (see profile.h) also read a perf_event_open() group of
+ *             user-space counters: instructions, cycles, branch misses and L1d read
+ *             misses, and accumulate the difference per stage in perf_stats[].
+ *
+ *             The counters are optional at run time: nothing is counted until
+ *             perf_counters_open() succeeds. Counters the kernel or the CPU does not
+ *             provide (e.g. perf_event_paranoid, containers, VMs without a PMU) are left
+ *             out and shown as "n/a"; if none can be opened the profile falls back to
+ *             timing only.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "profile.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#if defined(__arm__)
+#error "perf_counters.c is for the Linux host build only"
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* The counters, in the order they are read. */
+typedef enum
+{
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_L1D_MISSES,        /* L1 data cache read misses. */
+    PERF_COUNTER_COUNT
+} PerfCounter_t;
+
+/* A reading of every counter (0 for those not available). */
+typedef struct
+{
+    uint64_t value[PERF_COUNTER_COUNT];
+} PerfSample_t;
+
+/* Counts accumulated over the calls of one stage. */
+typedef struct
+{
+    uint64_t count;
+    uint64_t total[PERF_COUNTER_COUNT];
+} PerfStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+bool        perf_counters_open(void);
+void        perf_counters_close(void);
+bool        perf_counter_available(PerfCounter_t counter);
+const char *perf_counter_name(PerfCounter_t counter);
+void        perf_counters_read(PerfSample_t *p_sample);
+void        perf_counters_record(ProfileStage_t stage, const PerfSample_t *p_start);
+void        perf_counters_reset(void);
+void        perf_counters_dump(void (*p_write_line)(const char *p_line));
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+extern PerfStats_t perf_stats[PROFILE_STAGE_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,180 @@
+/**
+ * $File: profile.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      profile.c
+ *
+ *  @brief     Stage profiling table. See profile.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "profile.h"
+#include <stddef.h>
+#include <stdio.h>
+#if !defined(__arm__) && !defined(__x86_64__) && !defined(__i386__)
+#include <time.h>
+#endif
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+ProfileStats_t profile_stats[PROFILE_STAGE_COUNT]; /* Readable with the debugger as well as profile_dump(). */
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const char *const stage_names[PROFILE_STAGE_COUNT] = {
+    "syntax_check_1", "syntax_check_2", "identify_tokens", "simple_atof",
+    "syntax_check_3", "evaluate",       "display_byte",    "keypad_scan",
+    "typed_char",     "stream_feed",    "stream_finish",
+};
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Add one timing to a stage's statistics.
+ * @param   [in] stage The stage timed.
+ * @param   [in] ticks The elapsed counter ticks.
+ * @return  None.
+ **/
+void
+profile_record(ProfileStage_t stage, uint32_t ticks)
+{
+    ProfileStats_t *p_stats = &profile_stats[stage];
+
+    if ((0u == p_stats->count) || (ticks < p_stats->min))
+    {
+        p_stats->min = ticks;
+    }
+    if (ticks > p_stats->max)
+    {
+        p_stats->max = ticks;
+    }
+    p_stats->total += ticks;
+    p_stats->count++;
+}
+
+/**
+ * @brief   Clear the statistics of every stage.
+ * @param   None.
+ * @return  None.
+ **/
+void
+profile_reset(void)
+{
+    for (size_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        profile_stats[stage].count = 0;
+        profile_stats[stage].min = 0;
+        profile_stats[stage].max = 0;
+        profile_stats[stage].total = 0;
+    }
+}
+
+/**
+ * @brief   Dump the statistics as text, one line per stage that has been timed.
+ * Each line is "stage count min mean max", with times in profile_tick_unit().
+ * @param   [in] p_write_line Called with each null-terminated line (no newline).
+ * @return  None.
+ **/
+void
+profile_dump(void (*p_write_line)(const char *p_line))
+{
+    char line[PROFILE_LINE_SIZE];
+
+    snprintf(line, sizeof(line), "%-16s %8s %8s %8s %8s", "stage", "count", "min", "mean", "max");
+    p_write_line(line);
+
+    for (size_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        const ProfileStats_t *p_stats = &profile_stats[stage];
+
+        if (0u == p_stats->count)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-16s %8lu %8lu %8lu %8lu", stage_names[stage],
+                 (unsigned long)p_stats->count, (unsigned long)p_stats->min,
+                 (unsigned long)(p_stats->total / p_stats->count), (unsigned long)p_stats->max);
+        p_write_line(line);
+    }
+}
+
+/**
+ * @brief   Name a stage, as in profile_dump().
+ * @param   [in] stage The stage.
+ * @return  Its name.
+ **/
+const char *
+profile_stage_name(ProfileStage_t stage)
+{
+    return stage_names[stage];
+}
+
+/**
+ * @brief   Name the unit of the profiling counter.
+ * @param   None.
+ * @return  "cycles" on the target, "TSC ticks" or "ns" on the host.
+ **/
+const char *
+profile_tick_unit(void)
+{
+#if defined(__arm__)
+    return "cycles";
+#elif defined(__x86_64__) || defined(__i386__)
+    return "TSC ticks";
+#else
+    return "ns";
+#endif
+}
+
+#if !defined(__arm__) && !defined(__x86_64__) && !defined(__i386__)
+/**
+ * @brief   Read a nanosecond clock (host stand-in for the cycle counter).
+ * @param   None.
+ * @return  The low 32 bits of the monotonic clock in nanoseconds.
+ **/
+uint32_t
+profile_read_cycles(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+}
+#endif
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
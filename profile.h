@@ -0,0 +1,145 @@
+/**
+ * $File: profile.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      profile.h
+ *
+ *  @brief     Stage profiling: PROFILE_START()/PROFILE_STOP() read a cycle counter at stage
+ *             boundaries and accumulate per-stage min/mean/max in a static table.
+ *
+ *             On the target the counter is the Cortex-M4 DWT CYCCNT (started by
+ *             init_all_hardware()). On the host it is the TSC on x86 and clock_gettime()
+ *             nanoseconds elsewhere. When PROFILE_ENABLE is 0 (the default) the macros
+ *             expand to nothing.
+ *
+ *             On a Linux host, PROFILE_PERF_COUNTERS=1 also counts instructions, cycles,
+ *             branch misses and L1d misses per stage (see perf_counters.h).
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE 0 //!< Set to 1 to compile the profiling hooks in.
+#endif
+
+#ifndef PROFILE_PERF_COUNTERS
+#define PROFILE_PERF_COUNTERS 0 //!< Set to 1 on a Linux host to add hardware counters per stage.
+#endif
+
+#define PROFILE_LINE_SIZE 64 //!< Size of each line passed to the profile_dump() callback.
+
+#if PROFILE_ENABLE && PROFILE_PERF_COUNTERS
+/** Start timing and counting a stage. Must be followed by PROFILE_STOP() for the same stage in the same block. */
+#define PROFILE_START(stage)                                                      \
+    PerfSample_t profile_perf_##stage;                                            \
+    perf_counters_read(&profile_perf_##stage);                                    \
+    const uint32_t profile_start_##stage = profile_read_cycles()
+/** Stop timing and counting a stage and record the results. */
+#define PROFILE_STOP(stage)                                                       \
+    profile_record((stage), profile_read_cycles() - profile_start_##stage);      \
+    perf_counters_record((stage), &profile_perf_##stage)
+#elif PROFILE_ENABLE
+/** Start timing a stage. Must be followed by PROFILE_STOP() for the same stage in the same block. */
+#define PROFILE_START(stage) const uint32_t profile_start_##stage = profile_read_cycles()
+/** Stop timing a stage and record the elapsed cycles. */
+#define PROFILE_STOP(stage)  profile_record((stage), profile_read_cycles() - profile_start_##stage)
+#else
+#define PROFILE_START(stage) do { } while (0)
+#define PROFILE_STOP(stage)  do { } while (0)
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* Profiled stages. */
+typedef enum
+{
+    PROFILE_STAGE_SYNTAX_CHECK_1,
+    PROFILE_STAGE_SYNTAX_CHECK_2,
+    PROFILE_STAGE_IDENTIFY_TOKENS,
+    PROFILE_STAGE_SIMPLE_ATOF,      /* Included in PROFILE_STAGE_IDENTIFY_TOKENS. */
+    PROFILE_STAGE_SYNTAX_CHECK_3,
+    PROFILE_STAGE_EVALUATE,
+    PROFILE_STAGE_DISPLAY_BYTE,     /* One byte sent to the LCD, including its delays. */
+    PROFILE_STAGE_KEYPAD_SCAN,      /* One scan of the keypad. */
+    PROFILE_STAGE_TYPED_CHAR,       /* One typed character, in calc_incremental_append(). */
+    PROFILE_STAGE_STREAM_FEED,      /* Included in PROFILE_STAGE_TYPED_CHAR. */
+    PROFILE_STAGE_STREAM_FINISH,    /* Included in PROFILE_STAGE_TYPED_CHAR. */
+    PROFILE_STAGE_COUNT
+} ProfileStage_t;
+
+/* Accumulated timings of one stage, in counter ticks. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} ProfileStats_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void        profile_record(ProfileStage_t stage, uint32_t ticks);
+void        profile_reset(void);
+void        profile_dump(void (*p_write_line)(const char *p_line));
+const char *profile_stage_name(ProfileStage_t stage);
+const char *profile_tick_unit(void);
+
+#if defined(__arm__)
+/**
+ * @brief   Read the DWT cycle counter.
+ * @return  The current cycle count.
+ **/
+static inline uint32_t
+profile_read_cycles(void)
+{
+    return *((volatile uint32_t *)0xE0001004); // DWT_CYCCNT
+}
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+/**
+ * @brief   Read the time-stamp counter.
+ * @return  The low 32 bits of the TSC.
+ **/
+static inline uint32_t
+profile_read_cycles(void)
+{
+    return (uint32_t)__rdtsc();
+}
+#else
+uint32_t profile_read_cycles(void);
+#endif
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+extern ProfileStats_t profile_stats[PROFILE_STAGE_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+#if PROFILE_PERF_COUNTERS
+#include "perf_counters.h"
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
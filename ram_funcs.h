@@ -0,0 +1,91 @@
+/**
+ * $File: ram_funcs.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      ram_funcs.h
+ *
+ *  @brief     Annotations that place hot functions in SRAM instead of flash.
+ *
+ *             Above 40 MHz the TM4C123 flash needs wait states and relies on its prefetch
+ *             buffer, so branchy code runs faster from SRAM. Functions are grouped, and each
+ *             group is placed in SRAM only when its RAM_PLACE_... flag is non-zero, so the
+ *             choice can follow the stage timings from the profiler. The engine is placed by
+ *             default; the LCD and keypad drivers spend most of their time in waits, so they
+ *             are only worth placing if profiling shows otherwise.
+ *
+ *             With GCC the functions go in the .ramfunc section, which the linker script
+ *             must load in flash and run from SRAM; copy_ram_functions() copies it at start-up.
+ *             Host builds ignore the annotations.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#ifndef RAM_PLACE_ENGINE
+#define RAM_PLACE_ENGINE 1 //!< CalculateAnswer() and its helpers, the number parser and formatter.
+#endif
+#ifndef RAM_PLACE_LCD
+#define RAM_PLACE_LCD 0    //!< send_display_nibble() and lcd_pulse().
+#endif
+#ifndef RAM_PLACE_KEYPAD
+#define RAM_PLACE_KEYPAD 0 //!< The keypad scan loop and its port accesses.
+#endif
+
+#if defined(__TI_COMPILER_VERSION__) && defined(__TI_ARM__)
+#define RAMFUNC __attribute__((ramfunc))
+#elif defined(__GNUC__) && defined(__arm__)
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline, long_call))
+#else
+#define RAMFUNC
+#endif
+
+#if RAM_PLACE_ENGINE
+#define RAMFUNC_ENGINE RAMFUNC
+#else
+#define RAMFUNC_ENGINE
+#endif
+
+#if RAM_PLACE_LCD
+#define RAMFUNC_LCD RAMFUNC
+#else
+#define RAMFUNC_LCD
+#endif
+
+#if RAM_PLACE_KEYPAD
+#define RAMFUNC_KEYPAD RAMFUNC
+#else
+#define RAMFUNC_KEYPAD
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
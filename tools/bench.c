@@ -0,0 +1,782 @@
+/**
+ * $File: bench.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      bench.c
+ *
+ *  @brief     Host micro-benchmarks for the calculation engine, the result formatting and
+ *             the (simulated) LCD driver path.
+ *
+ *             Usage: bench [-t seconds] [-f filter] [-c baseline.csv [-r percent]]
+ *               -t  Minimum time per benchmark (default 0.5 s).
+ *               -f  Only run benchmarks whose name contains the filter.
+ *               -c  Compare with a stored baseline; exit with 1 on a regression.
+ *               -r  Slow-down in ns/op that counts as a regression (default 10 %).
+ *
+ *             Results go to stdout as CSV: name, ns/op, ops/s and simulated device cycles
+ *             per op (the LCD waits modelled by low_level_funcs_host.c). The cycles are
+ *             left empty for a benchmark that costs none, such as the engine's. The batch/
+ *             benchmarks evaluate every corpus expression per run; for them an op is one
+ *             expression, so ops/s is items/s. The session/ benchmarks replay a recorded
+ *             operator session. uncached and cached evaluate a line per op through
+ *             main()'s call, without and with the result cache, whose hit rate on the
+ *             session is written to stderr. typed_key and typed_equals type the session
+ *             into the incremental evaluator, one key or one equals key per op. The jit/
+ *             benchmarks evaluate the corpora with the interpreter and with code compiled
+ *             by calc_jit.c, from tokens (eval_) and from text (line_). Save the output to
+ *             make a new baseline. The comparison is written to stderr, so
+ *             stdout stays machine-readable.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../answer_cache.h"
+#include "../calc_incremental.h"
+#include "../calc_jit.h"
+#include "../calculate_answer.h"
+#include "../high_level_funcs.h"
+#include "../mid_level_funcs.h"
+#include "../low_level_funcs_tiva.h"
+#include "../low_level_funcs_host.h"
+#include "bench_corpora.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define INPUT_BUFFER_SIZE   17  /* One screen of input and the null, as the corpora are. */
+#define REPETITIONS         15  /* Timed runs per benchmark; the fastest is reported. */
+#define MAX_BENCHMARKS      32
+#define MAX_NAME_LENGTH     48
+#define ARRAY_SIZE(array)   (sizeof(array) / sizeof((array)[0]))
+#define BATCH_SIZE          (EXPRESSION_CLASS_COUNT * CORPUS_SIZE) /* Every corpus expression. */
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One benchmark: run_op() performs operation number op_no (of a corpus, round-robin),
+   which is items_per_op of the ops reported. */
+typedef struct
+{
+    const char *p_name;
+    void (*run_op)(size_t op_no);
+    size_t items_per_op;
+} Benchmark_t;
+
+/* A result, measured or read from the baseline. */
+typedef struct
+{
+    char   name[MAX_NAME_LENGTH];
+    double ns_per_op;
+    double sim_cycles_per_op;
+    bool   b_sim_cycles; /* false if the benchmark costs no simulated cycles. */
+} BenchResult_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void   run_short_int(size_t op_no);
+static void   run_long_mixed(size_t op_no);
+static void   run_e_heavy(size_t op_no);
+static void   run_error_path(size_t op_no);
+static void   run_max_length(size_t op_no);
+static void   run_display_result(size_t op_no);
+static void   run_display_error(size_t op_no);
+static void   run_print_string(size_t op_no);
+static void   run_batch_loop(size_t op_no);
+static void   run_batch_array(size_t op_no);
+static void   run_batch_packed(size_t op_no);
+static void   run_session_uncached(size_t op_no);
+static void   run_session_cached(size_t op_no);
+static void   run_session_typed_key(size_t op_no);
+static void   run_session_typed_equals(size_t op_no);
+static void   run_jit_eval_interpreted(size_t op_no);
+static void   run_jit_eval_compiled(size_t op_no);
+static void   run_jit_line_interpreted(size_t op_no);
+static void   run_jit_line_compiled(size_t op_no);
+static void   prepare_batch(void);
+static void   prepare_session(void);
+static void   prepare_jit(void);
+static void   calculate(size_t class_no, size_t op_no);
+static double now_ns(void);
+static void   measure(const Benchmark_t *p_benchmark, double min_seconds, BenchResult_t *p_result);
+static size_t load_baseline(const char *p_path, BenchResult_t *p_baseline, size_t max_results);
+static int    compare(const BenchResult_t *p_results, size_t n_results, const BenchResult_t *p_baseline,
+                      size_t n_baseline, double threshold_percent);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const double answers[] = {
+    0.0, 1.0, -1.0, 3.14159, -42.5, 123456.78, 99.999, -2147483.0,
+};
+static const char *const display_lines[] = {
+    "12+34x56-78/9E2", "1.5E3", "7", "3.14159x2+1",
+};
+
+static const Benchmark_t benchmarks[] = {
+    {"engine/short_int", run_short_int, 1},
+    {"engine/long_mixed", run_long_mixed, 1},
+    {"engine/e_heavy", run_e_heavy, 1},
+    {"engine/error_path", run_error_path, 1},
+    {"engine/max_length", run_max_length, 1},
+    {"display/result", run_display_result, 1},
+    {"display/error", run_display_error, 1},
+    {"lcd/print_string", run_print_string, 1},
+    {"batch/loop", run_batch_loop, BATCH_SIZE},
+    {"batch/array", run_batch_array, BATCH_SIZE},
+    {"batch/packed", run_batch_packed, BATCH_SIZE},
+    {"session/uncached", run_session_uncached, 1},
+    {"session/cached", run_session_cached, 1},
+    {"session/typed_key", run_session_typed_key, 1},
+    {"session/typed_equals", run_session_typed_equals, 1},
+    {"jit/eval_interpreted", run_jit_eval_interpreted, 1},
+    {"jit/eval_compiled", run_jit_eval_compiled, 1},
+    {"jit/line_interpreted", run_jit_line_interpreted, 1},
+    {"jit/line_compiled", run_jit_line_compiled, 1},
+};
+
+/* The batch inputs: every corpus expression where it is, and packed one after another
+   with their offsets. */
+static const char *batch_inputs[BATCH_SIZE];
+static char        batch_packed[BATCH_SIZE * INPUT_BUFFER_SIZE];
+static uint32_t    batch_offsets[BATCH_SIZE];
+static size_t      batch_packed_size;
+static double      batch_answers[BATCH_SIZE];
+static uint8_t     batch_error_ref_nos[BATCH_SIZE];
+
+/* The session typed into the incremental evaluator: each line in full, and the line being
+   typed by session/typed_key with the position in the session. */
+static CalcIncremental_t typed_lines[SESSION_REPLAY_LENGTH];
+static CalcIncremental_t typing_line;
+static size_t            typing_line_no;
+static size_t            typing_index;
+
+/* The jit/ inputs: the valid corpus expressions as tokens, and every one as text. */
+static ParsedExpression_t jit_tokens[BATCH_SIZE];
+static size_t             jit_n_tokens;
+static size_t             jit_lengths[BATCH_SIZE];
+static CalcJit_t         *p_jit;
+
+static volatile double  answer_sink; /* Keeps the compiler from discarding the results. */
+static volatile uint8_t error_sink;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Run the benchmarks.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0, or 1 if a regression was found.
+ **/
+int
+main(int argc, char *argv[])
+{
+    static BenchResult_t results[MAX_BENCHMARKS];
+    static BenchResult_t baseline[MAX_BENCHMARKS];
+    double               min_seconds = 0.5;
+    double               threshold_percent = 10.0;
+    const char          *p_filter = "";
+    const char          *p_baseline_path = NULL;
+    size_t               n_results = 0;
+    int                  option;
+
+    while (-1 != (option = getopt(argc, argv, "t:f:c:r:")))
+    {
+        switch (option)
+        {
+            case 't':
+                min_seconds = atof(optarg);
+                break;
+            case 'f':
+                p_filter = optarg;
+                break;
+            case 'c':
+                p_baseline_path = optarg;
+                break;
+            case 'r':
+                threshold_percent = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t seconds] [-f filter] [-c baseline.csv [-r percent]]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    clear_display(); // Runs the one-off LCD initialisation, so it is not counted below
+    prepare_batch();
+    prepare_session();
+    prepare_jit();
+
+    printf("name,ns_per_op,ops_per_s,sim_cycles_per_op\n");
+    for (size_t index = 0; index < ARRAY_SIZE(benchmarks); index++)
+    {
+        BenchResult_t *p_result = &results[n_results];
+
+        if (NULL == strstr(benchmarks[index].p_name, p_filter))
+        {
+            continue;
+        }
+        measure(&benchmarks[index], min_seconds, p_result);
+        printf("%s,%.1f,%.0f,", p_result->name, p_result->ns_per_op, 1e9 / p_result->ns_per_op);
+        if (p_result->b_sim_cycles)
+        {
+            printf("%.1f", p_result->sim_cycles_per_op);
+        }
+        printf("\n");
+        fflush(stdout);
+        n_results++;
+    }
+
+    if (NULL != p_baseline_path)
+    {
+        size_t n_baseline = load_baseline(p_baseline_path, baseline, MAX_BENCHMARKS);
+
+        if (0 == n_baseline)
+        {
+            fprintf(stderr, "%s: no results to compare with\n", p_baseline_path);
+            return EXIT_FAILURE;
+        }
+        return compare(results, n_results, baseline, n_baseline, threshold_percent);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/* The operations timed by benchmarks[]; op_no picks the input, round-robin. */
+static void
+run_short_int(size_t op_no)
+{
+    calculate(0, op_no); // short_int
+}
+
+static void
+run_long_mixed(size_t op_no)
+{
+    calculate(1, op_no); // long_mixed
+}
+
+static void
+run_e_heavy(size_t op_no)
+{
+    calculate(2, op_no); // e_heavy
+}
+
+static void
+run_error_path(size_t op_no)
+{
+    calculate(3, op_no); // error_path
+}
+
+static void
+run_max_length(size_t op_no)
+{
+    calculate(4, op_no); // max_length
+}
+
+static void
+run_display_result(size_t op_no)
+{
+    DisplayResult(answers[op_no % ARRAY_SIZE(answers)]);
+}
+
+static void
+run_display_error(size_t op_no)
+{
+    uint8_t error_ref_no = 7 + (op_no % 5);
+
+    DisplayErrorMessage(error_message_line1[error_ref_no], error_message_line2[error_ref_no]);
+}
+
+static void
+run_print_string(size_t op_no)
+{
+    print_string(1, 0, display_lines[op_no % ARRAY_SIZE(display_lines)]);
+}
+
+/* The loop a tool would write without the batch API: CalculateAnswer() takes a writable
+   buffer, so each read-only expression is copied into one first, as main() does. */
+static void
+run_batch_loop(size_t op_no)
+{
+    (void)op_no;
+    for (size_t item = 0; item < BATCH_SIZE; item++)
+    {
+        char input_buffer[INPUT_BUFFER_SIZE];
+
+        strncpy(input_buffer, batch_inputs[item], INPUT_BUFFER_SIZE - 1);
+        input_buffer[INPUT_BUFFER_SIZE - 1] = '\0';
+        batch_answers[item] = CalculateAnswer(input_buffer, INPUT_BUFFER_SIZE, &batch_error_ref_nos[item]);
+    }
+    answer_sink = batch_answers[BATCH_SIZE - 1];
+}
+
+static void
+run_batch_array(size_t op_no)
+{
+    (void)op_no;
+    CalculateAnswerBatch(batch_inputs, BATCH_SIZE, INPUT_BUFFER_SIZE, batch_answers, batch_error_ref_nos);
+    answer_sink = batch_answers[BATCH_SIZE - 1];
+}
+
+static void
+run_batch_packed(size_t op_no)
+{
+    (void)op_no;
+    CalculateAnswerPacked(batch_packed, batch_packed_size, batch_offsets, BATCH_SIZE, INPUT_BUFFER_SIZE,
+                          batch_answers, batch_error_ref_nos);
+    answer_sink = batch_answers[BATCH_SIZE - 1];
+}
+
+/* One line of the replayed session, as main() evaluates it: typed into the input buffer
+   and calculated, directly or through the result cache. */
+static void
+run_session_uncached(size_t op_no)
+{
+    char    input_buffer[INPUT_BUFFER_SIZE];
+    uint8_t error_ref_no = 0;
+
+    strncpy(input_buffer, session_replay[op_no % SESSION_REPLAY_LENGTH], INPUT_BUFFER_SIZE - 1);
+    input_buffer[INPUT_BUFFER_SIZE - 1] = '\0';
+    answer_sink = CalculateAnswer(input_buffer, INPUT_BUFFER_SIZE, &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+static void
+run_session_cached(size_t op_no)
+{
+    char    input_buffer[INPUT_BUFFER_SIZE];
+    uint8_t error_ref_no = 0;
+
+    strncpy(input_buffer, session_replay[op_no % SESSION_REPLAY_LENGTH], INPUT_BUFFER_SIZE - 1);
+    input_buffer[INPUT_BUFFER_SIZE - 1] = '\0';
+    answer_sink = CalculateAnswerCached(input_buffer, INPUT_BUFFER_SIZE, &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+/* One key of the session, starting the next line when one is finished (op_no is unused:
+   the keys are typed in order). */
+static void
+run_session_typed_key(size_t op_no)
+{
+    const char *p_line = session_replay[typing_line_no];
+
+    (void)op_no;
+    if ('\0' == p_line[typing_index])
+    {
+        typing_line_no = (typing_line_no + 1u) % SESSION_REPLAY_LENGTH;
+        typing_index = 0;
+        p_line = session_replay[typing_line_no];
+        calc_incremental_clear(&typing_line);
+    }
+    (void)calc_incremental_append(&typing_line, p_line[typing_index++]);
+}
+
+/* The equals key on a typed line: the answer is already there. */
+static void
+run_session_typed_equals(size_t op_no)
+{
+    uint8_t error_ref_no;
+
+    answer_sink = calc_incremental_answer(&typed_lines[op_no % SESSION_REPLAY_LENGTH], &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+/* One expression through the interpreter or the compiled code for its shape. Evaluation
+   only reads the tokens, so they are used where they are. */
+static void
+run_jit_eval_interpreted(size_t op_no)
+{
+    uint8_t error_ref_no;
+
+    answer_sink = EvaluateTokens(&jit_tokens[op_no % jit_n_tokens], &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+static void
+run_jit_eval_compiled(size_t op_no)
+{
+    uint8_t error_ref_no;
+
+    answer_sink = calc_jit_evaluate(p_jit, &jit_tokens[op_no % jit_n_tokens], &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+static void
+run_jit_line_interpreted(size_t op_no)
+{
+    uint8_t error_ref_no;
+
+    answer_sink = CalculateAnswerSpan(batch_inputs[op_no % BATCH_SIZE], jit_lengths[op_no % BATCH_SIZE],
+                                      &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+static void
+run_jit_line_compiled(size_t op_no)
+{
+    uint8_t error_ref_no;
+
+    answer_sink = calc_jit_calculate_span(p_jit, batch_inputs[op_no % BATCH_SIZE], jit_lengths[op_no % BATCH_SIZE],
+                                          &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+/**
+ * @brief   Lay out the batch inputs, and check that both batch functions agree
+ * bit for bit with CalculateAnswer() on them.
+ * @param   None.
+ * @return  None (exits on a mismatch).
+ **/
+static void
+prepare_batch(void)
+{
+    double  loop_answers[BATCH_SIZE];
+    uint8_t loop_error_ref_nos[BATCH_SIZE];
+
+    for (size_t item = 0; item < BATCH_SIZE; item++)
+    {
+        const char *p_expression = expression_classes[item / CORPUS_SIZE].expressions[item % CORPUS_SIZE];
+        size_t      length = strlen(p_expression); // All shorter than INPUT_BUFFER_SIZE
+
+        batch_inputs[item] = p_expression;
+        batch_offsets[item] = (uint32_t)batch_packed_size;
+        memcpy(&batch_packed[batch_packed_size], p_expression, length + 1);
+        batch_packed_size += length + 1;
+    }
+
+    run_batch_loop(0);
+    memcpy(loop_answers, batch_answers, sizeof(loop_answers));
+    memcpy(loop_error_ref_nos, batch_error_ref_nos, sizeof(loop_error_ref_nos));
+    for (int variant = 0; variant < 2; variant++)
+    {
+        if (0 == variant)
+        {
+            run_batch_array(0);
+        }
+        else
+        {
+            run_batch_packed(0);
+        }
+        if ((0 != memcmp(loop_answers, batch_answers, sizeof(loop_answers))) ||
+            (0 != memcmp(loop_error_ref_nos, batch_error_ref_nos, sizeof(loop_error_ref_nos))))
+        {
+            fprintf(stderr, "batch/%s: results differ from CalculateAnswer()\n", (0 == variant) ? "array" : "packed");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * @brief   Replay the session twice through the result cache from empty, check every
+ * result against CalculateAnswer() and report the hit rate on stderr. Then type each line
+ * into the incremental evaluator and check its answers too.
+ * @param   None.
+ * @return  None (exits on a mismatch).
+ **/
+static void
+prepare_session(void)
+{
+    answer_cache_reset();
+    for (size_t op_no = 0; op_no < 2 * SESSION_REPLAY_LENGTH; op_no++)
+    {
+        double  answer;
+        double  cached_answer;
+        uint8_t error_ref_no;
+
+        run_session_uncached(op_no);
+        answer = answer_sink;
+        error_ref_no = error_sink;
+        run_session_cached(op_no);
+        cached_answer = answer_sink;
+        if ((0 != memcmp(&answer, &cached_answer, sizeof(answer))) || (error_ref_no != error_sink))
+        {
+            fprintf(stderr, "session/cached: \"%s\" differs from CalculateAnswer()\n",
+                    session_replay[op_no % SESSION_REPLAY_LENGTH]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fprintf(stderr, "session/cached: %u hits, %u misses in %zu lines (%u entries)\n",
+            (unsigned)answer_cache_stats.hits, (unsigned)answer_cache_stats.misses, 2 * SESSION_REPLAY_LENGTH,
+            (unsigned)ANSWER_CACHE_ENTRIES);
+    answer_cache_reset();
+
+    for (size_t line_no = 0; line_no < SESSION_REPLAY_LENGTH; line_no++)
+    {
+        double  answer;
+        double  expected;
+        uint8_t error_ref_no;
+
+        calc_incremental_clear(&typed_lines[line_no]);
+        for (const char *p_key = session_replay[line_no]; '\0' != *p_key; p_key++)
+        {
+            (void)calc_incremental_append(&typed_lines[line_no], *p_key);
+        }
+        run_session_uncached(line_no);
+        expected = answer_sink;
+        answer = calc_incremental_answer(&typed_lines[line_no], &error_ref_no);
+        if ((0 != memcmp(&answer, &expected, sizeof(answer))) || (error_ref_no != error_sink))
+        {
+            fprintf(stderr, "session/typed: \"%s\" differs from CalculateAnswer()\n", session_replay[line_no]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    calc_incremental_clear(&typing_line);
+}
+
+/**
+ * @brief   Tokenise the corpora for the jit/ benchmarks and compile their shapes, checking
+ * that the compiled code gives the interpreter's answers bit for bit.
+ * @param   None.
+ * @return  None (exits if the compiler cannot be created or on a mismatch).
+ **/
+static void
+prepare_jit(void)
+{
+    CalcJitStats_t stats;
+
+    p_jit = calc_jit_create(CALC_JIT_DEFAULT_BYTES);
+    if (NULL == p_jit)
+    {
+        fprintf(stderr, "jit: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t item = 0; item < BATCH_SIZE; item++)
+    {
+        uint8_t error_ref_no;
+
+        jit_lengths[item] = strlen(batch_inputs[item]);
+        TokeniseExpression(batch_inputs[item], jit_lengths[item], &jit_tokens[jit_n_tokens], &error_ref_no);
+        jit_n_tokens += (0u == error_ref_no);
+    }
+
+    for (size_t op_no = 0; op_no < CALC_JIT_HOT_COUNT * BATCH_SIZE; op_no++)
+    {
+        double  answer;
+        double  compiled_answer;
+        uint8_t error_ref_no;
+
+        run_jit_line_interpreted(op_no);
+        answer = answer_sink;
+        error_ref_no = error_sink;
+        run_jit_line_compiled(op_no);
+        compiled_answer = answer_sink;
+        if ((0 != memcmp(&answer, &compiled_answer, sizeof(answer))) || (error_ref_no != error_sink))
+        {
+            fprintf(stderr, "jit: \"%s\" differs from CalculateAnswerSpan()\n", batch_inputs[op_no % BATCH_SIZE]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    calc_jit_stats(p_jit, &stats);
+    fprintf(stderr, "jit: %llu shapes compiled into %llu bytes\n", (unsigned long long)stats.shapes_compiled,
+            (unsigned long long)stats.code_bytes);
+}
+
+/**
+ * @brief   Evaluate one expression of a corpus, as main() does.
+ * @param   [in] class_no The corpus, in expression_classes[].
+ * @param   [in] op_no Picks the expression, round-robin.
+ * @return  None.
+ **/
+static void
+calculate(size_t class_no, size_t op_no)
+{
+    char    input_buffer[INPUT_BUFFER_SIZE];
+    uint8_t error_ref_no = 0;
+
+    strncpy(input_buffer, expression_classes[class_no].expressions[op_no % CORPUS_SIZE], INPUT_BUFFER_SIZE - 1);
+    input_buffer[INPUT_BUFFER_SIZE - 1] = '\0';
+    answer_sink = CalculateAnswer(input_buffer, INPUT_BUFFER_SIZE, &error_ref_no);
+    error_sink = error_ref_no;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**
+ * @brief   Time a benchmark.
+ * The number of operations per run is doubled until a run takes a fifth of the
+ * minimum time; REPETITIONS runs of that size are then timed and the fastest
+ * kept. The simulated cycles come from a separate single pass, so they do not
+ * depend on how many operations were timed.
+ * @param   [in] p_benchmark The benchmark.
+ * @param   [in] min_seconds The minimum total time.
+ * @param   [out] p_result The result.
+ * @return  None.
+ **/
+static void
+measure(const Benchmark_t *p_benchmark, double min_seconds, BenchResult_t *p_result)
+{
+    const size_t pass_ops = 8 * 5 * 4; /* A whole number of passes over every corpus above. */
+    size_t       n_ops = pass_ops;
+    double       best_ns = 0.0;
+    uint64_t     start_cycles;
+
+    snprintf(p_result->name, sizeof(p_result->name), "%s", p_benchmark->p_name);
+
+    start_cycles = host_sim_get_cycles();
+    for (size_t op_no = 0; op_no < pass_ops; op_no++)
+    {
+        p_benchmark->run_op(op_no);
+    }
+    p_result->sim_cycles_per_op =
+        (double)(host_sim_get_cycles() - start_cycles) / (double)(pass_ops * p_benchmark->items_per_op);
+    p_result->b_sim_cycles = (host_sim_get_cycles() != start_cycles);
+
+    for (;;)
+    {
+        double start_ns = now_ns();
+
+        for (size_t op_no = 0; op_no < n_ops; op_no++)
+        {
+            p_benchmark->run_op(op_no);
+        }
+        if ((now_ns() - start_ns) >= (min_seconds * 1e9 / REPETITIONS))
+        {
+            break;
+        }
+        n_ops *= 2;
+    }
+
+    for (int repetition = 0; repetition < REPETITIONS; repetition++)
+    {
+        double start_ns = now_ns();
+        double elapsed_ns;
+
+        for (size_t op_no = 0; op_no < n_ops; op_no++)
+        {
+            p_benchmark->run_op(op_no);
+        }
+        elapsed_ns = now_ns() - start_ns;
+        if ((0 == repetition) || (elapsed_ns < best_ns))
+        {
+            best_ns = elapsed_ns;
+        }
+    }
+    p_result->ns_per_op = best_ns / (double)(n_ops * p_benchmark->items_per_op);
+}
+
+/**
+ * @brief   Read a baseline written by an earlier run.
+ * @param   [in] p_path The CSV file.
+ * @param   [out] p_baseline The results read.
+ * @param   [in] max_results Size of p_baseline.
+ * @return  The number of results read.
+ **/
+static size_t
+load_baseline(const char *p_path, BenchResult_t *p_baseline, size_t max_results)
+{
+    FILE  *p_file = fopen(p_path, "r");
+    char   line[256];
+    size_t n_results = 0;
+
+    if (NULL == p_file)
+    {
+        return 0;
+    }
+    while ((n_results < max_results) && (NULL != fgets(line, sizeof(line), p_file)))
+    {
+        BenchResult_t *p_result = &p_baseline[n_results];
+        double         ops_per_s;
+        int            n_fields = sscanf(line, "%47[^,],%lf,%lf,%lf", p_result->name, &p_result->ns_per_op,
+                                         &ops_per_s, &p_result->sim_cycles_per_op);
+
+        if (n_fields >= 3) // The cycles are empty (or 0.0, in older baselines) if there are none
+        {
+            p_result->b_sim_cycles = (4 == n_fields) && (0.0 != p_result->sim_cycles_per_op);
+            p_result->sim_cycles_per_op = p_result->b_sim_cycles ? p_result->sim_cycles_per_op : 0.0;
+            n_results++;
+        }
+    }
+    fclose(p_file);
+    return n_results;
+}
+
+/**
+ * @brief   Compare results with a baseline and report on stderr.
+ * A benchmark regresses if it is more than threshold_percent slower, or if its
+ * simulated cycles (which are exact) changed at all. Benchmarks with no simulated
+ * cycles in either run are compared on time alone.
+ * @param   [in] p_results, n_results This run.
+ * @param   [in] p_baseline, n_baseline The baseline.
+ * @param   [in] threshold_percent Allowed slow-down.
+ * @return  0 if nothing regressed, otherwise 1.
+ **/
+static int
+compare(const BenchResult_t *p_results, size_t n_results, const BenchResult_t *p_baseline, size_t n_baseline,
+        double threshold_percent)
+{
+    int status = EXIT_SUCCESS;
+
+    fprintf(stderr, "%-20s %12s %12s %8s  %s\n", "benchmark", "baseline ns", "ns", "change", "");
+    for (size_t result = 0; result < n_results; result++)
+    {
+        const BenchResult_t *p_now = &p_results[result];
+        const BenchResult_t *p_then = NULL;
+        double               change_percent;
+        const char          *p_verdict = "";
+
+        for (size_t index = 0; index < n_baseline; index++)
+        {
+            if (0 == strcmp(p_baseline[index].name, p_now->name))
+            {
+                p_then = &p_baseline[index];
+            }
+        }
+        if (NULL == p_then)
+        {
+            fprintf(stderr, "%-20s %12s %12.1f %8s  new\n", p_now->name, "-", p_now->ns_per_op, "");
+            continue;
+        }
+
+        change_percent = 100.0 * (p_now->ns_per_op - p_then->ns_per_op) / p_then->ns_per_op;
+        if (change_percent > threshold_percent)
+        {
+            p_verdict = "REGRESSION";
+            status = 1;
+        }
+        if ((p_now->b_sim_cycles || p_then->b_sim_cycles) &&
+            ((p_now->b_sim_cycles != p_then->b_sim_cycles) ||
+             (p_now->sim_cycles_per_op - p_then->sim_cycles_per_op > 0.05) ||
+             (p_then->sim_cycles_per_op - p_now->sim_cycles_per_op > 0.05))) // Both as printed, to 0.1
+        {
+            p_verdict = "SIMULATED CYCLES CHANGED";
+            status = 1;
+        }
+        fprintf(stderr, "%-20s %12.1f %12.1f %+7.1f%%  %s\n", p_now->name, p_then->ns_per_op, p_now->ns_per_op,
+                change_percent, p_verdict);
+    }
+    return status;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
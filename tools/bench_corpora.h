@@ -0,0 +1,77 @@
+/**
+ * $File: bench_corpora.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      bench_corpora.h
+ *
+ *  @brief     Expression corpora shared by the host benchmark tools, one per class of
+ *             input. Every expression fits the 16-character input line.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stddef.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#define CORPUS_SIZE 8 //!< Expressions in each corpus.
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* A class of expression and its corpus. */
+typedef struct
+{
+    const char *p_name;
+    const char *expressions[CORPUS_SIZE];
+} ExpressionClass_t;
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+static const ExpressionClass_t expression_classes[] = {
+    {"short_int", {"1+2", "7x8", "9-3", "8/4", "12+34", "99x9", "100-1", "64/8"}},
+    {"long_mixed",
+     {"12.5+3x4-6/2", "1.25x8-3.5+2/4", "99/3+7.5x2-1", "3.14159x2+1", "45-12.5/5x2", "0.5+0.25x4-1/8",
+      "123+456x7/8", "6/4x3.5-2+1"}},
+    {"e_heavy", {"1E3", "2.5E3", "1E2+3E1", "4E2x2E1", "6.02E23/1E20", "1E1+1E1", "9E9-1E9", "1.5E2+2E2"}},
+    {"error_path",
+     {
+         "+12",   /* 7: starts with an operator */
+         "12+",   /* 8: ends with an operator */
+         "1+x2",  /* 9: two adjacent operators */
+         "1E2E3", /* 10: two adjacent E operators */
+         "1E2.5", /* 11: E followed by a non-integer */
+         "-5+3",  /* 6: leading minus is not a number */
+         "2x-",   /* 8 */
+         "1x/2",  /* 9 */
+     }},
+    {"max_length",
+     {"1+2x3/4-5E1+6x7", "9x8x7x6x5x4x3x2", "1.2345678901234", "1-2-3-4-5-6-7-8", "1/2/3/4/5/6/7/8",
+      "1E1+1E2-1x1/1+1", "12345678x987654", "1+1+1+1+1+1+1+1"}},
+};
+
+#define EXPRESSION_CLASS_COUNT (sizeof(expression_classes) / sizeof(expression_classes[0]))
+
+/* A replayed operator session, in the order it was typed: running totals re-entered,
+   a few checks repeated and the odd mistake corrected. It repeats itself as much as a
+   real session does, so it is what the result cache is measured on. */
+static const char *const session_replay[] = {
+    "12.5x4",   "50+7.5",   "57.5/2",   "12.5x4",   "28.75x2", "57.5/2",   "1E3/8",  "125x3",
+    "57.5/2",   "375-28.75", "12.5x4",  "1E3/8",    "346.25/5", "375-28.75", "69.25+1", "12.5x4",
+    "1E3/8",    "3x4-",     "3x4-2",    "57.5/2",   "10/3",    "12.5x4",   "10/3",   "3.3333x3",
+    "375-28.75", "1E3/8",   "10/3",     "57.5/2",   "12.5x4",  "99.99x12", "12.5x4", "1E3/8",
+};
+
+#define SESSION_REPLAY_LENGTH (sizeof(session_replay) / sizeof(session_replay[0]))
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
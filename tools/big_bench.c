@@ -0,0 +1,721 @@
+/**
+ * $File: big_bench.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      big_bench.c
+ *
+ *  @brief     Host tool: time the exact evaluator (calc_big.c) against the same evaluation
+ *             done with GMP, and check that both give the same digits.
+ *
+ *             Usage: big_bench [-s scale] [-t seconds per measurement]
+ *               -s  Digits a quotient keeps after the point (default 50; the karatsuba
+ *                   class always keeps 2000).
+ *               -t  Time spent on each class and evaluator (default 0.2).
+ *
+ *             The classes are the benchmark corpora (tools/bench_corpora.h), the recorded
+ *             session, and generated ones that need more than a double:
+ *               ledger       Sums of 200 amounts with 2 decimals, as a day's postings.
+ *               long_int     Sums of products of 48-digit integers, 4 to a term.
+ *               long_product Products of 150 48-digit integers: about 7200 digits, each
+ *                           factor far shorter than the product (schoolbook multiplies).
+ *               karatsuba    Products of 4 quotients kept to 2000 digits: factors of the
+ *                           same length, multiplied with Karatsuba.
+ *               division     Quotients of 48-digit numbers.
+ *             The GMP evaluator folds the operators in the same order and cuts each
+ *             quotient the same way: the coefficient is an mpz_t, and the power of ten is
+ *             kept beside it. Its numbers are set up once and reused, so its time is the
+ *             arithmetic and GMP's own allocation. Every answer must be the same text from
+ *             both, or the tool fails. The results go to stdout as CSV: class,
+ *             expressions, mean bytes, ns per expression for calc_big, GMP and the double
+ *             engine, GMP's time over calc_big's, and the most arena bytes one expression
+ *             used.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_big.h"
+#include "../calculate_answer.h"
+#include "bench_corpora.h"
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define ARENA_BYTES     (4u * 1024u * 1024u)
+#define ANSWER_BYTES    (1024u * 1024u)
+#define MAX_EXPRESSIONS 64
+#define GENERATED_COUNT 16   /* Expressions in each generated class. */
+#define KARATSUBA_SCALE 2000 /* Digits the karatsuba class's quotients keep. */
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* A class of expressions to time. */
+typedef struct
+{
+    const char *p_name;
+    const char *expressions[MAX_EXPRESSIONS];
+    size_t      n_expressions;
+    uint32_t    scale; /* The class's own scale, or 0 for the one asked for. */
+} BenchClass_t;
+
+/* A number for the GMP evaluator: coefficient x 10^exponent. */
+typedef struct
+{
+    mpz_t   coefficient;
+    int64_t exponent;
+} GmpNumber_t;
+
+/* The GMP evaluator's fold, as calc_big.c folds. */
+typedef struct
+{
+    GmpNumber_t answer;
+    GmpNumber_t run;
+    GmpNumber_t product;
+    GmpNumber_t quotient;
+    GmpNumber_t factor;
+    GmpNumber_t scratch;
+    mpz_t       power;
+    mpz_t       remainder;
+    uint32_t    scale;
+} GmpEvaluator_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void   add_corpus_classes(void);
+static void   add_generated_classes(void);
+static char  *generate(const char *p_kind);
+static void   append_digits(char **pp_end, unsigned n_digits);
+static void   gmp_init(GmpEvaluator_t *p_gmp);
+static bool   gmp_evaluate(GmpEvaluator_t *p_gmp, const char *p_expression, size_t length, char *p_answer,
+                           size_t answer_size);
+static void   gmp_fold(GmpEvaluator_t *p_gmp, char factor_operator, char operator, char *p_term_sign,
+                       bool *p_b_first_product, bool *p_b_first_run);
+static void   gmp_read_number(GmpNumber_t *p_number, const char *p_text, size_t length);
+static void   gmp_add(GmpEvaluator_t *p_gmp, GmpNumber_t *p_a, const GmpNumber_t *p_b, bool b_subtract);
+static void   gmp_divide(GmpEvaluator_t *p_gmp, GmpNumber_t *p_a, const GmpNumber_t *p_b);
+static void   gmp_format(const GmpNumber_t *p_number, char *p_answer, size_t answer_size);
+static bool   is_operator(char character);
+static double measure(int evaluator, const BenchClass_t *p_class, double seconds);
+static uint32_t next_random(void);
+static double now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static BenchClass_t   classes[EXPRESSION_CLASS_COUNT + 6];
+static size_t         n_classes;
+static CalcBig_t      big;
+static GmpEvaluator_t gmp;
+static uint32_t       random_state = 12345u;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check and time each class with both evaluators.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 on an error or if the evaluators disagree.
+ **/
+int
+main(int argc, char *argv[])
+{
+    long   scale = 50;
+    double seconds = 0.2;
+    int    option;
+    void  *p_arena;
+    char  *p_big_answer;
+    char  *p_gmp_answer;
+
+    while (-1 != (option = getopt(argc, argv, "s:t:")))
+    {
+        switch (option)
+        {
+            case 's':
+                scale = atol(optarg);
+                break;
+            case 't':
+                seconds = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s scale] [-t seconds per measurement]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((scale < 0) || (scale > 100000))
+    {
+        fprintf(stderr, "usage: %s [-s scale (0-100000)] [-t seconds per measurement]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    p_arena = malloc(ARENA_BYTES);
+    p_big_answer = malloc(ANSWER_BYTES);
+    p_gmp_answer = malloc(ANSWER_BYTES);
+    if ((NULL == p_arena) || (NULL == p_big_answer) || (NULL == p_gmp_answer))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    gmp_init(&gmp);
+    add_corpus_classes();
+    add_generated_classes();
+
+    printf("class,expressions,mean_bytes,calc_big_ns,gmp_ns,engine_ns,gmp_over_calc_big,peak_arena_bytes\n");
+    for (size_t class_no = 0; class_no < n_classes; class_no++)
+    {
+        const BenchClass_t *p_class = &classes[class_no];
+        size_t              bytes = 0;
+        size_t              peak = 0;
+        double              big_ns;
+        double              gmp_ns;
+        double              engine_ns;
+
+        gmp.scale = (0u != p_class->scale) ? p_class->scale : (uint32_t)scale;
+        calc_big_init(&big, p_arena, ARENA_BYTES, gmp.scale);
+        for (size_t expression_no = 0; expression_no < p_class->n_expressions; expression_no++)
+        {
+            const char     *p_expression = p_class->expressions[expression_no];
+            size_t          length = strlen(p_expression);
+            uint8_t         error_ref_no;
+            CalcBigStatus_t status = calc_big_evaluate(&big, p_expression, length, p_big_answer, ANSWER_BYTES,
+                                                       &error_ref_no);
+            bool            b_gmp_answer = gmp_evaluate(&gmp, p_expression, length, p_gmp_answer, ANSWER_BYTES);
+
+            if (((CALC_BIG_OK == status) != b_gmp_answer) || (b_gmp_answer && (0 != strcmp(p_big_answer, p_gmp_answer))))
+            {
+                fprintf(stderr, "%s: \"%.60s\" gives \"%.60s\" (status %d), GMP \"%.60s\"\n", p_class->p_name,
+                        p_expression, p_big_answer, (int)status, b_gmp_answer ? p_gmp_answer : "no answer");
+                return EXIT_FAILURE;
+            }
+            bytes += length;
+            if (calc_big_peak(&big) > peak)
+            {
+                peak = calc_big_peak(&big);
+            }
+        }
+
+        big_ns = measure(0, p_class, seconds);
+        gmp_ns = measure(1, p_class, seconds);
+        engine_ns = measure(2, p_class, seconds);
+        printf("%s,%zu,%.1f,%.1f,%.1f,%.1f,%.2f,%zu\n", p_class->p_name, p_class->n_expressions,
+               (double)bytes / (double)p_class->n_expressions, big_ns, gmp_ns, engine_ns, gmp_ns / big_ns, peak);
+        fflush(stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/* The benchmark corpora and the session, as they are. */
+static void
+add_corpus_classes(void)
+{
+    for (size_t class_no = 0; class_no < EXPRESSION_CLASS_COUNT; class_no++)
+    {
+        BenchClass_t *p_class = &classes[n_classes++];
+
+        p_class->p_name = expression_classes[class_no].p_name;
+        memcpy(p_class->expressions, expression_classes[class_no].expressions, sizeof(expression_classes[0].expressions));
+        p_class->n_expressions = CORPUS_SIZE;
+    }
+    classes[n_classes].p_name = "session";
+    memcpy(classes[n_classes].expressions, session_replay, sizeof(session_replay));
+    classes[n_classes].n_expressions = SESSION_REPLAY_LENGTH;
+    n_classes++;
+}
+
+/* The classes that need more than a double (see the file header). */
+static void
+add_generated_classes(void)
+{
+    static const char *const kinds[] = {"ledger", "long_int", "long_product", "karatsuba", "division"};
+
+    for (size_t kind_no = 0; kind_no < sizeof(kinds) / sizeof(kinds[0]); kind_no++)
+    {
+        BenchClass_t *p_class = &classes[n_classes++];
+
+        p_class->p_name = kinds[kind_no];
+        for (size_t expression_no = 0; expression_no < GENERATED_COUNT; expression_no++)
+        {
+            p_class->expressions[expression_no] = generate(kinds[kind_no]);
+        }
+        p_class->n_expressions = GENERATED_COUNT;
+        p_class->scale = (0 == strcmp(kinds[kind_no], "karatsuba")) ? KARATSUBA_SCALE : 0u;
+    }
+}
+
+/**
+ * @brief   Write one expression of a generated class (the same every run).
+ * @param   [in] p_kind The class.
+ * @return  The expression (allocated, and kept to the end).
+ **/
+static char *
+generate(const char *p_kind)
+{
+    char *p_expression = malloc(16384);
+    char *p_end = p_expression;
+
+    if (0 == strcmp(p_kind, "ledger"))
+    {
+        for (int amount_no = 0; amount_no < 200; amount_no++)
+        {
+            if (0 != amount_no)
+            {
+                *p_end++ = (0u == next_random() % 3u) ? '-' : '+';
+            }
+            p_end += sprintf(p_end, "%u.%02u", next_random() % 100000u, next_random() % 100u);
+        }
+    }
+    else if (0 == strcmp(p_kind, "long_int"))
+    {
+        for (int term_no = 0; term_no < 8; term_no++)
+        {
+            if (0 != term_no)
+            {
+                *p_end++ = (0u == next_random() % 4u) ? '-' : '+';
+            }
+            for (int factor_no = 0; factor_no < 4; factor_no++)
+            {
+                if (0 != factor_no)
+                {
+                    *p_end++ = 'x';
+                }
+                append_digits(&p_end, 48);
+            }
+        }
+    }
+    else if (0 == strcmp(p_kind, "long_product"))
+    {
+        for (int factor_no = 0; factor_no < 150; factor_no++)
+        {
+            if (0 != factor_no)
+            {
+                *p_end++ = 'x';
+            }
+            append_digits(&p_end, 48);
+        }
+    }
+    else if (0 == strcmp(p_kind, "karatsuba"))
+    {
+        for (int factor_no = 0; factor_no < 4; factor_no++)
+        {
+            if (0 != factor_no)
+            {
+                *p_end++ = 'x';
+            }
+            append_digits(&p_end, 1u + next_random() % 6u);
+            *p_end++ = '/';
+            append_digits(&p_end, 2u + next_random() % 5u);
+        }
+    }
+    else
+    {
+        for (int term_no = 0; term_no < 4; term_no++)
+        {
+            if (0 != term_no)
+            {
+                *p_end++ = '+';
+            }
+            append_digits(&p_end, 48);
+            *p_end++ = '/';
+            append_digits(&p_end, 1u + next_random() % 48u);
+        }
+    }
+    *p_end = '\0';
+    return p_expression;
+}
+
+/* Append a random number of so many digits, the first not 0. */
+static void
+append_digits(char **pp_end, unsigned n_digits)
+{
+    for (unsigned digit_no = 0; digit_no < n_digits; digit_no++)
+    {
+        *(*pp_end)++ = (char)((0u == digit_no) ? '1' + next_random() % 9u : '0' + next_random() % 10u);
+    }
+}
+
+/* Set up the GMP evaluator's numbers once (the scale is set for each class). */
+static void
+gmp_init(GmpEvaluator_t *p_gmp)
+{
+    mpz_inits(p_gmp->answer.coefficient, p_gmp->run.coefficient, p_gmp->product.coefficient,
+              p_gmp->quotient.coefficient, p_gmp->factor.coefficient, p_gmp->scratch.coefficient, p_gmp->power,
+              p_gmp->remainder, NULL);
+}
+
+/**
+ * @brief   Evaluate an expression with GMP numbers.
+ * @param   [in,out] p_gmp The evaluator.
+ * @param   [in] p_expression The expression.
+ * @param   [in] length Its characters.
+ * @param   [out] p_answer The answer, formatted as calc_big.c formats it.
+ * @param   [in] answer_size The room for it.
+ * @return  false if there is no answer (an error, or a division by zero).
+ **/
+static bool
+gmp_evaluate(GmpEvaluator_t *p_gmp, const char *p_expression, size_t length, char *p_answer, size_t answer_size)
+{
+    uint8_t error_ref_no;
+    size_t  number_start = 0;
+    char    factor_operator = '\0';
+    char    term_sign = '\0';
+    char    previous_operator = '\0';
+    bool    b_first_product = true;
+    bool    b_first_run = true;
+
+    CheckExpressionSyntax(p_expression, length, &error_ref_no);
+    if (0u != error_ref_no)
+    {
+        return false;
+    }
+
+    for (size_t index = 0; index <= length; index++)
+    {
+        char character = (index < length) ? p_expression[index] : '\0';
+
+        if ((index < length) && !is_operator(character))
+        {
+            continue;
+        }
+        if ((number_start == index) || (('E' == character) && ('E' == previous_operator)))
+        {
+            return false; // Errors 6 and 10
+        }
+        if ('E' == previous_operator)
+        {
+            gmp_read_number(&p_gmp->scratch, &p_expression[number_start], index - number_start);
+            p_gmp->factor.exponent += mpz_get_si(p_gmp->scratch.coefficient);
+        }
+        else
+        {
+            gmp_read_number(&p_gmp->factor, &p_expression[number_start], index - number_start);
+        }
+        previous_operator = character;
+        number_start = index + 1u;
+        if ('E' == character)
+        {
+            continue;
+        }
+
+        if (('/' == factor_operator) && (0 == mpz_sgn(p_gmp->factor.coefficient)))
+        {
+            return false;
+        }
+        gmp_fold(p_gmp, factor_operator, character, &term_sign, &b_first_product, &b_first_run);
+        factor_operator = character;
+    }
+
+    if (!b_first_run)
+    {
+        gmp_add(p_gmp, &p_gmp->answer, &p_gmp->run, true);
+        mpz_swap(p_gmp->run.coefficient, p_gmp->answer.coefficient);
+        p_gmp->run.exponent = p_gmp->answer.exponent;
+    }
+    gmp_format(&p_gmp->run, p_answer, answer_size);
+    return true;
+}
+
+/* Fold the factor into the levels the operator ends (see fold_operator() in calc_big.c). */
+static void
+gmp_fold(GmpEvaluator_t *p_gmp, char factor_operator, char operator, char *p_term_sign, bool *p_b_first_product,
+         bool *p_b_first_run)
+{
+    if ('/' == factor_operator)
+    {
+        gmp_divide(p_gmp, &p_gmp->quotient, &p_gmp->factor);
+    }
+    else
+    {
+        mpz_swap(p_gmp->quotient.coefficient, p_gmp->factor.coefficient);
+        p_gmp->quotient.exponent = p_gmp->factor.exponent;
+    }
+    if ('/' == operator)
+    {
+        return;
+    }
+
+    if (*p_b_first_product)
+    {
+        mpz_swap(p_gmp->product.coefficient, p_gmp->quotient.coefficient);
+        p_gmp->product.exponent = p_gmp->quotient.exponent;
+    }
+    else
+    {
+        mpz_mul(p_gmp->product.coefficient, p_gmp->product.coefficient, p_gmp->quotient.coefficient);
+        p_gmp->product.exponent += p_gmp->quotient.exponent;
+    }
+    *p_b_first_product = false;
+    if ('x' == operator)
+    {
+        return;
+    }
+
+    if ('+' == *p_term_sign)
+    {
+        gmp_add(p_gmp, &p_gmp->run, &p_gmp->product, false);
+    }
+    else
+    {
+        mpz_swap(p_gmp->run.coefficient, p_gmp->product.coefficient);
+        p_gmp->run.exponent = p_gmp->product.exponent;
+    }
+    if ('-' == operator)
+    {
+        if (*p_b_first_run)
+        {
+            mpz_swap(p_gmp->answer.coefficient, p_gmp->run.coefficient);
+            p_gmp->answer.exponent = p_gmp->run.exponent;
+        }
+        else
+        {
+            gmp_add(p_gmp, &p_gmp->answer, &p_gmp->run, true);
+        }
+        *p_b_first_run = false;
+    }
+    *p_term_sign = operator;
+    *p_b_first_product = true;
+}
+
+/* Read a number as simple_atof() does: the digits after a second point are left out. */
+static void
+gmp_read_number(GmpNumber_t *p_number, const char *p_text, size_t length)
+{
+    char    digits[MAX_NUMBER_STRING_LENGTH + 1];
+    size_t  n_digits = 0;
+    int64_t n_fraction_digits = 0;
+    int     n_points = 0;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        if ('.' == p_text[index])
+        {
+            n_points++;
+        }
+        else if (n_points < 2)
+        {
+            digits[n_digits++] = p_text[index];
+            n_fraction_digits += n_points;
+        }
+    }
+    digits[n_digits] = '\0';
+    if (0u == n_digits)
+    {
+        mpz_set_ui(p_number->coefficient, 0);
+    }
+    else
+    {
+        mpz_set_str(p_number->coefficient, digits, 10);
+    }
+    p_number->exponent = -n_fraction_digits;
+}
+
+/* a = a + b (or a - b), the points lined up. */
+static void
+gmp_add(GmpEvaluator_t *p_gmp, GmpNumber_t *p_a, const GmpNumber_t *p_b, bool b_subtract)
+{
+    if (p_a->exponent > p_b->exponent)
+    {
+        mpz_ui_pow_ui(p_gmp->power, 10, (unsigned long)(p_a->exponent - p_b->exponent));
+        mpz_mul(p_a->coefficient, p_a->coefficient, p_gmp->power);
+        p_a->exponent = p_b->exponent;
+        mpz_set(p_gmp->scratch.coefficient, p_b->coefficient);
+    }
+    else
+    {
+        mpz_ui_pow_ui(p_gmp->power, 10, (unsigned long)(p_b->exponent - p_a->exponent));
+        mpz_mul(p_gmp->scratch.coefficient, p_b->coefficient, p_gmp->power);
+    }
+    if (b_subtract)
+    {
+        mpz_sub(p_a->coefficient, p_a->coefficient, p_gmp->scratch.coefficient);
+    }
+    else
+    {
+        mpz_add(p_a->coefficient, p_a->coefficient, p_gmp->scratch.coefficient);
+    }
+}
+
+/* a = a / b, to the scale, cut toward zero. */
+static void
+gmp_divide(GmpEvaluator_t *p_gmp, GmpNumber_t *p_a, const GmpNumber_t *p_b)
+{
+    int64_t shift = p_a->exponent - p_b->exponent + (int64_t)p_gmp->scale;
+
+    if (shift >= 0)
+    {
+        mpz_ui_pow_ui(p_gmp->power, 10, (unsigned long)shift);
+        mpz_mul(p_a->coefficient, p_a->coefficient, p_gmp->power);
+        mpz_tdiv_q(p_a->coefficient, p_a->coefficient, p_b->coefficient);
+    }
+    else
+    {
+        mpz_ui_pow_ui(p_gmp->power, 10, (unsigned long)-shift);
+        mpz_mul(p_gmp->power, p_gmp->power, p_b->coefficient);
+        mpz_tdiv_q(p_a->coefficient, p_a->coefficient, p_gmp->power);
+    }
+    p_a->exponent = -(int64_t)p_gmp->scale;
+}
+
+/* Write a number in decimal, as format_number() in calc_big.c does. */
+static void
+gmp_format(const GmpNumber_t *p_number, char *p_answer, size_t answer_size)
+{
+    char   *p_digits = p_answer;
+    size_t  n_digits;
+    int64_t n_whole_digits;
+    char   *p_end;
+
+    if (0 == mpz_sgn(p_number->coefficient))
+    {
+        strcpy(p_answer, "0");
+        return;
+    }
+    if (mpz_sgn(p_number->coefficient) < 0)
+    {
+        *p_digits++ = '-';
+    }
+    if (mpz_sizeinbase(p_number->coefficient, 10) + 4u + (size_t)llabs(p_number->exponent) > answer_size)
+    {
+        strcpy(p_answer, "too large");
+        return;
+    }
+    mpz_get_str(p_digits, 10, p_number->coefficient);
+    if ('-' == *p_digits)
+    {
+        memmove(p_digits, p_digits + 1, strlen(p_digits));
+    }
+    n_digits = strlen(p_digits);
+    p_end = p_digits + n_digits;
+    n_whole_digits = (int64_t)n_digits + p_number->exponent;
+
+    if (p_number->exponent >= 0)
+    {
+        memset(p_end, '0', (size_t)p_number->exponent);
+        p_end += p_number->exponent;
+    }
+    else
+    {
+        if (n_whole_digits > 0)
+        {
+            memmove(p_digits + n_whole_digits + 1, p_digits + n_whole_digits, (size_t)-p_number->exponent);
+            p_digits[n_whole_digits] = '.';
+        }
+        else
+        {
+            memmove(p_digits + 2 - n_whole_digits, p_digits, n_digits);
+            p_digits[0] = '0';
+            p_digits[1] = '.';
+            memset(p_digits + 2, '0', (size_t)-n_whole_digits);
+        }
+        p_end = p_digits + n_digits + 1 + ((n_whole_digits > 0) ? 0 : 1 - n_whole_digits);
+        while ('0' == p_end[-1])
+        {
+            p_end--;
+        }
+        if ('.' == p_end[-1])
+        {
+            p_end--;
+        }
+    }
+    *p_end = '\0';
+}
+
+/* The engine's operators. */
+static bool
+is_operator(char character)
+{
+    return ('+' == character) || ('-' == character) || ('x' == character) || ('/' == character) ||
+           ('E' == character);
+}
+
+/**
+ * @brief   Time one evaluator on a class.
+ * @param   [in] evaluator 0 for calc_big, 1 for GMP, 2 for the double engine.
+ * @param   [in] p_class The class.
+ * @param   [in] seconds How long to keep evaluating it.
+ * @return  The mean nanoseconds per expression.
+ **/
+static double
+measure(int evaluator, const BenchClass_t *p_class, double seconds)
+{
+    static char answer[ANSWER_BYTES];
+    size_t      lengths[MAX_EXPRESSIONS];
+    double      start_ns;
+    double      elapsed_ns;
+    uint64_t    n_evaluations = 0;
+
+    for (size_t expression_no = 0; expression_no < p_class->n_expressions; expression_no++)
+    {
+        lengths[expression_no] = strlen(p_class->expressions[expression_no]);
+    }
+
+    start_ns = now_ns();
+    do
+    {
+        for (size_t expression_no = 0; expression_no < p_class->n_expressions; expression_no++)
+        {
+            const char *p_expression = p_class->expressions[expression_no];
+            uint8_t     error_ref_no;
+
+            if (0 == evaluator)
+            {
+                (void)calc_big_evaluate(&big, p_expression, lengths[expression_no], answer, sizeof(answer),
+                                        &error_ref_no);
+            }
+            else if (1 == evaluator)
+            {
+                (void)gmp_evaluate(&gmp, p_expression, lengths[expression_no], answer, sizeof(answer));
+            }
+            else
+            {
+                (void)CalculateAnswerSpan(p_expression, lengths[expression_no], &error_ref_no);
+            }
+        }
+        n_evaluations += p_class->n_expressions;
+        elapsed_ns = now_ns() - start_ns;
+    } while (elapsed_ns < seconds * 1e9);
+
+    return elapsed_ns / (double)n_evaluations;
+}
+
+/* A linear congruential generator, so every run sees the same expressions. */
+static uint32_t
+next_random(void)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
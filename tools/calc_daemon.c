@@ -0,0 +1,573 @@
+/**
+ * $File: calc_daemon.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_daemon.c
+ *
+ *  @brief     Host tool: a local evaluation daemon on a Unix-domain socket, so test rigs
+ *             and scripts on the same machine do not pay for a process per evaluation.
+ *
+ *             Usage: calc_daemon [-s socket] [-C entries]
+ *               -s  The socket path (default /tmp/calc_daemon.sock).
+ *               -C  Results kept in the LRU result cache (default 4096; 0 for no cache).
+ *
+ *             Protocol: each request is an expression on a line of its own. Requests may be
+ *             pipelined (sent without waiting for answers); the answers come back in the
+ *             same order, one line each:
+ *               0 <answer>\n                    the answer, as "%.17g"
+ *               <n> <line1> <line2>\n           error n and its two-line message
+ *             A request is checked as the calculator would check it, so one of more than
+ *             CALC_INCREMENTAL_MAX_LENGTH (32) characters gets error 3 and an empty one
+ *             error 2.
+ *
+ *             One thread serves every connection from a level-triggered epoll loop. At each
+ *             wakeup a readable connection gets one read(); all the complete requests read
+ *             are evaluated, and their answers go out with one write(). Each connection has
+ *             a fixed input and output buffer: while the output buffer cannot take another
+ *             answer the connection is not read, so a client that does not read its answers
+ *             is held back instead of growing the daemon. A request longer than the input
+ *             buffer is answered with error 3 and the rest of its line is skipped.
+ *
+ *             SIGINT or SIGTERM stops the daemon, which removes the socket and prints the
+ *             requests served, the mean number of requests per wakeup and the cache's hits
+ *             and misses.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#define _GNU_SOURCE /* For accept4(). */
+#include "../answer_cache_lru.h"
+#include "../calc_incremental.h"
+#include "../calculate_answer.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define DEFAULT_SOCKET_PATH     "/tmp/calc_daemon.sock"
+#define MAX_CONNECTIONS         256
+#define MAX_EVENTS              64    /* Events taken per epoll_wait(). */
+#define CONNECTION_INPUT_SIZE   4096  /* Per connection: the most unread request bytes. */
+#define CONNECTION_OUTPUT_SIZE  16384 /* Per connection: the most unsent answer bytes. */
+#define DEFAULT_CACHE_ENTRIES   4096
+#define MAX_RESPONSE_LENGTH     64    /* The longest answer line, with its newline. */
+#define LISTEN_BACKLOG          64
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One client connection; fd is -1 when the slot is free. */
+typedef struct
+{
+    int      fd;
+    uint32_t events;        /* What epoll is watching for. */
+    bool     b_discarding;  /* Skipping the rest of an over-long request. */
+    bool     b_peer_closed; /* Nothing more will be read. */
+    size_t   in_length;
+    size_t   out_start;
+    size_t   out_length;
+    char     in[CONNECTION_INPUT_SIZE];
+    char     out[CONNECTION_OUTPUT_SIZE];
+} Connection_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static int  open_listener(const char *p_path);
+static void accept_connections(int listen_fd, int epoll_fd);
+static void serve(Connection_t *p_connection, int epoll_fd);
+static void read_requests(Connection_t *p_connection);
+static void answer_requests(Connection_t *p_connection);
+static void answer(Connection_t *p_connection, const char *p_request, size_t length);
+static void write_answers(Connection_t *p_connection);
+static void watch(Connection_t *p_connection, int epoll_fd);
+static void close_connection(Connection_t *p_connection);
+static void stop(int signal_no);
+static void format_error_answers(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static Connection_t          connections[MAX_CONNECTIONS];
+static char                  error_answers[MAX_ERROR_MESSAGES][MAX_RESPONSE_LENGTH]; /* Formatted once. */
+static size_t                error_answer_lengths[MAX_ERROR_MESSAGES];
+static volatile sig_atomic_t b_stopping = 0;
+static uint64_t              n_requests = 0;
+static uint64_t              n_wakeups = 0;
+static uint64_t              n_connections = 0;
+static AnswerCacheLru_t     *p_cache = NULL; /* One shard: only one thread evaluates. */
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Serve requests until stopped by a signal.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on a clean stop.
+ **/
+int
+main(int argc, char *argv[])
+{
+    const char        *p_path = DEFAULT_SOCKET_PATH;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL}; // NULL: the listener
+    struct sigaction   action;
+    long               cache_entries = DEFAULT_CACHE_ENTRIES;
+    int                listen_fd;
+    int                epoll_fd;
+    int                option;
+
+    while (-1 != (option = getopt(argc, argv, "s:C:")))
+    {
+        switch (option)
+        {
+            case 's':
+                p_path = optarg;
+                break;
+            case 'C':
+                cache_entries = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s socket] [-C cache entries]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (cache_entries > 0)
+    {
+        p_cache = answer_cache_lru_create((size_t)cache_entries, 1);
+        if (NULL == p_cache)
+        {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN); // A client that goes away shows up as EPIPE instead
+
+    format_error_answers();
+    for (size_t slot = 0; slot < MAX_CONNECTIONS; slot++)
+    {
+        connections[slot].fd = -1;
+    }
+
+    listen_fd = open_listener(p_path);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ((listen_fd < 0) || (epoll_fd < 0) || (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event)))
+    {
+        perror(p_path);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "listening on %s\n", p_path);
+
+    while (!b_stopping)
+    {
+        struct epoll_event events[MAX_EVENTS];
+        int                n_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+
+        if (n_events < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        n_wakeups++;
+        for (int event_no = 0; event_no < n_events; event_no++)
+        {
+            if (NULL == events[event_no].data.ptr)
+            {
+                accept_connections(listen_fd, epoll_fd);
+            }
+            else
+            {
+                serve(events[event_no].data.ptr, epoll_fd);
+            }
+        }
+    }
+
+    unlink(p_path);
+    fprintf(stderr, "%llu requests on %llu connections, %llu wakeups (%.1f requests per wakeup)\n",
+            (unsigned long long)n_requests, (unsigned long long)n_connections, (unsigned long long)n_wakeups,
+            (n_wakeups > 0) ? (double)n_requests / (double)n_wakeups : 0.0);
+    if (NULL != p_cache)
+    {
+        AnswerCacheLruStats_t stats;
+
+        answer_cache_lru_stats(p_cache, &stats);
+        fprintf(stderr, "cache: %llu hits, %llu misses, %llu evictions\n", (unsigned long long)stats.hits,
+                (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+        answer_cache_lru_destroy(p_cache);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Create the listening socket, replacing a stale socket file.
+ * @param   [in] p_path The socket path.
+ * @return  The socket, or -1 with errno set.
+ **/
+static int
+open_listener(const char *p_path)
+{
+    struct sockaddr_un address;
+    int                listen_fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(p_path) >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, p_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+    {
+        return -1;
+    }
+    unlink(p_path);
+    if ((0 != bind(listen_fd, (struct sockaddr *)&address, sizeof(address))) ||
+        (0 != listen(listen_fd, LISTEN_BACKLOG)))
+    {
+        close(listen_fd);
+        return -1;
+    }
+    return listen_fd;
+}
+
+/**
+ * @brief   Accept every pending connection. One that finds no free slot is closed.
+ * @param   [in] listen_fd The listening socket.
+ * @param   [in] epoll_fd The event loop.
+ * @return  None.
+ **/
+static void
+accept_connections(int listen_fd, int epoll_fd)
+{
+    for (;;)
+    {
+        Connection_t *p_connection = NULL;
+        int           fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+        {
+            return; // EAGAIN: none left (other errors are for that connection only)
+        }
+        for (size_t slot = 0; (slot < MAX_CONNECTIONS) && (NULL == p_connection); slot++)
+        {
+            if (connections[slot].fd < 0)
+            {
+                p_connection = &connections[slot];
+            }
+        }
+        if (NULL == p_connection)
+        {
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = p_connection};
+
+        p_connection->fd = fd;
+        p_connection->events = EPOLLIN;
+        p_connection->b_discarding = false;
+        p_connection->b_peer_closed = false;
+        p_connection->in_length = 0;
+        p_connection->out_start = 0;
+        p_connection->out_length = 0;
+        if (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event))
+        {
+            close_connection(p_connection);
+            continue;
+        }
+        n_connections++;
+    }
+}
+
+/**
+ * @brief   Handle a wakeup of one connection: one read, the answers, one write.
+ * @param   [in,out] p_connection The connection.
+ * @param   [in] epoll_fd The event loop.
+ * @return  None.
+ **/
+static void
+serve(Connection_t *p_connection, int epoll_fd)
+{
+    if (p_connection->fd < 0)
+    {
+        return; // Closed earlier in the same wakeup
+    }
+    answer_requests(p_connection); // Those held back while the output was full
+    read_requests(p_connection);
+    answer_requests(p_connection);
+    write_answers(p_connection);
+
+    if ((p_connection->fd >= 0) && p_connection->b_peer_closed && (0 == p_connection->out_length))
+    {
+        close_connection(p_connection);
+    }
+    if (p_connection->fd >= 0)
+    {
+        watch(p_connection, epoll_fd);
+    }
+}
+
+/**
+ * @brief   Read as much as the input buffer has room for.
+ * @param   [in,out] p_connection The connection.
+ * @return  None.
+ **/
+static void
+read_requests(Connection_t *p_connection)
+{
+    ssize_t n_read;
+
+    if (p_connection->b_peer_closed || (p_connection->in_length == CONNECTION_INPUT_SIZE))
+    {
+        return;
+    }
+    n_read = read(p_connection->fd, &p_connection->in[p_connection->in_length],
+                  CONNECTION_INPUT_SIZE - p_connection->in_length);
+    if (n_read > 0)
+    {
+        p_connection->in_length += (size_t)n_read;
+    }
+    else if ((0 == n_read) || ((EAGAIN != errno) && (EINTR != errno)))
+    {
+        p_connection->b_peer_closed = true;
+    }
+}
+
+/**
+ * @brief   Answer the complete requests in the input buffer, as far as the output
+ * buffer has room. An over-long request is answered with error 3 as soon as it fills
+ * the input buffer, and a last request without a newline when the peer closes.
+ * @param   [in,out] p_connection The connection.
+ * @return  None.
+ **/
+static void
+answer_requests(Connection_t *p_connection)
+{
+    size_t start = 0;
+
+    while (CONNECTION_OUTPUT_SIZE - (p_connection->out_start + p_connection->out_length) >= MAX_RESPONSE_LENGTH)
+    {
+        const char *p_request = &p_connection->in[start];
+        const char *p_newline = memchr(p_request, '\n', p_connection->in_length - start);
+
+        if (NULL != p_newline)
+        {
+            if (p_connection->b_discarding)
+            {
+                p_connection->b_discarding = false; // The end of an over-long request
+            }
+            else
+            {
+                answer(p_connection, p_request, (size_t)(p_newline - p_request));
+            }
+            start = (size_t)(p_newline - p_connection->in) + 1;
+        }
+        else if ((0 == start) && (CONNECTION_INPUT_SIZE == p_connection->in_length))
+        {
+            if (!p_connection->b_discarding)
+            {
+                answer(p_connection, p_request, CONNECTION_INPUT_SIZE); // Error 3
+                p_connection->b_discarding = true;
+            }
+            start = p_connection->in_length;
+        }
+        else if (p_connection->b_peer_closed && (start < p_connection->in_length))
+        {
+            if (!p_connection->b_discarding)
+            {
+                answer(p_connection, p_request, p_connection->in_length - start);
+            }
+            start = p_connection->in_length;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    memmove(p_connection->in, &p_connection->in[start], p_connection->in_length - start);
+    p_connection->in_length -= start;
+}
+
+/**
+ * @brief   Evaluate one request and add its answer to the output buffer.
+ * @param   [in,out] p_connection The connection (with room for the answer).
+ * @param   [in] p_request The request, without its newline.
+ * @param   [in] length Its length.
+ * @return  None.
+ **/
+static void
+answer(Connection_t *p_connection, const char *p_request, size_t length)
+{
+    char   *p_answer = &p_connection->out[p_connection->out_start + p_connection->out_length];
+    uint8_t error_ref_no = 3; // "No null or too" "long I/P string", as for a full input_buffer
+    double  result = 0.0;
+
+    if ((length > 0) && ('\r' == p_request[length - 1]))
+    {
+        length--;
+    }
+    if (length >= CALC_INPUT_BUFFER_SIZE)
+    {
+        // Too long for the calculator: leave error 3
+    }
+    else if (NULL != p_cache)
+    {
+        result = answer_cache_lru_calculate(p_cache, p_request, length, &error_ref_no);
+    }
+    else
+    {
+        result = CalculateAnswerSpan(p_request, length, &error_ref_no);
+    }
+
+    if (0u == error_ref_no)
+    {
+        p_connection->out_length += (size_t)snprintf(p_answer, MAX_RESPONSE_LENGTH, "0 %.17g\n", result);
+    }
+    else
+    {
+        memcpy(p_answer, error_answers[error_ref_no], error_answer_lengths[error_ref_no]);
+        p_connection->out_length += error_answer_lengths[error_ref_no];
+    }
+    n_requests++;
+}
+
+/**
+ * @brief   Send as much of the output buffer as the socket takes, in one write().
+ * @param   [in,out] p_connection The connection.
+ * @return  None.
+ **/
+static void
+write_answers(Connection_t *p_connection)
+{
+    ssize_t n_written;
+
+    if (0 == p_connection->out_length)
+    {
+        return;
+    }
+    n_written = write(p_connection->fd, &p_connection->out[p_connection->out_start], p_connection->out_length);
+    if (n_written < 0)
+    {
+        if ((EAGAIN != errno) && (EINTR != errno))
+        {
+            close_connection(p_connection); // The client has gone; its answers are dropped
+        }
+        return;
+    }
+    p_connection->out_start += (size_t)n_written;
+    p_connection->out_length -= (size_t)n_written;
+    if (0 == p_connection->out_length)
+    {
+        p_connection->out_start = 0;
+    }
+    else if (p_connection->out_start > CONNECTION_OUTPUT_SIZE / 2)
+    {
+        memmove(p_connection->out, &p_connection->out[p_connection->out_start], p_connection->out_length);
+        p_connection->out_start = 0;
+    }
+}
+
+/**
+ * @brief   Watch for input only while there is room for it and for its answers, and
+ * for output only while answers are waiting.
+ * @param   [in,out] p_connection The connection.
+ * @param   [in] epoll_fd The event loop.
+ * @return  None.
+ **/
+static void
+watch(Connection_t *p_connection, int epoll_fd)
+{
+    size_t   output_room = CONNECTION_OUTPUT_SIZE - (p_connection->out_start + p_connection->out_length);
+    uint32_t events = 0;
+
+    if (!p_connection->b_peer_closed && (p_connection->in_length < CONNECTION_INPUT_SIZE) &&
+        (output_room >= MAX_RESPONSE_LENGTH))
+    {
+        events |= EPOLLIN;
+    }
+    if (p_connection->out_length > 0)
+    {
+        events |= EPOLLOUT;
+    }
+    if (events != p_connection->events)
+    {
+        struct epoll_event event = {.events = events, .data.ptr = p_connection};
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, p_connection->fd, &event);
+        p_connection->events = events;
+    }
+}
+
+/**
+ * @brief   Close a connection and free its slot (closing also removes it from epoll).
+ * @param   [in,out] p_connection The connection.
+ * @return  None.
+ **/
+static void
+close_connection(Connection_t *p_connection)
+{
+    close(p_connection->fd);
+    p_connection->fd = -1;
+}
+
+/**
+ * @brief   Signal handler: stop at the next wakeup.
+ * @param   [in] signal_no The signal.
+ * @return  None.
+ **/
+static void
+stop(int signal_no)
+{
+    (void)signal_no;
+    b_stopping = 1;
+}
+
+/**
+ * @brief   Format the answer for each error number, so answering an error is a copy.
+ * @param   None.
+ * @return  None.
+ **/
+static void
+format_error_answers(void)
+{
+    for (size_t error_ref_no = 1; error_ref_no < MAX_ERROR_MESSAGES; error_ref_no++)
+    {
+        error_answer_lengths[error_ref_no] =
+            (size_t)snprintf(error_answers[error_ref_no], MAX_RESPONSE_LENGTH, "%zu %s %s\n", error_ref_no,
+                             error_message_line1[error_ref_no], error_message_line2[error_ref_no]);
+    }
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
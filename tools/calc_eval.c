@@ -0,0 +1,968 @@
+/**
+ * $File: calc_eval.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_eval.c
+ *
+ *  @brief     Host tool: evaluate a file of newline-separated expressions with the
+ *             calculator engine on every core, and write the results in input order.
+ *
+ *             Usage: calc_eval [-j threads] [-c chunk KiB] [-C entries | -J | -P | -B scale] [-o output]
+ *                              [-q] file
+ *               -j  Worker threads (default: the number of online cores).
+ *               -c  Bytes of input per chunk, the unit of work that is stolen, in KiB
+ *                   (default 256).
+ *               -C  Put a sharded LRU cache of this many results in front of the engine
+ *                   (default 0, no cache). Worth it when the file repeats itself.
+ *               -J  Evaluate with code compiled for each frequent shape of expression
+ *                   (calc_jit.c, one compiler per thread). The answers are the same;
+ *                   it is not reliably faster (see the README).
+ *               -P  Evaluate the leading terms a line shares with lines before it only once
+ *                   (calc_prefix.c, one prefix trie per thread). Worth it when long lines
+ *                   keep the leading terms of the lines before them and change the last.
+ *               -B  Evaluate exactly (calc_big.c, one arena per thread), keeping this many
+ *                   digits after the point of each quotient. Lines may then be of any
+ *                   length, and a result is the answer's every digit.
+ *               -o  Write the results here instead of stdout.
+ *               -q  Do not write the results, only the statistics.
+ *
+ *             Each line is evaluated as CalculateAnswer() would evaluate it on the
+ *             calculator, so a line of more than CALC_INCREMENTAL_MAX_LENGTH (32)
+ *             characters gets error 3 and an empty line error 2. A result line is the
+ *             answer ("%.17g") or "error N: message".
+ *             With -B a line of any length is evaluated, and a result line may also be
+ *             "error 12: Division by zero" or "error 13: Too large" (for the arena or the
+ *             answer). The scale must be a number from 0 to CALC_BIG_MAX_EXPONENT.
+ *
+ *             The file is memory-mapped and each line is evaluated where it is with
+ *             CalculateAnswerSpan(), so the input is never copied. A chunk is a byte range
+ *             of the file and holds the lines that start in it. The chunks are evaluated a
+ *             window (WINDOW_CHUNKS_PER_THREAD per thread) at a time: each thread is dealt
+ *             an equal contiguous range of the window, takes chunks from the front of it,
+ *             and when that is empty steals the back half of the fullest other range. Each
+ *             range is a single 64-bit atomic (next, end), so taking and stealing are both
+ *             one compare-and-swap. The engine has no global mutable state (unless built
+ *             with PROFILE_ENABLE), so the threads share nothing else.
+ *
+ *             Each chunk formats its results into its own buffer. When a window is done a
+ *             writer thread sends its buffers, in order, with writev() while the workers
+ *             go on with the next window, so memory stays bounded by two windows of output
+ *             however large the file is.
+ *
+ *             Per-thread lines, chunks, steals, busy time and throughput are written to
+ *             stderr, with the load imbalance (the busiest thread's time over the mean)
+ *             and the overall MB/s and expressions/s.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../answer_cache_lru.h"
+#include "../calc_big.h"
+#include "../calc_incremental.h"
+#include "../calc_jit.h"
+#include "../calc_prefix.h"
+#include "../calculate_answer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define DEFAULT_CHUNK_KIB         256
+#define MAX_THREADS               256
+#define WINDOW_CHUNKS_PER_THREAD  4    /* Enough chunks for stealing to even out the threads. */
+#define WINDOWS_IN_FLIGHT         2    /* One being evaluated while the other is written. */
+#define MAX_RESULT_LENGTH         64   /* The longest result line, with its newline. */
+#define MAX_VECTORS               1024 /* Buffers per writev() call: IOV_MAX on Linux. */
+#define CACHE_SHARDS_PER_THREAD   8    /* Keeps two threads off the same shard lock. */
+#define BIG_ARENA_BYTES           (1024 * 1024) /* Each thread's arena for -B. */
+#define BIG_ANSWER_BYTES          (64 * 1024)   /* The longest exact answer, with its newline. */
+#define ERROR_DIVIDE_BY_ZERO      12   /* -B: error numbers after the engine's, for the */
+#define ERROR_TOO_LARGE           13   /* failures only exact evaluation has. */
+
+/* A range of chunks packed into one atomic word: the next chunk in the low half, the
+   end (exclusive) in the high half. */
+#define RANGE(next, end)    (((uint64_t)(end) << 32) | (uint32_t)(next))
+#define RANGE_NEXT(range)   ((uint32_t)(range))
+#define RANGE_END(range)    ((uint32_t)((range) >> 32))
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One worker: its range of the current window and what it did. Aligned so that workers
+   do not share cache lines. */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t range;
+    pthread_t     thread;
+    CalcJit_t    *p_jit;    /* NULL when not compiling. */
+    CalcPrefix_t *p_prefix; /* NULL when not reusing prefixes. */
+    CalcBig_t    *p_big;    /* NULL when not evaluating exactly. */
+    void         *p_big_arena;
+    char         *p_big_answer;
+    size_t        n_lines;
+    size_t        n_chunks;
+    size_t        n_steals;
+    double        busy_ns;
+} Worker_t;
+
+/* The formatted results of one chunk. */
+typedef struct
+{
+    char  *p_text;
+    size_t length;
+    size_t capacity;
+} OutputBuffer_t;
+
+/* The input, the output and the threads, shared by every worker. */
+typedef struct
+{
+    const char      *p_text;        /* The mapped file. */
+    size_t           text_size;
+    size_t           chunk_bytes;
+    size_t           n_chunks;
+    size_t           window_chunks;
+    size_t           n_windows;
+    size_t           window_no;     /* The window being evaluated. */
+    bool             b_write;
+    AnswerCacheLru_t *p_cache;      /* NULL when not caching. */
+    int              output_fd;
+    OutputBuffer_t  *p_outputs;     /* window_chunks buffers per window in flight. */
+    Worker_t        *p_workers;
+    size_t           n_workers;
+    pthread_barrier_t start_barrier;
+    pthread_barrier_t end_barrier;
+
+    /* The writer thread: windows below n_windows_done are evaluated, below
+       n_windows_written written. */
+    pthread_t        writer;
+    pthread_mutex_t  lock;
+    pthread_cond_t   changed;
+    size_t           n_windows_done;
+    size_t           n_windows_written;
+    int              write_errno;
+    size_t           output_bytes;
+} Job_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void           print_usage(const char *p_program);
+static void          *worker_main(void *p_arg);
+static void           run_window(Worker_t *p_worker);
+static bool           take_chunk(Worker_t *p_worker, uint32_t *p_chunk_no);
+static bool           steal_chunks(const Job_t *p_job, Worker_t *p_thief);
+static void           evaluate_chunk(const Job_t *p_job, size_t chunk_no, OutputBuffer_t *p_output,
+                                     Worker_t *p_worker);
+static void           evaluate_exactly(const Job_t *p_job, const char *p_line, size_t length, OutputBuffer_t *p_output,
+                                       Worker_t *p_worker);
+static bool           reserve_output(OutputBuffer_t *p_output, size_t length);
+static OutputBuffer_t *window_outputs(const Job_t *p_job, size_t window_no);
+static void          *writer_main(void *p_arg);
+static int            write_window(const Job_t *p_job, size_t window_no, size_t *p_bytes);
+static void           report(const Job_t *p_job, double wall_ns);
+static double         now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static Job_t job;
+static char   error_lines[MAX_ERROR_MESSAGES][MAX_RESULT_LENGTH]; /* Formatted once, then copied. */
+static size_t error_line_lengths[MAX_ERROR_MESSAGES];
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Evaluate the file and write the results.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success.
+ **/
+int
+main(int argc, char *argv[])
+{
+    long        n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long        chunk_kib = DEFAULT_CHUNK_KIB;
+    long        cache_entries = 0;
+    bool        b_compile = false;
+    bool        b_prefix = false;
+    long        big_scale = -1;
+    char       *p_end;
+    const char *p_output_path = NULL;
+    bool        b_quiet = false;
+    struct stat input_stat;
+    double      start_ns;
+    int         input_fd;
+    int         option;
+
+    while (-1 != (option = getopt(argc, argv, "j:c:C:JPB:o:q")))
+    {
+        switch (option)
+        {
+            case 'j':
+                n_threads = atol(optarg);
+                break;
+            case 'c':
+                chunk_kib = atol(optarg);
+                break;
+            case 'C':
+                cache_entries = atol(optarg);
+                break;
+            case 'J':
+                b_compile = true;
+                break;
+            case 'P':
+                b_prefix = true;
+                break;
+            case 'B':
+                big_scale = strtol(optarg, &p_end, 10);
+                if ((p_end == optarg) || ('\0' != *p_end) || (big_scale < 0))
+                {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'o':
+                p_output_path = optarg;
+                break;
+            case 'q':
+                b_quiet = true;
+                break;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((optind != argc - 1) || (n_threads < 1) || (n_threads > MAX_THREADS) || (chunk_kib < 1) ||
+        (cache_entries < 0) || ((cache_entries > 0) + b_compile + b_prefix + (big_scale >= 0) > 1) ||
+        (big_scale > CALC_BIG_MAX_EXPONENT))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    input_fd = open(argv[optind], O_RDONLY);
+    if ((input_fd < 0) || (0 != fstat(input_fd, &input_stat)))
+    {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    job.text_size = (size_t)input_stat.st_size;
+    if (job.text_size > 0)
+    {
+        void *p_map = mmap(NULL, job.text_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+
+        if (MAP_FAILED == p_map)
+        {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+        posix_madvise(p_map, job.text_size, POSIX_MADV_SEQUENTIAL);
+        job.p_text = p_map;
+    }
+    close(input_fd);
+
+    job.b_write = !b_quiet;
+    job.output_fd = STDOUT_FILENO;
+    if (job.b_write && (NULL != p_output_path))
+    {
+        job.output_fd = open(p_output_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (job.output_fd < 0)
+        {
+            perror(p_output_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (size_t error_ref_no = 1; error_ref_no < MAX_ERROR_MESSAGES; error_ref_no++)
+    {
+        error_line_lengths[error_ref_no] =
+            (size_t)snprintf(error_lines[error_ref_no], MAX_RESULT_LENGTH, "error %zu: %s %s\n", error_ref_no,
+                             error_message_line1[error_ref_no], error_message_line2[error_ref_no]);
+    }
+    error_line_lengths[ERROR_DIVIDE_BY_ZERO] = (size_t)snprintf(
+        error_lines[ERROR_DIVIDE_BY_ZERO], MAX_RESULT_LENGTH, "error %d: Division by zero\n", ERROR_DIVIDE_BY_ZERO);
+    error_line_lengths[ERROR_TOO_LARGE] = (size_t)snprintf(error_lines[ERROR_TOO_LARGE], MAX_RESULT_LENGTH,
+                                                           "error %d: Too large\n", ERROR_TOO_LARGE);
+
+    job.chunk_bytes = (size_t)chunk_kib * 1024;
+    job.n_chunks = (job.text_size + job.chunk_bytes - 1) / job.chunk_bytes;
+    job.n_workers = (size_t)n_threads;
+    job.window_chunks = job.n_workers * WINDOW_CHUNKS_PER_THREAD;
+    job.n_windows = (job.n_chunks + job.window_chunks - 1) / job.window_chunks;
+    job.p_outputs = calloc(WINDOWS_IN_FLIGHT * job.window_chunks, sizeof(OutputBuffer_t));
+    job.p_workers = aligned_alloc(64, job.n_workers * sizeof(Worker_t));
+    if (cache_entries > 0)
+    {
+        job.p_cache = answer_cache_lru_create((size_t)cache_entries, job.n_workers * CACHE_SHARDS_PER_THREAD);
+    }
+    if ((NULL == job.p_outputs) || (NULL == job.p_workers) || ((cache_entries > 0) && (NULL == job.p_cache)))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    memset(job.p_workers, 0, job.n_workers * sizeof(Worker_t));
+    for (size_t worker_no = 0; b_compile && (worker_no < job.n_workers); worker_no++)
+    {
+        job.p_workers[worker_no].p_jit = calc_jit_create(CALC_JIT_DEFAULT_BYTES);
+        if (NULL == job.p_workers[worker_no].p_jit)
+        {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (size_t worker_no = 0; b_prefix && (worker_no < job.n_workers); worker_no++)
+    {
+        job.p_workers[worker_no].p_prefix = calc_prefix_create();
+        if (NULL == job.p_workers[worker_no].p_prefix)
+        {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (size_t worker_no = 0; (big_scale >= 0) && (worker_no < job.n_workers); worker_no++)
+    {
+        Worker_t *p_worker = &job.p_workers[worker_no];
+
+        p_worker->p_big = malloc(sizeof(CalcBig_t));
+        p_worker->p_big_arena = malloc(BIG_ARENA_BYTES);
+        p_worker->p_big_answer = malloc(BIG_ANSWER_BYTES);
+        if ((NULL == p_worker->p_big) || (NULL == p_worker->p_big_arena) || (NULL == p_worker->p_big_answer))
+        {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+        calc_big_init(p_worker->p_big, p_worker->p_big_arena, BIG_ARENA_BYTES, (uint32_t)big_scale);
+    }
+    pthread_barrier_init(&job.start_barrier, NULL, (unsigned)job.n_workers);
+    pthread_barrier_init(&job.end_barrier, NULL, (unsigned)job.n_workers);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    start_ns = now_ns();
+    if ((0 != pthread_create(&job.writer, NULL, writer_main, &job)))
+    {
+        fprintf(stderr, "cannot start the writer thread\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t worker_no = 1; worker_no < job.n_workers; worker_no++)
+    {
+        if (0 != pthread_create(&job.p_workers[worker_no].thread, NULL, worker_main, &job.p_workers[worker_no]))
+        {
+            fprintf(stderr, "cannot start thread %zu\n", worker_no);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* The main thread is worker 0 and also deals out each window. A window's buffers
+       are reused once the window WINDOWS_IN_FLIGHT before it has been written. */
+    for (job.window_no = 0; job.window_no <= job.n_windows; job.window_no++)
+    {
+        size_t first_chunk = job.window_no * job.window_chunks;
+        size_t n_chunks = (job.window_no < job.n_windows) ? job.window_chunks : 0;
+
+        if (first_chunk + n_chunks > job.n_chunks)
+        {
+            n_chunks = job.n_chunks - first_chunk;
+        }
+        pthread_mutex_lock(&job.lock);
+        while ((job.window_no >= WINDOWS_IN_FLIGHT) && (job.n_windows_written < job.window_no - 1) &&
+               (0 == job.write_errno))
+        {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        for (size_t worker_no = 0; worker_no < job.n_workers; worker_no++)
+        {
+            atomic_store(&job.p_workers[worker_no].range,
+                         RANGE(n_chunks * worker_no / job.n_workers, n_chunks * (worker_no + 1) / job.n_workers));
+        }
+        pthread_barrier_wait(&job.start_barrier);
+        if (job.window_no == job.n_windows)
+        {
+            break; // The other workers have seen the end too
+        }
+        run_window(&job.p_workers[0]);
+        pthread_barrier_wait(&job.end_barrier);
+
+        pthread_mutex_lock(&job.lock);
+        job.n_windows_done = job.window_no + 1;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (size_t worker_no = 1; worker_no < job.n_workers; worker_no++)
+    {
+        pthread_join(job.p_workers[worker_no].thread, NULL);
+    }
+    pthread_join(job.writer, NULL);
+    report(&job, now_ns() - start_ns);
+    answer_cache_lru_destroy(job.p_cache);
+    for (size_t worker_no = 0; worker_no < job.n_workers; worker_no++)
+    {
+        calc_jit_destroy(job.p_workers[worker_no].p_jit);
+        calc_prefix_destroy(job.p_workers[worker_no].p_prefix);
+        free(job.p_workers[worker_no].p_big);
+        free(job.p_workers[worker_no].p_big_arena);
+        free(job.p_workers[worker_no].p_big_answer);
+    }
+
+    if (0 != job.write_errno)
+    {
+        errno = job.write_errno;
+        perror("write");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Print the usage on stderr.
+ * @param   [in] p_program The program's name.
+ * @return  None.
+ **/
+static void
+print_usage(const char *p_program)
+{
+    fprintf(stderr,
+            "usage: %s [-j threads (1-%d)] [-c chunk KiB] [-C cache entries | -J | -P | -B scale] [-o output] [-q]"
+            " file\n",
+            p_program, MAX_THREADS);
+}
+
+/**
+ * @brief   Evaluate each window dealt out by the main thread until the last.
+ * @param   [in] p_arg The worker.
+ * @return  NULL.
+ **/
+static void *
+worker_main(void *p_arg)
+{
+    Worker_t *p_worker = p_arg;
+
+    for (;;)
+    {
+        pthread_barrier_wait(&job.start_barrier);
+        if (job.window_no == job.n_windows)
+        {
+            return NULL;
+        }
+        run_window(p_worker);
+        pthread_barrier_wait(&job.end_barrier);
+    }
+}
+
+/**
+ * @brief   Evaluate chunks of the current window until none are left anywhere.
+ * @param   [in,out] p_worker The worker.
+ * @return  None.
+ **/
+static void
+run_window(Worker_t *p_worker)
+{
+    size_t          first_chunk = job.window_no * job.window_chunks;
+    OutputBuffer_t *p_outputs = window_outputs(&job, job.window_no);
+
+    for (;;)
+    {
+        uint32_t chunk_no;
+
+        while (take_chunk(p_worker, &chunk_no))
+        {
+            evaluate_chunk(&job, first_chunk + chunk_no, &p_outputs[chunk_no], p_worker);
+        }
+        if (!steal_chunks(&job, p_worker))
+        {
+            return; // Every range is empty: no chunk is left to start
+        }
+    }
+}
+
+/**
+ * @brief   Take the next chunk from the front of a worker's own range.
+ * @param   [in,out] p_worker The worker.
+ * @param   [out] p_chunk_no The chunk, counted from the start of the window.
+ * @return  false if the range is empty.
+ **/
+static bool
+take_chunk(Worker_t *p_worker, uint32_t *p_chunk_no)
+{
+    uint64_t range = atomic_load_explicit(&p_worker->range, memory_order_relaxed);
+
+    while (RANGE_NEXT(range) < RANGE_END(range))
+    {
+        if (atomic_compare_exchange_weak(&p_worker->range, &range, RANGE(RANGE_NEXT(range) + 1, RANGE_END(range))))
+        {
+            *p_chunk_no = RANGE_NEXT(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief   Move the back half of the fullest other range to an idle worker.
+ * @param   [in] p_job The job.
+ * @param   [in,out] p_thief The idle worker (its own range is empty).
+ * @return  false if every range is empty.
+ **/
+static bool
+steal_chunks(const Job_t *p_job, Worker_t *p_thief)
+{
+    for (;;)
+    {
+        Worker_t *p_victim = NULL;
+        uint64_t  victim_range = 0;
+        uint32_t  most_left = 0;
+
+        for (size_t worker_no = 0; worker_no < p_job->n_workers; worker_no++)
+        {
+            Worker_t *p_worker = &p_job->p_workers[worker_no];
+            uint64_t  range = atomic_load_explicit(&p_worker->range, memory_order_relaxed);
+            uint32_t  left = RANGE_END(range) - RANGE_NEXT(range);
+
+            if ((p_worker != p_thief) && (RANGE_NEXT(range) < RANGE_END(range)) && (left > most_left))
+            {
+                p_victim = p_worker;
+                victim_range = range;
+                most_left = left;
+            }
+        }
+        if (NULL == p_victim)
+        {
+            return false;
+        }
+
+        /* The victim keeps the front half, rounded down: it is busy with a chunk
+           already, so a last chunk is better started by the idle thief. If the
+           victim took or lost a chunk meanwhile, the compare-and-swap fails and
+           the search starts again. */
+        uint32_t next = RANGE_NEXT(victim_range);
+        uint32_t end = RANGE_END(victim_range);
+        uint32_t middle = next + most_left / 2;
+
+        if (atomic_compare_exchange_strong(&p_victim->range, &victim_range, RANGE(next, middle)))
+        {
+            atomic_store(&p_thief->range, RANGE(middle, end));
+            p_thief->n_steals++;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief   Evaluate the lines that start in one chunk and format their results.
+ * A line that crosses the end of the chunk belongs to it, and is skipped by the next.
+ * @param   [in] p_job The job.
+ * @param   [in] chunk_no The chunk.
+ * @param   [out] p_output Where to put the results.
+ * @param   [in,out] p_worker The worker, whose statistics are updated.
+ * @return  None.
+ **/
+static void
+evaluate_chunk(const Job_t *p_job, size_t chunk_no, OutputBuffer_t *p_output, Worker_t *p_worker)
+{
+    const char *p_text = p_job->p_text;
+    const char *p_file_end = p_text + p_job->text_size;
+    const char *p_line = p_text + chunk_no * p_job->chunk_bytes;
+    const char *p_chunk_end = (p_job->text_size - chunk_no * p_job->chunk_bytes > p_job->chunk_bytes)
+                                  ? p_line + p_job->chunk_bytes
+                                  : p_file_end;
+    size_t      n_lines = 0;
+    double      start_ns = now_ns();
+
+    p_output->length = 0;
+    if ((p_line > p_text) && ('\n' != p_line[-1]))
+    {
+        const char *p_newline = memchr(p_line, '\n', (size_t)(p_file_end - p_line));
+
+        p_line = (NULL != p_newline) ? p_newline + 1 : p_file_end;
+    }
+
+    while (p_line < p_chunk_end)
+    {
+        const char *p_newline = memchr(p_line, '\n', (size_t)(p_file_end - p_line));
+        const char *p_line_end = (NULL != p_newline) ? p_newline : p_file_end;
+        size_t      length = (size_t)(p_line_end - p_line);
+        uint8_t     error_ref_no = 3; // "No null or too" "long I/P string", as for a full input_buffer
+        double      answer = 0.0;
+
+        if ((length > 0) && ('\r' == p_line[length - 1]))
+        {
+            length--;
+        }
+        if (NULL != p_worker->p_big)
+        {
+            evaluate_exactly(p_job, p_line, length, p_output, p_worker);
+            n_lines++;
+            p_line = p_line_end + 1;
+            continue;
+        }
+        if (length >= CALC_INPUT_BUFFER_SIZE)
+        {
+            // Too long for the calculator: leave error 3
+        }
+        else if (NULL != p_job->p_cache)
+        {
+            answer = answer_cache_lru_calculate(p_job->p_cache, p_line, length, &error_ref_no);
+        }
+        else if (NULL != p_worker->p_jit)
+        {
+            answer = calc_jit_calculate_span(p_worker->p_jit, p_line, length, &error_ref_no);
+        }
+        else if (NULL != p_worker->p_prefix)
+        {
+            answer = calc_prefix_calculate_span(p_worker->p_prefix, p_line, length, &error_ref_no);
+        }
+        else
+        {
+            answer = CalculateAnswerSpan(p_line, length, &error_ref_no);
+        }
+
+        if (p_job->b_write && reserve_output(p_output, MAX_RESULT_LENGTH))
+        {
+            char *p_result = &p_output->p_text[p_output->length];
+
+            if (0u == error_ref_no)
+            {
+                p_output->length += (size_t)snprintf(p_result, MAX_RESULT_LENGTH, "%.17g\n", answer);
+            }
+            else
+            {
+                memcpy(p_result, error_lines[error_ref_no], error_line_lengths[error_ref_no]);
+                p_output->length += error_line_lengths[error_ref_no];
+            }
+        }
+        n_lines++;
+        p_line = p_line_end + 1;
+    }
+
+    p_worker->busy_ns += now_ns() - start_ns;
+    p_worker->n_lines += n_lines;
+    p_worker->n_chunks++;
+}
+
+/**
+ * @brief   Evaluate one line with the worker's exact evaluator and add its result line.
+ * @param   [in] p_job The job.
+ * @param   [in] p_line The line (without its newline).
+ * @param   [in] length Its length.
+ * @param   [out] p_output Where to put the result.
+ * @param   [in,out] p_worker The worker, whose evaluator is used.
+ * @return  None.
+ **/
+static void
+evaluate_exactly(const Job_t *p_job, const char *p_line, size_t length, OutputBuffer_t *p_output, Worker_t *p_worker)
+{
+    char           *p_answer = p_worker->p_big_answer;
+    uint8_t         error_ref_no = 0;
+    CalcBigStatus_t status =
+        calc_big_evaluate(p_worker->p_big, p_line, length, p_answer, BIG_ANSWER_BYTES - 1, &error_ref_no);
+    const char     *p_result = p_answer;
+    size_t          result_length;
+
+    if (!p_job->b_write)
+    {
+        return;
+    }
+    switch (status)
+    {
+        case CALC_BIG_OK:
+            result_length = strlen(p_answer);
+            p_answer[result_length++] = '\n';
+            break;
+        case CALC_BIG_SYNTAX_ERROR:
+            p_result = error_lines[error_ref_no];
+            result_length = error_line_lengths[error_ref_no];
+            break;
+        case CALC_BIG_DIVIDE_BY_ZERO:
+            p_result = error_lines[ERROR_DIVIDE_BY_ZERO];
+            result_length = error_line_lengths[ERROR_DIVIDE_BY_ZERO];
+            break;
+        default:
+            p_result = error_lines[ERROR_TOO_LARGE];
+            result_length = error_line_lengths[ERROR_TOO_LARGE];
+            break;
+    }
+    if (reserve_output(p_output, result_length))
+    {
+        memcpy(&p_output->p_text[p_output->length], p_result, result_length);
+        p_output->length += result_length;
+    }
+}
+
+/**
+ * @brief   Make room for more results in a chunk's buffer.
+ * @param   [in,out] p_output The buffer.
+ * @param   [in] length The room needed after what it holds.
+ * @return  false if out of memory (the results are then dropped and the write fails).
+ **/
+static bool
+reserve_output(OutputBuffer_t *p_output, size_t length)
+{
+    if (p_output->length + length > p_output->capacity)
+    {
+        size_t capacity = (0 == p_output->capacity) ? job.chunk_bytes : 2 * p_output->capacity;
+        char  *p_bigger;
+
+        while (capacity < p_output->length + length)
+        {
+            capacity *= 2;
+        }
+        p_bigger = realloc(p_output->p_text, capacity);
+        if (NULL == p_bigger)
+        {
+            return false;
+        }
+        p_output->p_text = p_bigger;
+        p_output->capacity = capacity;
+    }
+    return true;
+}
+
+/**
+ * @brief   Find the output buffers of a window.
+ * @param   [in] p_job The job.
+ * @param   [in] window_no The window.
+ * @return  Its window_chunks buffers.
+ **/
+static OutputBuffer_t *
+window_outputs(const Job_t *p_job, size_t window_no)
+{
+    return &p_job->p_outputs[(window_no % WINDOWS_IN_FLIGHT) * p_job->window_chunks];
+}
+
+/**
+ * @brief   Write each window as soon as it has been evaluated, in order.
+ * @param   [in] p_arg The job.
+ * @return  NULL.
+ **/
+static void *
+writer_main(void *p_arg)
+{
+    Job_t *p_job = p_arg;
+
+    for (size_t window_no = 0; window_no < p_job->n_windows; window_no++)
+    {
+        size_t bytes = 0;
+        int    error = 0;
+
+        pthread_mutex_lock(&p_job->lock);
+        while (p_job->n_windows_done <= window_no)
+        {
+            pthread_cond_wait(&p_job->changed, &p_job->lock);
+        }
+        pthread_mutex_unlock(&p_job->lock);
+
+        if (p_job->b_write && (0 == p_job->write_errno))
+        {
+            error = write_window(p_job, window_no, &bytes);
+        }
+
+        pthread_mutex_lock(&p_job->lock);
+        p_job->output_bytes += bytes;
+        if (0 == p_job->write_errno)
+        {
+            p_job->write_errno = error;
+        }
+        p_job->n_windows_written = window_no + 1;
+        pthread_cond_broadcast(&p_job->changed);
+        pthread_mutex_unlock(&p_job->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Write the results of a window with as few writev() calls as possible.
+ * @param   [in] p_job The job.
+ * @param   [in] window_no The window.
+ * @param   [out] p_bytes The bytes written.
+ * @return  0, or the errno of a failed write.
+ **/
+static int
+write_window(const Job_t *p_job, size_t window_no, size_t *p_bytes)
+{
+    OutputBuffer_t *p_outputs = window_outputs(p_job, window_no);
+    size_t          n_chunks = p_job->n_chunks - window_no * p_job->window_chunks;
+    struct iovec    vectors[MAX_VECTORS];
+    size_t          chunk_no = 0;
+
+    if (n_chunks > p_job->window_chunks)
+    {
+        n_chunks = p_job->window_chunks;
+    }
+    while (chunk_no < n_chunks)
+    {
+        int     n_vectors = 0;
+        int     vector_no = 0;
+        ssize_t n_written;
+
+        for (; (chunk_no < n_chunks) && (n_vectors < MAX_VECTORS); chunk_no++)
+        {
+            if (p_outputs[chunk_no].length > 0)
+            {
+                vectors[n_vectors].iov_base = p_outputs[chunk_no].p_text;
+                vectors[n_vectors].iov_len = p_outputs[chunk_no].length;
+                n_vectors++;
+            }
+        }
+
+        /* A short write (e.g. to a pipe) carries on from where it stopped. */
+        while (vector_no < n_vectors)
+        {
+            n_written = writev(p_job->output_fd, &vectors[vector_no], n_vectors - vector_no);
+            if (n_written < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                return errno;
+            }
+            *p_bytes += (size_t)n_written;
+            while ((vector_no < n_vectors) && ((size_t)n_written >= vectors[vector_no].iov_len))
+            {
+                n_written -= (ssize_t)vectors[vector_no].iov_len;
+                vector_no++;
+            }
+            if (vector_no < n_vectors)
+            {
+                vectors[vector_no].iov_base = (char *)vectors[vector_no].iov_base + n_written;
+                vectors[vector_no].iov_len -= (size_t)n_written;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief   Write the per-thread statistics, the load imbalance and the throughput to
+ * stderr.
+ * @param   [in] p_job The job.
+ * @param   [in] wall_ns The time from starting the threads to the last result written.
+ * @return  None.
+ **/
+static void
+report(const Job_t *p_job, double wall_ns)
+{
+    double total_busy_ns = 0.0;
+    double max_busy_ns = 0.0;
+    double mean_busy_ns;
+    size_t n_lines = 0;
+
+    fprintf(stderr, "%-6s %12s %8s %7s %10s %14s\n", "thread", "lines", "chunks", "steals", "busy ms", "lines/s");
+    for (size_t worker_no = 0; worker_no < p_job->n_workers; worker_no++)
+    {
+        const Worker_t *p_worker = &p_job->p_workers[worker_no];
+
+        fprintf(stderr, "%-6zu %12zu %8zu %7zu %10.2f %14.0f\n", worker_no, p_worker->n_lines, p_worker->n_chunks,
+                p_worker->n_steals, p_worker->busy_ns / 1e6,
+                (p_worker->busy_ns > 0.0) ? 1e9 * (double)p_worker->n_lines / p_worker->busy_ns : 0.0);
+        n_lines += p_worker->n_lines;
+        total_busy_ns += p_worker->busy_ns;
+        if (p_worker->busy_ns > max_busy_ns)
+        {
+            max_busy_ns = p_worker->busy_ns;
+        }
+    }
+
+    mean_busy_ns = total_busy_ns / (double)p_job->n_workers;
+    fprintf(stderr, "%zu lines in %zu chunks on %zu threads: %.2f ms\n", n_lines, p_job->n_chunks,
+            p_job->n_workers, wall_ns / 1e6);
+    if (wall_ns > 0.0)
+    {
+        fprintf(stderr, "in: %.1f MB/s, out: %.1f MB/s, %.0f expressions/s\n",
+                1e3 * (double)p_job->text_size / wall_ns, 1e3 * (double)p_job->output_bytes / wall_ns,
+                1e9 * (double)n_lines / wall_ns);
+    }
+    fprintf(stderr, "load imbalance (busiest / mean busy time): %.1f %%\n",
+            (mean_busy_ns > 0.0) ? 100.0 * (max_busy_ns / mean_busy_ns - 1.0) : 0.0);
+    if (NULL != p_job->p_workers[0].p_jit)
+    {
+        CalcJitStats_t totals = {0};
+
+        for (size_t worker_no = 0; worker_no < p_job->n_workers; worker_no++)
+        {
+            CalcJitStats_t stats;
+
+            calc_jit_stats(p_job->p_workers[worker_no].p_jit, &stats);
+            totals.compiled_evaluations += stats.compiled_evaluations;
+            totals.interpreted_evaluations += stats.interpreted_evaluations;
+            totals.shapes_compiled += stats.shapes_compiled;
+            totals.code_bytes += stats.code_bytes;
+        }
+        fprintf(stderr, "jit: %llu compiled, %llu interpreted evaluations; %llu shapes in %llu bytes of code\n",
+                (unsigned long long)totals.compiled_evaluations, (unsigned long long)totals.interpreted_evaluations,
+                (unsigned long long)totals.shapes_compiled, (unsigned long long)totals.code_bytes);
+    }
+    if (NULL != p_job->p_workers[0].p_prefix)
+    {
+        CalcPrefixStats_t totals = {0};
+
+        for (size_t worker_no = 0; worker_no < p_job->n_workers; worker_no++)
+        {
+            CalcPrefixStats_t stats;
+
+            calc_prefix_stats(p_job->p_workers[worker_no].p_prefix, &stats);
+            totals.terms_evaluated += stats.terms_evaluated;
+            totals.terms_reused += stats.terms_reused;
+            totals.bytes += stats.bytes;
+            totals.bytes_reused += stats.bytes_reused;
+        }
+        fprintf(stderr, "prefix: %llu of %llu terms and %llu of %llu characters reused\n",
+                (unsigned long long)totals.terms_reused,
+                (unsigned long long)(totals.terms_evaluated + totals.terms_reused),
+                (unsigned long long)totals.bytes_reused, (unsigned long long)totals.bytes);
+    }
+    if (NULL != p_job->p_cache)
+    {
+        AnswerCacheLruStats_t stats;
+        uint64_t              lookups;
+
+        answer_cache_lru_stats(p_job->p_cache, &stats);
+        lookups = stats.hits + stats.misses;
+        fprintf(stderr, "cache: %llu hits, %llu misses (%.1f %% hit), %llu evictions, %llu bypassed\n",
+                (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+                (lookups > 0u) ? 100.0 * (double)stats.hits / (double)lookups : 0.0,
+                (unsigned long long)stats.evictions, (unsigned long long)stats.bypasses);
+    }
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,489 @@
+/**
+ * $File: calc_load.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      calc_load.c
+ *
+ *  @brief     Host tool: load generator for calc_daemon. Opens several connections, keeps
+ *             a number of pipelined requests outstanding on each, and reports requests/s
+ *             and the latency percentiles.
+ *
+ *             Usage: calc_load [-s socket] [-c connections] [-d depth] [-n requests] [-f file] [-v]
+ *               -s  The daemon's socket (default /tmp/calc_daemon.sock).
+ *               -c  Connections (default 4).
+ *               -d  Requests outstanding per connection (default 16, at most MAX_DEPTH).
+ *               -n  Requests per connection (default 100000).
+ *               -f  Send the lines of this file (default: the corpora in bench_corpora.h).
+ *               -v  Check every answer against CalculateAnswerSpan() here.
+ *
+ *             A request's latency runs from handing it to write() to reading the end of its
+ *             answer, so with -d above 1 it includes the time spent queued behind the
+ *             requests before it on the same connection.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_incremental.h"
+#include "../calculate_answer.h"
+#include "bench_corpora.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define DEFAULT_SOCKET_PATH "/tmp/calc_daemon.sock"
+#define MAX_CONNECTIONS     256
+#define MAX_DEPTH           256
+#define MAX_REQUEST_LENGTH  256  /* Longer lines of a -f file are cut (the daemon gives error 3). */
+#define MAX_RESPONSE_LENGTH 64
+#define SEND_BUFFER_SIZE    (MAX_DEPTH * (MAX_REQUEST_LENGTH + 1))
+#define RECEIVE_BUFFER_SIZE 8192
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* One connection and its requests in flight. */
+typedef struct
+{
+    int      fd;
+    size_t   n_sent;                     /* Requests handed to write(). */
+    size_t   n_answered;
+    uint64_t sent_ns[MAX_DEPTH];         /* When each request in flight was sent, by number. */
+    size_t   send_start;
+    size_t   send_length;
+    size_t   receive_length;
+    char     send_buffer[SEND_BUFFER_SIZE];
+    char     receive_buffer[RECEIVE_BUFFER_SIZE];
+} Connection_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static int      connect_to(const char *p_path);
+static size_t   load_expressions(const char *p_path, const char ***ppp_expressions);
+static void     send_requests(Connection_t *p_connection);
+static bool     receive_answers(Connection_t *p_connection);
+static void     check_answer(const char *p_answer, size_t length, size_t request_no);
+static size_t   expression_no(const Connection_t *p_connection, size_t request_no);
+static int      compare_latencies(const void *p_a, const void *p_b);
+static uint64_t latency_at(double fraction);
+static uint64_t now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static Connection_t *p_connections;
+static size_t        n_connections = 4;
+static size_t        depth = 16;
+static size_t        n_requests_each = 100000;
+static bool          b_verify = false;
+static const char  **pp_expressions;
+static size_t        n_expressions;
+static uint64_t     *p_latencies_ns;
+static size_t        n_latencies = 0;
+static size_t        n_error_answers = 0;
+static size_t        n_mismatches = 0;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Run the load and print the results.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 if an answer was wrong or the daemon went away.
+ **/
+int
+main(int argc, char *argv[])
+{
+    const char   *p_path = DEFAULT_SOCKET_PATH;
+    const char   *p_file = NULL;
+    struct pollfd poll_fds[MAX_CONNECTIONS];
+    size_t        n_done = 0;
+    uint64_t      start_ns;
+    double        elapsed_s;
+    int           option;
+
+    while (-1 != (option = getopt(argc, argv, "s:c:d:n:f:v")))
+    {
+        switch (option)
+        {
+            case 's':
+                p_path = optarg;
+                break;
+            case 'c':
+                n_connections = (size_t)atol(optarg);
+                break;
+            case 'd':
+                depth = (size_t)atol(optarg);
+                break;
+            case 'n':
+                n_requests_each = (size_t)atol(optarg);
+                break;
+            case 'f':
+                p_file = optarg;
+                break;
+            case 'v':
+                b_verify = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s socket] [-c connections] [-d depth] [-n requests] [-f file] [-v]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((n_connections < 1) || (n_connections > MAX_CONNECTIONS) || (depth < 1) || (depth > MAX_DEPTH))
+    {
+        fprintf(stderr, "connections must be 1-%d and depth 1-%d\n", MAX_CONNECTIONS, MAX_DEPTH);
+        return EXIT_FAILURE;
+    }
+
+    n_expressions = load_expressions(p_file, &pp_expressions);
+    p_connections = calloc(n_connections, sizeof(Connection_t));
+    p_latencies_ns = malloc(n_connections * n_requests_each * sizeof(uint64_t) + 1);
+    if ((0 == n_expressions) || (NULL == p_connections) || (NULL == p_latencies_ns))
+    {
+        fprintf(stderr, "%s: no expressions, or out of memory\n", (NULL != p_file) ? p_file : "corpora");
+        return EXIT_FAILURE;
+    }
+    for (size_t connection_no = 0; connection_no < n_connections; connection_no++)
+    {
+        p_connections[connection_no].fd = connect_to(p_path);
+        if (p_connections[connection_no].fd < 0)
+        {
+            perror(p_path);
+            return EXIT_FAILURE;
+        }
+        poll_fds[connection_no].fd = p_connections[connection_no].fd;
+    }
+
+    start_ns = now_ns();
+    while (n_done < n_connections)
+    {
+        n_done = 0;
+        for (size_t connection_no = 0; connection_no < n_connections; connection_no++)
+        {
+            Connection_t *p_connection = &p_connections[connection_no];
+
+            send_requests(p_connection);
+            poll_fds[connection_no].events = POLLIN | ((p_connection->send_length > 0) ? POLLOUT : 0);
+            n_done += (p_connection->n_answered == n_requests_each);
+        }
+        if ((n_done < n_connections) && (poll(poll_fds, n_connections, -1) < 0) && (EINTR != errno))
+        {
+            perror("poll");
+            return EXIT_FAILURE;
+        }
+        for (size_t connection_no = 0; connection_no < n_connections; connection_no++)
+        {
+            if ((0 != (poll_fds[connection_no].revents & (POLLIN | POLLHUP | POLLERR))) &&
+                !receive_answers(&p_connections[connection_no]))
+            {
+                fprintf(stderr, "connection %zu: the daemon closed it\n", connection_no);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    elapsed_s = (double)(now_ns() - start_ns) / 1e9;
+
+    qsort(p_latencies_ns, n_latencies, sizeof(uint64_t), compare_latencies);
+    printf("%zu requests on %zu connections, depth %zu: %.3f s, %.0f requests/s\n", n_latencies, n_connections,
+           depth, elapsed_s, (double)n_latencies / elapsed_s);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", latency_at(0.50) / 1e3,
+           latency_at(0.90) / 1e3, latency_at(0.99) / 1e3, latency_at(0.999) / 1e3, latency_at(1.0) / 1e3);
+    printf("%zu error answers", n_error_answers);
+    if (b_verify)
+    {
+        printf(", %zu wrong", n_mismatches);
+    }
+    printf("\n");
+    return (0 == n_mismatches) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Connect to the daemon.
+ * @param   [in] p_path The socket path.
+ * @return  The non-blocking socket, or -1 with errno set.
+ **/
+static int
+connect_to(const char *p_path)
+{
+    struct sockaddr_un address;
+    int                fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, p_path, sizeof(address.sun_path) - 1);
+    if ((fd < 0) || (0 != connect(fd, (struct sockaddr *)&address, sizeof(address))))
+    {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @brief   Get the expressions to send: the lines of a file, or the benchmark corpora.
+ * @param   [in] p_path The file, or NULL.
+ * @param   [out] ppp_expressions The expressions.
+ * @return  How many there are (0 on an error).
+ **/
+static size_t
+load_expressions(const char *p_path, const char ***ppp_expressions)
+{
+    static const char *corpus[EXPRESSION_CLASS_COUNT * CORPUS_SIZE];
+    FILE              *p_file;
+    char               line[MAX_REQUEST_LENGTH + 2];
+    size_t             n_lines = 0;
+    size_t             capacity = 0;
+    const char       **pp_lines = NULL;
+
+    if (NULL == p_path)
+    {
+        for (size_t index = 0; index < EXPRESSION_CLASS_COUNT * CORPUS_SIZE; index++)
+        {
+            corpus[index] = expression_classes[index / CORPUS_SIZE].expressions[index % CORPUS_SIZE];
+        }
+        *ppp_expressions = corpus;
+        return EXPRESSION_CLASS_COUNT * CORPUS_SIZE;
+    }
+
+    p_file = fopen(p_path, "r");
+    if (NULL == p_file)
+    {
+        return 0;
+    }
+    while (NULL != fgets(line, sizeof(line), p_file))
+    {
+        char *p_copy;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        line[MAX_REQUEST_LENGTH] = '\0';
+        if (n_lines == capacity)
+        {
+            capacity = (0 == capacity) ? 1024 : 2 * capacity;
+            pp_lines = realloc(pp_lines, capacity * sizeof(char *));
+        }
+        p_copy = strdup(line);
+        if ((NULL == pp_lines) || (NULL == p_copy))
+        {
+            fclose(p_file);
+            return 0;
+        }
+        pp_lines[n_lines++] = p_copy;
+    }
+    fclose(p_file);
+    *ppp_expressions = pp_lines;
+    return n_lines;
+}
+
+/**
+ * @brief   Top the connection up to depth requests in flight and send what it can.
+ * @param   [in,out] p_connection The connection.
+ * @return  None.
+ **/
+static void
+send_requests(Connection_t *p_connection)
+{
+    ssize_t n_written;
+
+    while ((p_connection->n_sent - p_connection->n_answered < depth) && (p_connection->n_sent < n_requests_each))
+    {
+        const char *p_expression = pp_expressions[expression_no(p_connection, p_connection->n_sent)];
+        size_t      length = strlen(p_expression);
+        size_t      end = p_connection->send_start + p_connection->send_length;
+
+        if (end + length + 1 > SEND_BUFFER_SIZE)
+        {
+            memmove(p_connection->send_buffer, &p_connection->send_buffer[p_connection->send_start],
+                    p_connection->send_length);
+            p_connection->send_start = 0;
+            end = p_connection->send_length;
+        }
+        memcpy(&p_connection->send_buffer[end], p_expression, length);
+        p_connection->send_buffer[end + length] = '\n';
+        p_connection->send_length += length + 1;
+        p_connection->sent_ns[p_connection->n_sent % MAX_DEPTH] = now_ns();
+        p_connection->n_sent++;
+    }
+
+    if (0 == p_connection->send_length)
+    {
+        return;
+    }
+    n_written = write(p_connection->fd, &p_connection->send_buffer[p_connection->send_start],
+                      p_connection->send_length);
+    if (n_written > 0)
+    {
+        p_connection->send_start += (size_t)n_written;
+        p_connection->send_length -= (size_t)n_written;
+        if (0 == p_connection->send_length)
+        {
+            p_connection->send_start = 0;
+        }
+    }
+}
+
+/**
+ * @brief   Read answers and record the latency of each.
+ * @param   [in,out] p_connection The connection.
+ * @return  false if the daemon closed the connection.
+ **/
+static bool
+receive_answers(Connection_t *p_connection)
+{
+    ssize_t n_read = read(p_connection->fd, &p_connection->receive_buffer[p_connection->receive_length],
+                          RECEIVE_BUFFER_SIZE - p_connection->receive_length);
+    uint64_t now;
+    size_t   start = 0;
+
+    if (n_read <= 0)
+    {
+        return (n_read < 0) && ((EAGAIN == errno) || (EINTR == errno));
+    }
+    now = now_ns();
+    p_connection->receive_length += (size_t)n_read;
+
+    for (;;)
+    {
+        char  *p_answer = &p_connection->receive_buffer[start];
+        char  *p_newline = memchr(p_answer, '\n', p_connection->receive_length - start);
+        size_t request_no = p_connection->n_answered;
+
+        if (NULL == p_newline)
+        {
+            break;
+        }
+        p_latencies_ns[n_latencies++] = now - p_connection->sent_ns[request_no % MAX_DEPTH];
+        n_error_answers += ('0' != p_answer[0]);
+        if (b_verify)
+        {
+            check_answer(p_answer, (size_t)(p_newline - p_answer), expression_no(p_connection, request_no));
+        }
+        p_connection->n_answered++;
+        start = (size_t)(p_newline - p_connection->receive_buffer) + 1;
+    }
+
+    memmove(p_connection->receive_buffer, &p_connection->receive_buffer[start],
+            p_connection->receive_length - start);
+    p_connection->receive_length -= start;
+    return true;
+}
+
+/**
+ * @brief   Check an answer against the engine.
+ * @param   [in] p_answer The answer, without its newline.
+ * @param   [in] length Its length.
+ * @param   [in] index The expression it answers, in pp_expressions[].
+ * @return  None.
+ **/
+static void
+check_answer(const char *p_answer, size_t length, size_t index)
+{
+    const char *p_expression = pp_expressions[index];
+    size_t      expression_length = strlen(p_expression);
+    char        expected[MAX_RESPONSE_LENGTH];
+    uint8_t     error_ref_no = 3;
+    double      result = 0.0;
+
+    if (expression_length < CALC_INPUT_BUFFER_SIZE)
+    {
+        result = CalculateAnswerSpan(p_expression, expression_length, &error_ref_no);
+    }
+    if (0u == error_ref_no)
+    {
+        snprintf(expected, sizeof(expected), "0 %.17g", result);
+    }
+    else
+    {
+        snprintf(expected, sizeof(expected), "%u %s %s", error_ref_no, error_message_line1[error_ref_no],
+                 error_message_line2[error_ref_no]);
+    }
+    if ((strlen(expected) != length) || (0 != memcmp(expected, p_answer, length)))
+    {
+        if (0 == n_mismatches)
+        {
+            fprintf(stderr, "\"%s\": expected \"%s\", got \"%.*s\"\n", p_expression, expected, (int)length, p_answer);
+        }
+        n_mismatches++;
+    }
+}
+
+/**
+ * @brief   Pick the expression for a request; each connection starts at a different one.
+ * @param   [in] p_connection The connection.
+ * @param   [in] request_no The request on that connection.
+ * @return  The index in pp_expressions[].
+ **/
+static size_t
+expression_no(const Connection_t *p_connection, size_t request_no)
+{
+    return ((size_t)(p_connection - p_connections) + request_no) % n_expressions;
+}
+
+/**
+ * @brief   qsort() comparison of two latencies.
+ * @param   [in] p_a, p_b The latencies.
+ * @return  <0, 0 or >0.
+ **/
+static int
+compare_latencies(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief   Read a percentile from the sorted latencies.
+ * @param   [in] fraction 0.5 for the median, 1.0 for the maximum.
+ * @return  The latency in nanoseconds.
+ **/
+static uint64_t
+latency_at(double fraction)
+{
+    size_t index = (size_t)(fraction * (double)n_latencies);
+
+    if (0 == n_latencies)
+    {
+        return 0;
+    }
+    return p_latencies_ns[(index < n_latencies) ? index : n_latencies - 1];
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static uint64_t
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# echo_cost.sh - Count the LCD bytes the firmware sends for one keystroke, at
+# various lengths of the input line, on the host build (low_level_funcs_host.c).
+# Run it from the top of the tree.
+#
+# The keystroke at length L costs the difference between typing 20 lines of L
+# keys and 20 lines of L-1 keys (each line cleared with '#'), divided by 20. The
+# lines repeat "12+". It is printed for the echo alone (LIVE_PREVIEW_ENABLE=0)
+# and with the preview of the running result on line 2.
+#
+# Usage: tools/echo_cost.sh [lengths, default 1 4 8 12 15 16 17 20 24 28 31]
+# Set CC and CFLAGS to change the host compiler and its options.
+
+cc=${CC:-gcc}
+cflags=${CFLAGS:--O2}
+lengths=${*:-1 4 8 12 15 16 17 20 24 28 31}
+sources="main.c high_level_funcs.c mid_level_funcs.c calculate_answer.c calc_stream.c
+         calc_incremental.c answer_cache.c low_level_funcs_host.c profile.c
+         latency_histogram.c trace.c"
+lines=20
+out=$(mktemp -d) || exit 1
+trap 'rm -rf "$out"' EXIT
+
+for preview in 0 1; do
+    $cc -std=c99 -D_POSIX_C_SOURCE=200809L $cflags -DLIVE_PREVIEW_ENABLE=$preview \
+        -o "$out/sim$preview" $sources -lm || exit 1
+done
+
+# LCD bytes for $lines lines of $1 keys.
+lcd_bytes() {
+    line=""
+    if [ "$1" -gt 0 ]; then
+        line=$(printf '12+%.0s' $(seq 1 "$1") | cut -c "1-$1")
+    fi
+    for n in $(seq 1 $lines); do
+        printf '%s#' "$line"
+    done | "$out/sim$2" | awk '/^LCD bytes sent/ { print $5 }'
+}
+
+printf '%6s %14s %14s\n' length echo "with preview"
+for length in $lengths; do
+    printf '%6d' "$length"
+    for preview in 0 1; do
+        before=$(lcd_bytes $((length - 1)) $preview)
+        after=$(lcd_bytes "$length" $preview)
+        awk -v before="$before" -v after="$after" -v lines=$lines \
+            'BEGIN { printf " %14.1f", (after - before) / lines }'
+    done
+    printf '\n'
+done
@@ -0,0 +1,250 @@
+/**
+ * $File: long_scaling.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      long_scaling.c
+ *
+ *  @brief     Host tool: how calc_long_evaluate() scales with threads and with the number
+ *             of terms.
+ *
+ *             Usage: long_scaling [-j max threads] [-n max terms] [-r repetitions]
+ *               -j  The most threads (default: the number of online cores); the thread
+ *                   counts measured double from 1.
+ *               -n  The most terms (default 1000000); the term counts grow tenfold from
+ *                   1000.
+ *               -r  Timed runs per measurement, the fastest reported (default 5).
+ *
+ *             Each expression is a generated sum of products, like those of the test
+ *             generators: 1 to 4 numbers joined by x, / or E in each term, and the terms
+ *             joined by + and -. For each reduction order and thread count the results go
+ *             to stdout as CSV: terms, bytes, reduction, threads, chunks used, ms, ns per
+ *             term, the speed-up over one thread and the relative difference from the
+ *             sequential answer. The tool fails if the sequential or pairwise answer
+ *             changes with the number of threads, since both must not.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_long.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define MIN_TERMS       1000
+#define MAX_TERM_LENGTH 32 /* Longest generated term, with its sign. */
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static size_t   generate(char *p_expression, size_t n_terms);
+static uint32_t next_random(void);
+static double   now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const char *const reduction_names[] = {"sequential", "pairwise", "per_thread"};
+
+static uint32_t random_state = 12345u;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Measure each reduction order over each term count and thread count.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 on an error or if an answer that must not change did.
+ **/
+int
+main(int argc, char *argv[])
+{
+    long   max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long   max_terms = 1000000;
+    int    repetitions = 5;
+    int    option;
+    char  *p_expression;
+
+    while (-1 != (option = getopt(argc, argv, "j:n:r:")))
+    {
+        switch (option)
+        {
+            case 'j':
+                max_threads = atol(optarg);
+                break;
+            case 'n':
+                max_terms = atol(optarg);
+                break;
+            case 'r':
+                repetitions = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j max threads] [-n max terms] [-r repetitions]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((max_threads < 1) || (max_threads > CALC_LONG_MAX_THREADS) || (max_terms < MIN_TERMS) ||
+        (repetitions < 1))
+    {
+        fprintf(stderr, "usage: %s [-j max threads (1-%d)] [-n max terms (at least %d)] [-r repetitions]\n",
+                argv[0], CALC_LONG_MAX_THREADS, MIN_TERMS);
+        return EXIT_FAILURE;
+    }
+
+    p_expression = malloc((size_t)max_terms * MAX_TERM_LENGTH);
+    if (NULL == p_expression)
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("terms,bytes,reduction,threads,chunks,ms,ns_per_term,speedup,relative_difference\n");
+    for (long n_terms = MIN_TERMS; n_terms <= max_terms; n_terms *= 10)
+    {
+        size_t length = generate(p_expression, (size_t)n_terms);
+        double sequential_answer = 0.0;
+
+        for (int reduction = CALC_LONG_SEQUENTIAL; reduction <= CALC_LONG_PER_THREAD; reduction++)
+        {
+            double one_thread_ns = 0.0;
+            double one_thread_answer = 0.0;
+
+            for (long n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+            {
+                CalcLongStats_t stats;
+                uint8_t         error_ref_no;
+                double          answer = 0.0;
+                double          best_ns = 0.0;
+
+                for (int repetition = 0; repetition < repetitions; repetition++)
+                {
+                    double start_ns = now_ns();
+                    double elapsed_ns;
+
+                    answer = calc_long_evaluate(p_expression, length, (unsigned)n_threads,
+                                                (CalcLongReduction_t)reduction, &error_ref_no, &stats);
+                    elapsed_ns = now_ns() - start_ns;
+                    if ((0 == repetition) || (elapsed_ns < best_ns))
+                    {
+                        best_ns = elapsed_ns;
+                    }
+                }
+                if (0u != error_ref_no)
+                {
+                    fprintf(stderr, "%ld terms: error %u\n", n_terms, error_ref_no);
+                    return EXIT_FAILURE;
+                }
+
+                if (1 == n_threads)
+                {
+                    one_thread_ns = best_ns;
+                    one_thread_answer = answer;
+                    if (CALC_LONG_SEQUENTIAL == reduction)
+                    {
+                        sequential_answer = answer;
+                    }
+                }
+                else if ((CALC_LONG_PER_THREAD != reduction) && (0 != memcmp(&answer, &one_thread_answer, sizeof(double))))
+                {
+                    fprintf(stderr, "%ld terms, %s: %ld threads give %.17g, one gives %.17g\n", n_terms,
+                            reduction_names[reduction], n_threads, answer, one_thread_answer);
+                    return EXIT_FAILURE;
+                }
+
+                printf("%ld,%zu,%s,%ld,%zu,%.3f,%.1f,%.2f,%.3g\n", n_terms, length, reduction_names[reduction],
+                       n_threads, stats.chunks, best_ns / 1e6, best_ns / (double)stats.terms, one_thread_ns / best_ns,
+                       fabs(answer - sequential_answer) / fabs(sequential_answer));
+                fflush(stdout);
+            }
+        }
+    }
+
+    free(p_expression);
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Write a sum of products with a given number of terms (the same every time).
+ * @param   [out] p_expression Room for n_terms * MAX_TERM_LENGTH characters.
+ * @param   [in] n_terms The number of terms.
+ * @return  The length (there is no null).
+ **/
+static size_t
+generate(char *p_expression, size_t n_terms)
+{
+    static const char operators[] = {'x', 'x', '/', 'E'};
+    size_t            length = 0;
+
+    random_state = 12345u;
+    for (size_t term_no = 0; term_no < n_terms; term_no++)
+    {
+        unsigned n_numbers = 1u + next_random() % 4u;
+        char     previous = '\0';
+
+        if (0u != term_no)
+        {
+            p_expression[length++] = (0u == next_random() % 4u) ? '-' : '+';
+        }
+        for (unsigned number_no = 0; number_no < n_numbers; number_no++)
+        {
+            if (0u != number_no)
+            {
+                /* No two E operators in a row, and a small integer after an E. */
+                previous = operators[next_random() % (('E' == previous) ? 3u : 4u)];
+                p_expression[length++] = previous;
+            }
+            if ('E' == previous)
+            {
+                length += (size_t)sprintf(&p_expression[length], "%u", next_random() % 6u);
+            }
+            else
+            {
+                length += (size_t)sprintf(&p_expression[length], "%u.%02u", 1u + next_random() % 999u,
+                                          next_random() % 100u);
+            }
+        }
+    }
+
+    return length;
+}
+
+/* A linear congruential generator, so every run sees the same expressions. */
+static uint32_t
+next_random(void)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,133 @@
+/**
+ * $File: perf_stages.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      perf_stages.c
+ *
+ *  @brief     Host tool: per-stage timings and hardware counters of CalculateAnswer() for
+ *             each class of expression in bench_corpora.h.
+ *
+ *             Usage: perf_stages [-n] [-i iterations]
+ *               -n  Do not open the hardware counters (timing only).
+ *               -i  Evaluations per class (default 100000).
+ *
+ *             Must be built with -DPROFILE_ENABLE=1 -DPROFILE_PERF_COUNTERS=1. If the kernel
+ *             refuses the counters, or only some are available, the missing ones are shown
+ *             as "n/a" and the timings are still reported.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_incremental.h"
+#include "../calculate_answer.h"
+#include "../profile.h"
+#include "bench_corpora.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#if !PROFILE_ENABLE || !PROFILE_PERF_COUNTERS
+#error "Build with -DPROFILE_ENABLE=1 -DPROFILE_PERF_COUNTERS=1"
+#endif
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void write_line(const char *p_line);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static volatile double answer_sink; /* Keeps the compiler from discarding the results. */
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Profile each expression class in turn.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success.
+ **/
+int
+main(int argc, char *argv[])
+{
+    bool b_use_counters = true;
+    long n_iterations = 100000;
+    int  option;
+
+    while (-1 != (option = getopt(argc, argv, "ni:")))
+    {
+        switch (option)
+        {
+            case 'n':
+                b_use_counters = false;
+                break;
+            case 'i':
+                n_iterations = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n] [-i iterations]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (b_use_counters)
+    {
+        perf_counters_open();
+    }
+
+    for (size_t class_no = 0; class_no < EXPRESSION_CLASS_COUNT; class_no++)
+    {
+        const ExpressionClass_t *p_class = &expression_classes[class_no];
+
+        profile_reset();
+        perf_counters_reset();
+        for (long iteration = 0; iteration < n_iterations; iteration++)
+        {
+            char    input_buffer[CALC_INPUT_BUFFER_SIZE];
+            uint8_t error_ref_no = 0;
+
+            strncpy(input_buffer, p_class->expressions[iteration % CORPUS_SIZE], CALC_INPUT_BUFFER_SIZE - 1);
+            input_buffer[CALC_INPUT_BUFFER_SIZE - 1] = '\0';
+            answer_sink = CalculateAnswer(input_buffer, CALC_INPUT_BUFFER_SIZE, &error_ref_no);
+        }
+
+        printf("== %s: %ld evaluations, times in %s\n", p_class->p_name, n_iterations, profile_tick_unit());
+        profile_dump(write_line);
+        printf("-- counts per call (simple_atof is included in identify_tokens)\n");
+        perf_counters_dump(write_line);
+        printf("\n");
+    }
+
+    perf_counters_close();
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Print one line of a dump.
+ * @param   [in] p_line The line.
+ * @return  None.
+ **/
+static void
+write_line(const char *p_line)
+{
+    printf("  %s\n", p_line);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
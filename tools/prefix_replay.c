@@ -0,0 +1,435 @@
+/**
+ * $File: prefix_replay.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      prefix_replay.c
+ *
+ *  @brief     Host tool: replay a log of expressions through CalculateAnswerBatch() and
+ *             through the shared-prefix evaluator (calc_prefix.c), and report how much
+ *             work the prefix trie saved and the throughput of each.
+ *
+ *             Usage: prefix_replay [-r repetitions] [-b batch size] [file]
+ *                    prefix_replay -g lines
+ *               -r  Timed replays of the log, the fastest reported (default 5).
+ *               -b  Items per call (default 256).
+ *               -g  Write a generated log of this many lines to stdout instead: "what if"
+ *                   rework, in which an expression of up to CALC_INCREMENTAL_MAX_LENGTH
+ *                   characters is followed by 2 to 6 lines that keep its leading terms
+ *                   and change its last. The log is the same every run.
+ *
+ *             The file has one expression per line, as calc_eval reads them: a line of
+ *             more than CALC_INCREMENTAL_MAX_LENGTH (32) characters gets error 3. Without a
+ *             file the recorded session of bench_corpora.h is replayed 1000 times. Every
+ *             answer and error number is checked against CalculateAnswerBatch() first.
+ *             Each timed replay starts with an empty trie.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_prefix.h"
+#include "../calc_incremental.h"
+#include "../calculate_answer.h"
+#include "bench_corpora.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define SESSION_REPEATS   1000 /* Replays of the built-in session, without a file. */
+#define EXPRESSION_SIZE   64   /* Room for a generated expression or term. */
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static bool     load_log(const char *p_path);
+static bool     add_line(const char *p_line);
+static double   replay(bool b_prefix, size_t batch_size, CalcPrefixStats_t *p_stats);
+static void     generate_log(long n_log_lines);
+static size_t   make_term(char *p_term);
+static size_t   append_number(char *p_expression, size_t length);
+static uint32_t next_random(void);
+static double   now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static char        (*p_lines)[CALC_INPUT_BUFFER_SIZE];
+static const char **pp_inputs;
+static size_t        n_lines;
+static size_t        capacity;
+static double       *p_answers;
+static uint8_t      *p_error_ref_nos;
+static uint32_t      random_state = 12345u;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check and time both evaluators on the log.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 on an error or a mismatch.
+ **/
+int
+main(int argc, char *argv[])
+{
+    CalcPrefixStats_t stats;
+    double           *p_expected;
+    uint8_t          *p_expected_errors;
+    long              batch_size = 256;
+    long              n_log_lines = 0;
+    int               repetitions = 5;
+    int               option;
+    double            engine_ns = 0.0;
+    double            prefix_ns = 0.0;
+
+    while (-1 != (option = getopt(argc, argv, "r:b:g:")))
+    {
+        switch (option)
+        {
+            case 'r':
+                repetitions = atoi(optarg);
+                break;
+            case 'b':
+                batch_size = atol(optarg);
+                break;
+            case 'g':
+                n_log_lines = atol(optarg);
+                if (n_log_lines < 1)
+                {
+                    fprintf(stderr, "usage: %s -g lines\n", argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r repetitions] [-b batch size] [file] | -g lines\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((repetitions < 1) || (batch_size < 1))
+    {
+        fprintf(stderr, "usage: %s [-r repetitions] [-b batch size] [file] | -g lines\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (n_log_lines > 0)
+    {
+        generate_log(n_log_lines);
+        return EXIT_SUCCESS;
+    }
+
+    if (optind < argc)
+    {
+        if (!load_log(argv[optind]))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        for (size_t repeat = 0; repeat < SESSION_REPEATS; repeat++)
+        {
+            for (size_t line_no = 0; line_no < SESSION_REPLAY_LENGTH; line_no++)
+            {
+                if (!add_line(session_replay[line_no]))
+                {
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    pp_inputs = malloc(n_lines * sizeof(const char *));
+    p_answers = malloc(n_lines * sizeof(double));
+    p_error_ref_nos = malloc(n_lines);
+    p_expected = malloc(n_lines * sizeof(double));
+    p_expected_errors = malloc(n_lines);
+    if ((NULL == pp_inputs) || (NULL == p_answers) || (NULL == p_error_ref_nos) || (NULL == p_expected) ||
+        (NULL == p_expected_errors))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t line_no = 0; line_no < n_lines; line_no++)
+    {
+        pp_inputs[line_no] = p_lines[line_no];
+    }
+
+    /* The check. */
+    CalculateAnswerBatch(pp_inputs, n_lines, CALC_INPUT_BUFFER_SIZE, p_expected, p_expected_errors);
+    replay(true, (size_t)batch_size, &stats);
+    for (size_t line_no = 0; line_no < n_lines; line_no++)
+    {
+        if ((0 != memcmp(&p_answers[line_no], &p_expected[line_no], sizeof(double))) ||
+            (p_error_ref_nos[line_no] != p_expected_errors[line_no]))
+        {
+            fprintf(stderr, "line %zu \"%s\": %.17g (error %u), CalculateAnswerBatch() gives %.17g (error %u)\n",
+                    line_no + 1u, pp_inputs[line_no], p_answers[line_no], p_error_ref_nos[line_no],
+                    p_expected[line_no], p_expected_errors[line_no]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int repetition = 0; repetition < repetitions; repetition++)
+    {
+        double elapsed_ns = replay(false, (size_t)batch_size, NULL);
+
+        engine_ns = ((0 == repetition) || (elapsed_ns < engine_ns)) ? elapsed_ns : engine_ns;
+        elapsed_ns = replay(true, (size_t)batch_size, &stats);
+        prefix_ns = ((0 == repetition) || (elapsed_ns < prefix_ns)) ? elapsed_ns : prefix_ns;
+    }
+
+    printf("lines                %zu\n", n_lines);
+    printf("terms                %llu (%llu reused, %.1f %%)\n",
+           (unsigned long long)(stats.terms_evaluated + stats.terms_reused), (unsigned long long)stats.terms_reused,
+           100.0 * (double)stats.terms_reused / (double)(stats.terms_evaluated + stats.terms_reused));
+    printf("characters           %llu (%llu reused, %.1f %%)\n", (unsigned long long)stats.bytes,
+           (unsigned long long)stats.bytes_reused, 100.0 * (double)stats.bytes_reused / (double)stats.bytes);
+    printf("evaluated whole      %llu\n", (unsigned long long)stats.whole_items);
+    printf("trie nodes, resets   %llu, %llu\n", (unsigned long long)stats.nodes, (unsigned long long)stats.resets);
+    printf("engine               %.1f ns/line, %.2f M lines/s\n", engine_ns / (double)n_lines,
+           (double)n_lines / engine_ns * 1e3);
+    printf("prefix trie          %.1f ns/line, %.2f M lines/s (%.2fx)\n", prefix_ns / (double)n_lines,
+           (double)n_lines / prefix_ns * 1e3, engine_ns / prefix_ns);
+
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Read a log, one expression per line.
+ * @param   [in] p_path The file.
+ * @return  true on success.
+ **/
+static bool
+load_log(const char *p_path)
+{
+    FILE *p_file = fopen(p_path, "r");
+    char  line[256];
+
+    if (NULL == p_file)
+    {
+        perror(p_path);
+        return false;
+    }
+    while (NULL != fgets(line, sizeof(line), p_file))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!add_line(line))
+        {
+            fclose(p_file);
+            return false;
+        }
+    }
+    fclose(p_file);
+    return true;
+}
+
+/**
+ * @brief   Add a line to the log as main() would hold it: in a CALC_INPUT_BUFFER_SIZE
+ * buffer, with no null if it is too long (so it gets error 3).
+ * @param   [in] p_line The line.
+ * @return  true on success, false if out of memory.
+ **/
+static bool
+add_line(const char *p_line)
+{
+    if (n_lines == capacity)
+    {
+        size_t new_capacity = (0u == capacity) ? 4096u : 2u * capacity;
+        char (*p_new_lines)[CALC_INPUT_BUFFER_SIZE] = realloc(p_lines, new_capacity * CALC_INPUT_BUFFER_SIZE);
+
+        if (NULL == p_new_lines)
+        {
+            fprintf(stderr, "out of memory\n");
+            return false;
+        }
+        p_lines = p_new_lines;
+        capacity = new_capacity;
+    }
+
+    memset(p_lines[n_lines], 0, CALC_INPUT_BUFFER_SIZE);
+    strncpy(p_lines[n_lines], p_line, CALC_INPUT_BUFFER_SIZE);
+    n_lines++;
+    return true;
+}
+
+/**
+ * @brief   Evaluate the whole log once, a batch at a time.
+ * @param   [in] b_prefix true for calc_prefix_batch() (with a new trie), false for
+ * CalculateAnswerBatch().
+ * @param   [in] batch_size Items per call.
+ * @param   [out] p_stats The prefix evaluator's counters (if b_prefix).
+ * @return  The time taken, in ns.
+ **/
+static double
+replay(bool b_prefix, size_t batch_size, CalcPrefixStats_t *p_stats)
+{
+    CalcPrefix_t *p_prefix = b_prefix ? calc_prefix_create() : NULL;
+    double        start_ns;
+    double        elapsed_ns;
+
+    if (b_prefix && (NULL == p_prefix))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    start_ns = now_ns();
+    for (size_t first = 0; first < n_lines; first += batch_size)
+    {
+        size_t count = (n_lines - first < batch_size) ? n_lines - first : batch_size;
+
+        if (b_prefix)
+        {
+            calc_prefix_batch(p_prefix, &pp_inputs[first], count, CALC_INPUT_BUFFER_SIZE, &p_answers[first],
+                              &p_error_ref_nos[first]);
+        }
+        else
+        {
+            CalculateAnswerBatch(&pp_inputs[first], count, CALC_INPUT_BUFFER_SIZE, &p_answers[first],
+                                 &p_error_ref_nos[first]);
+        }
+    }
+    elapsed_ns = now_ns() - start_ns;
+
+    if (b_prefix)
+    {
+        calc_prefix_stats(p_prefix, p_stats);
+        calc_prefix_destroy(p_prefix);
+    }
+    return elapsed_ns;
+}
+
+/**
+ * @brief   Write a generated log of reworked expressions to stdout (see the file header).
+ * @param   [in] n_log_lines The number of lines.
+ * @return  None.
+ **/
+static void
+generate_log(long n_log_lines)
+{
+    char expression[EXPRESSION_SIZE];
+    char term[EXPRESSION_SIZE];
+    long line_no = 0;
+
+    while (line_no < n_log_lines)
+    {
+        size_t   length = make_term(expression);
+        size_t   head_length = 0; /* Up to the last term, with its sign. */
+        uint32_t n_variants = 2u + next_random() % 5u;
+
+        /* Terms are added while the expression keeps room for a few more characters. */
+        for (;;)
+        {
+            size_t term_length = make_term(term);
+            char   sign = "+-"[next_random() % 2u];
+
+            if (length + 1u + term_length > CALC_INCREMENTAL_MAX_LENGTH - 4u)
+            {
+                break;
+            }
+            expression[length++] = sign;
+            head_length = length;
+            memcpy(&expression[length], term, term_length + 1u);
+            length += term_length;
+        }
+        printf("%s\n", expression);
+        line_no++;
+
+        /* The same expression with its last term typed again differently. */
+        for (uint32_t variant = 0; (variant < n_variants) && (line_no < n_log_lines); variant++)
+        {
+            size_t term_length = make_term(term);
+
+            if (head_length + term_length <= CALC_INCREMENTAL_MAX_LENGTH)
+            {
+                printf("%.*s%s\n", (int)head_length, expression, term);
+                line_no++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief   Write a generated term: a number and up to two more, each after x or /.
+ * @param   [out] p_term The term, EXPRESSION_SIZE characters.
+ * @return  Its length.
+ **/
+static size_t
+make_term(char *p_term)
+{
+    uint32_t n_factors = next_random() % 3u;
+    size_t   length = append_number(p_term, 0);
+
+    for (uint32_t factor_no = 0; factor_no < n_factors; factor_no++)
+    {
+        p_term[length++] = "x/"[next_random() % 2u];
+        length = append_number(p_term, length);
+    }
+    return length;
+}
+
+/**
+ * @brief   Append a generated number: 1 to 999, 1.1 to 99.99, or 1E1 to 9E3.
+ * @param   [in,out] p_expression The expression, EXPRESSION_SIZE characters.
+ * @param   [in] length Its length so far.
+ * @return  Its new length.
+ **/
+static size_t
+append_number(char *p_expression, size_t length)
+{
+    switch (next_random() % 3u)
+    {
+        case 0:
+            length += (size_t)sprintf(&p_expression[length], "%u", 1u + next_random() % 999u);
+            break;
+        case 1:
+            length += (size_t)sprintf(&p_expression[length], "%u.%u", 1u + next_random() % 99u,
+                                      1u + next_random() % 99u);
+            break;
+        default:
+            length += (size_t)sprintf(&p_expression[length], "%uE%u", 1u + next_random() % 9u,
+                                      1u + next_random() % 3u);
+            break;
+    }
+    return length;
+}
+
+/* A linear congruential generator, so every run writes the same log. */
+static uint32_t
+next_random(void)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# ramfunc_report.sh - List the functions placed in SRAM (the .ramfunc section,
+# see ram_funcs.h) and the RAM they cost.
+#
+# Usage: tools/ramfunc_report.sh [calculator.elf]
+# Set OBJDUMP to use a toolchain other than arm-none-eabi.
+
+elf=${1:-calculator.elf}
+objdump=${OBJDUMP:-arm-none-eabi-objdump}
+
+if [ ! -f "$elf" ]; then
+    echo "usage: $0 [calculator.elf]" >&2
+    exit 1
+fi
+
+{ $objdump -t "$elf"; echo "--- sections"; $objdump -h "$elf"; } | awk '
+    function hex(s,    i, n) {
+        n = 0
+        for (i = 1; i <= length(s); i++) {
+            n = n * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1
+        }
+        return n
+    }
+    $0 == "--- sections" { in_sections = 1; next }
+    !in_sections && NF >= 5 && $(NF-2) == ".ramfunc" && $(NF-3) == "F" {
+        printf "  %-36s %6d bytes\n", $NF, hex($(NF-1))
+        total += hex($(NF-1))
+        count++
+    }
+    in_sections && $2 == ".ramfunc" {
+        section_size = hex($3)
+    }
+    END {
+        if (count == 0) {
+            print "No functions placed in SRAM"
+        } else {
+            printf "%d functions in SRAM, %d bytes of code\n", count, total
+            printf "RAM cost of .ramfunc (with alignment): %d bytes\n", section_size
+        }
+    }'
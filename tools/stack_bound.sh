@@ -0,0 +1,23 @@
+#!/bin/sh
+#
+# stack_bound.sh - Compile the firmware sources with -fstack-usage and
+# -fcallgraph-info=su and print the static worst-case stack depth from main()
+# (see tools/stack_usage.py). Run it from the top of the tree.
+#
+# Usage: tools/stack_bound.sh [stack_usage.py options, e.g. --limit 1024 --all]
+# Set CC and CFLAGS to match the real build (default arm-none-eabi-gcc, -O2).
+
+cc=${CC:-arm-none-eabi-gcc}
+cflags=${CFLAGS:--O2 -mcpu=cortex-m4 -mthumb -mfloat-abi=hard -mfpu=fpv4-sp-d16}
+sources="main.c high_level_funcs.c mid_level_funcs.c low_level_funcs_tiva.c
+         calculate_answer.c calc_stream.c calc_incremental.c answer_cache.c profile.c
+         latency_histogram.c trace.c"
+out=$(mktemp -d) || exit 1
+trap 'rm -rf "$out"' EXIT
+
+for source in $sources; do
+    $cc -std=c99 $cflags -fstack-usage -fcallgraph-info=su -c "$source" \
+        -o "$out/$(basename "$source" .c).o" || exit 1
+done
+
+python3 "$(dirname "$0")/stack_usage.py" "$@" "$out"/*.ci
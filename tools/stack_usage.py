@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+# stack_usage.py - Static worst-case stack depth from the compiler's call graph.
+#
+# Compile every source with -fstack-usage -fcallgraph-info=su, which writes a .ci
+# file (the call graph, with each function's frame size) next to each object, then:
+#
+#   tools/stack_usage.py [--root main] [--extern pow=64 ...] [--all] *.ci
+#
+# For each root it prints the deepest call chain and its total, i.e. the stack the
+# firmware can need. Functions with no frame size (library code compiled without
+# -fstack-usage) count as 0 unless given with --extern, and are listed so the bound
+# is not mistaken for a complete one. Recursion, indirect calls and dynamically
+# sized frames make the bound unknown; they are reported too. Exits with status 1
+# if the bound is not complete, or exceeds --limit.
+
+import argparse
+import re
+import sys
+
+NODE_RE = re.compile(r'node:\s*\{\s*title:\s*"([^"]*)"\s*label:\s*"([^"]*)"(.*)\}')
+EDGE_RE = re.compile(r'edge:\s*\{\s*sourcename:\s*"([^"]*)"\s*targetname:\s*"([^"]*)"')
+FRAME_RE = re.compile(r'(\d+) bytes \(([^)]*)\)')
+
+
+class Function:
+    def __init__(self, title, label):
+        parts = label.split('\\n')
+        self.title = title
+        self.name = parts[0]
+        self.location = parts[1] if len(parts) > 1 else ''
+        self.frame = None       # Bytes, or None if not compiled with -fstack-usage.
+        self.qualifier = ''     # 'static', 'dynamic', 'dynamic,bounded'
+        self.callees = []
+        for part in parts[2:]:
+            match = FRAME_RE.search(part)
+            if match:
+                self.frame = int(match.group(1))
+                self.qualifier = match.group(2)
+
+
+def read_call_graph(paths):
+    functions = {}
+    edges = set()
+    for path in paths:
+        with open(path) as ci_file:
+            for line in ci_file:
+                match = NODE_RE.search(line)
+                if match:
+                    function = Function(match.group(1), match.group(2))
+                    known = functions.get(function.title)
+                    # A function defined in one file is an external declaration in the others.
+                    if known is None or (known.frame is None and function.frame is not None):
+                        functions[function.title] = function
+                    continue
+                match = EDGE_RE.search(line)
+                if match:
+                    edges.add((match.group(1), match.group(2)))
+    for source, target in sorted(edges):
+        if source in functions and target not in functions[source].callees:
+            functions[source].callees.append(target)
+    return functions
+
+
+def worst_case(functions, root, extern_frames):
+    """Return (bytes, chain, problems) for the deepest call chain from root."""
+    memo = {}
+    problems = set()
+    on_path = []
+
+    def visit(title):
+        if title in on_path:
+            problems.add('recursion: ' + ' -> '.join(on_path[on_path.index(title):] + [title]))
+            return 0, []
+        if title in memo:
+            return memo[title]
+        function = functions.get(title)
+        if function is None:
+            return 0, [title]
+        if function.frame is not None:
+            frame = function.frame
+            if function.qualifier.startswith('dynamic') and function.qualifier != 'dynamic,bounded':
+                problems.add('unbounded dynamic frame: ' + function.name)
+        elif function.name in extern_frames:
+            frame = extern_frames[function.name]
+        else:
+            frame = 0
+            problems.add('no frame size (counted as 0): ' + function.name)
+        if function.name == '__indirect_call':
+            problems.add('indirect call (not followed)')
+
+        on_path.append(title)
+        deepest, chain = 0, []
+        for callee in function.callees:
+            depth, callee_chain = visit(callee)
+            if depth > deepest or not chain:
+                deepest, chain = depth, callee_chain
+        on_path.pop()
+
+        memo[title] = (frame + deepest, [title] + chain)
+        return memo[title]
+
+    total, chain = visit(root)
+    return total, chain, sorted(problems)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Worst-case stack depth from -fcallgraph-info=su output.')
+    parser.add_argument('ci_files', nargs='+', help='.ci files written by -fcallgraph-info=su')
+    parser.add_argument('--root', action='append', help='Entry point (default: main); repeat for ISRs')
+    parser.add_argument('--extern', action='append', default=[], metavar='NAME=BYTES',
+                        help='Frame size for a function compiled without -fstack-usage')
+    parser.add_argument('--limit', type=int, help='Fail if any root needs more than this many bytes')
+    parser.add_argument('--all', action='store_true', help='Also list every function, deepest first')
+    args = parser.parse_args()
+
+    extern_frames = {}
+    for item in args.extern:
+        name, _, size = item.partition('=')
+        extern_frames[name] = int(size)
+
+    functions = read_call_graph(args.ci_files)
+    roots = args.root or ['main']
+    status = 0
+
+    for root in roots:
+        if root not in functions:
+            print('%s: not found in the call graph' % root)
+            status = 1
+            continue
+        total, chain, problems = worst_case(functions, root, extern_frames)
+        print('Worst-case stack from %s: %d bytes' % (root, total))
+        for title in chain:
+            function = functions.get(title)
+            if function is None:
+                print('  %8s  %s' % ('?', title))
+            elif function.frame is None:
+                print('  %8s  %s' % (extern_frames.get(function.name, '?'), function.name))
+            else:
+                print('  %8d  %-40s %s' % (function.frame, function.name, function.location))
+        for problem in problems:
+            print('  warning: ' + problem)
+        if problems or (args.limit is not None and total > args.limit):
+            status = 1
+
+    if args.all:
+        print('\nEvery function (own frame, deepest chain below it):')
+        rows = []
+        for title, function in functions.items():
+            if function.frame is not None:
+                rows.append((worst_case(functions, title, extern_frames)[0], function.frame, function.name))
+        for total, frame, name in sorted(rows, reverse=True):
+            print('  %8d %8d  %s' % (total, frame, name))
+
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,296 @@
+/**
+ * $File: stream_check.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      stream_check.c
+ *
+ *  @brief     Host tool: check the push evaluator (calc_stream.c) against the engine, and
+ *             time it on a long expression.
+ *
+ *             Usage: stream_check [-n random expressions] [-t long terms] [file]
+ *               -n  Random strings of the engine's characters to check (default 1000000).
+ *               -t  Terms of the long expression (default 1000000).
+ *
+ *             Each expression (each line of the file, if one is given, then the random
+ *             ones) is fed in chunks of random sizes and its answer and error number
+ *             compared with CalculateAnswerSpan()'s, bit for bit. Expressions the engine
+ *             rejects as too long (error 1) are skipped. Then a generated sum of products
+ *             is fed 4 KB at a time and compared with calc_long_evaluate() in its
+ *             sequential order, and the time per byte is printed.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_long.h"
+#include "../calc_stream.h"
+#include "../calculate_answer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define MAX_LINE_LENGTH   256
+#define MAX_RANDOM_LENGTH 40   /* Longest random expression. */
+#define MAX_TERM_LENGTH   32   /* Longest generated term of the long expression, with its sign. */
+#define LONG_CHUNK_SIZE   4096 /* Bytes fed at a time, as from a file. */
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static bool     check(const char *p_expression, size_t length);
+static size_t   generate(char *p_expression, size_t n_terms);
+static uint32_t next_random(void);
+static double   now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static uint32_t random_state = 12345u;
+static size_t   n_checked;
+static size_t   n_skipped;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check the file's expressions, the random ones and the long one.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 on an error or a mismatch.
+ **/
+int
+main(int argc, char *argv[])
+{
+    static const char characters[] = "0123456789.+-x/E";
+    CalcStream_t      stream;
+    long              n_random = 1000000;
+    long              n_terms = 1000000;
+    int               option;
+    char             *p_long;
+    size_t            long_length;
+    uint8_t           stream_error;
+    uint8_t           long_error;
+    double            stream_answer;
+    double            long_answer;
+    double            start_ns;
+    double            elapsed_ns;
+
+    while (-1 != (option = getopt(argc, argv, "n:t:")))
+    {
+        switch (option)
+        {
+            case 'n':
+                n_random = atol(optarg);
+                break;
+            case 't':
+                n_terms = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n random expressions] [-t long terms] [file]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((n_random < 0) || (n_terms < 1))
+    {
+        fprintf(stderr, "usage: %s [-n random expressions] [-t long terms] [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (optind < argc)
+    {
+        FILE *p_file = fopen(argv[optind], "r");
+        char  line[MAX_LINE_LENGTH];
+
+        if (NULL == p_file)
+        {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+        while (NULL != fgets(line, sizeof(line), p_file))
+        {
+            if (!check(line, strcspn(line, "\r\n")))
+            {
+                fclose(p_file);
+                return EXIT_FAILURE;
+            }
+        }
+        fclose(p_file);
+    }
+
+    /* Mostly the engine's characters, so most strings get past the character checks. */
+    for (long expression_no = 0; expression_no < n_random; expression_no++)
+    {
+        char   expression[MAX_RANDOM_LENGTH];
+        size_t length = next_random() % (MAX_RANDOM_LENGTH + 1u);
+
+        for (size_t index = 0; index < length; index++)
+        {
+            uint32_t choice = next_random() % 64u;
+
+            expression[index] = (choice < 40u) ? characters[choice % 10u]
+                                : (choice < 63u) ? characters[10u + choice % 6u] : ' ';
+        }
+        if (!check(expression, length))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    printf("expressions   %zu checked, %zu skipped (error 1)\n", n_checked, n_skipped);
+
+    p_long = malloc((size_t)n_terms * MAX_TERM_LENGTH);
+    if (NULL == p_long)
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    long_length = generate(p_long, (size_t)n_terms);
+
+    start_ns = now_ns();
+    calc_stream_init(&stream);
+    for (size_t offset = 0; offset < long_length; offset += LONG_CHUNK_SIZE)
+    {
+        calc_stream_feed(&stream, &p_long[offset],
+                         (long_length - offset < LONG_CHUNK_SIZE) ? long_length - offset : LONG_CHUNK_SIZE);
+    }
+    stream_answer = calc_stream_finish(&stream, &stream_error);
+    elapsed_ns = now_ns() - start_ns;
+
+    long_answer = calc_long_evaluate(p_long, long_length, 1, CALC_LONG_SEQUENTIAL, &long_error, NULL);
+    if ((stream_error != long_error) || (0 != memcmp(&stream_answer, &long_answer, sizeof(double))))
+    {
+        fprintf(stderr, "long expression: %.17g (error %u), calc_long_evaluate() gives %.17g (error %u)\n",
+                stream_answer, stream_error, long_answer, long_error);
+        return EXIT_FAILURE;
+    }
+    printf("long          %ld terms, %zu bytes, %.2f ns/byte, %zu bytes of state\n", n_terms, long_length,
+           elapsed_ns / (double)long_length, sizeof(CalcStream_t));
+
+    free(p_long);
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Feed an expression in random chunks and compare it with CalculateAnswerSpan().
+ * @param   [in] p_expression The characters.
+ * @param   [in] length Their number.
+ * @return  true if the answers and error numbers match (or the engine gives error 1).
+ **/
+static bool
+check(const char *p_expression, size_t length)
+{
+    CalcStream_t stream;
+    uint8_t      expected_error;
+    uint8_t      error_ref_no;
+    double       expected = CalculateAnswerSpan(p_expression, length, &expected_error);
+    double       answer;
+    size_t       offset = 0;
+
+    if (1u == expected_error)
+    {
+        n_skipped++;
+        return true;
+    }
+
+    calc_stream_init(&stream);
+    while (offset < length)
+    {
+        size_t chunk = 1u + next_random() % 8u;
+
+        chunk = (chunk > length - offset) ? length - offset : chunk;
+        calc_stream_feed(&stream, &p_expression[offset], chunk);
+        offset += chunk;
+    }
+    answer = calc_stream_finish(&stream, &error_ref_no);
+
+    n_checked++;
+    if ((error_ref_no != expected_error) || (0 != memcmp(&answer, &expected, sizeof(double))))
+    {
+        fprintf(stderr, "\"%.*s\": %.17g (error %u), CalculateAnswerSpan() gives %.17g (error %u)\n", (int)length,
+                p_expression, answer, error_ref_no, expected, expected_error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   Write a sum of products with a given number of terms, as long_scaling.c does.
+ * @param   [out] p_expression Room for n_terms * MAX_TERM_LENGTH characters.
+ * @param   [in] n_terms The number of terms.
+ * @return  The length (there is no null).
+ **/
+static size_t
+generate(char *p_expression, size_t n_terms)
+{
+    static const char operators[] = {'x', 'x', '/', 'E'};
+    size_t            length = 0;
+
+    for (size_t term_no = 0; term_no < n_terms; term_no++)
+    {
+        unsigned n_numbers = 1u + next_random() % 4u;
+        char     previous = '\0';
+
+        if (0u != term_no)
+        {
+            p_expression[length++] = (0u == next_random() % 4u) ? '-' : '+';
+        }
+        for (unsigned number_no = 0; number_no < n_numbers; number_no++)
+        {
+            if (0u != number_no)
+            {
+                previous = operators[next_random() % (('E' == previous) ? 3u : 4u)];
+                p_expression[length++] = previous;
+            }
+            if ('E' == previous)
+            {
+                length += (size_t)sprintf(&p_expression[length], "%u", next_random() % 6u);
+            }
+            else
+            {
+                length += (size_t)sprintf(&p_expression[length], "%u.%02u", 1u + next_random() % 999u,
+                                          next_random() % 100u);
+            }
+        }
+    }
+
+    return length;
+}
+
+/* A linear congruential generator, so every run sees the same expressions. */
+static uint32_t
+next_random(void)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
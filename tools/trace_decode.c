@@ -0,0 +1,274 @@
+/**
+ * $File: trace_decode.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      trace_decode.c
+ *
+ *  @brief     Host tool: decode a dump of trace_buffer (see trace.h) into a timeline.
+ *
+ *             The dump is either a raw copy of trace_buffer from the target's RAM, e.g.
+ *               (gdb) dump binary value trace.bin trace_buffer
+ *             or the file written by the host build when CALC_HOST_TRACE is set.
+ *
+ *             Usage: trace_decode [-s] trace.bin
+ *               -s  Print only the summaries, not every event.
+ *
+ *             After the timeline it prints, for each calculation, where the time went from
+ *             the equals key to the end of the flash write, and the total time spent after
+ *             each kind of event (up to the next event).
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+/* Times of the steps of one calculation, in microseconds from the first event. */
+typedef struct
+{
+    double equals_key;
+    double calc_start;
+    double calc_end;
+    double flash_erase_start;
+    double flash_erase_end;
+    double flash_program_start;
+    int    error_ref_no;
+    bool   b_started;
+} Calculation_t;
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static void print_event(const TraceEvent_t *p_event, double time_us, double delta_us);
+static void print_calculation(int number, const Calculation_t *p_calc, double end_us);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const char *const event_names[TRACE_EVENT_COUNT] = {
+    "none",        "key",           "lcd",           "calc start",        "calc end",
+    "flash erase", "flash erased",  "flash program", "flash programmed", "preview",
+    "previewed",
+};
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Decode a trace dump.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success.
+ **/
+int
+main(int argc, char *argv[])
+{
+    static TraceBuffer_t trace;
+    bool                 b_summary_only = false;
+    const char          *p_path = NULL;
+    FILE                *p_file;
+    uint32_t             first;
+    uint64_t             elapsed_cycles = 0;
+    double               time_in_state_us[TRACE_EVENT_COUNT] = {0};
+    uint32_t             n_events_of_type[TRACE_EVENT_COUNT] = {0};
+    Calculation_t        calc = {0};
+    int                  n_calculations = 0;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (0 == strcmp(argv[arg], "-s"))
+        {
+            b_summary_only = true;
+        }
+        else
+        {
+            p_path = argv[arg];
+        }
+    }
+    if (NULL == p_path)
+    {
+        fprintf(stderr, "usage: %s [-s] trace.bin\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    p_file = fopen(p_path, "rb");
+    if ((NULL == p_file) || (1 != fread(&trace, sizeof(trace), 1, p_file)))
+    {
+        fprintf(stderr, "%s: cannot read a %zu-byte trace buffer\n", p_path, sizeof(trace));
+        return EXIT_FAILURE;
+    }
+    fclose(p_file);
+
+    if ((TRACE_MAGIC != trace.magic) || (TRACE_BUFFER_EVENTS != trace.capacity) || (0u == trace.cycles_per_microsec))
+    {
+        fprintf(stderr, "%s: not a trace buffer with %d events\n", p_path, TRACE_BUFFER_EVENTS);
+        return EXIT_FAILURE;
+    }
+
+    first = (trace.n_written > trace.capacity) ? trace.n_written - trace.capacity : 0;
+    printf("%lu events recorded, last %lu kept\n", (unsigned long)trace.n_written,
+           (unsigned long)(trace.n_written - first));
+    if (!b_summary_only)
+    {
+        printf("%12s %10s  event\n", "time (us)", "+delta");
+    }
+
+    for (uint32_t n = first; n < trace.n_written; n++)
+    {
+        const TraceEvent_t *p_event = &trace.events[n % trace.capacity];
+        const TraceEvent_t *p_previous = &trace.events[(n - 1) % trace.capacity];
+        uint32_t            delta_cycles = (n == first) ? 0 : p_event->timestamp - p_previous->timestamp;
+        double              delta_us = (double)delta_cycles / trace.cycles_per_microsec;
+        double              time_us;
+
+        elapsed_cycles += delta_cycles;
+        time_us = (double)elapsed_cycles / trace.cycles_per_microsec;
+
+        if (p_event->type >= TRACE_EVENT_COUNT)
+        {
+            continue;
+        }
+        if (n != first)
+        {
+            time_in_state_us[p_previous->type] += delta_us;
+        }
+        n_events_of_type[p_event->type]++;
+
+        if (!b_summary_only)
+        {
+            print_event(p_event, time_us, delta_us);
+        }
+
+        switch (p_event->type)
+        {
+            case TRACE_EVENT_KEY_SCANNED:
+                if ('*' == p_event->arg8)
+                {
+                    memset(&calc, 0, sizeof(calc));
+                    calc.equals_key = time_us;
+                    calc.b_started = true;
+                }
+                break;
+            case TRACE_EVENT_CALC_START:
+                calc.calc_start = time_us;
+                break;
+            case TRACE_EVENT_CALC_END:
+                calc.calc_end = time_us;
+                calc.error_ref_no = p_event->arg8;
+                break;
+            case TRACE_EVENT_FLASH_ERASE_START:
+                calc.flash_erase_start = time_us;
+                break;
+            case TRACE_EVENT_FLASH_ERASE_END:
+                calc.flash_erase_end = time_us;
+                break;
+            case TRACE_EVENT_FLASH_PROGRAM_START:
+                calc.flash_program_start = time_us;
+                break;
+            case TRACE_EVENT_FLASH_PROGRAM_END:
+                if (calc.b_started)
+                {
+                    print_calculation(++n_calculations, &calc, time_us);
+                    calc.b_started = false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    printf("\nTime after each kind of event, up to the next event:\n");
+    printf("  %-18s %8s %14s\n", "event", "count", "time (us)");
+    for (int type = 1; type < TRACE_EVENT_COUNT; type++)
+    {
+        printf("  %-18s %8lu %14.1f\n", event_names[type], (unsigned long)n_events_of_type[type],
+               time_in_state_us[type]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Print one event of the timeline.
+ * @param   [in] p_event The event.
+ * @param   [in] time_us Time since the first event kept.
+ * @param   [in] delta_us Time since the previous event.
+ * @return  None.
+ **/
+static void
+print_event(const TraceEvent_t *p_event, double time_us, double delta_us)
+{
+    printf("%12.1f %+10.1f  %-16s", time_us, delta_us, event_names[p_event->type]);
+
+    switch (p_event->type)
+    {
+        case TRACE_EVENT_KEY_SCANNED:
+            printf(" '%c'", p_event->arg8);
+            break;
+        case TRACE_EVENT_LCD_BYTE:
+            if (p_event->arg16)
+            {
+                printf(" data '%c'", (p_event->arg8 >= 0x20 && p_event->arg8 < 0x7F) ? p_event->arg8 : '?');
+            }
+            else
+            {
+                printf(" instruction 0x%02X", p_event->arg8);
+            }
+            break;
+        case TRACE_EVENT_CALC_START:
+            printf(" %u chars", p_event->arg16);
+            break;
+        case TRACE_EVENT_CALC_END:
+            printf(" error %u", p_event->arg8);
+            break;
+        case TRACE_EVENT_FLASH_PROGRAM_START:
+            printf(" %u bytes", p_event->arg16);
+            break;
+        case TRACE_EVENT_PREVIEW_START:
+            printf(" %u chars", p_event->arg16);
+            break;
+        default:
+            break;
+    }
+    printf("\n");
+}
+
+/**
+ * @brief   Print where the time went for one calculation.
+ * @param   [in] number The calculation's number in the trace.
+ * @param   [in] p_calc Times of its steps.
+ * @param   [in] end_us Time the flash write finished.
+ * @return  None.
+ **/
+static void
+print_calculation(int number, const Calculation_t *p_calc, double end_us)
+{
+    printf("calculation %d (error %d): equals->calc %.1f us, calc %.1f us, display %.1f us, "
+           "flash erase %.1f us, flash program %.1f us, total %.1f us\n",
+           number, p_calc->error_ref_no, p_calc->calc_start - p_calc->equals_key,
+           p_calc->calc_end - p_calc->calc_start, p_calc->flash_erase_start - p_calc->calc_end,
+           p_calc->flash_erase_end - p_calc->flash_erase_start, end_us - p_calc->flash_program_start,
+           end_us - p_calc->equals_key);
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,313 @@
+/**
+ * $File: validate_bench.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      validate_bench.c
+ *
+ *  @brief     Host tool: check the kernels of calc_validate.c against
+ *             CheckExpressionSyntax(), then measure how fast each one checks.
+ *
+ *             Usage: validate_bench [-n random strings] [-t seconds per measurement]
+ *               -n  Random strings checked with each kernel (default 1000000).
+ *               -t  Time spent on each size and kernel (default 0.2).
+ *
+ *             The random strings are 0 to 200 bytes long, mostly of the engine's
+ *             characters (with runs of operators, dots and E), sometimes any byte, and
+ *             some are long generated sums of products with one byte changed. Every
+ *             kernel the CPU has must give each one the error number
+ *             CheckExpressionSyntax() gives, or the tool fails. The speeds are then
+ *             measured on valid sums of products of 16 bytes to 1 MB, and go to stdout
+ *             as CSV: bytes, kernel, ns per call, GB/s and the speed-up over the scalar
+ *             checks.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "../calc_validate.h"
+#include "../calculate_answer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#define MAX_RANDOM_LENGTH 200
+#define LONG_LENGTH       5000    /* Bytes of each long generated string that is checked. */
+#define MAX_LENGTH        1048576 /* The longest string measured. */
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+static size_t   random_string(char *p_text);
+static size_t   generate(char *p_text, size_t length);
+static bool     check(const char *p_text, size_t length);
+static double   measure(CalcValidateKernel_t kernel, const char *p_text, size_t length, double seconds);
+static uint32_t next_random(void);
+static double   now_ns(void);
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+static const size_t measured_lengths[] = {16, 64, 256, 4096, MAX_LENGTH};
+
+static uint32_t random_state = 12345u;
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Check every kernel, then measure each one.
+ * @param   argc, argv See the usage in the file header.
+ * @return  0 on success, 1 on an error or if a kernel disagrees with the scalar checks.
+ **/
+int
+main(int argc, char *argv[])
+{
+    long   n_strings = 1000000;
+    double seconds = 0.2;
+    int    option;
+    char  *p_text;
+
+    while (-1 != (option = getopt(argc, argv, "n:t:")))
+    {
+        switch (option)
+        {
+            case 'n':
+                n_strings = atol(optarg);
+                break;
+            case 't':
+                seconds = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n random strings] [-t seconds per measurement]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    p_text = malloc(MAX_LENGTH);
+    if (NULL == p_text)
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    for (long string_no = 0; string_no < n_strings; string_no++)
+    {
+        size_t length;
+
+        if (0 == string_no % 1000)
+        {
+            /* A long valid string, with a byte changed somewhere (or not). */
+            length = generate(p_text, LONG_LENGTH);
+            if (0u != next_random() % 4u)
+            {
+                p_text[next_random() % length] = "+-x/E.0a"[next_random() % 8u];
+            }
+        }
+        else
+        {
+            length = random_string(p_text);
+        }
+        if (!check(p_text, length))
+        {
+            free(p_text);
+            return EXIT_FAILURE;
+        }
+    }
+    fprintf(stderr, "%ld strings: every kernel agrees with CheckExpressionSyntax()\n", n_strings);
+
+    printf("bytes,kernel,ns_per_call,gb_per_s,speedup\n");
+    for (size_t size_no = 0; size_no < sizeof(measured_lengths) / sizeof(measured_lengths[0]); size_no++)
+    {
+        size_t length = generate(p_text, measured_lengths[size_no]);
+        double scalar_ns = 0.0;
+
+        for (int kernel = CALC_VALIDATE_SCALAR; kernel < CALC_VALIDATE_KERNEL_COUNT; kernel++)
+        {
+            double ns;
+
+            if (!calc_validate_kernel_supported((CalcValidateKernel_t)kernel))
+            {
+                continue;
+            }
+            ns = measure((CalcValidateKernel_t)kernel, p_text, length, seconds);
+            if (CALC_VALIDATE_SCALAR == kernel)
+            {
+                scalar_ns = ns;
+            }
+            printf("%zu,%s,%.1f,%.2f,%.2f\n", length, calc_validate_kernel_name((CalcValidateKernel_t)kernel), ns,
+                   (double)length / ns, scalar_ns / ns);
+            fflush(stdout);
+        }
+    }
+
+    free(p_text);
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Write a random string, mostly of the engine's characters.
+ * @param   [out] p_text Room for MAX_RANDOM_LENGTH characters.
+ * @return  The length (there is no null).
+ **/
+static size_t
+random_string(char *p_text)
+{
+    static const char alphabet[] = "0123456789012345678901234567890123456789+-x/E.+-x/E.--E";
+    size_t            length = next_random() % (MAX_RANDOM_LENGTH + 1u);
+    bool              b_any_byte = (0u == next_random() % 16u);
+
+    for (size_t index = 0; index < length; index++)
+    {
+        if (b_any_byte && (0u == next_random() % 32u))
+        {
+            p_text[index] = (char)(next_random() & 0xFFu);
+        }
+        else
+        {
+            p_text[index] = alphabet[next_random() % (sizeof(alphabet) - 1u)];
+        }
+    }
+
+    return length;
+}
+
+/**
+ * @brief   Write a valid sum of products of about a given length.
+ * @param   [out] p_text Room for length characters.
+ * @param   [in] length The most characters.
+ * @return  The length written (within a term of the one asked for; there is no null).
+ **/
+static size_t
+generate(char *p_text, size_t length)
+{
+    static const char *const terms[] = {"12.5", "3x4", "7/2.25", "1.5E3", "2E-1x8", "9x-3", "0.75/5"};
+    size_t                   written = 0;
+
+    for (;;)
+    {
+        const char *p_term = terms[next_random() % (sizeof(terms) / sizeof(terms[0]))];
+        size_t      term_length = strlen(p_term);
+
+        if (written + 1u + term_length > length)
+        {
+            break;
+        }
+        if (0u != written)
+        {
+            p_text[written++] = (0u == next_random() % 4u) ? '-' : '+';
+        }
+        memcpy(&p_text[written], p_term, term_length);
+        written += term_length;
+    }
+
+    return written;
+}
+
+/**
+ * @brief   Check a string with every kernel the CPU has against CheckExpressionSyntax().
+ * @param   [in] p_text The string.
+ * @param   [in] length Its length.
+ * @return  true if they all agree.
+ **/
+static bool
+check(const char *p_text, size_t length)
+{
+    uint8_t expected;
+
+    CheckExpressionSyntax(p_text, length, &expected);
+    for (int kernel = CALC_VALIDATE_SWAR; kernel < CALC_VALIDATE_KERNEL_COUNT; kernel++)
+    {
+        uint8_t error_ref_no = 0xFFu;
+
+        if (!calc_validate_kernel_supported((CalcValidateKernel_t)kernel))
+        {
+            continue;
+        }
+        calc_validate_with((CalcValidateKernel_t)kernel, p_text, length, &error_ref_no);
+        if (error_ref_no != expected)
+        {
+            fprintf(stderr, "%s gives error %u, the engine %u, for \"%.*s\"\n",
+                    calc_validate_kernel_name((CalcValidateKernel_t)kernel), error_ref_no, expected, (int)length,
+                    p_text);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Time a kernel on one string.
+ * @param   [in] kernel The kernel.
+ * @param   [in] p_text The string.
+ * @param   [in] length Its length.
+ * @param   [in] seconds How long to keep calling it.
+ * @return  The mean nanoseconds per call.
+ **/
+static double
+measure(CalcValidateKernel_t kernel, const char *p_text, size_t length, double seconds)
+{
+    double   start_ns = now_ns();
+    double   elapsed_ns;
+    uint64_t n_calls = 0;
+    unsigned n_errors = 0;
+
+    do
+    {
+        for (unsigned call_no = 0; call_no < 64u; call_no++)
+        {
+            uint8_t error_ref_no;
+
+            calc_validate_with(kernel, p_text, length, &error_ref_no);
+            n_errors += error_ref_no;
+        }
+        n_calls += 64u;
+        elapsed_ns = now_ns() - start_ns;
+    } while (elapsed_ns < seconds * 1e9);
+
+    if (0u != n_errors)
+    {
+        fprintf(stderr, "%s found an error in a valid string\n", calc_validate_kernel_name(kernel));
+    }
+    return elapsed_ns / (double)n_calls;
+}
+
+/* A linear congruential generator, so every run sees the same strings. */
+static uint32_t
+next_random(void)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+/**
+ * @brief   Read the monotonic clock.
+ * @param   None.
+ * @return  The time in nanoseconds.
+ **/
+static double
+now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,87 @@
+/**
+ * $File: trace.c
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      trace.c
+ *
+ *  @brief     Binary event trace ring buffer. See trace.h.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include "trace.h"
+#include "low_level_funcs_tiva.h"
+/**********************************************************************************************
+ * Referenced external functions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Referenced external variables
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Global variable definitions
+ **********************************************************************************************/
+TraceBuffer_t trace_buffer = {
+    TRACE_MAGIC,
+    50, /* Timestamps are system clock cycles at 50 MHz. */
+    TRACE_BUFFER_EVENTS,
+    0,
+    {{0, TRACE_EVENT_NONE, 0, 0}},
+};
+
+/**********************************************************************************************
+ * Private constant definitions
+ **********************************************************************************************/
+#if (TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) != 0
+#error "TRACE_BUFFER_EVENTS must be a power of two"
+#endif
+
+/**********************************************************************************************
+ * Private type definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private function declarations
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Private variable definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * Public function definitions
+ **********************************************************************************************/
+
+/**
+ * @brief   Record one event, overwriting the oldest once the buffer is full.
+ * Use the TRACE() macro so that trace points can be compiled out.
+ * @param   [in] type The event type.
+ * @param   [in] arg8 First argument (see TraceEventType_t).
+ * @param   [in] arg16 Second argument (see TraceEventType_t).
+ * @return  None.
+ **/
+void
+trace_event(TraceEventType_t type, uint8_t arg8, uint16_t arg16)
+{
+    TraceEvent_t *p_event = &trace_buffer.events[trace_buffer.n_written & (TRACE_BUFFER_EVENTS - 1)];
+
+    p_event->timestamp = read_cycle_count();
+    p_event->type = (uint8_t)type;
+    p_event->arg8 = arg8;
+    p_event->arg16 = arg16;
+    trace_buffer.n_written++;
+}
+
+/**********************************************************************************************
+ * Private function definitions
+ **********************************************************************************************/
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/
@@ -0,0 +1,100 @@
+/**
+ * $File: trace.h
+ *
+ *  *******************************************************************************************
+ *
+ *  @file      trace.h
+ *
+ *  @brief     Binary event trace: a fixed-size ring buffer of timestamped 8-byte events in
+ *             RAM, cheap enough to leave enabled in release builds.
+ *
+ *             trace_buffer is laid out so that a raw dump of it (from the debugger, or
+ *             written by the host build) can be decoded by tools/trace_decode.c.
+ *  *******************************************************************************************
+ *
+ *  $NoKeywords
+ **/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************************************************************************************
+ * Module includes
+ **********************************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************************************************************
+ * Public constant definitions
+ **********************************************************************************************/
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1 //!< Set to 0 to compile the trace points out.
+#endif
+
+#define TRACE_BUFFER_EVENTS 256        //!< Ring size; must be a power of two.
+#define TRACE_MAGIC         0x45435254 //!< "TRCE" in a little-endian dump.
+
+#if TRACE_ENABLE
+#define TRACE(type, arg8, arg16) trace_event((type), (uint8_t)(arg8), (uint16_t)(arg16))
+#else
+#define TRACE(type, arg8, arg16) do { } while (0)
+#endif
+
+/**********************************************************************************************
+ * Public type definitions
+ **********************************************************************************************/
+/* Event types. The meaning of arg8 and arg16 is given for each. */
+typedef enum
+{
+    TRACE_EVENT_NONE,
+    TRACE_EVENT_KEY_SCANNED,         /* arg8: key character. */
+    TRACE_EVENT_LCD_BYTE,            /* arg8: byte; arg16: 0 instruction, 1 data. */
+    TRACE_EVENT_CALC_START,          /* arg16: input length. */
+    TRACE_EVENT_CALC_END,            /* arg8: error reference number. */
+    TRACE_EVENT_FLASH_ERASE_START,
+    TRACE_EVENT_FLASH_ERASE_END,
+    TRACE_EVENT_FLASH_PROGRAM_START, /* arg16: bytes to program. */
+    TRACE_EVENT_FLASH_PROGRAM_END,
+    TRACE_EVENT_PREVIEW_START,       /* arg16: characters to draw on line 2. */
+    TRACE_EVENT_PREVIEW_END,
+    TRACE_EVENT_COUNT
+} TraceEventType_t;
+
+/* One event: 8 bytes. */
+typedef struct
+{
+    uint32_t timestamp; /* read_cycle_count() when the event was recorded. */
+    uint8_t  type;      /* TraceEventType_t */
+    uint8_t  arg8;
+    uint16_t arg16;
+} TraceEvent_t;
+
+/* The ring buffer, header first. */
+typedef struct
+{
+    uint32_t     magic;               /* TRACE_MAGIC */
+    uint32_t     cycles_per_microsec; /* Timestamp rate. */
+    uint32_t     capacity;            /* TRACE_BUFFER_EVENTS */
+    uint32_t     n_written;           /* Events written since start-up; the next goes at n_written % capacity. */
+    TraceEvent_t events[TRACE_BUFFER_EVENTS];
+} TraceBuffer_t;
+
+/**********************************************************************************************
+ * Public function declarations
+ **********************************************************************************************/
+void trace_event(TraceEventType_t type, uint8_t arg8, uint16_t arg16);
+
+/**********************************************************************************************
+ * Global variable declarations
+ **********************************************************************************************/
+extern TraceBuffer_t trace_buffer;
+
+#ifdef __cplusplus
+}
+#endif
+
+/**********************************************************************************************
+ * End of file
+ **********************************************************************************************/